@@ -14,6 +14,7 @@ find_package(cppcodec REQUIRED)
 find_package(jwt-cpp REQUIRED)
 find_package(picojson REQUIRED)
 find_package(RapidJSON CONFIG REQUIRED)
+find_package(ZLIB REQUIRED)
 
 # Tightly-coupled dependencies
 set(FETCHCONTENT_QUIET OFF)
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <faabric/proto/faabric.pb.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace codegen {
+
+enum class CodegenStatus
+{
+    Generated,
+    Skipped,
+    Failed,
+};
+
+struct CodegenResult
+{
+    std::string name;
+    CodegenStatus status = CodegenStatus::Failed;
+    double timeMs = 0;
+    std::string error;
+};
+
+/*
+ * Runs codegen for a batch of functions or shared objects across a pool of
+ * worker threads, which take items from a shared queue. Items whose machine
+ * code is up to date are skipped (unless cleaning), and a failure in one item
+ * does not stop the others. Results are returned in the order of the inputs.
+ */
+class BatchCodegen
+{
+  public:
+    // Uses as many threads as usable cores if not specified
+    BatchCodegen(int nThreadsIn = 0);
+
+    std::vector<CodegenResult> codegenForFunctions(
+      const std::vector<faabric::Message>& msgs,
+      bool clean = false);
+
+    std::vector<CodegenResult> codegenForSharedObjects(
+      const std::vector<std::string>& inputPaths,
+      bool clean = false);
+
+    int getThreadCount() const { return nThreads; }
+
+  private:
+    int nThreads;
+
+    std::vector<CodegenResult> runBatch(
+      const std::vector<std::string>& names,
+      const std::function<bool(size_t)>& codegenItem);
+};
+
+// Finds the shared objects (.so or .wasm files) under the given directory
+std::vector<std::string> getSharedObjectPaths(const std::string& dirPath);
+
+// Logs the status and time of each item, and a summary of the batch. Returns
+// the number of failed items
+int logCodegenResults(const std::vector<CodegenResult>& results);
+}
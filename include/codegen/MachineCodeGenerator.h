@@ -14,9 +14,12 @@ class MachineCodeGenerator
 
     MachineCodeGenerator(storage::FileLoader& loaderIn);
 
-    void codegenForFunction(faabric::Message& msg, bool clean = false);
+    // Generates the generic machine code, and the machine code specialised
+    // for each of the configured ISAs. Returns false if all the machine code
+    // was up to date, so codegen was skipped
+    bool codegenForFunction(faabric::Message& msg, bool clean = false);
 
-    void codegenForSharedObject(const std::string& inputPath,
+    bool codegenForSharedObject(const std::string& inputPath,
                                 bool clean = false);
 
   private:
@@ -25,7 +28,14 @@ class MachineCodeGenerator
 
     std::vector<uint8_t> hashBytes(const std::vector<uint8_t>& bytes);
 
-    std::vector<uint8_t> doCodegen(std::vector<uint8_t>& bytes);
+    std::vector<uint8_t> doCodegen(std::vector<uint8_t>& bytes,
+                                   const std::string& isa = "");
+
+    bool codegenForFunctionIsa(faabric::Message& msg,
+                               std::vector<uint8_t>& bytes,
+                               const std::vector<uint8_t>& newHash,
+                               const std::string& isa,
+                               bool clean);
 };
 
 MachineCodeGenerator& getMachineCodeGenerator();
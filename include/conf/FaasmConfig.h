@@ -17,12 +17,19 @@ class FaasmConfig
 
     int chainedCallTimeout;
 
+    int warmPoolSize;
+    int warmPoolMinFreeMb;
+
     std::string wasmVm;
+    std::string codegenIsas;
+    std::string wamrTiered;
+    std::string deltaMigration;
 
     std::string functionDir;
     std::string objectFileDir;
     std::string runtimeFilesDir;
     std::string sharedFilesDir;
+    int localCacheMaxMb;
 
     std::string s3Bucket;
     std::string s3Host;
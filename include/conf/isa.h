@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#define ISA_AVX2 "avx2"
+#define ISA_AVX512 "avx512"
+
+namespace conf {
+
+// Instruction set levels we can specialise machine code for, best first
+std::vector<std::string> getKnownCodegenIsas();
+
+bool hostSupportsIsa(const std::string& isa);
+
+// The LLVM target CPU to generate code for the given ISA
+std::string getIsaTargetCpu(const std::string& isa);
+
+// The ISAs configured for codegen (in CODEGEN_ISAS), best first
+std::vector<std::string> getCodegenIsas();
+
+// The ISAs configured for codegen that this host supports, best first
+std::vector<std::string> getHostCodegenIsas();
+}
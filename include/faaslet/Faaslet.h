@@ -1,6 +1,7 @@
 #pragma once
 
 #include <faabric/executor/ExecutorFactory.h>
+#include <faaslet/FaasletPool.h>
 #include <system/NetworkNamespace.h>
 #include <wasm/WasmModule.h>
 
@@ -42,13 +43,20 @@ class Faaslet final : public faabric::executor::Executor
 class FaasletFactory final : public faabric::executor::ExecutorFactory
 {
   public:
+    FaasletFactory();
+
     ~FaasletFactory();
 
     void flushHost() override;
 
+    FaasletPool& getWarmPool();
+
   protected:
     std::shared_ptr<faabric::executor::Executor> createExecutor(
       faabric::Message& msg) override;
+
+  private:
+    FaasletPool warmPool;
 };
 
 void preloadPythonRuntime();
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <conf/FaasmConfig.h>
+#include <faabric/proto/faabric.pb.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#define WARM_POOL_TICK_MS 1000
+
+namespace faaslet {
+
+class Faaslet;
+
+/*
+ * Pool of pre-warmed (i.e. already bound) Faaslets. A background thread
+ * creates Faaslets for the functions invoked recently on this host, up to the
+ * configured pool size per function, and drops idle ones when the demand
+ * decays or the host is short on memory.
+ */
+class FaasletPool
+{
+  public:
+    FaasletPool();
+
+    ~FaasletPool();
+
+    void start();
+
+    void stop();
+
+    // Records an invocation of the given function, and returns a pre-warmed
+    // Faaslet for it if there is one (or null otherwise)
+    std::shared_ptr<Faaslet> take(const faabric::Message& msg);
+
+    // Creates the Faaslets missing to meet the recent demand
+    void fill();
+
+    // Drops idle Faaslets above the recent demand, or all of them if the host
+    // is short on memory
+    void shrink();
+
+    void clear();
+
+    int getWarmFaasletCount(const faabric::Message& msg);
+
+    int getTotalWarmFaasletCount();
+
+  private:
+    conf::FaasmConfig& conf;
+
+    struct WarmFunction
+    {
+        faabric::Message msg;
+        double recentInvocations = 0;
+        int nPending = 0;
+        std::deque<std::shared_ptr<Faaslet>> faaslets;
+    };
+
+    std::mutex mx;
+    std::condition_variable cv;
+    std::unordered_map<std::string, WarmFunction> warmFunctions;
+
+    // Bumped on clear, so that Faaslets created before a flush are discarded
+    int generation = 0;
+
+    bool running = false;
+    std::thread bgThread;
+
+    void tick(bool decay);
+
+    int getTargetSize(const WarmFunction& f);
+
+    bool isUnderMemoryPressure();
+};
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <conf/FaasmConfig.h>
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace storage {
+
+/*
+ * Index of the artifacts (wasm, object files and their hashes) that the file
+ * loader caches on the local filesystem. Each entry records the md5 of the
+ * cached contents, used to check their integrity when read back, and the key
+ * of the remote .md5 file that tells whether they are stale, so that flushing
+ * only drops the artifacts that have changed. The least recently used entries
+ * are evicted to keep the cache within its size budget.
+ */
+class ArtifactCache
+{
+  public:
+    ArtifactCache();
+
+    // Records an artifact written to the given path. The remote hash is the
+    // expected contents of the remote hash file when the artifact is fresh
+    void put(const std::string& localPath,
+             std::span<const uint8_t> bytes,
+             const std::string& hashKey,
+             const std::vector<uint8_t>& remoteHash);
+
+    // Updates the expected remote hash of the artifact at the given path
+    void setRemoteHash(const std::string& localPath,
+                       const std::vector<uint8_t>& remoteHash);
+
+    // Checks the file at the given path is the one recorded. Files whose
+    // inode, size and modification time are unchanged are trusted without
+    // hashing them, otherwise the bytes read from the file are checked against
+    // the recorded hash, removing the file if they don't match
+    bool check(const std::string& localPath, std::span<const uint8_t> bytes);
+
+    bool isTracked(const std::string& localPath);
+
+    // Removes the artifacts whose remote hash has changed, as returned by the
+    // given function, and returns how many were removed
+    int invalidate(
+      const std::function<std::vector<uint8_t>(const std::string&)>&
+        getRemoteHash);
+
+    size_t getTotalSize();
+
+    int getEntryCount();
+
+    void clear();
+
+    static std::vector<uint8_t> hashBytes(std::span<const uint8_t> bytes);
+
+  private:
+    conf::FaasmConfig& conf;
+
+    // Identifies the version of a file on disk, so that unchanged files can
+    // be checked without reading them
+    struct FileVersion
+    {
+        uint64_t inode = 0;
+        uint64_t size = 0;
+        int64_t mtimeNs = 0;
+
+        bool operator==(const FileVersion&) const = default;
+    };
+
+    static FileVersion getFileVersion(const std::string& localPath);
+
+    struct Entry
+    {
+        std::vector<uint8_t> hash;
+        FileVersion version;
+        size_t size = 0;
+        std::string hashKey;
+        std::vector<uint8_t> remoteHash;
+        uint64_t lastUsed = 0;
+    };
+
+    std::mutex mx;
+    std::unordered_map<std::string, Entry> entries;
+    size_t totalSize = 0;
+    uint64_t useCounter = 0;
+
+    // Takes a copy of the path, as it may be the key of the removed entry
+    void doRemove(std::string localPath);
+
+    void evict(const std::string& keepPath);
+};
+
+ArtifactCache& getArtifactCache();
+}
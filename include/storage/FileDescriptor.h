@@ -118,6 +118,22 @@ class FileDescriptor
 
     ssize_t write(std::vector<::iovec>& nativeIovecs, int iovecCount);
 
+    // Positional reads and writes don't move the file offset. Both return -1
+    // on failure, setting the WASI errno
+    ssize_t pread(std::vector<::iovec>& nativeIovecs,
+                  int iovecCount,
+                  uint64_t offset);
+
+    ssize_t pwrite(std::vector<::iovec>& nativeIovecs,
+                   int iovecCount,
+                   uint64_t offset);
+
+    uint16_t allocate(uint64_t offset, uint64_t len);
+
+    uint16_t setSize(uint64_t size);
+
+    uint16_t sync() const;
+
     void close() const;
 
     bool mkdir(const std::string& dirPath);
@@ -146,7 +162,7 @@ class FileDescriptor
 
     void setPath(const std::string& newPath);
 
-    std::string getPath();
+    const std::string& getPath() const;
 
     int duplicate(const FileDescriptor& other);
 
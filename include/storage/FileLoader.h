@@ -1,12 +1,16 @@
 #pragma once
 
 #include <conf/FaasmConfig.h>
+#include <storage/MappedFile.h>
 #include <storage/S3Wrapper.h>
 
 #include <faabric/util/config.h>
 #include <faabric/util/exception.h>
 #include <faabric/util/func.h>
 
+#include <memory>
+#include <span>
+
 #define EMPTY_FILE_RESPONSE "Empty response"
 #define IS_DIR_RESPONSE "IS_DIR"
 #define FILE_PATH_HEADER "FilePath"
@@ -32,6 +36,10 @@ class FileLoader
 
     void clearLocalCache();
 
+    // Removes the locally cached files that have changed remotely, keeping
+    // the rest
+    void invalidateLocalCache();
+
     std::string getHashFilePath(const std::string& path);
 
     // ----- Function wasm -----
@@ -42,30 +50,51 @@ class FileLoader
     void uploadFunction(faabric::Message& msg);
 
     // ----- Function object files -----
-    std::string getFunctionObjectFile(const faabric::Message& msg);
+    // Machine code can be specialised for an ISA (see conf/isa.h). Loading
+    // picks the best machine code this host supports, falling back to the
+    // generic one (empty ISA)
+    std::string getFunctionObjectFile(const faabric::Message& msg,
+                                      const std::string& isa = "");
 
     std::vector<uint8_t> loadFunctionObjectFile(const faabric::Message& msg);
 
-    std::vector<uint8_t> loadFunctionObjectHash(const faabric::Message& msg);
+    std::shared_ptr<MappedFile> mapFunctionObjectFile(
+      const faabric::Message& msg);
+
+    std::vector<uint8_t> loadFunctionObjectHash(const faabric::Message& msg,
+                                                const std::string& isa = "");
 
     void uploadFunctionObjectFile(const faabric::Message& msg,
-                                  const std::vector<uint8_t>& objBytes);
+                                  const std::vector<uint8_t>& objBytes,
+                                  const std::string& isa = "");
 
     void uploadFunctionObjectHash(const faabric::Message& msg,
-                                  const std::vector<uint8_t>& hash);
+                                  const std::vector<uint8_t>& hash,
+                                  const std::string& isa = "");
 
     // ----- Function WAMR AoT files -----
-    std::string getFunctionAotFile(const faabric::Message& msg);
+    std::string getFunctionAotFile(const faabric::Message& msg,
+                                   const std::string& isa = "");
 
     std::vector<uint8_t> loadFunctionWamrAotFile(const faabric::Message& msg);
 
-    std::vector<uint8_t> loadFunctionWamrAotHash(const faabric::Message& msg);
+    std::shared_ptr<MappedFile> mapFunctionWamrAotFile(
+      const faabric::Message& msg);
+
+    std::vector<uint8_t> loadFunctionWamrAotHash(const faabric::Message& msg,
+                                                 const std::string& isa = "");
 
     void uploadFunctionWamrAotFile(const faabric::Message& msg,
-                                   const std::vector<uint8_t>& objBytes);
+                                   const std::vector<uint8_t>& objBytes,
+                                   const std::string& isa = "");
 
     void uploadFunctionWamrAotHash(const faabric::Message& msg,
-                                   const std::vector<uint8_t>& hash);
+                                   const std::vector<uint8_t>& hash,
+                                   const std::string& isa = "");
+
+    // Deletes the hashes of all the function's AoT files, so that they are
+    // treated as missing until the next codegen
+    void deleteFunctionWamrAotHashes(const faabric::Message& msg);
 
     // ----- Encrypted function wasm -----
     std::string getEncryptedFunctionFile(const faabric::Message& msg);
@@ -81,6 +110,9 @@ class FileLoader
 
     std::vector<uint8_t> loadSharedObjectObjectFile(const std::string& path);
 
+    std::shared_ptr<MappedFile> mapSharedObjectObjectFile(
+      const std::string& path);
+
     std::vector<uint8_t> loadSharedObjectObjectHash(const std::string& path);
 
     void uploadSharedObjectObjectFile(const std::string& path,
@@ -94,6 +126,11 @@ class FileLoader
 
     std::vector<uint8_t> loadSharedFile(const std::string& path);
 
+    // Writes the shared file to the given path, streaming it from S3 rather
+    // than buffering it in memory. Returns false if the file doesn't exist
+    bool loadSharedFileToPath(const std::string& path,
+                              const std::string& destPath);
+
     void deleteSharedFile(const std::string& path);
 
     void uploadSharedFile(const std::string& path,
@@ -125,6 +162,33 @@ class FileLoader
     std::vector<uint8_t> loadHashFileBytes(const std::string& path,
                                            const std::string& localCachePath);
 
+    std::vector<uint8_t> loadArtifactBytes(const std::string& path,
+                                           const std::string& localCachePath,
+                                           const std::string& hashKey,
+                                           bool tolerateMissing = false);
+
+    // The best ISA with machine code under the given key, cached per key
+    std::string getBestIsa(const std::string& key,
+                           const std::string& localCachePath);
+
+    static void clearBestIsas();
+
+    std::string getBestAotIsa(const faabric::Message& msg);
+
+    std::shared_ptr<MappedFile> mapArtifactFile(
+      const std::string& path,
+      const std::string& localCachePath,
+      const std::string& hashKey);
+
+    std::vector<uint8_t> getExpectedRemoteHash(const std::string& path,
+                                               const std::string& hashKey,
+                                               std::span<const uint8_t> bytes);
+
+    void uploadArtifactBytes(const std::string& path,
+                             const std::string& localCachePath,
+                             const std::string& hashKey,
+                             const std::vector<uint8_t>& bytes);
+
     void uploadFileBytes(const std::string& path,
                          const std::string& localCachePath,
                          const std::vector<uint8_t>& bytes);
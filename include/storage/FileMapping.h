@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <sys/types.h>
+#include <utility>
+
+namespace storage {
+
+/*
+ * Records that a file is mapped into guest memory for as long as this is
+ * alive. Touching a mapped page past the end of its file raises SIGBUS, which
+ * would take down the whole worker, so files can't be shrunk below any of
+ * their live mappings. Files are told apart by device and inode, as the same
+ * file may be opened under different paths and descriptors.
+ */
+class FileMapping
+{
+  public:
+    FileMapping(int linuxFd, size_t lengthIn);
+
+    ~FileMapping();
+
+    FileMapping(const FileMapping&) = delete;
+
+    FileMapping& operator=(const FileMapping&) = delete;
+
+    // Returns the size the file can't be shrunk below, zero if it is not
+    // mapped
+    static size_t getMinFileSize(int linuxFd);
+
+  private:
+    std::pair<dev_t, ino_t> fileId;
+    size_t length;
+};
+}
@@ -4,7 +4,7 @@
 
 #include <faabric/proto/faabric.pb.h>
 
-#include <unordered_map>
+#include <deque>
 
 namespace storage {
 class FileSystem
@@ -30,14 +30,14 @@ class FileSystem
 
     void tearDown();
 
-    std::string getPathForFd(int fd);
+    const std::string& getPathForFd(int fd);
 
     void printDebugInfo();
 
   private:
-    int nextFd;
-
-    std::unordered_map<int, storage::FileDescriptor> fileDescriptors;
+    // Descriptors are never removed, so each fd is its index in the table.
+    // Adding to the end of a deque keeps references to the others valid
+    std::deque<storage::FileDescriptor> fileDescriptors;
 
     int getNewFd();
 };
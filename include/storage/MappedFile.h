@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace storage {
+
+/*
+ * A file mapped into memory, so that its contents are read straight from the
+ * page cache and shared by everyone mapping the same file, rather than copied
+ * onto the heap. The mapping is private (copy-on-write), as some runtimes
+ * take a mutable buffer, but it is never written back to the file.
+ *
+ * Files that are not cached locally are held in memory instead.
+ */
+class MappedFile
+{
+  public:
+    explicit MappedFile(const std::string& pathIn);
+
+    explicit MappedFile(std::vector<uint8_t>&& bytesIn);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::span<const uint8_t> getSpan() const;
+
+    uint8_t* data();
+
+    size_t size() const;
+
+    bool isMapped() const;
+
+    const std::string path;
+
+  private:
+    uint8_t* mappedPtr = nullptr;
+    size_t mappedSize = 0;
+
+    std::vector<uint8_t> bytes;
+};
+}
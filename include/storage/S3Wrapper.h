@@ -48,6 +48,13 @@ class S3Wrapper
                           const std::string& keyName,
                           bool tolerateMissing = false);
 
+    // Streams the key to the given file, without buffering it in memory.
+    // Returns false if the key is missing and we tolerate it
+    bool getKeyToFile(const std::string& bucketName,
+                      const std::string& keyName,
+                      const std::string& filePath,
+                      bool tolerateMissing = false);
+
   private:
     const conf::FaasmConfig& faasmConf;
     minio::s3::BaseUrl baseUrl;
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace threads {
+
+// The first segment of the table has this many slots, and each segment added
+// when the ones before it are full has twice as many as the last
+#define GUEST_SYNC_TABLE_INITIAL_SLOTS 256
+#define GUEST_SYNC_TABLE_MAX_SEGMENTS 16
+
+// Number of slots we probe in each segment before moving on to the next
+#define GUEST_SYNC_TABLE_MAX_PROBES 32
+
+// Upper bound on how long a thread spins for a contended guest mutex before
+// parking
+#define GUEST_MUTEX_MAX_SPINS 1000
+
+/*
+ * A spin-then-park mutex for guest code, which tends to hold locks for a very
+ * short time. Threads spin for a while before blocking on a futex, adapting
+ * how long they spin to how long it has recently taken to get the lock. The
+ * state is 0 if unlocked, 1 if locked, and 2 if locked with parked waiters.
+ */
+class GuestMutex
+{
+  public:
+    void lock();
+
+    bool try_lock();
+
+    void unlock();
+
+  private:
+    std::atomic<uint32_t> state = 0;
+
+    // Moving average of the spins needed to get the lock when contended
+    std::atomic<uint32_t> spinEstimate = 0;
+};
+
+/*
+ * The host-side state of a guest pthread mutex or condition variable.
+ */
+struct GuestSyncObject
+{
+    GuestMutex mx;
+
+    // Bumped on each signal or broadcast, and waited on by threads waiting on
+    // the condition variable
+    std::atomic<uint32_t> condSeq = 0;
+};
+
+/*
+ * Lock-free table of the host-side state of guest pthread objects, keyed by
+ * their address in wasm memory. Objects live inline in the table and are only
+ * removed all at once, when no threads are using it, so lookups don't take a
+ * lock or touch a reference count, and the pointers returned stay valid until
+ * the table is cleared.
+ *
+ * The table is a list of open-addressing segments, each twice the size of the
+ * last. Keys are inserted in the first free slot along their probe sequence
+ * in the first segment that has one, and as slots are never freed, all threads
+ * agree on where that is.
+ */
+class GuestSyncTable
+{
+  public:
+    explicit GuestSyncTable(
+      size_t maxSegmentsIn = GUEST_SYNC_TABLE_MAX_SEGMENTS);
+
+    GuestSyncTable(const GuestSyncTable&) = delete;
+
+    GuestSyncTable& operator=(const GuestSyncTable&) = delete;
+
+    ~GuestSyncTable();
+
+    // Returns the object for the given address, or null if there isn't one
+    GuestSyncObject* get(uint32_t addr);
+
+    // Returns the object for the given address, creating it if need be
+    GuestSyncObject* getOrCreate(uint32_t addr);
+
+    size_t size() const;
+
+    // Removes all objects, e.g. when the guest memory they belong to is
+    // reset. Must not be called while other threads are using the table
+    void clear();
+
+  private:
+    static constexpr uint32_t EMPTY_KEY = UINT32_MAX;
+
+    const size_t maxSegments;
+
+    struct Slot
+    {
+        std::atomic<uint32_t> key = EMPTY_KEY;
+        GuestSyncObject obj;
+    };
+
+    std::array<std::atomic<Slot*>, GUEST_SYNC_TABLE_MAX_SEGMENTS> segments{};
+
+    std::atomic<size_t> nEntries = 0;
+
+    GuestSyncObject* find(uint32_t addr, bool create);
+};
+}
@@ -37,6 +37,11 @@ class Level
     // Offset for the global thread numbers at this level
     int32_t globalTidOffset = 0;
 
+    // Schedule for loops with schedule(runtime), set by omp_set_schedule. The
+    // kind is an omp_sched_t, and defaults to static
+    int32_t runtimeScheduleKind = 1;
+    int32_t runtimeScheduleChunk = 0;
+
     uint32_t nSharedVarOffsets = 0;
     std::unique_ptr<uint32_t[]> sharedVarOffsets;
     static_assert(sizeof(sharedVarOffsets) == sizeof(uint32_t*));
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <faabric/proto/faabric.pb.h>
+#include <storage/MappedFile.h>
+
+#include <wasm_runtime_common.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace wasm {
+
+/*
+ * A WAMR module loaded in memory. The same loaded module is shared by all
+ * the instances of the same function (and AOT file) on this host, and is
+ * unloaded when the last reference to it is dropped. In tiered mode, a module
+ * may also be loaded from the function's wasm, to run in WAMR's interpreter
+ * until its AOT file is ready.
+ */
+class WAMRCachedModule
+{
+  public:
+    WAMRCachedModule(const std::string& hashIn,
+                     std::shared_ptr<storage::MappedFile> aotFileIn);
+
+    WAMRCachedModule(std::vector<uint8_t> wasmBytesIn);
+
+    ~WAMRCachedModule();
+
+    // The hash of the AOT file, empty for interpreted modules
+    const std::string hash;
+
+    WASMModuleCommon* getModule();
+
+    bool isInterpreted() const { return aotFile == nullptr; }
+
+  private:
+    // WAMR may keep references to the AOT buffer after loading it, so we must
+    // keep the file mapped for as long as the module is loaded
+    std::shared_ptr<storage::MappedFile> aotFile;
+
+    // Likewise for the wasm of interpreted modules
+    std::vector<uint8_t> wasmBytes;
+
+    WASMModuleCommon* wasmModule = nullptr;
+
+    void load(uint8_t* buffer, size_t size);
+};
+
+/*
+ * Process-wide cache of loaded WAMR AOT modules, keyed by user/function and
+ * the hash of the function's AOT file. Loads of different functions can
+ * happen in parallel, and concurrent loads of the same function will wait
+ * for a single load.
+ *
+ * In tiered mode (WAMR_TIERED), a function without an AOT file is served from
+ * an interpreted module, while its AOT file is generated in the background.
+ * As the hash of the AOT file is checked on every lookup, binds after the
+ * AOT file is stored pick up the compiled module.
+ */
+class WAMRModuleCache
+{
+  public:
+    std::shared_ptr<WAMRCachedModule> getModule(const faabric::Message& msg);
+
+    size_t getTotalCachedModuleCount();
+
+    ~WAMRModuleCache();
+
+    // Waits for any AOT files being generated in the background
+    void waitForBackgroundCodegen();
+
+    bool isGeneratingInBackground(const faabric::Message& msg);
+
+    // Drops the cached modules. AOT files being generated in the background
+    // are not waited for
+    void clear();
+
+  private:
+    std::shared_mutex mx;
+    std::unordered_map<std::string, std::shared_ptr<WAMRCachedModule>>
+      cachedModuleMap;
+    std::unordered_map<std::string, std::shared_ptr<std::mutex>> loadMutexes;
+
+    struct BackgroundCodegen
+    {
+        std::thread thread;
+        std::atomic<bool> finished = false;
+    };
+
+    // Functions whose AOT file is being generated, and the workers doing so.
+    // Workers remove their function once done, so that a failed codegen is
+    // retried on the next lookup, and are joined the next time codegen starts
+    std::mutex codegenMx;
+    std::unordered_set<std::string> codegenKeys;
+    std::vector<std::shared_ptr<BackgroundCodegen>> codegenWorkers;
+
+    std::shared_ptr<std::mutex> getLoadMutex(const std::string& key);
+
+    void startBackgroundCodegen(const faabric::Message& msg);
+
+    void doBackgroundCodegen(const faabric::Message& msg);
+
+    void joinFinishedCodegen();
+};
+
+WAMRModuleCache& getWAMRModuleCache();
+}
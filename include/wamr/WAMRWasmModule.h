@@ -1,10 +1,14 @@
 #pragma once
 
+#include <storage/FileMapping.h>
+#include <wamr/WAMRModuleCache.h>
 #include <wamr/WAMRModuleMixin.h>
 #include <wasm/WasmModule.h>
 
 #include <wasm_runtime_common.h>
 
+#include <map>
+#include <mutex>
 #include <setjmp.h>
 
 #define ERROR_BUFFER_SIZE 256
@@ -34,7 +38,10 @@ enum WAMRExceptionTypes
     FunctionFrozenException = 4,
 };
 
-std::vector<uint8_t> wamrCodegen(std::vector<uint8_t>& wasmBytesIn, bool isSgx);
+// An empty target CPU generates code for the generic x86_64 target
+std::vector<uint8_t> wamrCodegen(std::vector<uint8_t>& wasmBytesIn,
+                                 bool isSgx,
+                                 const std::string& targetCpu = "");
 
 class WAMRWasmModule final
   : public WasmModule
@@ -45,6 +52,18 @@ class WAMRWasmModule final
 
     static void destroyWAMRGlobally();
 
+    static void clearCaches();
+
+    // Loading and unloading modules changes WAMR's global state, so it is
+    // serialised with the runtime's initialisation and teardown. Modules still
+    // referenced when the runtime is torn down are not unloaded
+    static WASMModuleCommon* loadModuleGlobally(uint8_t* buffer,
+                                                size_t size,
+                                                char* errorBuffer,
+                                                uint32_t errorBufferSize);
+
+    static void unloadModuleGlobally(WASMModuleCommon* module);
+
     WAMRWasmModule();
 
     explicit WAMRWasmModule(int threadPoolSizeIn);
@@ -58,6 +77,11 @@ class WAMRWasmModule final
 
     int32_t executeFunction(faabric::Message& msg) override;
 
+    // Registers the post-instantiation memory of this module as the reset
+    // snapshot for its function (if it doesn't already exist), and returns
+    // the snapshot key
+    std::string registerResetSnapshot(faabric::Message& msg);
+
     // ----- Threads ------
     int32_t executeOMPThread(int threadPoolIdx,
                              uint32_t stackTop,
@@ -84,6 +108,15 @@ class WAMRWasmModule final
     // ----- Memory management -----
     uint32_t mmapFile(uint32_t hostFd, size_t length) override;
 
+    // Maps the file straight into linear memory. Private mappings are
+    // copy-on-write, while writes to shared ones go to the file
+    uint32_t mmapFile(uint32_t hostFd, size_t length, bool shared);
+
+    // Replaces any part of a file mapped in the given range with zeroed
+    // memory, so that the range can be reused. Mappings may only be partly
+    // in the range, in which case the rest of them stays mapped
+    void unmapFile(uint32_t wasmOffset, size_t length);
+
     size_t getMemorySizeBytes() override;
 
     uint8_t* getMemoryBase() override;
@@ -97,9 +130,29 @@ class WAMRWasmModule final
   private:
     char errorBuffer[ERROR_BUFFER_SIZE];
 
-    std::vector<uint8_t> wasmBytes;
+    // The loaded module may be shared with other instances of the same
+    // function, so we only keep a reference to it
+    std::shared_ptr<WAMRCachedModule> cachedModule;
     WASMModuleCommon* wasmModule;
     WASMModuleInstanceCommon* moduleInstance;
+
+    // Copy of the module instance's globals right after instantiation, used
+    // together with the reset snapshot to reset the module without
+    // re-instantiating it
+    std::vector<uint8_t> resetGlobals;
+
+    // Files mapped into linear memory, by wasm offset. What is left of a
+    // partly unmapped file shares its registration, so the file can only be
+    // shrunk once all of it is unmapped
+    struct MappedRange
+    {
+        size_t length;
+        std::shared_ptr<storage::FileMapping> fileMapping;
+    };
+    std::mutex mappedFilesMx;
+    std::map<uint32_t, MappedRange> mappedFiles;
+
+    void unmapAllFiles();
     // WAMR's execution environments are not thread-safe. Thus, we create an
     // array of them at the beginning, each thread will access a different
     // position in the array, so we do not need a mutex
@@ -120,6 +173,8 @@ class WAMRWasmModule final
 
     void bindInternal(faabric::Message& msg);
 
+    void resetFromSnapshot(const std::string& snapshotKey);
+
     bool doGrowMemory(uint32_t pageChange) override;
 };
 
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace wasm {
+
+// Sends up to this size are copied out of the sender's memory if there is no
+// receive posted, so that the sender can carry on. Larger sends wait for the
+// receiver to copy them straight out of the sender's memory
+#define LOCAL_MPI_EAGER_LIMIT (16 * 1024)
+
+// Sends through faabric never wait for the receiver, and programs may rely on
+// that, so large sends only wait this long for a receive before falling back
+// to copying the message out
+#define LOCAL_MPI_RENDEZVOUS_TIMEOUT_US 500
+
+/*
+ * The ranks of an MPI world that run in this process. They share buffers
+ * directly in the local stage of the hierarchical collectives, so they need to
+ * be able to see each other's buffers, and to wait for each other.
+ */
+class LocalMpiGroup
+{
+  public:
+    explicit LocalMpiGroup(const std::vector<int>& ranksIn);
+
+    // Sorted, so the first rank is the group's leader
+    const std::vector<int> ranks;
+
+    int getLocalIdx(int rank) const;
+
+    // Makes this rank's buffers visible to the others in the group, then
+    // waits for them all to do the same
+    void shareBuffers(int rank, const uint8_t* sendBuffer, uint8_t* recvBuffer);
+
+    const uint8_t* getSendBuffer(int localIdx) const;
+
+    uint8_t* getRecvBuffer(int localIdx) const;
+
+    void barrier();
+
+  private:
+    std::vector<const uint8_t*> sendBuffers;
+    std::vector<uint8_t*> recvBuffers;
+
+    std::mutex mx;
+    std::condition_variable cv;
+    int nWaiting = 0;
+    int generation = 0;
+};
+
+/*
+ * Point-to-point messaging between MPI ranks running in this process. All
+ * ranks share an address space, so messages are copied directly from the
+ * sender's linear memory to the receiver's buffer, rather than going through
+ * faabric's message queues.
+ *
+ * Messages between each pair of ranks are matched in order. Both ranks in a
+ * pair must use the transport for all their point-to-point messages, so that
+ * they agree on that order. Messages with different tags are matched
+ * separately, so that collectives never match point-to-point messages.
+ *
+ * Request ids are negative, so they can't clash with those from faabric.
+ */
+class LocalMpiTransport
+{
+  public:
+    void send(int worldId,
+              int sendRank,
+              int recvRank,
+              const uint8_t* buffer,
+              size_t nBytes,
+              int tag = 0);
+
+    // Returns the size of the message received
+    size_t recv(int worldId,
+                int sendRank,
+                int recvRank,
+                uint8_t* buffer,
+                size_t maxBytes,
+                int tag = 0);
+
+    int isend(int worldId,
+              int sendRank,
+              int recvRank,
+              const uint8_t* buffer,
+              size_t nBytes,
+              int tag = 0);
+
+    int irecv(int worldId,
+              int sendRank,
+              int recvRank,
+              uint8_t* buffer,
+              size_t maxBytes,
+              int tag = 0);
+
+    // Waits for the given request, returning the size of the message sent or
+    // received
+    size_t await(int requestId);
+
+    // Waits for a message to arrive, returning its size without receiving it
+    size_t probe(int worldId, int sendRank, int recvRank, int tag = 0);
+
+    // Drops the channels to the given rank, which must have received all its
+    // messages
+    void removeReceiver(int worldId, int recvRank);
+
+    static bool isLocalRequest(int requestId) { return requestId < 0; }
+
+    // Returns the group of the given ranks of the world, which must be the
+    // same on every call with the same point-to-point group
+    std::shared_ptr<LocalMpiGroup> getGroup(int worldId,
+                                            int groupId,
+                                            const std::vector<int>& ranks);
+
+    void removeGroups(int worldId);
+
+  private:
+    struct Channel;
+
+    struct Message
+    {
+        // The sender's buffer, or the receiver's buffer for posted receives
+        uint8_t* buffer = nullptr;
+        size_t nBytes = 0;
+
+        // Sends that don't wait for the receiver hold a copy of the data
+        std::vector<uint8_t> eagerData;
+
+        // Set for sends waiting for the receiver to copy them
+        std::shared_ptr<Channel> channel = nullptr;
+
+        // Set under the channel's lock once taken off the channel
+        bool matched = false;
+
+        std::atomic<bool> done = false;
+        bool truncated = false;
+    };
+
+    // Sends waiting for a receive, or receives waiting for a send. Only one
+    // of the two queues is non-empty at a time
+    struct Channel
+    {
+        std::mutex mx;
+        std::condition_variable cv;
+        std::deque<std::shared_ptr<Message>> sends;
+        std::deque<std::shared_ptr<Message>> recvs;
+    };
+
+    struct ChannelKey
+    {
+        int worldId;
+        int sendRank;
+        int recvRank;
+        int tag;
+
+        bool operator==(const ChannelKey&) const = default;
+    };
+
+    struct ChannelKeyHash
+    {
+        size_t operator()(const ChannelKey& key) const;
+    };
+
+    std::shared_mutex channelsMx;
+    std::unordered_map<ChannelKey, std::shared_ptr<Channel>, ChannelKeyHash>
+      channels;
+
+    std::mutex groupsMx;
+    std::map<std::pair<int, int>, std::shared_ptr<LocalMpiGroup>> groups;
+
+    std::mutex requestsMx;
+    std::unordered_map<int, std::shared_ptr<Message>> requests;
+    std::atomic<int> nextRequestId = -1;
+
+    std::shared_ptr<Channel> getChannel(const ChannelKey& key);
+
+    std::shared_ptr<Message> doSend(const ChannelKey& key,
+                                    const uint8_t* buffer,
+                                    size_t nBytes);
+
+    std::shared_ptr<Message> doRecv(const ChannelKey& key,
+                                    uint8_t* buffer,
+                                    size_t maxBytes);
+
+    int addRequest(std::shared_ptr<Message> msg);
+
+    static void transfer(Message& send, Message& recv);
+
+    size_t awaitMessage(const std::shared_ptr<Message>& msg);
+};
+
+LocalMpiTransport& getLocalMpiTransport();
+}
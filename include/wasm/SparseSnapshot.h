@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace wasm {
+
+// Runs are compressed in chunks of at most this size when serialised, so that
+// chunks can be compressed and decompressed in parallel
+#define SPARSE_SNAPSHOT_CHUNK_SIZE (1024 * 1024)
+
+struct SparseSnapshotRun
+{
+    uint32_t offset = 0;
+    std::vector<uint8_t> data;
+};
+
+/*
+ * A snapshot of a module's memory, encoded as the runs of pages that differ
+ * from a base snapshot in the snapshot registry (usually the function's reset
+ * snapshot). Restoring maps the base snapshot and writes the runs on top, and
+ * anything above the base snapshot that is not in a run is zero.
+ */
+class SparseSnapshot
+{
+  public:
+    SparseSnapshot(const std::string& baseKeyIn, size_t sizeIn);
+
+    const std::string baseKey;
+
+    // Size of the memory when the snapshot was taken
+    const size_t size;
+
+    // Hash of the base snapshot the runs were taken against, so that we can
+    // check it is the same when restoring on another host. Empty if unknown
+    std::vector<uint8_t> baseHash;
+
+    // Adds a page-aligned chunk of memory, extending the last run if they are
+    // contiguous. Chunks must be added in order of offset
+    void addPages(uint32_t offset, std::span<const uint8_t> data);
+
+    const std::vector<SparseSnapshotRun>& getRuns() const;
+
+    size_t getOverlaySize() const;
+
+    // Writes the runs over the given memory
+    void writeRuns(std::span<uint8_t> memory) const;
+
+    // Serialises the snapshot, compressing the runs across up to the given
+    // number of threads. Threads beyond the caller's are shared by everything
+    // (de)compressing on this host, and are capped by its cores
+    std::vector<uint8_t> toBytes(int nThreads = 1) const;
+
+    static std::shared_ptr<SparseSnapshot> fromBytes(
+      std::span<const uint8_t> bytes,
+      int nThreads = 1);
+
+  private:
+    std::vector<SparseSnapshotRun> runs;
+    size_t overlaySize = 0;
+};
+
+// Returns the pages of the given page-aligned region whose contents may
+// differ from the file it is privately mapped from, i.e. those that have been
+// copied on write or swapped out, as read from /proc/self/pagemap
+std::vector<bool> getPrivatelyModifiedPages(std::span<uint8_t> region);
+
+// Returns the hash of the given snapshot in the registry. Hashes are cached, as
+// base snapshots are large and rarely change once registered
+std::vector<uint8_t> getSnapshotHash(const std::string& snapshotKey);
+}
@@ -7,9 +7,11 @@
 #include <faabric/util/queue.h>
 #include <faabric/util/snapshot.h>
 #include <storage/FileSystem.h>
+#include <threads/GuestSyncTable.h>
 #include <threads/ThreadState.h>
 #include <wasm/WasmCommon.h>
 #include <wasm/WasmEnvironment.h>
+#include <wasm/SparseSnapshot.h>
 
 #include <atomic>
 #include <exception>
@@ -127,22 +129,62 @@ class WasmModule
 
     void restore(const std::string& snapshotKey);
 
-    // ----- Threading -----
-    // Queues a pthread call that will be executed along with all other queued
-    // calls on the first call to await
-    void queuePthreadCall(threads::PthreadCall call);
+    // Captures only the pages of memory that differ from the given base
+    // snapshot. This is cheapest when memory was last restored from the base
+    // snapshot, as untouched pages can then be skipped without reading them
+    std::shared_ptr<SparseSnapshot> getSparseSnapshotData(
+      const std::string& baseSnapshotKey);
+
+    void restoreSparse(const SparseSnapshot& snap);
+
+    // Records which snapshot memory is currently mapped from, if any
+    void setMappedSnapshotKey(const std::string& snapshotKey);
+
+    // The snapshot this module is reset to between executions, if any. Every
+    // host running the function has its own copy under the same key
+    std::string getResetSnapshotKey();
 
-    // Executes all queued pthread calls and awaits the call relating to the
-    // given pointer
+    void setResetSnapshotKey(const std::string& snapshotKey);
+
+    // ----- Threading -----
+    // Brings the main thread snapshot up to date with the pages dirtied since
+    // the last batch of threads, and sets the merge regions saved up for the
+    // next batch. Must be called from the main thread
+    std::shared_ptr<faabric::util::SnapshotData> updateMainThreadSnapshot(
+      faabric::Message& msg);
+
+    // Dispatches a pthread call straight away, so that it runs alongside the
+    // thread that created it. Calls created while others are still pending
+    // share their snapshot. Returns the id of the call's message
+    int dispatchPthreadCall(faabric::Message* msg, threads::PthreadCall call);
+
+    // Awaits the pthread call relating to the given pointer, returning its
+    // result
     int awaitPthreadCall(faabric::Message* msg, int pthreadPtr);
 
+    // Stops the pthread call relating to the given pointer from being joined.
+    // It will be awaited when the function finishes instead
+    void detachPthreadCall(int pthreadPtr);
+
+    // Awaits all pthread calls that have not been joined
+    void awaitAllPthreadCalls();
+
+    // Returns the number of pthread calls that have not been awaited
+    int getPendingPthreadCount();
+
+    // Awaits all pthread calls, ignoring their results, e.g. when the function
+    // that made them has failed
+    void clearPthreadCalls();
+
     std::vector<uint32_t> getThreadStacks();
 
-    // Returns the given pthread mutex and errors if it doesn't exist
-    std::shared_ptr<std::mutex> getPthreadMutex(uint32_t id);
+    // Returns the state of the given pthread mutex or condition variable and
+    // errors if it doesn't exist
+    threads::GuestSyncObject* getPthreadSyncObject(uint32_t id);
 
-    // Returns the given pthread mutex, creating it if it doesn't exist
-    std::shared_ptr<std::mutex> getOrCreatePthreadMutex(uint32_t id);
+    // Returns the state of the given pthread mutex or condition variable,
+    // creating it if it doesn't exist
+    threads::GuestSyncObject* getOrCreatePthreadSyncObject(uint32_t id);
 
     // Adds a merge region to be used in the next threaded operation spawned by
     // this module
@@ -192,13 +234,15 @@ class WasmModule
     size_t argvBufferSize;
 
     // Threads
-    std::vector<threads::PthreadCall> queuedPthreadCalls;
-    std::unordered_map<int32_t, uint32_t> pthreadPtrsToChainedCalls;
-    std::vector<std::pair<uint32_t, int32_t>> lastPthreadResults;
+    std::mutex pthreadCallsMx;
+    int nextPthreadIdx = 1;
+    std::unordered_map<int32_t, std::shared_ptr<faabric::BatchExecuteRequest>>
+      pthreadPtrsToRequests;
+    std::vector<std::shared_ptr<faabric::BatchExecuteRequest>>
+      detachedPthreadRequests;
     std::vector<faabric::util::SnapshotMergeRegion> mergeRegions;
 
-    std::shared_mutex pthreadLocksMx;
-    std::unordered_map<uint32_t, std::shared_ptr<std::mutex>> pthreadLocks;
+    threads::GuestSyncTable pthreadSyncObjects;
 
     // Shared memory regions
     std::shared_mutex sharedMemWasmPtrsMutex;
@@ -217,10 +261,18 @@ class WasmModule
     // Snapshots
     faabric::snapshot::SnapshotRegistry& reg;
 
+    std::string mappedSnapshotKey;
+
+    std::string resetSnapshotKey;
+
     void snapshotWithKey(const std::string& snapKey);
 
     void ignoreThreadStacksInSnapshot(const std::string& snapKey);
 
+    // Replaces the given range of memory with fresh zeroed pages, dropping
+    // anything mapped there (e.g. from a snapshot or a file)
+    void remapAsZeroed(uint32_t wasmOffset, size_t length);
+
     // Threads
     void createThreadStacks();
 };
@@ -1,6 +1,28 @@
 #pragma once
 
+#include <faabric/util/snapshot.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+
+// Snapshots under keys with this prefix hold the compressed pages of memory
+// that differ from a base snapshot, rather than the memory itself
+#define MIGRATION_DELTA_PREFIX "migration_delta_"
+
 namespace wasm {
+class WasmModule;
+
 void doMigrationPoint(int32_t entrypointFuncWasmOffset,
                       const std::string& entrypointFuncArg);
+
+// Takes the snapshot to migrate the given module with, and returns it along
+// with its key. If the module has a reset snapshot, every other host running
+// the function has it too, so we only send the pages that differ from it
+std::pair<std::string, std::shared_ptr<faabric::util::SnapshotData>>
+takeMigrationSnapshot(WasmModule& module, int msgId);
+
+bool isMigrationDelta(const std::string& snapshotKey);
+
+void restoreMigrationDelta(WasmModule& module, const std::string& snapshotKey);
 }
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <faabric/mpi/MpiWorld.h>
+#include <faabric/mpi/mpi.h>
+
+#include <cstdint>
+#include <vector>
+
+// Large collectives are split into chunks of this size, so that hosts can
+// work on one chunk while the next is in flight
+#define MPI_COLLECTIVE_CHUNK_SIZE (1024 * 1024)
+
+/*
+ * MPI calls shared by the host interfaces. Point-to-point messages between
+ * ranks in this process go through the LocalMpiTransport, and all others
+ * through the MPI world. Collectives built on them pass their own message
+ * type, so that they are never matched with the program's own messages.
+ */
+namespace wasm {
+void doMpiSend(faabric::mpi::MpiWorld& world,
+               int rank,
+               int destRank,
+               const uint8_t* buffer,
+               faabric_datatype_t* dtype,
+               int count,
+               faabric::mpi::MpiMessageType messageType =
+                 faabric::mpi::MpiMessageType::NORMAL);
+
+void doMpiRecv(faabric::mpi::MpiWorld& world,
+               int rank,
+               int sourceRank,
+               uint8_t* buffer,
+               faabric_datatype_t* dtype,
+               int count,
+               MPI_Status* status,
+               faabric::mpi::MpiMessageType messageType =
+                 faabric::mpi::MpiMessageType::NORMAL);
+
+int doMpiIsend(faabric::mpi::MpiWorld& world,
+               int rank,
+               int destRank,
+               const uint8_t* buffer,
+               faabric_datatype_t* dtype,
+               int count,
+               faabric::mpi::MpiMessageType messageType =
+                 faabric::mpi::MpiMessageType::NORMAL);
+
+int doMpiIrecv(faabric::mpi::MpiWorld& world,
+               int rank,
+               int sourceRank,
+               uint8_t* buffer,
+               faabric_datatype_t* dtype,
+               int count,
+               faabric::mpi::MpiMessageType messageType =
+                 faabric::mpi::MpiMessageType::NORMAL);
+
+void doMpiAwait(faabric::mpi::MpiWorld& world, int requestId);
+
+void doMpiSendRecv(faabric::mpi::MpiWorld& world,
+                   int rank,
+                   const uint8_t* sendBuffer,
+                   int sendCount,
+                   faabric_datatype_t* sendType,
+                   int destRank,
+                   uint8_t* recvBuffer,
+                   int recvCount,
+                   faabric_datatype_t* recvType,
+                   int sourceRank,
+                   MPI_Status* status);
+
+void doMpiProbe(faabric::mpi::MpiWorld& world,
+                int rank,
+                int sourceRank,
+                MPI_Status* status);
+
+// Waits on the first of the given requests that is still active, and marks it
+// as done by zeroing its id. Returns its index, or -1 if none are active. The
+// status, if any, gets the size of the message of local requests only
+int doMpiWaitAny(faabric::mpi::MpiWorld& world,
+                 int32_t* requestIds,
+                 int count,
+                 MPI_Status* status = nullptr);
+
+// Vector collectives, with one count and displacement (in elements) per rank.
+// Every rank exchanges a block with every other rank, sent as the given type
+// of collective
+void doMpiAllToAllV(faabric::mpi::MpiWorld& world,
+                    int rank,
+                    const uint8_t* sendBuffer,
+                    const std::vector<int32_t>& sendCounts,
+                    const std::vector<int32_t>& sendDispls,
+                    faabric_datatype_t* sendType,
+                    uint8_t* recvBuffer,
+                    const std::vector<int32_t>& recvCounts,
+                    const std::vector<int32_t>& recvDispls,
+                    faabric_datatype_t* recvType,
+                    faabric::mpi::MpiMessageType messageType);
+
+// Reduces the ranks' send buffers, and gives each rank its block of the
+// result, blocks being back to back. The send buffer may be the receive buffer
+void doMpiReduceScatter(faabric::mpi::MpiWorld& world,
+                        int rank,
+                        const uint8_t* sendBuffer,
+                        uint8_t* recvBuffer,
+                        const std::vector<int32_t>& recvCounts,
+                        faabric_datatype_t* dtype,
+                        faabric_op_t* op);
+
+// We only have the world communicator, so we can only split it if every rank
+// gives the same color, and keys that keep the ranks in order. Takes the color
+// and key of each rank, in turn, and throws if the split is unsupported
+void checkMpiCommSplit(const std::vector<int32_t>& colorKeys);
+
+// Collectives that work in two levels when ranks share a host: within each
+// host through shared memory, and between hosts with one leader per host
+void doMpiAllReduce(faabric::mpi::MpiWorld& world,
+                    int rank,
+                    const uint8_t* sendBuffer,
+                    uint8_t* recvBuffer,
+                    faabric_datatype_t* dtype,
+                    int count,
+                    faabric_op_t* op);
+
+void doMpiBroadcast(faabric::mpi::MpiWorld& world,
+                    int rank,
+                    int root,
+                    uint8_t* buffer,
+                    faabric_datatype_t* dtype,
+                    int count);
+
+// The stages of the collectives between hosts, which take the ranks taking
+// part, in order. Every rank in the ring ends up with the reduced buffer,
+// while the buffer of the first rank in the chain is passed down the chain
+void doMpiRingAllReduce(faabric::mpi::MpiWorld& world,
+                        int rank,
+                        const std::vector<int>& ring,
+                        uint8_t* buffer,
+                        faabric_datatype_t* dtype,
+                        int count,
+                        faabric_op_t* op);
+
+void doMpiChainBroadcast(faabric::mpi::MpiWorld& world,
+                         int rank,
+                         const std::vector<int>& chain,
+                         uint8_t* buffer,
+                         faabric_datatype_t* dtype,
+                         int count);
+
+// Called when the given rank leaves the world
+void doMpiFinalize(faabric::mpi::MpiWorld& world, int rank);
+}
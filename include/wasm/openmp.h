@@ -5,6 +5,8 @@
 #include <faabric/util/macros.h>
 #include <threads/ThreadState.h>
 
+#include <functional>
+
 // ------------------------------------------------
 // LOGGING
 // ------------------------------------------------
@@ -84,6 +86,68 @@ void doOpenMPForStaticInit8(int32_t loc,
 
 void doOpenMPForStaticFini(int32_t loc, int32_t globalTid);
 
+void doOpenMPDispatchInit4(int32_t loc,
+                           int32_t gtid,
+                           int32_t schedule,
+                           int32_t lower,
+                           int32_t upper,
+                           int32_t stride,
+                           int32_t chunk);
+
+void doOpenMPDispatchInit4u(int32_t loc,
+                            int32_t gtid,
+                            int32_t schedule,
+                            uint32_t lower,
+                            uint32_t upper,
+                            int32_t stride,
+                            int32_t chunk);
+
+void doOpenMPDispatchInit8(int32_t loc,
+                           int32_t gtid,
+                           int32_t schedule,
+                           int64_t lower,
+                           int64_t upper,
+                           int64_t stride,
+                           int64_t chunk);
+
+void doOpenMPDispatchInit8u(int32_t loc,
+                            int32_t gtid,
+                            int32_t schedule,
+                            uint64_t lower,
+                            uint64_t upper,
+                            int64_t stride,
+                            int64_t chunk);
+
+int32_t doOpenMPDispatchNext4(int32_t loc,
+                              int32_t gtid,
+                              int32_t* lastIter,
+                              int32_t* lower,
+                              int32_t* upper,
+                              int32_t* stride);
+
+int32_t doOpenMPDispatchNext4u(int32_t loc,
+                               int32_t gtid,
+                               int32_t* lastIter,
+                               uint32_t* lower,
+                               uint32_t* upper,
+                               int32_t* stride);
+
+int32_t doOpenMPDispatchNext8(int32_t loc,
+                              int32_t gtid,
+                              int32_t* lastIter,
+                              int64_t* lower,
+                              int64_t* upper,
+                              int64_t* stride);
+
+int32_t doOpenMPDispatchNext8u(int32_t loc,
+                               int32_t gtid,
+                               int32_t* lastIter,
+                               uint64_t* lower,
+                               uint64_t* upper,
+                               int64_t* stride);
+
+void doOpenMPDispatchFini(int32_t loc, int32_t gtid);
+
 int32_t doOpenMPGetMaxThreads();
 
 int32_t doOpenMPGetNumThreads();
@@ -102,15 +166,39 @@ void doOpenMPPushNumThreads(int32_t loc, int32_t globalTid, int32_t numThreads);
 
 void doOpenMPSetNumThreads(int32_t numThreads);
 
+void doOpenMPSetSchedule(int32_t kind, int32_t chunk);
+
+void doOpenMPGetSchedule(int32_t* kind, int32_t* chunk);
+
 int32_t doOpenMPSingle(int32_t loc, int32_t globalTid);
 
 void doOpenMPEndSingle(int32_t loc, int32_t globalTid);
 
-void doOpenMPStartReduceCritical(faabric::Message* msg,
-                                 std::shared_ptr<threads::Level> level,
-                                 int32_t numReduceVars,
-                                 int32_t reduceVarPtrs,
-                                 int32_t reduceVarsSize);
+// Combines the reduction variables at the second wasm pointer into those at the
+// first, using the function generated by the compiler for the reduction
+typedef std::function<void(int32_t, int32_t)> OpenMPReduceFunc;
+
+int32_t doOpenMPStartReduce(faabric::Message* msg,
+                            std::shared_ptr<threads::Level> level,
+                            int32_t reduceData,
+                            const OpenMPReduceFunc& reduceFunc,
+                            bool barrier);
+
+void doOpenMPEndReduce(faabric::Message* msg, bool barrier);
+
+// Called when an OpenMP thread has finished executing
+void doOpenMPFinishThread(faabric::Message* msg);
+
+// Finishes the OpenMP thread when it goes out of scope, so that the thread's
+// team is cleaned up even if the thread throws
+class OpenMPThreadScope
+{
+  public:
+    OpenMPThreadScope(faabric::Message* msgIn);
+
+    ~OpenMPThreadScope();
 
-void doOpenMPEndReduceCritical(faabric::Message* msg, bool barrier);
+  private:
+    faabric::Message* msg;
+};
 }
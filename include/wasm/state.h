@@ -0,0 +1,51 @@
+#pragma once
+
+#include <faabric/state/StateKeyValue.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Most keys in a batch are waiting on a round-trip to the host that owns them,
+// so batches are spread over up to this many threads, taken from a pool shared
+// by all batches
+#define STATE_BATCH_MAX_THREADS 16
+
+namespace wasm {
+
+// Gets the value for the given key, for the user of the executing function.
+// Without a size, the value keeps the size it already has
+std::shared_ptr<faabric::state::StateKeyValue> getStateKV(
+  const std::string& key,
+  size_t size = 0);
+
+/*
+ * One key in a batched state call. Whole values are read and written when the
+ * offset is zero and the length is the value's total length, otherwise only
+ * the given chunk is.
+ */
+struct StateBatchEntry
+{
+    std::string key;
+    uint32_t totalLen = 0;
+    uint32_t offset = 0;
+    uint8_t* buffer = nullptr;
+    uint32_t len = 0;
+};
+
+/*
+ * State calls for many keys at once, shared by the host interfaces. Keys are
+ * handled concurrently, so that their round-trips overlap rather than adding
+ * up, while entries for the same key are handled in order.
+ */
+void doFaasmReadStateBatch(const std::string& user,
+                           const std::vector<StateBatchEntry>& entries);
+
+void doFaasmWriteStateBatch(const std::string& user,
+                            const std::vector<StateBatchEntry>& entries);
+
+void doFaasmPushStateBatch(const std::string& user,
+                           const std::vector<std::string>& keys,
+                           bool partial);
+}
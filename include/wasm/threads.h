@@ -25,9 +25,17 @@ void doPthreadExit();
 
 int32_t doPthreadJoin(int32_t pthreadPtr);
 
+int32_t doPthreadDetach(int32_t pthreadPtr);
+
 int32_t doPthreadMutexLock(int32_t mutex);
 
 int32_t doPthreadMutexTryLock(int32_t mutex);
 
 int32_t doPthreadMutexUnlock(int32_t mutex);
+
+int32_t doPthreadCondWait(int32_t cond, int32_t mutex);
+
+int32_t doPthreadCondSignal(int32_t cond);
+
+int32_t doPthreadCondBroadcast(int32_t cond);
 }
@@ -20,7 +20,9 @@ WAVM_DECLARE_INTRINSIC_MODULE(wasi)
 
 WAVM_DECLARE_INTRINSIC_MODULE(wasiThreads)
 
-std::vector<uint8_t> wavmCodegen(std::vector<uint8_t>& wasmBytes);
+// An empty target CPU generates code for WAVM's default (host) target
+std::vector<uint8_t> wavmCodegen(std::vector<uint8_t>& wasmBytes,
+                                 const std::string& targetCpu = "");
 
 template<class T>
 T unalignedWavmRead(WAVM::Runtime::Memory* memory, WAVM::Uptr offset)
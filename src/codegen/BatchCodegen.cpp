@@ -0,0 +1,153 @@
+#include <codegen/BatchCodegen.h>
+#include <codegen/MachineCodeGenerator.h>
+#include <faabric/util/environment.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/string_tools.h>
+#include <faabric/util/timing.h>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <thread>
+
+namespace codegen {
+
+BatchCodegen::BatchCodegen(int nThreadsIn)
+  : nThreads(nThreadsIn > 0 ? nThreadsIn : faabric::util::getUsableCores())
+{}
+
+std::vector<CodegenResult> BatchCodegen::codegenForFunctions(
+  const std::vector<faabric::Message>& msgs,
+  bool clean)
+{
+    std::vector<std::string> names;
+    for (const auto& msg : msgs) {
+        names.push_back(faabric::util::funcToString(msg, false));
+    }
+
+    return runBatch(names, [&msgs, clean](size_t idx) {
+        // Each worker thread has its own generator and file loader
+        faabric::Message msg = msgs.at(idx);
+        return getMachineCodeGenerator().codegenForFunction(msg, clean);
+    });
+}
+
+std::vector<CodegenResult> BatchCodegen::codegenForSharedObjects(
+  const std::vector<std::string>& inputPaths,
+  bool clean)
+{
+    return runBatch(inputPaths, [&inputPaths, clean](size_t idx) {
+        return getMachineCodeGenerator().codegenForSharedObject(
+          inputPaths.at(idx), clean);
+    });
+}
+
+std::vector<CodegenResult> BatchCodegen::runBatch(
+  const std::vector<std::string>& names,
+  const std::function<bool(size_t)>& codegenItem)
+{
+    std::vector<CodegenResult> results(names.size());
+    std::atomic<size_t> nextIdx = 0;
+
+    int nWorkers = std::min<int>(nThreads, names.size());
+    SPDLOG_INFO(
+      "Running codegen for {} items on {} threads", names.size(), nWorkers);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nWorkers; i++) {
+        threads.emplace_back([&names, &results, &nextIdx, &codegenItem] {
+            while (true) {
+                size_t idx = nextIdx.fetch_add(1);
+                if (idx >= names.size()) {
+                    break;
+                }
+
+                // Each item writes to its own result, so no need to lock
+                CodegenResult& result = results.at(idx);
+                result.name = names.at(idx);
+
+                faabric::util::TimePoint start = faabric::util::startTimer();
+                try {
+                    bool generated = codegenItem(idx);
+                    result.status = generated ? CodegenStatus::Generated
+                                              : CodegenStatus::Skipped;
+                } catch (std::exception& e) {
+                    SPDLOG_ERROR(
+                      "Codegen failed for {}: {}", result.name, e.what());
+                    result.status = CodegenStatus::Failed;
+                    result.error = e.what();
+                }
+                result.timeMs = faabric::util::getTimeDiffMillis(start);
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+
+    return results;
+}
+
+std::vector<std::string> getSharedObjectPaths(const std::string& dirPath)
+{
+    std::vector<std::string> paths;
+    for (const auto& entry :
+         std::filesystem::recursive_directory_iterator(dirPath)) {
+        const std::string fileName = entry.path().filename().string();
+        if (entry.is_regular_file() &&
+            (faabric::util::endsWith(fileName, ".so") ||
+             faabric::util::endsWith(fileName, ".wasm"))) {
+            paths.push_back(entry.path().string());
+        }
+    }
+
+    // Keep the order stable between runs
+    std::sort(paths.begin(), paths.end());
+
+    return paths;
+}
+
+int logCodegenResults(const std::vector<CodegenResult>& results)
+{
+    int nGenerated = 0;
+    int nSkipped = 0;
+    int nFailed = 0;
+    double totalMs = 0;
+
+    for (const auto& r : results) {
+        totalMs += r.timeMs;
+
+        switch (r.status) {
+            case CodegenStatus::Generated: {
+                SPDLOG_INFO("Generated {} ({:.1f} ms)", r.name, r.timeMs);
+                nGenerated++;
+                break;
+            }
+            case CodegenStatus::Skipped: {
+                SPDLOG_INFO("Skipped {} ({:.1f} ms)", r.name, r.timeMs);
+                nSkipped++;
+                break;
+            }
+            case CodegenStatus::Failed: {
+                SPDLOG_ERROR(
+                  "Failed {} ({:.1f} ms): {}", r.name, r.timeMs, r.error);
+                nFailed++;
+                break;
+            }
+        }
+    }
+
+    SPDLOG_INFO("Codegen finished: {} generated, {} skipped, {} failed ({:.1f} "
+                "ms of work)",
+                nGenerated,
+                nSkipped,
+                nFailed,
+                totalMs);
+
+    return nFailed;
+}
+}
@@ -1,4 +1,5 @@
 #include <codegen/MachineCodeGenerator.h>
+#include <conf/isa.h>
 #include <faabric/util/bytes.h>
 #include <faabric/util/config.h>
 #include <faabric/util/files.h>
@@ -55,20 +56,23 @@ std::vector<uint8_t> MachineCodeGenerator::hashBytes(
 }
 
 std::vector<uint8_t> MachineCodeGenerator::doCodegen(
-  std::vector<uint8_t>& bytes)
+  std::vector<uint8_t>& bytes,
+  const std::string& isa)
 {
+    std::string targetCpu = isa.empty() ? "" : conf::getIsaTargetCpu(isa);
+
     if (conf.wasmVm == "wamr") {
-        return wasm::wamrCodegen(bytes, false);
+        return wasm::wamrCodegen(bytes, false, targetCpu);
     }
 
     if (conf.wasmVm == "sgx") {
         return wasm::wamrCodegen(bytes, true);
     }
 
-    return wasm::wavmCodegen(bytes);
+    return wasm::wavmCodegen(bytes, targetCpu);
 }
 
-void MachineCodeGenerator::codegenForFunction(faabric::Message& msg, bool clean)
+bool MachineCodeGenerator::codegenForFunction(faabric::Message& msg, bool clean)
 {
     std::vector<uint8_t> bytes = loader.loadFunctionWasm(msg);
 
@@ -78,16 +82,47 @@ void MachineCodeGenerator::codegenForFunction(faabric::Message& msg, bool clean)
         throw std::runtime_error("Loaded empty bytes for " + funcStr);
     }
 
-    // Compare hashes
+    if (conf.wasmVm != "wamr" && conf.wasmVm != "sgx" &&
+        conf.wasmVm != "wavm") {
+        SPDLOG_ERROR("Unrecognised WASM VM during codegen: {}", conf.wasmVm);
+        throw std::runtime_error("Unrecognised WASM VM");
+    }
+
+    // Always generate the generic machine code, then the machine code
+    // specialised for each configured ISA (SGX code is not specialised)
+    std::vector<std::string> isas = { "" };
+    if (conf.wasmVm != "sgx") {
+        for (const auto& isa : conf::getCodegenIsas()) {
+            isas.push_back(isa);
+        }
+    }
+
     std::vector<uint8_t> newHash = hashBytes(bytes);
+    bool generated = false;
+    for (const auto& isa : isas) {
+        generated |= codegenForFunctionIsa(msg, bytes, newHash, isa, clean);
+    }
+
+    return generated;
+}
+
+bool MachineCodeGenerator::codegenForFunctionIsa(
+  faabric::Message& msg,
+  std::vector<uint8_t>& bytes,
+  const std::vector<uint8_t>& newHash,
+  const std::string& isa,
+  bool clean)
+{
+    const std::string funcStr = funcToString(msg, false);
+    const std::string isaStr = isa.empty() ? "generic" : isa;
+    bool isWamr = conf.wasmVm == "wamr" || conf.wasmVm == "sgx";
+
+    // Compare hashes
     std::vector<uint8_t> oldHash;
-    if (conf.wasmVm == "wamr" || conf.wasmVm == "sgx") {
-        oldHash = loader.loadFunctionWamrAotHash(msg);
-    } else if (conf.wasmVm == "wavm") {
-        oldHash = loader.loadFunctionObjectHash(msg);
+    if (isWamr) {
+        oldHash = loader.loadFunctionWamrAotHash(msg, isa);
     } else {
-        SPDLOG_ERROR("Unrecognised WASM VM during codegen: {}", conf.wasmVm);
-        throw std::runtime_error("Unrecognised WASM VM");
+        oldHash = loader.loadFunctionObjectHash(msg, isa);
     }
 
     // If we run the machine code generator with the 'clean' flag, we ignore
@@ -95,48 +130,62 @@ void MachineCodeGenerator::codegenForFunction(faabric::Message& msg, bool clean)
     if (!clean && (!oldHash.empty()) && newHash == oldHash) {
         // Even if we skip the code generation step, we want to sync the latest
         // object file
-        if (conf.wasmVm == "wamr" || conf.wasmVm == "sgx") {
-            UNUSED(loader.loadFunctionWamrAotHash(msg));
-        } else {
-            UNUSED(loader.loadFunctionObjectFile(msg));
+        if (isa.empty()) {
+            if (isWamr) {
+                UNUSED(loader.loadFunctionWamrAotHash(msg));
+            } else {
+                UNUSED(loader.loadFunctionObjectFile(msg));
+            }
         }
-        SPDLOG_DEBUG(
-          "Skipping codegen for {} (WASM VM: {})", funcStr, conf.wasmVm);
-        return;
+        SPDLOG_DEBUG("Skipping codegen for {} (WASM VM: {}, ISA: {})",
+                     funcStr,
+                     conf.wasmVm,
+                     isaStr);
+        return false;
     }
 
     if (oldHash.empty()) {
-        SPDLOG_DEBUG(
-          "No old hash found for {} (WASM VM: {})", funcStr, conf.wasmVm);
+        SPDLOG_DEBUG("No old hash found for {} (WASM VM: {}, ISA: {})",
+                     funcStr,
+                     conf.wasmVm,
+                     isaStr);
     } else if (clean) {
-        SPDLOG_DEBUG(
-          "Generating machine code for {} (WASM VM: {})", funcStr, conf.wasmVm);
+        SPDLOG_DEBUG("Generating machine code for {} (WASM VM: {}, ISA: {})",
+                     funcStr,
+                     conf.wasmVm,
+                     isaStr);
     } else {
-        SPDLOG_DEBUG(
-          "Hashes differ for {} (WASM VM: {})", funcStr, conf.wasmVm);
+        SPDLOG_DEBUG("Hashes differ for {} (WASM VM: {}, ISA: {})",
+                     funcStr,
+                     conf.wasmVm,
+                     isaStr);
     }
 
     // Run the actual codegen
     std::vector<uint8_t> objBytes;
     try {
-        objBytes = doCodegen(bytes);
+        objBytes = doCodegen(bytes, isa);
     } catch (std::runtime_error& ex) {
-        SPDLOG_ERROR(
-          "Codegen failed for {} (WASM VM: {})", funcStr, conf.wasmVm);
+        SPDLOG_ERROR("Codegen failed for {} (WASM VM: {}, ISA: {})",
+                     funcStr,
+                     conf.wasmVm,
+                     isaStr);
         throw ex;
     }
 
     // Upload the file contents and the hash
-    if (conf.wasmVm == "wamr" || conf.wasmVm == "sgx") {
-        loader.uploadFunctionWamrAotFile(msg, objBytes);
-        loader.uploadFunctionWamrAotHash(msg, newHash);
+    if (isWamr) {
+        loader.uploadFunctionWamrAotFile(msg, objBytes, isa);
+        loader.uploadFunctionWamrAotHash(msg, newHash, isa);
     } else {
-        loader.uploadFunctionObjectFile(msg, objBytes);
-        loader.uploadFunctionObjectHash(msg, newHash);
+        loader.uploadFunctionObjectFile(msg, objBytes, isa);
+        loader.uploadFunctionObjectHash(msg, newHash, isa);
     }
+
+    return true;
 }
 
-void MachineCodeGenerator::codegenForSharedObject(const std::string& inputPath,
+bool MachineCodeGenerator::codegenForSharedObject(const std::string& inputPath,
                                                   bool clean)
 {
     // Load the wasm
@@ -151,7 +200,7 @@ void MachineCodeGenerator::codegenForSharedObject(const std::string& inputPath,
         // shared object object file
         UNUSED(loader.loadSharedObjectObjectFile(inputPath));
         SPDLOG_DEBUG("Skipping codegen for {}", inputPath);
-        return;
+        return false;
     }
 
     // Run the actual codegen
@@ -165,5 +214,7 @@ void MachineCodeGenerator::codegenForSharedObject(const std::string& inputPath,
 
     loader.uploadSharedObjectObjectFile(inputPath, objBytes);
     loader.uploadSharedObjectObjectHash(inputPath, newHash);
+
+    return true;
 }
 }
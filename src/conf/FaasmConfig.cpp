@@ -28,14 +28,21 @@ void FaasmConfig::initialise()
     captureStdout = getEnvVar("CAPTURE_STDOUT", "off");
 
     wasmVm = getEnvVar("FAASM_WASM_VM", "wavm");
+    codegenIsas = getEnvVar("CODEGEN_ISAS", "");
+    wamrTiered = getEnvVar("WAMR_TIERED", "off");
+    deltaMigration = getEnvVar("DELTA_MIGRATION", "on");
     chainedCallTimeout = this->getIntParam("CHAINED_CALL_TIMEOUT", "300000");
 
+    warmPoolSize = this->getIntParam("WARM_POOL_SIZE", "0");
+    warmPoolMinFreeMb = this->getIntParam("WARM_POOL_MIN_FREE_MB", "1024");
+
     std::string faasmLocalDir =
       getEnvVar("FAASM_LOCAL_DIR", "/usr/local/faasm");
     functionDir = fmt::format("{}/{}", faasmLocalDir, "wasm");
     objectFileDir = fmt::format("{}/{}", faasmLocalDir, "object");
     runtimeFilesDir = fmt::format("{}/{}", faasmLocalDir, "runtime_root");
     sharedFilesDir = fmt::format("{}/{}", faasmLocalDir, "shared");
+    localCacheMaxMb = this->getIntParam("LOCAL_CACHE_MAX_MB", "4096");
 
     s3Bucket = getEnvVar("S3_BUCKET", "faasm");
     s3Host = getEnvVar("S3_HOST", "minio");
@@ -71,7 +78,12 @@ void FaasmConfig::print()
     SPDLOG_INFO("Capture stdout:       {}", captureStdout);
     SPDLOG_INFO("Chained call timeout: {}", chainedCallTimeout);
     SPDLOG_INFO("Python preload:       {}", pythonPreload);
+    SPDLOG_INFO("Warm pool size:       {}", warmPoolSize);
+    SPDLOG_INFO("Warm pool min. free:  {} MB", warmPoolMinFreeMb);
     SPDLOG_INFO("Wasm VM:              {}", wasmVm);
+    SPDLOG_INFO("Codegen ISAs:         {}", codegenIsas);
+    SPDLOG_INFO("WAMR tiered mode:     {}", wamrTiered);
+    SPDLOG_INFO("Delta migration:      {}", deltaMigration);
     SPDLOG_INFO("Att. service URL:     {}", attestationServiceUrl);
     SPDLOG_INFO("Accless mode:         {}", acclessEnabled);
 
@@ -80,5 +92,6 @@ void FaasmConfig::print()
     SPDLOG_INFO("Object file dir:      {}", objectFileDir);
     SPDLOG_INFO("Runtime files dir:    {}", runtimeFilesDir);
     SPDLOG_INFO("Shared files dir:     {}", sharedFilesDir);
+    SPDLOG_INFO("Local cache max.:     {} MB", localCacheMaxMb);
 }
 }
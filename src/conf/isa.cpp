@@ -0,0 +1,91 @@
+#include <conf/FaasmConfig.h>
+#include <conf/isa.h>
+
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace conf {
+
+std::vector<std::string> getKnownCodegenIsas()
+{
+    return { ISA_AVX512, ISA_AVX2 };
+}
+
+bool hostSupportsIsa(const std::string& isa)
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+
+    if (isa == ISA_AVX2) {
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    }
+
+    if (isa == ISA_AVX512) {
+        // The features enabled by LLVM's skylake-avx512 target
+        return __builtin_cpu_supports("avx512f") &&
+               __builtin_cpu_supports("avx512cd") &&
+               __builtin_cpu_supports("avx512bw") &&
+               __builtin_cpu_supports("avx512dq") &&
+               __builtin_cpu_supports("avx512vl");
+    }
+#endif
+
+    return false;
+}
+
+std::string getIsaTargetCpu(const std::string& isa)
+{
+    if (isa == ISA_AVX2) {
+        return "haswell";
+    }
+
+    if (isa == ISA_AVX512) {
+        return "skylake-avx512";
+    }
+
+    SPDLOG_ERROR("Unrecognised codegen ISA: {}", isa);
+    throw std::runtime_error("Unrecognised codegen ISA");
+}
+
+std::vector<std::string> getCodegenIsas()
+{
+    std::vector<std::string> configured;
+    std::stringstream ss(getFaasmConfig().codegenIsas);
+    std::string isa;
+    while (std::getline(ss, isa, ',')) {
+        if (!isa.empty()) {
+            configured.push_back(isa);
+        }
+    }
+
+    std::vector<std::string> isas;
+    for (const auto& known : getKnownCodegenIsas()) {
+        if (std::find(configured.begin(), configured.end(), known) !=
+            configured.end()) {
+            isas.push_back(known);
+        }
+    }
+
+    if (isas.size() != configured.size()) {
+        SPDLOG_WARN("Ignoring unrecognised codegen ISAs in {}",
+                    getFaasmConfig().codegenIsas);
+    }
+
+    return isas;
+}
+
+std::vector<std::string> getHostCodegenIsas()
+{
+    std::vector<std::string> isas;
+    for (const auto& isa : getCodegenIsas()) {
+        if (hostSupportsIsa(isa)) {
+            isas.push_back(isa);
+        }
+    }
+
+    return isas;
+}
+}
@@ -74,8 +74,9 @@ void EnclaveInterface::doBindToFunction(faabric::Message& msg, bool cache)
     // Load AoT
     storage::FileLoader& functionLoader = storage::getFileLoader();
 
-    std::vector<uint8_t> wasmBytes =
-      functionLoader.loadFunctionWamrAotFile(msg);
+    // The AoT file is copied into the enclave, so we just map it here
+    std::shared_ptr<storage::MappedFile> aotFile =
+      functionLoader.mapFunctionWamrAotFile(msg);
 
     // Bind the enclave wasm module to the function
     faasm_sgx_status_t returnValue;
@@ -83,8 +84,8 @@ void EnclaveInterface::doBindToFunction(faabric::Message& msg, bool cache)
                                                 &returnValue,
                                                 msg.user().c_str(),
                                                 msg.function().c_str(),
-                                                (void*)wasmBytes.data(),
-                                                (uint32_t)wasmBytes.size(),
+                                                (void*)aotFile->data(),
+                                                (uint32_t)aotFile->size(),
                                                 enableAccless);
     processECallErrors("Unable to enter enclave", status, returnValue);
 
@@ -262,8 +262,8 @@ extern "C"
     {
         auto* enclaveInt = wasm::getExecutingEnclaveInterface();
         auto& fileSystem = enclaveInt->getFileSystem();
-        std::string path = fileSystem.getPathForFd(wasmFd);
-        storage::FileDescriptor fileDesc = fileSystem.getFileDescriptor(wasmFd);
+        storage::FileDescriptor& fileDesc =
+          fileSystem.getFileDescriptor(wasmFd);
 
         // Build a ioVec vector from the serialised arguments
         std::vector<::iovec> ioVecNative(ioVecCount, (::iovec){});
@@ -291,7 +291,6 @@ extern "C"
     {
         auto* enclaveInt = wasm::getExecutingEnclaveInterface();
         auto& fileSystem = enclaveInt->getFileSystem();
-        std::string path = fileSystem.getPathForFd(wasmFd);
         storage::FileDescriptor& fileDesc =
           fileSystem.getFileDescriptor(wasmFd);
 
@@ -335,7 +334,6 @@ extern "C"
         wasm::EnclaveInterface* enclaveInt =
           wasm::getExecutingEnclaveInterface();
         storage::FileSystem& fileSystem = enclaveInt->getFileSystem();
-        std::string path = fileSystem.getPathForFd(wasmFd);
 
         // Build a ioVec vector from the serialised arguments
         std::vector<::iovec> ioVecNative(ioVecCount, (::iovec){});
@@ -78,11 +78,16 @@ Faaslet::Faaslet(faabric::Message& msg)
     module->bindToFunction(msg);
 
     // Create the reset snapshot for this function if it doesn't already exist
-    // (currently only supported in WAVM)
+    // (currently only supported in WAVM and WAMR)
     if (conf.wasmVm == "wavm") {
         localResetSnapshotKey =
           wasm::getWAVMModuleCache().registerResetSnapshot(*module, msg);
+    } else if (conf.wasmVm == "wamr") {
+        localResetSnapshotKey =
+          static_cast<wasm::WAMRWasmModule*>(module.get())
+            ->registerResetSnapshot(msg);
     }
+    module->setResetSnapshotKey(localResetSnapshotKey);
 }
 
 int32_t Faaslet::executeTask(int threadPoolIdx,
@@ -149,24 +154,49 @@ std::string Faaslet::getLocalResetSnapshotKey()
     return localResetSnapshotKey;
 }
 
-FaasletFactory::~FaasletFactory() {}
+FaasletFactory::FaasletFactory()
+{
+    // Only starts if the warm pool is enabled
+    warmPool.start();
+}
+
+FaasletFactory::~FaasletFactory()
+{
+    warmPool.stop();
+}
 
 std::shared_ptr<faabric::executor::Executor> FaasletFactory::createExecutor(
   faabric::Message& msg)
 {
+    // Hand out a pre-warmed Faaslet if there is one
+    std::shared_ptr<Faaslet> faaslet = warmPool.take(msg);
+    if (faaslet != nullptr) {
+        return faaslet;
+    }
+
     return std::make_shared<Faaslet>(msg);
 }
 
+FaasletPool& FaasletFactory::getWarmPool()
+{
+    return warmPool;
+}
+
 void FaasletFactory::flushHost()
 {
-    // Clear cached wasm and object files
+    // Drop warm Faaslets, as they may have been created from stale code
+    warmPool.clear();
+
+    // Remove cached wasm and object files that have changed
     storage::FileLoader& fileLoader = storage::getFileLoader();
-    fileLoader.clearLocalCache();
+    fileLoader.invalidateLocalCache();
 
-    // WAVM-specific flushing
+    // Runtime-specific flushing
     const conf::FaasmConfig& conf = conf::getFaasmConfig();
     if (conf.wasmVm == "wavm") {
         wasm::WAVMWasmModule::clearCaches();
+    } else if (conf.wasmVm == "wamr") {
+        wasm::WAMRWasmModule::clearCaches();
     }
 }
 }
@@ -0,0 +1,277 @@
+#include <faabric/util/func.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+#include <faaslet/Faaslet.h>
+#include <faaslet/FaasletPool.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace faaslet {
+
+FaasletPool::FaasletPool()
+  : conf(conf::getFaasmConfig())
+{}
+
+FaasletPool::~FaasletPool()
+{
+    stop();
+}
+
+void FaasletPool::start()
+{
+    faabric::util::UniqueLock lock(mx);
+    if (conf.warmPoolSize <= 0 || running) {
+        return;
+    }
+
+    SPDLOG_INFO("Starting warm Faaslet pool (size {})", conf.warmPoolSize);
+    running = true;
+
+    bgThread = std::thread([this] {
+        auto interval = std::chrono::milliseconds(WARM_POOL_TICK_MS);
+        auto lastDecay = std::chrono::steady_clock::now();
+
+        faabric::util::UniqueLock lock(mx);
+        while (running) {
+            // Wake up periodically, or whenever a warm Faaslet is taken
+            cv.wait_for(lock, interval);
+            if (!running) {
+                break;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            bool decay = (now - lastDecay) >= interval;
+            if (decay) {
+                lastDecay = now;
+            }
+
+            lock.unlock();
+            tick(decay);
+            lock.lock();
+        }
+    });
+}
+
+void FaasletPool::stop()
+{
+    {
+        faabric::util::UniqueLock lock(mx);
+        running = false;
+    }
+
+    cv.notify_all();
+    if (bgThread.joinable()) {
+        bgThread.join();
+    }
+
+    clear();
+}
+
+std::shared_ptr<Faaslet> FaasletPool::take(const faabric::Message& msg)
+{
+    if (conf.warmPoolSize <= 0) {
+        return nullptr;
+    }
+
+    std::string key = faabric::util::funcToString(msg, false);
+    std::shared_ptr<Faaslet> faaslet = nullptr;
+    {
+        faabric::util::UniqueLock lock(mx);
+        auto [it, inserted] = warmFunctions.try_emplace(key);
+        WarmFunction& f = it->second;
+
+        // Keep a minimal copy of the message to create Faaslets from
+        if (inserted) {
+            f.msg = faabric::util::messageFactory(msg.user(), msg.function());
+            f.msg.set_ispython(msg.ispython());
+            f.msg.set_pythonuser(msg.pythonuser());
+            f.msg.set_pythonfunction(msg.pythonfunction());
+        }
+
+        f.recentInvocations += 1;
+
+        if (!f.faaslets.empty()) {
+            faaslet = f.faaslets.front();
+            f.faaslets.pop_front();
+            SPDLOG_DEBUG("Using warm Faaslet for {}", key);
+        }
+    }
+
+    // Let the background thread replace it
+    cv.notify_one();
+
+    return faaslet;
+}
+
+void FaasletPool::tick(bool decay)
+{
+    // Halve the recent invocations every tick, so that the target size of
+    // the pool follows the recent demand
+    if (decay) {
+        faabric::util::UniqueLock lock(mx);
+        for (auto it = warmFunctions.begin(); it != warmFunctions.end();) {
+            WarmFunction& f = it->second;
+            f.recentInvocations /= 2;
+
+            if (getTargetSize(f) == 0 && f.faaslets.empty() &&
+                f.nPending == 0) {
+                it = warmFunctions.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    shrink();
+    fill();
+}
+
+void FaasletPool::fill()
+{
+    std::vector<std::pair<std::string, faabric::Message>> toCreate;
+    int thisGeneration;
+    {
+        faabric::util::UniqueLock lock(mx);
+        if (isUnderMemoryPressure()) {
+            SPDLOG_DEBUG("Not filling warm Faaslet pool under memory pressure");
+            return;
+        }
+
+        thisGeneration = generation;
+        for (auto& [key, f] : warmFunctions) {
+            int nMissing = getTargetSize(f) - f.faaslets.size() - f.nPending;
+            for (int i = 0; i < nMissing; i++) {
+                toCreate.emplace_back(key, f.msg);
+                f.nPending++;
+            }
+        }
+    }
+
+    // Creating a Faaslet loads and binds the module, so we do it without
+    // holding the lock
+    for (auto& [key, msg] : toCreate) {
+        SPDLOG_DEBUG("Creating warm Faaslet for {}", key);
+
+        std::shared_ptr<Faaslet> faaslet = nullptr;
+        try {
+            faaslet = std::make_shared<Faaslet>(msg);
+        } catch (std::exception& ex) {
+            SPDLOG_ERROR("Failed to create warm Faaslet for {}: {}",
+                         key,
+                         ex.what());
+        }
+
+        bool discard = true;
+        {
+            faabric::util::UniqueLock lock(mx);
+            auto it = warmFunctions.find(key);
+            if (generation == thisGeneration && it != warmFunctions.end()) {
+                WarmFunction& f = it->second;
+                f.nPending--;
+
+                if (faaslet != nullptr) {
+                    f.faaslets.push_back(faaslet);
+                    discard = false;
+                } else {
+                    // Don't keep retrying a function we can't create
+                    f.recentInvocations = 0;
+                }
+            }
+        }
+
+        if (discard && faaslet != nullptr) {
+            faaslet->shutdown();
+        }
+    }
+}
+
+void FaasletPool::shrink()
+{
+    std::vector<std::shared_ptr<Faaslet>> toDrop;
+    {
+        faabric::util::UniqueLock lock(mx);
+        bool underPressure = isUnderMemoryPressure();
+        for (auto& [key, f] : warmFunctions) {
+            size_t targetSize = underPressure ? 0 : getTargetSize(f);
+            while (f.faaslets.size() > targetSize) {
+                toDrop.push_back(f.faaslets.back());
+                f.faaslets.pop_back();
+            }
+        }
+    }
+
+    if (!toDrop.empty()) {
+        SPDLOG_DEBUG("Dropping {} idle warm Faaslets", toDrop.size());
+    }
+
+    for (auto& faaslet : toDrop) {
+        faaslet->shutdown();
+    }
+}
+
+void FaasletPool::clear()
+{
+    std::vector<std::shared_ptr<Faaslet>> toDrop;
+    {
+        faabric::util::UniqueLock lock(mx);
+        generation++;
+        for (auto& [key, f] : warmFunctions) {
+            toDrop.insert(toDrop.end(), f.faaslets.begin(), f.faaslets.end());
+        }
+        warmFunctions.clear();
+    }
+
+    for (auto& faaslet : toDrop) {
+        faaslet->shutdown();
+    }
+}
+
+int FaasletPool::getWarmFaasletCount(const faabric::Message& msg)
+{
+    std::string key = faabric::util::funcToString(msg, false);
+
+    faabric::util::UniqueLock lock(mx);
+    auto it = warmFunctions.find(key);
+    if (it == warmFunctions.end()) {
+        return 0;
+    }
+
+    return it->second.faaslets.size();
+}
+
+int FaasletPool::getTotalWarmFaasletCount()
+{
+    faabric::util::UniqueLock lock(mx);
+    int count = 0;
+    for (const auto& [key, f] : warmFunctions) {
+        count += f.faaslets.size();
+    }
+
+    return count;
+}
+
+int FaasletPool::getTargetSize(const WarmFunction& f)
+{
+    int recent = std::lround(f.recentInvocations);
+    return std::min(conf.warmPoolSize, recent);
+}
+
+bool FaasletPool::isUnderMemoryPressure()
+{
+    std::ifstream memInfo("/proc/meminfo");
+    std::string line;
+    while (std::getline(memInfo, line)) {
+        long availableKb = 0;
+        if (sscanf(line.c_str(), "MemAvailable: %ld kB", &availableKb) == 1) {
+            return (availableKb / 1024) < conf.warmPoolMinFreeMb;
+        }
+    }
+
+    SPDLOG_WARN("Could not read available memory from /proc/meminfo");
+    return false;
+}
+}
@@ -1,9 +1,7 @@
-#include <codegen/MachineCodeGenerator.h>
+#include <codegen/BatchCodegen.h>
 #include <conf/FaasmConfig.h>
 #include <faabric/util/config.h>
-#include <faabric/util/environment.h>
 #include <faabric/util/func.h>
-#include <faabric/util/locks.h>
 #include <faabric/util/logging.h>
 #include <storage/FileLoader.h>
 #include <storage/S3Wrapper.h>
@@ -11,6 +9,8 @@
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 
+#include <algorithm>
+
 using namespace boost::filesystem;
 namespace po = boost::program_options;
 
@@ -21,7 +21,10 @@ po::variables_map parseCmdLine(int argc, char* argv[])
     desc.add_options()(
       "user", po::value<std::string>(), "function's user name (required)")(
       "func", po::value<std::string>(), "function's name")(
-      "clean", "overwrite existing generated code");
+      "clean", "overwrite existing generated code")(
+      "threads",
+      po::value<int>(),
+      "number of codegen threads (defaults to usable cores)");
 
     // Mark user and function as positional arguments
     po::positional_options_description p;
@@ -37,26 +40,18 @@ po::variables_map parseCmdLine(int argc, char* argv[])
     return vm;
 }
 
-void codegenForFunc(const std::string& user,
-                    const std::string& func,
-                    bool clean)
+bool isValidFunction(const std::string& user, const std::string& func)
 {
-    codegen::MachineCodeGenerator& gen = codegen::getMachineCodeGenerator();
     storage::FileLoader& loader = storage::getFileLoader();
     faabric::Message msg = faabric::util::messageFactory(user, func);
 
     std::string funcFile = loader.getFunctionFile(msg);
     if (!boost::filesystem::exists(funcFile)) {
         SPDLOG_WARN("Invalid function: {}/{}", user, func);
-        return;
+        return false;
     }
 
-    SPDLOG_INFO("Generating machine code for {}/{} (WASM VM: {})",
-                user,
-                func,
-                conf::getFaasmConfig().wasmVm);
-
-    gen.codegenForFunction(msg, clean);
+    return true;
 }
 
 int main(int argc, char* argv[])
@@ -69,6 +64,12 @@ int main(int argc, char* argv[])
     std::string user = vm["user"].as<std::string>();
     bool clean = vm.find("clean") != vm.end();
 
+    int nThreads = 0;
+    if (vm.find("threads") != vm.end()) {
+        nThreads = vm["threads"].as<int>();
+    }
+
+    std::vector<std::string> funcs;
     if (vm.find("func") != vm.end()) {
         std::string func = vm["func"].as<std::string>();
 
@@ -76,7 +77,7 @@ int main(int argc, char* argv[])
                     user,
                     func,
                     conf.wasmVm);
-        codegenForFunc(user, func, clean);
+        funcs.push_back(func);
     } else {
         SPDLOG_INFO(
           "Running codegen for user {} on dir {}", user, conf.functionDir);
@@ -91,47 +92,25 @@ int main(int argc, char* argv[])
 
         boost::filesystem::directory_iterator iter(path);
         boost::filesystem::directory_iterator end;
-        std::mutex mx;
-
-        unsigned int nThreads = faabric::util::getUsableCores();
-        std::vector<std::thread> threads;
-
-        for (unsigned int i = 0; i < nThreads; i++) {
-            threads.emplace_back([&iter, &mx, &end, &user, clean] {
-                SPDLOG_INFO("Spawning codegen thread");
-
-                while (true) {
-                    std::string thisPath;
-
-                    {
-                        // Get lock
-                        faabric::util::UniqueLock lock(mx);
-
-                        // Check if we've got more to do
-                        if (iter == end) {
-                            SPDLOG_INFO("Codegen thread finished");
-                            break;
-                        }
-
-                        // Get path and increment
-                        thisPath = iter->path().string();
-                        iter++;
-                    }
-
-                    directory_entry subPath(thisPath);
-                    std::string functionName =
-                      subPath.path().filename().string();
-                    codegenForFunc(user, functionName, clean);
-                }
-            });
+        for (; iter != end; iter++) {
+            funcs.push_back(iter->path().filename().string());
         }
+        std::sort(funcs.begin(), funcs.end());
+    }
 
-        for (auto& t : threads) {
-            if (t.joinable()) {
-                t.join();
-            }
+    std::vector<faabric::Message> msgs;
+    for (const auto& func : funcs) {
+        if (isValidFunction(user, func)) {
+            msgs.push_back(faabric::util::messageFactory(user, func));
         }
     }
 
+    codegen::BatchCodegen batch(nThreads);
+    std::vector<codegen::CodegenResult> results =
+      batch.codegenForFunctions(msgs, clean);
+    int nFailed = codegen::logCodegenResults(results);
+
     storage::shutdownFaasmS3();
+
+    return nFailed > 0 ? 1 : 0;
 }
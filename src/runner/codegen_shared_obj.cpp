@@ -1,8 +1,5 @@
-#include <codegen/MachineCodeGenerator.h>
-#include <faabric/util/environment.h>
-#include <faabric/util/locks.h>
+#include <codegen/BatchCodegen.h>
 #include <faabric/util/logging.h>
-#include <faabric/util/string_tools.h>
 #include <storage/S3Wrapper.h>
 
 #include <boost/filesystem.hpp>
@@ -18,7 +15,10 @@ po::variables_map parseCmdLine(int argc, char* argv[])
     desc.add_options()("input-path",
                        po::value<std::string>(),
                        "directory of shared objects (required)")(
-      "clean", "overwrite existing generated code");
+      "clean", "overwrite existing generated code")(
+      "threads",
+      po::value<int>(),
+      "number of codegen threads (defaults to usable cores)");
 
     // Mark user and function as positional arguments
     po::positional_options_description p;
@@ -34,62 +34,6 @@ po::variables_map parseCmdLine(int argc, char* argv[])
     return vm;
 }
 
-void codegenForDirectory(std::string& inputPath, bool clean)
-{
-    SPDLOG_INFO("Running codegen on directory {}", inputPath);
-
-    // Iterate through the directory
-    path inputFilePath(inputPath);
-    recursive_directory_iterator iter(inputFilePath);
-    recursive_directory_iterator end;
-    std::mutex mx;
-
-    // Run multiple threads to do codegen
-    unsigned int nThreads = faabric::util::getUsableCores();
-    std::vector<std::thread> threads;
-
-    for (unsigned int i = 0; i < nThreads; i++) {
-        threads.emplace_back([&iter, &mx, &end, clean] {
-            SPDLOG_INFO("Spawning codegen thread");
-            codegen::MachineCodeGenerator& gen =
-              codegen::getMachineCodeGenerator();
-
-            while (true) {
-                std::string thisPath;
-
-                {
-                    // Get lock
-                    faabric::util::UniqueLock lock(mx);
-
-                    // Check if we've got more to do
-                    if (iter == end) {
-                        SPDLOG_INFO("Codegen thread finished");
-                        break;
-                    }
-
-                    // Get path and increment
-                    thisPath = iter->path().string();
-                    iter++;
-                }
-
-                directory_entry f(thisPath);
-                const std::string fileName = f.path().filename().string();
-                if (faabric::util::endsWith(fileName, ".so") ||
-                    faabric::util::endsWith(fileName, ".wasm")) {
-                    SPDLOG_INFO("Generating machine code for {}", thisPath);
-                    gen.codegenForSharedObject(thisPath, clean);
-                }
-            }
-        });
-    }
-
-    for (auto& t : threads) {
-        if (t.joinable()) {
-            t.join();
-        }
-    }
-}
-
 int main(int argc, char* argv[])
 {
     faabric::util::initLogging();
@@ -99,12 +43,25 @@ int main(int argc, char* argv[])
     std::string inputPath = vm["input-path"].as<std::string>();
     bool clean = vm.find("clean") != vm.end();
 
+    int nThreads = 0;
+    if (vm.find("threads") != vm.end()) {
+        nThreads = vm["threads"].as<int>();
+    }
+
+    std::vector<std::string> inputPaths;
     if (is_directory(inputPath)) {
-        codegenForDirectory(inputPath, clean);
+        SPDLOG_INFO("Running codegen on directory {}", inputPath);
+        inputPaths = codegen::getSharedObjectPaths(inputPath);
     } else {
-        codegen::MachineCodeGenerator& gen = codegen::getMachineCodeGenerator();
-        gen.codegenForSharedObject(inputPath, clean);
+        inputPaths.push_back(inputPath);
     }
 
+    codegen::BatchCodegen batch(nThreads);
+    std::vector<codegen::CodegenResult> results =
+      batch.codegenForSharedObjects(inputPaths, clean);
+    int nFailed = codegen::logCodegenResults(results);
+
     storage::shutdownFaasmS3();
+
+    return nFailed > 0 ? 1 : 0;
 }
@@ -0,0 +1,240 @@
+#include <storage/ArtifactCache.h>
+
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/testing.h>
+
+#include <filesystem>
+#include <openssl/evp.h>
+#include <sys/stat.h>
+
+namespace storage {
+
+ArtifactCache& getArtifactCache()
+{
+    static ArtifactCache cache;
+    return cache;
+}
+
+ArtifactCache::ArtifactCache()
+  : conf(conf::getFaasmConfig())
+{}
+
+std::vector<uint8_t> ArtifactCache::hashBytes(std::span<const uint8_t> bytes)
+{
+    EVP_MD_CTX* mdctx = EVP_MD_CTX_new();
+    EVP_DigestInit_ex(mdctx, EVP_md5(), NULL);
+    EVP_DigestUpdate(mdctx, bytes.data(), bytes.size());
+
+    unsigned int md5DigestLen = EVP_MD_size(EVP_md5());
+    std::vector<uint8_t> result(md5DigestLen);
+    EVP_DigestFinal_ex(mdctx, result.data(), &md5DigestLen);
+    EVP_MD_CTX_free(mdctx);
+
+    return result;
+}
+
+ArtifactCache::FileVersion ArtifactCache::getFileVersion(
+  const std::string& localPath)
+{
+    // Files we can't stat get an empty version, which never matches
+    FileVersion version;
+    struct stat fileStat;
+    if (::stat(localPath.c_str(), &fileStat) == 0) {
+        version.inode = fileStat.st_ino;
+        version.size = fileStat.st_size;
+        version.mtimeNs = fileStat.st_mtim.tv_sec * 1000000000L +
+                          fileStat.st_mtim.tv_nsec;
+    }
+
+    return version;
+}
+
+void ArtifactCache::put(const std::string& localPath,
+                        std::span<const uint8_t> bytes,
+                        const std::string& hashKey,
+                        const std::vector<uint8_t>& remoteHash)
+{
+    std::vector<uint8_t> hash = hashBytes(bytes);
+    FileVersion version = getFileVersion(localPath);
+
+    faabric::util::UniqueLock lock(mx);
+    Entry& e = entries[localPath];
+    totalSize -= e.size;
+
+    e.hash = hash;
+    e.version = version;
+    e.size = bytes.size();
+    e.hashKey = hashKey;
+    e.remoteHash = remoteHash;
+    e.lastUsed = ++useCounter;
+    totalSize += e.size;
+
+    evict(localPath);
+}
+
+void ArtifactCache::setRemoteHash(const std::string& localPath,
+                                  const std::vector<uint8_t>& remoteHash)
+{
+    faabric::util::UniqueLock lock(mx);
+    auto it = entries.find(localPath);
+    if (it != entries.end()) {
+        it->second.remoteHash = remoteHash;
+    }
+}
+
+bool ArtifactCache::check(const std::string& localPath,
+                          std::span<const uint8_t> bytes)
+{
+    FileVersion version = getFileVersion(localPath);
+
+    {
+        faabric::util::UniqueLock lock(mx);
+        auto it = entries.find(localPath);
+        if (it == entries.end()) {
+            return false;
+        }
+
+        if (it->second.version == version) {
+            it->second.lastUsed = ++useCounter;
+            return true;
+        }
+    }
+
+    // The file has changed on disk, so we hash its contents without holding
+    // the lock
+    SPDLOG_DEBUG("Cached artifact {} changed on disk, checking its hash",
+                 localPath);
+    std::vector<uint8_t> hash = hashBytes(bytes);
+
+    faabric::util::UniqueLock lock(mx);
+    auto it = entries.find(localPath);
+    if (it == entries.end()) {
+        return false;
+    }
+
+    if (it->second.hash != hash) {
+        SPDLOG_WARN("Cached artifact {} is corrupt, removing", localPath);
+        doRemove(localPath);
+        return false;
+    }
+
+    it->second.version = version;
+    it->second.lastUsed = ++useCounter;
+    return true;
+}
+
+bool ArtifactCache::isTracked(const std::string& localPath)
+{
+    faabric::util::UniqueLock lock(mx);
+    return entries.find(localPath) != entries.end();
+}
+
+int ArtifactCache::invalidate(
+  const std::function<std::vector<uint8_t>(const std::string&)>& getRemoteHash)
+{
+    // Take a copy of the entries, to fetch the remote hashes without holding
+    // the lock
+    std::unordered_map<std::string, Entry> toCheck;
+    {
+        faabric::util::UniqueLock lock(mx);
+        toCheck = entries;
+    }
+
+    std::unordered_map<std::string, std::vector<uint8_t>> remoteHashes;
+    std::vector<std::string> stale;
+    for (const auto& [path, e] : toCheck) {
+        // Artifacts without a remote hash can't be checked, so are dropped
+        if (!e.hashKey.empty() &&
+            remoteHashes.find(e.hashKey) == remoteHashes.end()) {
+            remoteHashes[e.hashKey] = getRemoteHash(e.hashKey);
+        }
+
+        if (e.hashKey.empty() || remoteHashes[e.hashKey].empty() ||
+            remoteHashes[e.hashKey] != e.remoteHash) {
+            stale.push_back(path);
+        }
+    }
+
+    faabric::util::UniqueLock lock(mx);
+    int nRemoved = 0;
+    for (const auto& path : stale) {
+        // Skip entries rewritten since we checked them
+        auto it = entries.find(path);
+        if (it == entries.end() ||
+            it->second.remoteHash != toCheck[path].remoteHash) {
+            continue;
+        }
+
+        SPDLOG_DEBUG("Removing stale cached artifact {}", path);
+        doRemove(path);
+        nRemoved++;
+    }
+
+    return nRemoved;
+}
+
+size_t ArtifactCache::getTotalSize()
+{
+    faabric::util::UniqueLock lock(mx);
+    return totalSize;
+}
+
+int ArtifactCache::getEntryCount()
+{
+    faabric::util::UniqueLock lock(mx);
+    return entries.size();
+}
+
+void ArtifactCache::clear()
+{
+    faabric::util::UniqueLock lock(mx);
+    entries.clear();
+    totalSize = 0;
+}
+
+void ArtifactCache::doRemove(std::string localPath)
+{
+    auto it = entries.find(localPath);
+    if (it != entries.end()) {
+        totalSize -= it->second.size;
+        entries.erase(it);
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(localPath, ec);
+    if (ec) {
+        SPDLOG_ERROR("Failed to remove cached artifact {}: {}",
+                     localPath,
+                     ec.message());
+    }
+}
+
+void ArtifactCache::evict(const std::string& keepPath)
+{
+    // Don't remove local files in test mode, as with clearing the cache
+    if (faabric::util::isTestMode() || conf.localCacheMaxMb <= 0) {
+        return;
+    }
+
+    size_t maxBytes = ((size_t)conf.localCacheMaxMb) * 1024 * 1024;
+    while (totalSize > maxBytes && entries.size() > 1) {
+        auto lru = entries.end();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->first == keepPath) {
+                continue;
+            }
+
+            if (lru == entries.end() ||
+                it->second.lastUsed < lru->second.lastUsed) {
+                lru = it;
+            }
+        }
+
+        SPDLOG_DEBUG("Evicting cached artifact {} ({} bytes)",
+                     lru->first,
+                     lru->second.size);
+        doRemove(lru->first);
+    }
+}
+}
@@ -7,16 +7,19 @@
 #include <faabric/util/timing.h>
 
 #include <conf/FaasmConfig.h>
+#include <storage/FileMapping.h>
 #include <storage/SharedFiles.h>
 
 #include <WAVM/WASI/WASIABI.h>
 #include <boost/filesystem.hpp>
 #include <dirent.h>
 #include <fcntl.h>
+#include <limits>
 #include <stdexcept>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/uio.h>
+#include <unistd.h>
 
 #define WASI_FD_FLAGS                                                          \
     (__WASI_FDFLAG_RSYNC | __WASI_FDFLAG_APPEND | __WASI_FDFLAG_DSYNC |        \
@@ -141,7 +144,7 @@ uint16_t errnoToWasi(int errnoIn)
     }
 }
 
-std::string FileDescriptor::getPath()
+const std::string& FileDescriptor::getPath() const
 {
     return path;
 }
@@ -521,6 +524,105 @@ ssize_t FileDescriptor::write(std::vector<::iovec>& nativeIovecs,
     return bytesWritten;
 }
 
+// Offsets are unsigned in WASI, but signed on Linux
+static bool isValidOffset(uint64_t offset)
+{
+    return offset <= (uint64_t)std::numeric_limits<off_t>::max();
+}
+
+ssize_t FileDescriptor::pread(std::vector<::iovec>& nativeIovecs,
+                              int iovecCount,
+                              uint64_t offset)
+{
+    if (!isValidOffset(offset)) {
+        wasiErrno = __WASI_EINVAL;
+        return -1;
+    }
+
+    ssize_t bytesRead =
+      ::preadv(getLinuxFd(), nativeIovecs.data(), iovecCount, (off_t)offset);
+    if (bytesRead < 0) {
+        wasiErrno = errnoToWasi(errno);
+    }
+
+    return bytesRead;
+}
+
+ssize_t FileDescriptor::pwrite(std::vector<::iovec>& nativeIovecs,
+                               int iovecCount,
+                               uint64_t offset)
+{
+    if (!isValidOffset(offset)) {
+        wasiErrno = __WASI_EINVAL;
+        return -1;
+    }
+
+    ssize_t bytesWritten =
+      ::pwritev(getLinuxFd(), nativeIovecs.data(), iovecCount, (off_t)offset);
+    if (bytesWritten < 0) {
+        SPDLOG_ERROR(
+          "pwritev failed on fd {}: {}", getLinuxFd(), strerror(errno));
+        wasiErrno = errnoToWasi(errno);
+        return -1;
+    }
+
+    if (SharedFiles::isPathShared(path)) {
+        SharedFiles::updateSharedFile(path);
+    }
+
+    return bytesWritten;
+}
+
+uint16_t FileDescriptor::allocate(uint64_t offset, uint64_t len)
+{
+    if (!isValidOffset(offset) || !isValidOffset(len)) {
+        return __WASI_EINVAL;
+    }
+
+    // Returns the error rather than setting errno
+    int res = ::posix_fallocate(linuxFd, (off_t)offset, (off_t)len);
+    if (res != 0) {
+        return errnoToWasi(res);
+    }
+
+    if (SharedFiles::isPathShared(path)) {
+        SharedFiles::updateSharedFile(path);
+    }
+
+    return __WASI_ESUCCESS;
+}
+
+uint16_t FileDescriptor::setSize(uint64_t size)
+{
+    if (!isValidOffset(size)) {
+        return __WASI_EINVAL;
+    }
+
+    // Shrinking the file would pull pages out from under its mappings
+    if (size < FileMapping::getMinFileSize(linuxFd)) {
+        return __WASI_EBUSY;
+    }
+
+    if (::ftruncate(linuxFd, (off_t)size) != 0) {
+        return errnoToWasi(errno);
+    }
+
+    if (SharedFiles::isPathShared(path)) {
+        SharedFiles::updateSharedFile(path);
+    }
+
+    return __WASI_ESUCCESS;
+}
+
+uint16_t FileDescriptor::sync() const
+{
+    if (::fsync(linuxFd) != 0) {
+        return errnoToWasi(errno);
+    }
+
+    return __WASI_ESUCCESS;
+}
+
 void FileDescriptor::close() const
 {
     if (linuxFd > 0) {
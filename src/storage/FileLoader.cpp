@@ -1,4 +1,6 @@
 #include <conf/FaasmConfig.h>
+#include <conf/isa.h>
+#include <storage/ArtifactCache.h>
 #include <storage/FileLoader.h>
 #include <storage/SharedFiles.h>
 
@@ -6,10 +8,14 @@
 #include <faabric/util/config.h>
 #include <faabric/util/files.h>
 #include <faabric/util/func.h>
+#include <faabric/util/gids.h>
+#include <faabric/util/locks.h>
 #include <faabric/util/testing.h>
 
 #include <filesystem>
+#include <shared_mutex>
 #include <stdexcept>
+#include <unordered_map>
 
 using namespace faabric::util;
 
@@ -51,6 +57,42 @@ static int removeAllInside(const std::filesystem::path& dir)
     return removedItemsCount;
 }
 
+static int removeUntrackedInside(const std::filesystem::path& dir)
+{
+    int removedItemsCount = 0;
+
+    if (!std::filesystem::is_directory(dir)) {
+        return removedItemsCount;
+    }
+
+    ArtifactCache& cache = getArtifactCache();
+    std::vector<std::filesystem::path> toRemove;
+    for (auto& dirElement :
+         std::filesystem::recursive_directory_iterator(dir)) {
+        if (dirElement.is_regular_file() &&
+            !cache.isTracked(dirElement.path().string())) {
+            toRemove.push_back(dirElement.path());
+        }
+    }
+
+    for (const auto& p : toRemove) {
+        removedItemsCount += std::filesystem::remove(p);
+    }
+
+    return removedItemsCount;
+}
+
+// Files in the local cache may be mapped into memory, so we must replace them
+// rather than truncate them in place
+static void replaceFileBytes(const std::string& path,
+                             const std::vector<uint8_t>& bytes)
+{
+    std::string tmpPath =
+      fmt::format("{}.{}.tmp", path, faabric::util::generateGid());
+    writeBytesToFile(tmpPath, bytes);
+    std::filesystem::rename(tmpPath, path);
+}
+
 static void createDirectories(const std::filesystem::path& path)
 {
     try {
@@ -92,6 +134,23 @@ static std::string getKey(const faabric::Message& msg,
     return key;
 }
 
+// The hash of the machine code for the current WASM VM, which is the hash of
+// the function wasm
+static std::string getMachineCodeHashKey(const faabric::Message& msg)
+{
+    std::string key;
+    const std::string& wasmVm = conf::getFaasmConfig().wasmVm;
+    if (wasmVm == "sgx") {
+        key = getKey(msg, SGX_WAMR_AOT_FILENAME);
+    } else if (wasmVm == "wamr") {
+        key = getKey(msg, WAMR_AOT_FILENAME);
+    } else {
+        key = getKey(msg, FUNC_OBJECT_FILENAME);
+    }
+
+    return key + HASH_EXT;
+}
+
 static std::filesystem::path getDir(std::string baseDir,
                                     const faabric::Message& msg,
                                     bool create)
@@ -136,6 +195,8 @@ FileLoader& getFileLoaderWithoutLocalCache()
 
 void FileLoader::clearLocalCache()
 {
+    clearBestIsas();
+
     if (faabric::util::isTestMode()) {
         SPDLOG_DEBUG("Not clearing local file loader cache in test mode");
         return;
@@ -152,6 +213,39 @@ void FileLoader::clearLocalCache()
 
     SPDLOG_DEBUG("Clearing the local shared files cache");
     SharedFiles::clear();
+
+    getArtifactCache().clear();
+}
+
+void FileLoader::invalidateLocalCache()
+{
+    // The machine code available may have changed along with the artifacts
+    clearBestIsas();
+
+    if (faabric::util::isTestMode()) {
+        SPDLOG_DEBUG("Not invalidating local file loader cache in test mode");
+        return;
+    }
+
+    // Remove the artifacts whose remote hash has changed
+    int nStale = getArtifactCache().invalidate(
+      [this](const std::string& hashKey) {
+          return s3.getKeyBytes(
+            conf.s3Bucket, trimLeadingSlashes(hashKey), true);
+      });
+
+    // We can't tell if files we haven't loaded are stale, so remove them
+    int nUntracked = removeUntrackedInside(conf.functionDir) +
+                     removeUntrackedInside(conf.objectFileDir);
+
+    SPDLOG_DEBUG("Removed {} stale and {} untracked cached files",
+                 nStale,
+                 nUntracked);
+
+    // Shared files are not tracked, so we clear them all
+    SPDLOG_DEBUG("Clearing shared files from {}", conf.sharedFilesDir);
+    removeAllInside(conf.sharedFilesDir);
+    SharedFiles::clear();
 }
 
 // -------------------------------------
@@ -187,12 +281,143 @@ std::vector<uint8_t> FileLoader::loadFileBytes(
                      conf.s3Bucket,
                      pathCopy,
                      localCachePath);
-        writeBytesToFile(localCachePath, bytes);
+        replaceFileBytes(localCachePath, bytes);
+    }
+
+    return bytes;
+}
+
+std::vector<uint8_t> FileLoader::loadArtifactBytes(
+  const std::string& path,
+  const std::string& localCachePath,
+  const std::string& hashKey,
+  bool tolerateMissing)
+{
+    ArtifactCache& cache = getArtifactCache();
+
+    if (useLocalFsCache && std::filesystem::exists(localCachePath)) {
+        std::vector<uint8_t> bytes =
+          loadFileBytes(path, localCachePath, tolerateMissing);
+
+        // Start tracking files cached before we started
+        if (!cache.isTracked(localCachePath)) {
+            cache.put(localCachePath,
+                      bytes,
+                      hashKey,
+                      getExpectedRemoteHash(path, hashKey, bytes));
+            return bytes;
+        }
+
+        if (cache.check(localCachePath, bytes)) {
+            return bytes;
+        }
+
+        SPDLOG_WARN("Reloading corrupt cached file {}", localCachePath);
+    }
+
+    std::vector<uint8_t> bytes =
+      loadFileBytes(path, localCachePath, tolerateMissing);
+    if (!bytes.empty() && useLocalFsCache) {
+        cache.put(localCachePath,
+                  bytes,
+                  hashKey,
+                  getExpectedRemoteHash(path, hashKey, bytes));
     }
 
     return bytes;
 }
 
+std::shared_ptr<MappedFile> FileLoader::mapArtifactFile(
+  const std::string& path,
+  const std::string& localCachePath,
+  const std::string& hashKey)
+{
+    if (!useLocalFsCache) {
+        return std::make_shared<MappedFile>(
+          loadFileBytes(path, localCachePath));
+    }
+
+    ArtifactCache& cache = getArtifactCache();
+    if (std::filesystem::exists(localCachePath)) {
+        if (std::filesystem::is_directory(localCachePath)) {
+            SPDLOG_ERROR("Local cache path ({}) exists but is a directory",
+                         localCachePath);
+            throw SharedFileIsDirectoryException(localCachePath);
+        }
+
+        auto mappedFile = std::make_shared<MappedFile>(localCachePath);
+
+        // Start tracking files cached before we started
+        if (!cache.isTracked(localCachePath)) {
+            cache.put(
+              localCachePath,
+              mappedFile->getSpan(),
+              hashKey,
+              getExpectedRemoteHash(path, hashKey, mappedFile->getSpan()));
+            return mappedFile;
+        }
+
+        if (cache.check(localCachePath, mappedFile->getSpan())) {
+            return mappedFile;
+        }
+
+        SPDLOG_WARN("Reloading corrupt cached file {}", localCachePath);
+    }
+
+    // Stream from S3 straight to the local cache, then map it
+    std::string pathCopy = trimLeadingSlashes(path);
+    s3.getKeyToFile(conf.s3Bucket, pathCopy, localCachePath);
+
+    auto mappedFile = std::make_shared<MappedFile>(localCachePath);
+    cache.put(localCachePath,
+              mappedFile->getSpan(),
+              hashKey,
+              getExpectedRemoteHash(path, hashKey, mappedFile->getSpan()));
+
+    return mappedFile;
+}
+
+std::vector<uint8_t> FileLoader::getExpectedRemoteHash(
+  const std::string& path,
+  const std::string& hashKey,
+  std::span<const uint8_t> bytes)
+{
+    // Hash files are checked against themselves
+    if (hashKey == path) {
+        return std::vector<uint8_t>(bytes.begin(), bytes.end());
+    }
+
+    // Machine code is checked against the hash uploaded alongside it
+    if (hashKey == getHashFilePath(path)) {
+        return s3.getKeyBytes(conf.s3Bucket, trimLeadingSlashes(hashKey), true);
+    }
+
+    // Wasm is checked against the hash of its machine code, which is the hash
+    // of the wasm itself
+    return ArtifactCache::hashBytes(bytes);
+}
+
+void FileLoader::uploadArtifactBytes(const std::string& path,
+                                     const std::string& localCachePath,
+                                     const std::string& hashKey,
+                                     const std::vector<uint8_t>& bytes)
+{
+    uploadFileBytes(path, localCachePath, bytes);
+
+    if (!useLocalFsCache || localCachePath.empty()) {
+        return;
+    }
+
+    // Machine code is uploaded before its hash, which updates the expected
+    // remote hash
+    std::vector<uint8_t> remoteHash;
+    if (hashKey != getHashFilePath(path)) {
+        remoteHash = getExpectedRemoteHash(path, hashKey, bytes);
+    }
+
+    getArtifactCache().put(localCachePath, bytes, hashKey, remoteHash);
+}
+
 void FileLoader::uploadFileBytes(const std::string& path,
                                  const std::string& localCachePath,
                                  const std::vector<uint8_t>& bytes)
@@ -205,7 +430,7 @@ void FileLoader::uploadFileBytes(const std::string& path,
                      conf.s3Bucket,
                      pathCopy,
                      localCachePath);
-        writeBytesToFile(localCachePath, bytes);
+        replaceFileBytes(localCachePath, bytes);
     }
 }
 
@@ -223,7 +448,7 @@ void FileLoader::uploadFileString(const std::string& path,
                      conf.s3Bucket,
                      pathCopy,
                      localCachePath);
-        writeBytesToFile(localCachePath, stringToBytes(bytes));
+        replaceFileBytes(localCachePath, stringToBytes(bytes));
     }
 }
 
@@ -240,16 +465,22 @@ std::vector<uint8_t> FileLoader::loadHashFileBytes(
   const std::string& path,
   const std::string& localCachePath)
 {
-    return loadFileBytes(
-      getHashFilePath(path), getHashFilePath(localCachePath), true);
+    const std::string hashPath = getHashFilePath(path);
+    return loadArtifactBytes(
+      hashPath, getHashFilePath(localCachePath), hashPath, true);
 }
 
 void FileLoader::uploadHashFileBytes(const std::string& path,
                                      const std::string& localCachePath,
                                      const std::vector<uint8_t>& bytes)
 {
-    uploadFileBytes(
-      getHashFilePath(path), getHashFilePath(localCachePath), bytes);
+    const std::string hashPath = getHashFilePath(path);
+    uploadArtifactBytes(
+      hashPath, getHashFilePath(localCachePath), hashPath, bytes);
+
+    if (useLocalFsCache && !localCachePath.empty()) {
+        getArtifactCache().setRemoteHash(localCachePath, bytes);
+    }
 }
 
 // -------------------------------------
@@ -267,7 +498,7 @@ std::vector<uint8_t> FileLoader::loadFunctionWasm(const faabric::Message& msg)
 {
     const std::string key = getKey(msg, FUNC_FILENAME);
     const std::string localCachePath = getFunctionFile(msg);
-    return loadFileBytes(key, localCachePath);
+    return loadArtifactBytes(key, localCachePath, getMachineCodeHashKey(msg));
 }
 
 void FileLoader::uploadFunction(faabric::Message& msg)
@@ -276,50 +507,157 @@ void FileLoader::uploadFunction(faabric::Message& msg)
     const std::string localCachePath = getFunctionFile(msg);
 
     // Note, when uploading, the input data is the function body
-    const std::string& inputBytes = msg.inputdata();
-    uploadFileString(key, localCachePath, inputBytes);
+    const std::vector<uint8_t> inputBytes = stringToBytes(msg.inputdata());
+    uploadArtifactBytes(
+      key, localCachePath, getMachineCodeHashKey(msg), inputBytes);
+}
+
+// -------------------------------------
+// ISA-SPECIFIC MACHINE CODE
+// -------------------------------------
+
+// Machine code specialised for an ISA lives next to the generic one, e.g.
+// function.aot.avx2
+static std::string getIsaPath(const std::string& path, const std::string& isa)
+{
+    if (isa.empty()) {
+        return path;
+    }
+
+    return path + "." + isa;
+}
+
+// The best ISA found for each machine code key, along with the ISAs configured
+// when it was found. Misses (i.e. only generic machine code) are recorded too,
+// so that we only probe S3 once per function
+struct BestIsa
+{
+    std::string configuredIsas;
+    std::string isa;
+};
+
+static std::shared_mutex bestIsasMx;
+static std::unordered_map<std::string, BestIsa> bestIsas;
+
+static void clearBestIsa(const std::string& key)
+{
+    faabric::util::FullLock lock(bestIsasMx);
+    bestIsas.erase(key);
+}
+
+void FileLoader::clearBestIsas()
+{
+    faabric::util::FullLock lock(bestIsasMx);
+    bestIsas.clear();
+}
+
+std::string FileLoader::getBestIsa(const std::string& key,
+                                   const std::string& localCachePath)
+{
+    {
+        faabric::util::SharedLock lock(bestIsasMx);
+        auto it = bestIsas.find(key);
+        if (it != bestIsas.end() &&
+            it->second.configuredIsas == conf.codegenIsas) {
+            return it->second.isa;
+        }
+    }
+
+    // Specialised machine code is only used if it was generated from the same
+    // wasm as the generic machine code, i.e. if their hashes match. Otherwise
+    // it's left over from a previous upload of the function
+    std::vector<uint8_t> genericHash = s3.getKeyBytes(
+      conf.s3Bucket, trimLeadingSlashes(getHashFilePath(key)), true);
+
+    std::string bestIsa;
+    for (const auto& isa : conf::getHostCodegenIsas()) {
+        if (genericHash.empty()) {
+            break;
+        }
+
+        std::string isaCachePath = getIsaPath(localCachePath, isa);
+        if (useLocalFsCache && std::filesystem::exists(isaCachePath) &&
+            std::filesystem::exists(getHashFilePath(isaCachePath)) &&
+            readFileToBytes(getHashFilePath(isaCachePath)) == genericHash) {
+            bestIsa = isa;
+            break;
+        }
+
+        // The hash is uploaded with the machine code, and is much smaller
+        std::string hashKey = getHashFilePath(getIsaPath(key, isa));
+        if (s3.getKeyBytes(conf.s3Bucket, trimLeadingSlashes(hashKey), true) ==
+            genericHash) {
+            bestIsa = isa;
+            break;
+        }
+    }
+
+    faabric::util::FullLock lock(bestIsasMx);
+    bestIsas[key] = { conf.codegenIsas, bestIsa };
+
+    return bestIsa;
 }
 
 // -------------------------------------
 // FUNCTION OBJECT FILES
 // -------------------------------------
 
-std::string FileLoader::getFunctionObjectFile(const faabric::Message& msg)
+std::string FileLoader::getFunctionObjectFile(const faabric::Message& msg,
+                                              const std::string& isa)
 {
     auto path = getDir(conf.objectFileDir, msg, true);
     path.append(FUNC_OBJECT_FILENAME);
-    return path.string();
+    return getIsaPath(path.string(), isa);
 }
 
 std::vector<uint8_t> FileLoader::loadFunctionObjectFile(
   const faabric::Message& msg)
 {
-    const std::string key = getKey(msg, FUNC_OBJECT_FILENAME);
-    const std::string localCachePath = getFunctionObjectFile(msg);
-    return loadFileBytes(key, localCachePath);
+    std::string key = getKey(msg, FUNC_OBJECT_FILENAME);
+    std::string isa = getBestIsa(key, getFunctionObjectFile(msg));
+
+    key = getIsaPath(key, isa);
+    const std::string localCachePath = getFunctionObjectFile(msg, isa);
+    return loadArtifactBytes(key, localCachePath, getHashFilePath(key));
 }
 
-std::vector<uint8_t> FileLoader::loadFunctionObjectHash(
+std::shared_ptr<MappedFile> FileLoader::mapFunctionObjectFile(
   const faabric::Message& msg)
 {
-    const std::string key = getKey(msg, FUNC_OBJECT_FILENAME);
-    const std::string localCachePath = getFunctionObjectFile(msg);
+    std::string key = getKey(msg, FUNC_OBJECT_FILENAME);
+    std::string isa = getBestIsa(key, getFunctionObjectFile(msg));
+
+    key = getIsaPath(key, isa);
+    const std::string localCachePath = getFunctionObjectFile(msg, isa);
+    return mapArtifactFile(key, localCachePath, getHashFilePath(key));
+}
+
+std::vector<uint8_t> FileLoader::loadFunctionObjectHash(
+  const faabric::Message& msg,
+  const std::string& isa)
+{
+    const std::string key = getIsaPath(getKey(msg, FUNC_OBJECT_FILENAME), isa);
+    const std::string localCachePath = getFunctionObjectFile(msg, isa);
     return loadHashFileBytes(key, localCachePath);
 }
 
 void FileLoader::uploadFunctionObjectFile(const faabric::Message& msg,
-                                          const std::vector<uint8_t>& objBytes)
+                                          const std::vector<uint8_t>& objBytes,
+                                          const std::string& isa)
 {
-    const std::string key = getKey(msg, FUNC_OBJECT_FILENAME);
-    const std::string localCachePath = getFunctionObjectFile(msg);
-    uploadFileBytes(key, localCachePath, objBytes);
+    const std::string genericKey = getKey(msg, FUNC_OBJECT_FILENAME);
+    const std::string key = getIsaPath(genericKey, isa);
+    const std::string localCachePath = getFunctionObjectFile(msg, isa);
+    uploadArtifactBytes(key, localCachePath, getHashFilePath(key), objBytes);
+    clearBestIsa(genericKey);
 }
 
 void FileLoader::uploadFunctionObjectHash(const faabric::Message& msg,
-                                          const std::vector<uint8_t>& hash)
+                                          const std::vector<uint8_t>& hash,
+                                          const std::string& isa)
 {
-    const std::string key = getKey(msg, FUNC_OBJECT_FILENAME);
-    const std::string localCachePath = getFunctionObjectFile(msg);
+    const std::string key = getIsaPath(getKey(msg, FUNC_OBJECT_FILENAME), isa);
+    const std::string localCachePath = getFunctionObjectFile(msg, isa);
     uploadHashFileBytes(key, localCachePath, hash);
 }
 
@@ -336,7 +674,8 @@ static const std::string getWamrAotKey(const faabric::Message& msg)
     }
 }
 
-std::string FileLoader::getFunctionAotFile(const faabric::Message& msg)
+std::string FileLoader::getFunctionAotFile(const faabric::Message& msg,
+                                           const std::string& isa)
 {
     auto path = getDir(conf.objectFileDir, msg, true);
     if (conf::getFaasmConfig().wasmVm == "sgx") {
@@ -345,41 +684,92 @@ std::string FileLoader::getFunctionAotFile(const faabric::Message& msg)
         path.append(WAMR_AOT_FILENAME);
     }
 
-    return path.string();
+    return getIsaPath(path.string(), isa);
+}
+
+std::string FileLoader::getBestAotIsa(const faabric::Message& msg)
+{
+    // SGX machine code is not specialised
+    if (conf::getFaasmConfig().wasmVm == "sgx") {
+        return "";
+    }
+
+    return getBestIsa(getWamrAotKey(msg), getFunctionAotFile(msg));
 }
 
 std::vector<uint8_t> FileLoader::loadFunctionWamrAotFile(
   const faabric::Message& msg)
 {
-    const std::string key = getWamrAotKey(msg);
-    const std::string localCachePath = getFunctionAotFile(msg);
-    return loadFileBytes(key, localCachePath);
+    std::string isa = getBestAotIsa(msg);
+    const std::string key = getIsaPath(getWamrAotKey(msg), isa);
+    const std::string localCachePath = getFunctionAotFile(msg, isa);
+    return loadArtifactBytes(key, localCachePath, getHashFilePath(key));
 }
 
-std::vector<uint8_t> FileLoader::loadFunctionWamrAotHash(
+std::shared_ptr<MappedFile> FileLoader::mapFunctionWamrAotFile(
   const faabric::Message& msg)
 {
-    const std::string key = getWamrAotKey(msg);
-    const std::string localCachePath = getFunctionAotFile(msg);
+    std::string isa = getBestAotIsa(msg);
+    const std::string key = getIsaPath(getWamrAotKey(msg), isa);
+    const std::string localCachePath = getFunctionAotFile(msg, isa);
+    return mapArtifactFile(key, localCachePath, getHashFilePath(key));
+}
+
+std::vector<uint8_t> FileLoader::loadFunctionWamrAotHash(
+  const faabric::Message& msg,
+  const std::string& isa)
+{
+    const std::string key = getIsaPath(getWamrAotKey(msg), isa);
+    const std::string localCachePath = getFunctionAotFile(msg, isa);
     return loadHashFileBytes(key, localCachePath);
 }
 
 void FileLoader::uploadFunctionWamrAotFile(const faabric::Message& msg,
-                                           const std::vector<uint8_t>& objBytes)
+                                           const std::vector<uint8_t>& objBytes,
+                                           const std::string& isa)
 {
-    const std::string key = getWamrAotKey(msg);
-    const std::string localCachePath = getFunctionAotFile(msg);
-    uploadFileBytes(key, localCachePath, objBytes);
+    const std::string genericKey = getWamrAotKey(msg);
+    const std::string key = getIsaPath(genericKey, isa);
+    const std::string localCachePath = getFunctionAotFile(msg, isa);
+    uploadArtifactBytes(key, localCachePath, getHashFilePath(key), objBytes);
+    clearBestIsa(genericKey);
 }
 
 void FileLoader::uploadFunctionWamrAotHash(const faabric::Message& msg,
-                                           const std::vector<uint8_t>& hash)
+                                           const std::vector<uint8_t>& hash,
+                                           const std::string& isa)
 {
-    const std::string key = getWamrAotKey(msg);
-    const std::string localCachePath = getFunctionAotFile(msg);
+    const std::string key = getIsaPath(getWamrAotKey(msg), isa);
+    const std::string localCachePath = getFunctionAotFile(msg, isa);
     uploadHashFileBytes(key, localCachePath, hash);
 }
 
+void FileLoader::deleteFunctionWamrAotHashes(const faabric::Message& msg)
+{
+    std::vector<std::string> isas = { "" };
+    for (const auto& isa : conf::getKnownCodegenIsas()) {
+        isas.push_back(isa);
+    }
+
+    for (const auto& isa : isas) {
+        const std::string key = getIsaPath(getWamrAotKey(msg), isa);
+        s3.deleteKey(conf.s3Bucket, trimLeadingSlashes(getHashFilePath(key)));
+
+        if (useLocalFsCache) {
+            std::filesystem::remove(
+              getHashFilePath(getFunctionAotFile(msg, isa)));
+        }
+
+        // Specialised machine code is stale without its hash, so we remove
+        // it rather than let it be picked over the generic machine code
+        if (!isa.empty() && useLocalFsCache) {
+            std::filesystem::remove(getFunctionAotFile(msg, isa));
+        }
+    }
+
+    clearBestIsa(getWamrAotKey(msg));
+}
+
 // -------------------------------------
 // ENCRYPTED FUNCTION WASM
 // -------------------------------------
@@ -443,7 +833,14 @@ std::vector<uint8_t> FileLoader::loadSharedObjectObjectFile(
   const std::string& path)
 {
     const std::string localCachePath = getSharedObjectObjectFile(path);
-    return loadFileBytes(path, localCachePath);
+    return loadArtifactBytes(path, localCachePath, getHashFilePath(path));
+}
+
+std::shared_ptr<MappedFile> FileLoader::mapSharedObjectObjectFile(
+  const std::string& path)
+{
+    const std::string localCachePath = getSharedObjectObjectFile(path);
+    return mapArtifactFile(path, localCachePath, getHashFilePath(path));
 }
 
 std::vector<uint8_t> FileLoader::loadSharedObjectObjectHash(
@@ -458,7 +855,7 @@ void FileLoader::uploadSharedObjectObjectFile(
   const std::vector<uint8_t>& objBytes)
 {
     const std::string localCachePath = getSharedObjectObjectFile(path);
-    uploadFileBytes(path, localCachePath, objBytes);
+    uploadArtifactBytes(path, localCachePath, getHashFilePath(path), objBytes);
 }
 
 void FileLoader::uploadSharedObjectObjectHash(const std::string& path,
@@ -496,6 +893,52 @@ std::vector<uint8_t> FileLoader::loadSharedFile(const std::string& path)
     return bytes;
 }
 
+bool FileLoader::loadSharedFileToPath(const std::string& path,
+                                      const std::string& destPath)
+{
+    const std::string localCachePath = getSharedFileFile(path);
+
+    // Check locally first
+    if (useLocalFsCache && std::filesystem::exists(localCachePath)) {
+        if (std::filesystem::is_directory(localCachePath)) {
+            SPDLOG_ERROR("Local cache path ({}) exists but is a directory",
+                         localCachePath);
+            throw SharedFileIsDirectoryException(localCachePath);
+        }
+
+        if (localCachePath != destPath) {
+            SPDLOG_TRACE("Copying {} from {} to {}",
+                         path,
+                         localCachePath,
+                         destPath);
+            std::filesystem::copy_file(
+              localCachePath,
+              destPath,
+              std::filesystem::copy_options::overwrite_existing);
+        }
+
+        return true;
+    }
+
+    std::string pathCopy = trimLeadingSlashes(path);
+    if (!s3.getKeyToFile(conf.s3Bucket, pathCopy, destPath, true)) {
+        return false;
+    }
+
+    if (useLocalFsCache && localCachePath != destPath) {
+        SPDLOG_TRACE("Caching S3 key {}/{} at {}",
+                     conf.s3Bucket,
+                     pathCopy,
+                     localCachePath);
+        std::filesystem::copy_file(
+          destPath,
+          localCachePath,
+          std::filesystem::copy_options::overwrite_existing);
+    }
+
+    return true;
+}
+
 void FileLoader::deleteSharedFile(const std::string& path)
 {
     std::string pathCopy = trimLeadingSlashes(path);
@@ -0,0 +1,60 @@
+#include <storage/FileMapping.h>
+
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace storage {
+
+// The lengths of the live mappings of each file
+static std::mutex fileMappingsMx;
+static std::map<std::pair<dev_t, ino_t>, std::multiset<size_t>> fileMappings;
+
+static std::pair<dev_t, ino_t> getFileId(int linuxFd)
+{
+    struct stat fileStat;
+    if (::fstat(linuxFd, &fileStat) != 0) {
+        SPDLOG_ERROR("Error stat-ing fd {}: {}", linuxFd, strerror(errno));
+        throw std::runtime_error("Error stat-ing file descriptor");
+    }
+
+    return { fileStat.st_dev, fileStat.st_ino };
+}
+
+FileMapping::FileMapping(int linuxFd, size_t lengthIn)
+  : fileId(getFileId(linuxFd))
+  , length(lengthIn)
+{
+    faabric::util::UniqueLock lock(fileMappingsMx);
+    fileMappings[fileId].insert(length);
+}
+
+FileMapping::~FileMapping()
+{
+    faabric::util::UniqueLock lock(fileMappingsMx);
+    auto it = fileMappings.find(fileId);
+    it->second.erase(it->second.find(length));
+    if (it->second.empty()) {
+        fileMappings.erase(it);
+    }
+}
+
+size_t FileMapping::getMinFileSize(int linuxFd)
+{
+    auto fileId = getFileId(linuxFd);
+
+    faabric::util::UniqueLock lock(fileMappingsMx);
+    auto it = fileMappings.find(fileId);
+    if (it == fileMappings.end()) {
+        return 0;
+    }
+
+    return *it->second.rbegin();
+}
+}
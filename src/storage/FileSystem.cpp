@@ -16,21 +16,27 @@ void FileSystem::prepareFilesystem()
     fileDescriptors.clear();
 
     // Predefined stdin, stdout and stderr
-    fileDescriptors.emplace(0, storage::FileDescriptor::stdinFactory());
-    fileDescriptors.emplace(1, storage::FileDescriptor::stdoutFactory());
-    fileDescriptors.emplace(2, storage::FileDescriptor::stderrFactory());
+    fileDescriptors.push_back(storage::FileDescriptor::stdinFactory());
+    fileDescriptors.push_back(storage::FileDescriptor::stdoutFactory());
+    fileDescriptors.push_back(storage::FileDescriptor::stderrFactory());
 
     // Add roots, note that they are predefined as the file descriptors
-    // just above the stdxxx's (i.e. > 3)
+    // just above the stdxxx's (i.e. > 3). Subsequent file descriptors start
+    // after them
     createPreopenedFileDescriptor(3, "/");
     createPreopenedFileDescriptor(4, ".");
-
-    // Set the starting point for subsequent file descriptors
-    nextFd = 5;
 }
 
 void FileSystem::createPreopenedFileDescriptor(int fd, const std::string& path)
 {
+    // Fds are indexes into the table, so can't leave gaps
+    if (fd != (int)fileDescriptors.size()) {
+        SPDLOG_ERROR("Preopened fd {} is not the next fd ({})",
+                     fd,
+                     fileDescriptors.size());
+        throw std::runtime_error("Preopened fd is not the next fd");
+    }
+
     // Open the descriptor as a directory
     storage::FileDescriptor fileDesc;
     fileDesc.setPath(path);
@@ -53,21 +59,22 @@ void FileSystem::createPreopenedFileDescriptor(int fd, const std::string& path)
 
     // Add to this module's fds
     fileDesc.wasiPreopenType = __WASI_PREOPENTYPE_DIR;
-    fileDescriptors.emplace(fd, fileDesc);
+    fileDescriptors.push_back(std::move(fileDesc));
 }
 
 int FileSystem::getNewFd()
 {
-    // Assign a new file descriptor
-    int thisFd = nextFd;
-    nextFd++;
+    // Assign a new file descriptor at the end of the table
+    int thisFd = fileDescriptors.size();
+    fileDescriptors.emplace_back();
     return thisFd;
 }
 
-std::string FileSystem::getPathForFd(int fd)
+const std::string& FileSystem::getPathForFd(int fd)
 {
-    if (fileDescriptors.count(fd) == 0) {
-        return "";
+    static const std::string noPath;
+    if (!fileDescriptorExists(fd)) {
+        return noPath;
     }
 
     return fileDescriptors[fd].getPath();
@@ -97,7 +104,7 @@ int FileSystem::openFileDescriptor(int rootFd,
 
     // Initialise the new fd
     int thisFd = getNewFd();
-    FileDescriptor& fileDesc = fileDescriptors[thisFd];
+    FileDescriptor& fileDesc = fileDescriptors.back();
     fileDesc.setPath(fullPath);
 
     // AND requested rights with those of the root file descriptor. Rights for
@@ -122,16 +129,16 @@ int FileSystem::openFileDescriptor(int rootFd,
 
 bool FileSystem::fileDescriptorExists(int fd)
 {
-    return fileDescriptors.count(fd) > 0;
+    return fd >= 0 && fd < (int)fileDescriptors.size();
 }
 
 storage::FileDescriptor& FileSystem::getFileDescriptor(int fd)
 {
-    if (fileDescriptors.count(fd) == 0) {
+    if (!fileDescriptorExists(fd)) {
         throw std::runtime_error("File descriptor does not exist");
     }
 
-    return fileDescriptors.at(fd);
+    return fileDescriptors[fd];
 }
 
 int FileSystem::dup(int fd)
@@ -149,8 +156,8 @@ void FileSystem::tearDown()
 {
     for (auto& f : fileDescriptors) {
         // Only close non-preopened fds
-        if (f.second.wasiPreopenType != __WASI_PREOPENTYPE_DIR) {
-            f.second.close();
+        if (f.wasiPreopenType != __WASI_PREOPENTYPE_DIR) {
+            f.close();
         }
     }
 }
@@ -158,8 +165,8 @@ void FileSystem::tearDown()
 void FileSystem::printDebugInfo()
 {
     printf("--- Open file descriptors ---\n");
-    for (auto& p : fileDescriptors) {
-        printf("    %s\n", p.second.getPath().c_str());
+    for (auto& f : fileDescriptors) {
+        printf("    %s\n", f.getPath().c_str());
     }
 }
 
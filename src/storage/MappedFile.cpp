@@ -0,0 +1,89 @@
+#include <storage/MappedFile.h>
+
+#include <faabric/util/logging.h>
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace storage {
+
+MappedFile::MappedFile(const std::string& pathIn)
+  : path(pathIn)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        SPDLOG_ERROR("Failed to open {} for mapping: {}", path, errno);
+        throw std::runtime_error("Failed to open file for mapping");
+    }
+
+    struct stat statBuf;
+    if (::fstat(fd, &statBuf) < 0) {
+        SPDLOG_ERROR("Failed to stat {} for mapping: {}", path, errno);
+        ::close(fd);
+        throw std::runtime_error("Failed to stat file for mapping");
+    }
+
+    mappedSize = statBuf.st_size;
+
+    // Can't map an empty file
+    if (mappedSize > 0) {
+        void* ptr = ::mmap(nullptr,
+                           mappedSize,
+                           PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE,
+                           fd,
+                           0);
+        if (ptr == MAP_FAILED) {
+            SPDLOG_ERROR(
+              "Failed to map {} ({} bytes): {}", path, mappedSize, errno);
+            ::close(fd);
+            throw std::runtime_error("Failed to map file");
+        }
+
+        mappedPtr = static_cast<uint8_t*>(ptr);
+    }
+
+    // The mapping keeps the file alive, even if it's removed or replaced
+    ::close(fd);
+
+    SPDLOG_TRACE("Mapped {} ({} bytes)", path, mappedSize);
+}
+
+MappedFile::MappedFile(std::vector<uint8_t>&& bytesIn)
+  : bytes(std::move(bytesIn))
+{}
+
+MappedFile::~MappedFile()
+{
+    if (mappedPtr != nullptr) {
+        ::munmap(mappedPtr, mappedSize);
+    }
+}
+
+std::span<const uint8_t> MappedFile::getSpan() const
+{
+    if (isMapped()) {
+        return std::span<const uint8_t>(mappedPtr, mappedSize);
+    }
+
+    return std::span<const uint8_t>(bytes.data(), bytes.size());
+}
+
+uint8_t* MappedFile::data()
+{
+    return isMapped() ? mappedPtr : bytes.data();
+}
+
+size_t MappedFile::size() const
+{
+    return isMapped() ? mappedSize : bytes.size();
+}
+
+bool MappedFile::isMapped() const
+{
+    return !path.empty();
+}
+}
@@ -1,9 +1,12 @@
 #include <conf/FaasmConfig.h>
 #include <faabric/util/bytes.h>
+#include <faabric/util/gids.h>
 #include <faabric/util/logging.h>
 #include <storage/S3Wrapper.h>
 
 #include <boost/algorithm/string/trim.hpp>
+#include <filesystem>
+#include <fstream>
 
 namespace storage {
 
@@ -325,4 +328,64 @@ std::string S3Wrapper::getKeyStr(const std::string& bucketName,
 
     return data;
 }
+
+bool S3Wrapper::getKeyToFile(const std::string& bucketName,
+                             const std::string& keyName,
+                             const std::string& filePath,
+                             bool tolerateMissing)
+{
+    SPDLOG_TRACE(
+      "Getting S3 key {}/{} to file {}", bucketName, keyName, filePath);
+
+    // Write to a temporary file and move it in place once complete, so that
+    // nobody reads a partially written file
+    std::string tmpPath =
+      fmt::format("{}.{}.tmp", filePath, faabric::util::generateGid());
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        SPDLOG_ERROR("Could not open {} to write S3 key {}/{}",
+                     tmpPath,
+                     bucketName,
+                     keyName);
+        throw std::runtime_error("Could not open file to write S3 key");
+    }
+
+    minio::s3::GetObjectArgs args;
+    args.bucket = bucketName;
+    args.object = keyName;
+
+    args.datafunc = [&out](minio::http::DataFunctionArgs args) -> bool {
+        out.write(args.datachunk.data(), args.datachunk.size());
+        return out.good();
+    };
+
+    auto response = client.GetObject(args);
+    out.close();
+
+    if (!response) {
+        std::filesystem::remove(tmpPath);
+
+        auto error = parseError(response.code);
+        if (tolerateMissing && (error == S3Error::NoSuchKey)) {
+            SPDLOG_TRACE(
+              "Tolerating missing S3 key {}/{}", bucketName, keyName);
+            return false;
+        }
+
+        CHECK_ERRORS(response, bucketName, keyName);
+    }
+
+    if (out.fail()) {
+        std::filesystem::remove(tmpPath);
+        SPDLOG_ERROR("Failed writing S3 key {}/{} to {}",
+                     bucketName,
+                     keyName,
+                     tmpPath);
+        throw std::runtime_error("Failed writing S3 key to file");
+    }
+
+    std::filesystem::rename(tmpPath, filePath);
+
+    return true;
+}
 }
@@ -11,6 +11,10 @@
 #include <conf/FaasmConfig.h>
 #include <storage/FileLoader.h>
 
+#include <exception>
+#include <memory>
+#include <mutex>
+
 namespace storage {
 enum FileState
 {
@@ -23,6 +27,18 @@ enum FileState
 static std::shared_mutex sharedFileMapMutex;
 static std::unordered_map<std::string, FileState> sharedFileMap;
 
+// Syncs in progress, so that threads syncing the same path wait for each
+// other without holding the global lock during the download. If the sync
+// fails, threads that were waiting on it rethrow its error
+struct InFlightSync
+{
+    std::mutex mx;
+    std::exception_ptr error = nullptr;
+};
+
+static std::unordered_map<std::string, std::shared_ptr<InFlightSync>>
+  inFlightSyncs;
+
 std::string SharedFiles::prependSharedRoot(const std::string& originalPath)
 {
     conf::FaasmConfig& conf = conf::getFaasmConfig();
@@ -67,9 +83,8 @@ void SharedFiles::updateSharedFile(const std::string& p)
     loader.uploadSharedFile(relativePath, bytes);
 }
 
-int getReturnValueForSharedFileState(const std::string& sharedPath)
+static int getReturnValueForSharedFileState(FileState state)
 {
-    FileState& state = sharedFileMap[sharedPath];
     switch (state) {
         case (NOT_EXISTS): {
             return ENOENT;
@@ -92,33 +107,100 @@ void SharedFiles::clearCacheForSharedFile(const std::string& sharedPath)
     sharedFileMap.erase(sharedPath);
 }
 
+static FileState checkSharedFileState(const std::string& sharedPath,
+                                      const std::string& localPath)
+{
+    faabric::util::SharedLock lock(sharedFileMapMutex);
+    auto it = sharedFileMap.find(sharedPath);
+    if (it == sharedFileMap.end()) {
+        return NOT_CHECKED;
+    }
+
+    if (localPath.empty()) {
+        SPDLOG_TRACE("Not syncing shared file {}, already checked",
+                     sharedPath);
+    } else {
+        SPDLOG_TRACE(
+          "Not syncing shared file {}, cached at {}", sharedPath, localPath);
+    }
+
+    return it->second;
+}
+
+// Syncs the file to its real path on the local filesystem, returning its
+// state
+static FileState doSyncSharedFile(const std::string& strippedPath,
+                                  const std::string& realPath)
+{
+    FileState state;
+
+    // Check the filesystem
+    if (boost::filesystem::exists(realPath)) {
+        // If already exists on filesystem, just mark it as such
+        if (boost::filesystem::is_directory(realPath)) {
+            state = EXISTS_DIR;
+        } else {
+            state = EXISTS;
+        }
+    } else {
+        boost::filesystem::path p(realPath);
+
+        // Create parent directory
+        if (p.has_parent_path()) {
+            boost::filesystem::create_directories(p.parent_path());
+        }
+
+        // Stream the file straight to its real path
+        FileLoader& loader = getFileLoader();
+        try {
+            if (loader.loadSharedFileToPath(strippedPath, realPath)) {
+                state = EXISTS;
+            } else {
+                state = NOT_EXISTS;
+            }
+        } catch (storage::SharedFileIsDirectoryException& e) {
+            // Create directory if path is a directory
+            boost::filesystem::create_directories(p);
+            state = EXISTS_DIR;
+        }
+    }
+
+    return state;
+}
+
 int SharedFiles::syncSharedFile(const std::string& sharedPath,
                                 const std::string& localPath)
 {
     // See if file already synced
-    {
-        faabric::util::SharedLock lock(sharedFileMapMutex);
-        if (sharedFileMap.find(sharedPath) != sharedFileMap.end()) {
-            if (localPath.empty()) {
-                SPDLOG_TRACE("Not syncing shared file {}, already checked",
-                             sharedPath);
-            } else {
-                SPDLOG_TRACE("Not syncing shared file {}, cached at {}",
-                             sharedPath,
-                             localPath);
-            }
+    FileState state = checkSharedFileState(sharedPath, localPath);
+    if (state != NOT_CHECKED) {
+        return getReturnValueForSharedFileState(state);
+    }
 
-            return getReturnValueForSharedFileState(sharedPath);
+    // At this point, file has not been synced. We only hold the global lock
+    // to get the in-flight sync for this path, so that syncs of other paths
+    // can proceed while we download this one
+    std::shared_ptr<InFlightSync> inFlight;
+    {
+        faabric::util::FullLock fullLock(sharedFileMapMutex);
+        auto& sync = inFlightSyncs[sharedPath];
+        if (sync == nullptr) {
+            sync = std::make_shared<InFlightSync>();
         }
+        inFlight = sync;
     }
 
-    // At this point, file has not been synced, therefore need a lock
-    faabric::util::FullLock fullLock(sharedFileMapMutex);
+    faabric::util::UniqueLock inFlightLock(inFlight->mx);
 
-    // Check again
-    if (sharedFileMap.count(sharedPath) > 0) {
-        SPDLOG_TRACE("Not syncing {}, cached at {}", sharedPath, localPath);
-        return getReturnValueForSharedFileState(sharedPath);
+    // Check again, another thread may have synced it while we waited, or
+    // failed to
+    if (inFlight->error != nullptr) {
+        std::rethrow_exception(inFlight->error);
+    }
+
+    state = checkSharedFileState(sharedPath, localPath);
+    if (state != NOT_CHECKED) {
+        return getReturnValueForSharedFileState(state);
     }
 
     if (localPath.empty()) {
@@ -137,50 +219,23 @@ int SharedFiles::syncSharedFile(const std::string& sharedPath,
         realPath = localPath;
     }
 
-    // Check the filesystem
-    sharedFileMap[sharedPath] = NOT_CHECKED;
-    if (boost::filesystem::exists(realPath)) {
-        // If already exists on filesystem, just mark it as such
-        if (boost::filesystem::is_directory(realPath)) {
-            sharedFileMap[sharedPath] = EXISTS_DIR;
-        } else {
-            sharedFileMap[sharedPath] = EXISTS;
-        }
-    } else {
-        boost::filesystem::path p(realPath);
-
-        FileLoader& loader = getFileLoader();
-        std::vector<uint8_t> bytes;
-        bool isDir = false;
-
-        try {
-            bytes = loader.loadSharedFile(strippedPath);
-        } catch (storage::SharedFileIsDirectoryException& e) {
-            isDir = true;
-        } catch (storage::SharedFileNotExistsException& e) {
-            // Tolerate not existing
-        }
-
-        // Handle directories and files accordingly
-        if (isDir) {
-            // Create directory if path is a directory
-            boost::filesystem::create_directories(p);
-            sharedFileMap[sharedPath] = EXISTS_DIR;
-        } else if (bytes.empty()) {
-            sharedFileMap[sharedPath] = NOT_EXISTS;
-        } else {
-            // Create parent directory
-            if (p.has_parent_path()) {
-                boost::filesystem::create_directories(p.parent_path());
-            }
+    try {
+        state = doSyncSharedFile(strippedPath, realPath);
+    } catch (...) {
+        // Later syncs of this path start afresh
+        inFlight->error = std::current_exception();
+        faabric::util::FullLock fullLock(sharedFileMapMutex);
+        inFlightSyncs.erase(sharedPath);
+        throw;
+    }
 
-            // Write to file
-            faabric::util::writeBytesToFile(realPath, bytes);
-            sharedFileMap[sharedPath] = EXISTS;
-        }
+    {
+        faabric::util::FullLock fullLock(sharedFileMapMutex);
+        sharedFileMap[sharedPath] = state;
+        inFlightSyncs.erase(sharedPath);
     }
 
-    return getReturnValueForSharedFileState(sharedPath);
+    return getReturnValueForSharedFileState(state);
 }
 
 void SharedFiles::syncPythonFunctionFile(const faabric::Message& msg)
@@ -213,6 +268,7 @@ void SharedFiles::syncPythonFunctionFile(const faabric::Message& msg)
 
 void SharedFiles::clear()
 {
+    faabric::util::FullLock lock(sharedFileMapMutex);
     sharedFileMap.clear();
 }
 }
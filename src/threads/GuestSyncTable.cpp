@@ -0,0 +1,174 @@
+#include <threads/GuestSyncTable.h>
+
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace threads {
+
+static size_t getSegmentSize(size_t segmentIdx)
+{
+    return ((size_t)GUEST_SYNC_TABLE_INITIAL_SLOTS) << segmentIdx;
+}
+
+// Guest objects are word-aligned, so we mix the address up to spread them
+// across the table
+static size_t hashAddress(uint32_t addr)
+{
+    addr = ((addr >> 16) ^ addr) * 0x45d9f3b;
+    addr = ((addr >> 16) ^ addr) * 0x45d9f3b;
+    return (addr >> 16) ^ addr;
+}
+
+static inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+void GuestMutex::lock()
+{
+    uint32_t expected = 0;
+    if (state.compare_exchange_strong(
+          expected, 1, std::memory_order_acquire)) {
+        return;
+    }
+
+    // Spin for a bit longer than it's recently taken to get the lock
+    uint32_t estimate = spinEstimate.load(std::memory_order_relaxed);
+    uint32_t maxSpins =
+      std::min<uint32_t>(GUEST_MUTEX_MAX_SPINS, 2 * estimate + 10);
+    for (uint32_t spins = 0; spins < maxSpins; spins++) {
+        cpuRelax();
+
+        expected = 0;
+        if (state.load(std::memory_order_relaxed) == 0 &&
+            state.compare_exchange_weak(
+              expected, 1, std::memory_order_acquire)) {
+            spinEstimate.store(estimate + ((int)spins - (int)estimate) / 8,
+                               std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    spinEstimate.store(estimate + ((int)maxSpins - (int)estimate) / 8,
+                       std::memory_order_relaxed);
+
+    // Park until the lock is free, marking that there are waiters so that
+    // whoever unlocks wakes one of us
+    while (state.exchange(2, std::memory_order_acquire) != 0) {
+        state.wait(2, std::memory_order_relaxed);
+    }
+}
+
+bool GuestMutex::try_lock()
+{
+    uint32_t expected = 0;
+    return state.compare_exchange_strong(
+      expected, 1, std::memory_order_acquire);
+}
+
+void GuestMutex::unlock()
+{
+    if (state.exchange(0, std::memory_order_release) == 2) {
+        state.notify_one();
+    }
+}
+
+GuestSyncTable::GuestSyncTable(size_t maxSegmentsIn)
+  : maxSegments(std::min<size_t>(maxSegmentsIn, GUEST_SYNC_TABLE_MAX_SEGMENTS))
+{}
+
+GuestSyncTable::~GuestSyncTable()
+{
+    clear();
+}
+
+void GuestSyncTable::clear()
+{
+    for (auto& segment : segments) {
+        delete[] segment.exchange(nullptr);
+    }
+
+    nEntries = 0;
+}
+
+GuestSyncObject* GuestSyncTable::get(uint32_t addr)
+{
+    return find(addr, false);
+}
+
+GuestSyncObject* GuestSyncTable::getOrCreate(uint32_t addr)
+{
+    return find(addr, true);
+}
+
+size_t GuestSyncTable::size() const
+{
+    return nEntries.load(std::memory_order_relaxed);
+}
+
+GuestSyncObject* GuestSyncTable::find(uint32_t addr, bool create)
+{
+    if (addr == EMPTY_KEY) {
+        SPDLOG_ERROR("Invalid guest sync object address {}", addr);
+        throw std::runtime_error("Invalid guest sync object address");
+    }
+
+    for (size_t s = 0; s < maxSegments; s++) {
+        size_t segmentSize = getSegmentSize(s);
+        Slot* segment = segments.at(s).load(std::memory_order_acquire);
+
+        if (segment == nullptr) {
+            if (!create) {
+                return nullptr;
+            }
+
+            // Whoever loses the race to add the segment uses the winner's
+            Slot* newSegment = new Slot[segmentSize];
+            if (segments.at(s).compare_exchange_strong(
+                  segment, newSegment, std::memory_order_acq_rel)) {
+                segment = newSegment;
+            } else {
+                delete[] newSegment;
+            }
+        }
+
+        size_t mask = segmentSize - 1;
+        size_t idx = hashAddress(addr) & mask;
+        for (int p = 0; p < GUEST_SYNC_TABLE_MAX_PROBES; p++) {
+            Slot& slot = segment[idx];
+            uint32_t key = slot.key.load(std::memory_order_acquire);
+            if (key == addr) {
+                return &slot.obj;
+            }
+
+            // The key would have been inserted here if it existed
+            if (key == EMPTY_KEY) {
+                if (!create) {
+                    return nullptr;
+                }
+
+                if (slot.key.compare_exchange_strong(
+                      key, addr, std::memory_order_acq_rel)) {
+                    nEntries.fetch_add(1, std::memory_order_relaxed);
+                    return &slot.obj;
+                }
+
+                if (key == addr) {
+                    return &slot.obj;
+                }
+            }
+
+            idx = (idx + 1) & mask;
+        }
+    }
+
+    SPDLOG_ERROR("Guest sync table full ({} entries)", size());
+    throw std::runtime_error("Guest sync table full");
+}
+}
@@ -101,6 +101,9 @@ void Level::fromParentLevel(const std::shared_ptr<Level>& parent)
 
     maxActiveLevels = parent->maxActiveLevels;
 
+    runtimeScheduleKind = parent->runtimeScheduleKind;
+    runtimeScheduleChunk = parent->runtimeScheduleChunk;
+
     if (parent->depth == 0) {
         globalTidOffset = 0;
     } else {
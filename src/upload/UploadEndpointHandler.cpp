@@ -1,4 +1,5 @@
 #include <codegen/MachineCodeGenerator.h>
+#include <conf/FaasmConfig.h>
 #include <faabric/endpoint/FaabricEndpoint.h>
 #include <faabric/state/State.h>
 #include <faabric/util/bytes.h>
@@ -247,10 +248,19 @@ void UploadEndpointHandler::handlePut(
         auto& fileLoader = storage::getFileLoaderWithoutLocalCache();
         fileLoader.uploadFunction(msg);
 
-        auto& gen = codegen::getMachineCodeGenerator(fileLoader);
-        // When uploading a function, we always want to re-run the code
-        // generation so we set the clean flag to true
-        gen.codegenForFunction(msg, true);
+        conf::FaasmConfig& conf = conf::getFaasmConfig();
+        if (conf.wamrTiered == "on" && conf.wasmVm == "wamr") {
+            // In tiered mode, every worker that runs the function before its
+            // AOT file is ready interprets it, and generates the AOT files in
+            // the background. We drop the old hashes so that the old AOT
+            // files are not used
+            fileLoader.deleteFunctionWamrAotHashes(msg);
+        } else {
+            auto& gen = codegen::getMachineCodeGenerator(fileLoader);
+            // When uploading a function, we always want to re-run the code
+            // generation so we set the clean flag to true
+            gen.codegenForFunction(msg, true);
+        }
 
         response.body() = std::string("Function upload complete\n");
         response.result(beast::http::status::ok);
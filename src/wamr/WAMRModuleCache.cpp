@@ -0,0 +1,252 @@
+#include <conf/FaasmConfig.h>
+#include <conf/isa.h>
+#include <faabric/util/bytes.h>
+#include <faabric/util/func.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+#include <storage/ArtifactCache.h>
+#include <storage/FileLoader.h>
+#include <wamr/WAMRModuleCache.h>
+#include <wamr/WAMRWasmModule.h>
+
+#include <stdexcept>
+
+#include <wasm_export.h>
+
+namespace wasm {
+
+WAMRCachedModule::WAMRCachedModule(
+  const std::string& hashIn,
+  std::shared_ptr<storage::MappedFile> aotFileIn)
+  : hash(hashIn)
+  , aotFile(std::move(aotFileIn))
+{
+    SPDLOG_TRACE("WAMR loading {} AOT bytes", aotFile->size());
+    load(aotFile->data(), aotFile->size());
+}
+
+WAMRCachedModule::WAMRCachedModule(std::vector<uint8_t> wasmBytesIn)
+  : hash("")
+  , wasmBytes(std::move(wasmBytesIn))
+{
+    SPDLOG_TRACE("WAMR loading {} wasm bytes to interpret", wasmBytes.size());
+    load(wasmBytes.data(), wasmBytes.size());
+}
+
+void WAMRCachedModule::load(uint8_t* buffer, size_t size)
+{
+    char errorBuffer[ERROR_BUFFER_SIZE];
+
+    wasmModule = WAMRWasmModule::loadModuleGlobally(
+      buffer, size, errorBuffer, ERROR_BUFFER_SIZE);
+
+    if (wasmModule == nullptr) {
+        SPDLOG_ERROR("Failed to load WAMR module (hash: {}, size: {}): \n{}",
+                     hash,
+                     size,
+                     std::string(errorBuffer));
+        throw std::runtime_error("Failed to load WAMR module");
+    }
+}
+
+WAMRCachedModule::~WAMRCachedModule()
+{
+    if (wasmModule != nullptr) {
+        WAMRWasmModule::unloadModuleGlobally(wasmModule);
+    }
+}
+
+WASMModuleCommon* WAMRCachedModule::getModule()
+{
+    return wasmModule;
+}
+
+WAMRModuleCache& getWAMRModuleCache()
+{
+    static WAMRModuleCache c;
+    return c;
+}
+
+std::shared_ptr<std::mutex> WAMRModuleCache::getLoadMutex(
+  const std::string& key)
+{
+    {
+        faabric::util::SharedLock lock(mx);
+        auto it = loadMutexes.find(key);
+        if (it != loadMutexes.end()) {
+            return it->second;
+        }
+    }
+
+    faabric::util::FullLock lock(mx);
+    auto [it, inserted] =
+      loadMutexes.try_emplace(key, std::make_shared<std::mutex>());
+    return it->second;
+}
+
+std::shared_ptr<WAMRCachedModule> WAMRModuleCache::getModule(
+  const faabric::Message& msg)
+{
+    std::string key = faabric::util::funcToString(msg, false);
+
+    // The hash is tiny compared to the AOT file, so we check it every time to
+    // pick up new versions of the function
+    storage::FileLoader& loader = storage::getFileLoader();
+    std::vector<uint8_t> hashBytes = loader.loadFunctionWamrAotHash(msg);
+    std::string hash =
+      faabric::util::byteArrayToHexString(hashBytes.data(), hashBytes.size());
+
+    {
+        faabric::util::SharedLock lock(mx);
+        auto it = cachedModuleMap.find(key);
+        if (it != cachedModuleMap.end() && it->second->hash == hash) {
+            return it->second;
+        }
+    }
+
+    // Only loads of the same function are serialised, so that different
+    // functions can be loaded in parallel
+    std::shared_ptr<std::mutex> loadMx = getLoadMutex(key);
+    faabric::util::UniqueLock loadLock(*loadMx);
+
+    // Re-check, another thread may have loaded it while we waited
+    {
+        faabric::util::SharedLock lock(mx);
+        auto it = cachedModuleMap.find(key);
+        if (it != cachedModuleMap.end() && it->second->hash == hash) {
+            return it->second;
+        }
+    }
+
+    std::shared_ptr<WAMRCachedModule> cachedModule;
+    conf::FaasmConfig& conf = conf::getFaasmConfig();
+    if (hash.empty() && conf.wamrTiered == "on" && conf.wasmVm == "wamr") {
+        // Serve the function from the interpreter until its AOT file is ready
+        SPDLOG_DEBUG("WAMR module cache loading {} to interpret", key);
+        cachedModule =
+          std::make_shared<WAMRCachedModule>(loader.loadFunctionWasm(msg));
+        startBackgroundCodegen(msg);
+    } else {
+        SPDLOG_DEBUG("WAMR module cache loading {} (hash: {})", key, hash);
+        cachedModule = std::make_shared<WAMRCachedModule>(
+          hash, loader.mapFunctionWamrAotFile(msg));
+    }
+
+    // Modules with a stale hash are replaced here, but only unloaded once
+    // all the instances using them are destroyed
+    faabric::util::FullLock lock(mx);
+    cachedModuleMap[key] = cachedModule;
+
+    return cachedModule;
+}
+
+size_t WAMRModuleCache::getTotalCachedModuleCount()
+{
+    faabric::util::SharedLock lock(mx);
+    return cachedModuleMap.size();
+}
+
+void WAMRModuleCache::doBackgroundCodegen(const faabric::Message& msg)
+{
+    std::string key = faabric::util::funcToString(msg, false);
+
+    try {
+        storage::FileLoader& loader = storage::getFileLoader();
+        std::vector<uint8_t> wasmBytes = loader.loadFunctionWasm(msg);
+        std::vector<uint8_t> hash =
+          storage::ArtifactCache::hashBytes(wasmBytes);
+
+        // Generate the AOT files specialised for each configured ISA first,
+        // as they are only picked once they match the generic AOT file
+        for (const auto& isa : conf::getCodegenIsas()) {
+            std::vector<uint8_t> isaBytes =
+              wamrCodegen(wasmBytes, false, conf::getIsaTargetCpu(isa));
+            loader.uploadFunctionWamrAotFile(msg, isaBytes, isa);
+            loader.uploadFunctionWamrAotHash(msg, hash, isa);
+        }
+
+        std::vector<uint8_t> aotBytes = wamrCodegen(wasmBytes, false);
+
+        // Upload the hash last, as its presence marks the AOT file as ready
+        loader.uploadFunctionWamrAotFile(msg, aotBytes);
+        loader.uploadFunctionWamrAotHash(msg, hash);
+
+        SPDLOG_INFO("Finished generating WAMR AOT file for {}", key);
+    } catch (std::exception& e) {
+        SPDLOG_ERROR("Background codegen failed for {}: {}", key, e.what());
+    }
+
+    // Lookups either pick up the AOT file now, or retry the codegen
+    faabric::util::UniqueLock lock(codegenMx);
+    codegenKeys.erase(key);
+}
+
+void WAMRModuleCache::joinFinishedCodegen()
+{
+    auto it = codegenWorkers.begin();
+    while (it != codegenWorkers.end()) {
+        if ((*it)->finished) {
+            (*it)->thread.join();
+            it = codegenWorkers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void WAMRModuleCache::startBackgroundCodegen(const faabric::Message& msg)
+{
+    std::string key = faabric::util::funcToString(msg, false);
+
+    faabric::util::UniqueLock lock(codegenMx);
+    joinFinishedCodegen();
+
+    if (!codegenKeys.insert(key).second) {
+        return;
+    }
+
+    SPDLOG_INFO("Generating WAMR AOT file for {} in the background", key);
+    auto worker = std::make_shared<BackgroundCodegen>();
+    worker->thread = std::thread([this, worker, msg] {
+        doBackgroundCodegen(msg);
+        worker->finished = true;
+    });
+    codegenWorkers.push_back(worker);
+}
+
+bool WAMRModuleCache::isGeneratingInBackground(const faabric::Message& msg)
+{
+    faabric::util::UniqueLock lock(codegenMx);
+    return codegenKeys.find(faabric::util::funcToString(msg, false)) !=
+           codegenKeys.end();
+}
+
+void WAMRModuleCache::waitForBackgroundCodegen()
+{
+    std::vector<std::shared_ptr<BackgroundCodegen>> workers;
+    {
+        faabric::util::UniqueLock lock(codegenMx);
+        workers.swap(codegenWorkers);
+    }
+
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+WAMRModuleCache::~WAMRModuleCache()
+{
+    waitForBackgroundCodegen();
+}
+
+void WAMRModuleCache::clear()
+{
+    // Modules are unloaded as the last reference to them is dropped, which we
+    // do outside the lock
+    std::unordered_map<std::string, std::shared_ptr<WAMRCachedModule>> modules;
+    {
+        faabric::util::FullLock lock(mx);
+        modules.swap(cachedModuleMap);
+    }
+}
+}
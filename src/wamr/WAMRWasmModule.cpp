@@ -1,6 +1,9 @@
+#include <faabric/snapshot/SnapshotRegistry.h>
 #include <faabric/util/files.h>
+#include <faabric/util/func.h>
 #include <faabric/util/locks.h>
 #include <faabric/util/logging.h>
+#include <faabric/util/memory.h>
 #include <faabric/util/string_tools.h>
 #include <storage/FileLoader.h>
 #include <wamr/WAMRWasmModule.h>
@@ -8,12 +11,16 @@
 #include <wasm/WasmExecutionContext.h>
 #include <wasm/WasmModule.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <fcntl.h>
 #include <setjmp.h>
 #include <stdexcept>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <aot_runtime.h>
 #include <wasm_export.h>
@@ -33,6 +40,9 @@ const std::string WASI_PROC_EXIT = "Exception: wasi proc exit";
 // so it may cause performance issues under high churn of short-lived functions.
 static std::mutex wamrGlobalsMutex;
 
+// Protects the creation of the per-function reset snapshots
+static std::shared_mutex resetSnapshotMx;
+
 /* RAII wrapper aroudn WAMR's thread enviornment (de)-initialisation.
  *
  * When using WAMR as a library from multiple threads, WAMR complains if
@@ -102,6 +112,14 @@ void WAMRWasmModule::initialiseWAMRGlobally()
 
 void WAMRWasmModule::destroyWAMRGlobally()
 {
+    // Background codegen must finish before tearing down the runtime. It
+    // initialises WAMR itself, so we wait for it before taking the lock
+    getWAMRModuleCache().waitForBackgroundCodegen();
+
+    // Cached modules must be unloaded before tearing down the runtime, and
+    // unloading them takes the lock
+    getWAMRModuleCache().clear();
+
     faabric::util::UniqueLock lock(wamrGlobalsMutex);
 
     if (!wamrInitialised) {
@@ -113,6 +131,32 @@ void WAMRWasmModule::destroyWAMRGlobally()
     wamrInitialised = false;
 }
 
+void WAMRWasmModule::clearCaches()
+{
+    getWAMRModuleCache().clear();
+}
+
+WASMModuleCommon* WAMRWasmModule::loadModuleGlobally(uint8_t* buffer,
+                                                     size_t size,
+                                                     char* errorBuffer,
+                                                     uint32_t errorBufferSize)
+{
+    faabric::util::UniqueLock lock(wamrGlobalsMutex);
+    return wasm_runtime_load(buffer, size, errorBuffer, errorBufferSize);
+}
+
+void WAMRWasmModule::unloadModuleGlobally(WASMModuleCommon* module)
+{
+    faabric::util::UniqueLock lock(wamrGlobalsMutex);
+
+    if (!wamrInitialised) {
+        SPDLOG_WARN("Not unloading WAMR module after runtime teardown");
+        return;
+    }
+
+    wasm_runtime_unload(module);
+}
+
 WAMRWasmModule::WAMRWasmModule()
 {
     initialiseWAMRGlobally();
@@ -133,9 +177,10 @@ WAMRWasmModule::~WAMRWasmModule()
 
     // For WAMR's deinitialization procedure see here:
     // https://github.com/bytecodealliance/wasm-micro-runtime/tree/main/doc/embed_wamr.md#the-deinitialization-procedure
+    // Note that the module itself is unloaded once the last instance that
+    // references it is destroyed
     destroyThreadsExecEnv(true);
     wasm_runtime_deinstantiate(moduleInstance);
-    wasm_runtime_unload(wasmModule);
 }
 
 WAMRWasmModule* getExecutingWAMRModule()
@@ -155,48 +200,97 @@ void WAMRWasmModule::reset(faabric::Message& msg,
 
     std::string funcStr = faabric::util::funcToString(msg, true);
     SPDLOG_DEBUG("WAMR resetting after {} (snap key {})", funcStr, snapshotKey);
+    clearPthreadCalls();
+    pthreadSyncObjects.clear();
+
+    // If we have a reset snapshot we can avoid re-instantiating the module
+    if (!snapshotKey.empty()) {
+        resetFromSnapshot(snapshotKey);
+        return;
+    }
 
     destroyThreadsExecEnv(true);
     wasm_runtime_deinstantiate(moduleInstance);
     bindInternal(msg);
 }
 
-void WAMRWasmModule::doBindToFunction(faabric::Message& msg, bool cache)
+// Resets the module to its post-instantiation state by mapping the reset
+// snapshot over linear memory (copy-on-write) and restoring the globals. The
+// module instance, its memory and the main execution environment are reused
+void WAMRWasmModule::resetFromSnapshot(const std::string& snapshotKey)
 {
-    SPDLOG_TRACE("WAMR binding to {}/{} via message {}",
-                 msg.user(),
-                 msg.function(),
-                 msg.id());
+    auto* aotModule = reinterpret_cast<AOTModuleInstance*>(moduleInstance);
+    if (resetGlobals.size() != aotModule->global_data_size) {
+        SPDLOG_ERROR("WAMR reset globals size mismatch ({} != {})",
+                     resetGlobals.size(),
+                     aotModule->global_data_size);
+        throw std::runtime_error("WAMR reset globals size mismatch");
+    }
 
-    // Load the wasm file
-    storage::FileLoader& functionLoader = storage::getFileLoader();
+    // Spawned execution environments are re-created on demand by the next
+    // threaded execution
+    destroyThreadsExecEnv(false);
 
-    {
-        faabric::util::UniqueLock lock(wamrGlobalsMutex);
+    // Files mapped into memory would otherwise survive the reset
+    unmapAllFiles();
 
-        // Must load the WASM file with a lock to prevent some spurious race
-        // conditions when migrating to a new host
-        wasmBytes = functionLoader.loadFunctionWamrAotFile(msg);
+    // Restoring sets the brk and maps the snapshot over linear memory
+    size_t oldMemSize = getMemorySizeBytes();
+    restore(snapshotKey);
 
-        SPDLOG_TRACE("WAMR loading {} wasm bytes\n", wasmBytes.size());
-        wasmModule = wasm_runtime_load(
-          wasmBytes.data(), wasmBytes.size(), errorBuffer, ERROR_BUFFER_SIZE);
+    // Anything above the snapshot has been written to since instantiation,
+    // or may still be mapped from a larger snapshot restored before, so we
+    // replace it with fresh zeroed memory
+    size_t snapSize = reg.getSnapshot(snapshotKey)->getSize();
+    if (oldMemSize > snapSize) {
+        remapAsZeroed(snapSize, oldMemSize - snapSize);
+    }
 
-        if (wasmModule == nullptr) {
-            std::string errorMsg = std::string(errorBuffer);
-            SPDLOG_ERROR(
-              "{}:{}:{} Failed to load WAMR module {}/{} (size: {}): \n{}",
-              msg.appid(),
-              msg.groupid(),
-              msg.groupidx(),
-              msg.user(),
-              msg.function(),
-              wasmBytes.size(),
-              errorMsg);
-            throw std::runtime_error("Failed to load WAMR module");
+    std::memcpy(
+      aotModule->global_data, resetGlobals.data(), resetGlobals.size());
+
+    // Clear any state left over from the previous execution
+    wasm_runtime_clear_exception(moduleInstance);
+    wasm_runtime_get_wasi_ctx(moduleInstance)->exit_code = 0;
+    sharedMemWasmPtrs.clear();
+    filesystem.prepareFilesystem();
+}
+
+std::string WAMRWasmModule::registerResetSnapshot(faabric::Message& msg)
+{
+    // Note that the key must differ from WAVM's, as memory layouts differ
+    std::string snapKey =
+      faabric::util::funcToString(msg, false) + "_wamr_reset";
+
+    if (!reg.snapshotExists(snapKey)) {
+        faabric::util::FullLock lock(resetSnapshotMx);
+        if (!reg.snapshotExists(snapKey)) {
+            SPDLOG_DEBUG("Registering WAMR reset snapshot {}", snapKey);
+            reg.registerSnapshot(snapKey, getSnapshotData());
         }
     }
 
+    return snapKey;
+}
+
+void WAMRWasmModule::doBindToFunction(faabric::Message& msg, bool cache)
+{
+    SPDLOG_TRACE("WAMR binding to {}/{} via message {}",
+                 msg.user(),
+                 msg.function(),
+                 msg.id());
+
+    // Loaded modules are shared across all instances of the same function,
+    // and only loads of the same function are serialised
+    if (cache) {
+        cachedModule = getWAMRModuleCache().getModule(msg);
+    } else {
+        storage::FileLoader& functionLoader = storage::getFileLoader();
+        cachedModule = std::make_shared<WAMRCachedModule>(
+          "", functionLoader.mapFunctionWamrAotFile(msg));
+    }
+    wasmModule = cachedModule->getModule();
+
     bindInternal(msg);
 }
 
@@ -205,6 +299,13 @@ void WAMRWasmModule::bindInternal(faabric::Message& msg)
     // Prepare the filesystem
     filesystem.prepareFilesystem();
 
+    // Fresh instances are not mapped from any snapshot, or from files
+    mappedSnapshotKey.clear();
+    {
+        faabric::util::UniqueLock lock(mappedFilesMx);
+        mappedFiles.clear();
+    }
+
     // RAII-handle around WAMR's thread environment
     WAMRThreadEnv threadEnv;
 
@@ -237,6 +338,10 @@ void WAMRWasmModule::bindInternal(faabric::Message& msg)
     }
     currentBrk.store(getMemorySizeBytes(), std::memory_order_release);
 
+    // Keep the post-instantiation globals to reset from a snapshot later on
+    resetGlobals.assign(aotModule->global_data,
+                        aotModule->global_data + aotModule->global_data_size);
+
     // In WAMR the thread stacks are managed by the runtime, not by us, in
     // a dynamic fashion that also guarantees no overflows. As a consequence,
     // we do not need to use Faasm's home-built thread stack management
@@ -344,6 +449,19 @@ AOTFuncType* getFuncTypeFromFuncPtr(WASMModuleCommon* wasmModule,
         throw std::runtime_error("Error getting WAMR function signature");
     }
     uint32_t funcIdx = tableInstance->elems[wasmFuncPtr];
+
+    // Interpreted modules (see WAMRModuleCache) keep the function types with
+    // each function, rather than in a separate index
+    if (wasmModule->module_type == Wasm_Module_Bytecode) {
+        WASMModule* bcModule = reinterpret_cast<WASMModule*>(wasmModule);
+        if (funcIdx < bcModule->import_function_count) {
+            return bcModule->import_functions[funcIdx].u.function.func_type;
+        }
+
+        return bcModule->functions[funcIdx - bcModule->import_function_count]
+          ->func_type;
+    }
+
     uint32_t funcTypeIdx = aotModuleInstance->func_type_indexes[funcIdx];
 
     AOTModule* aotModule = reinterpret_cast<AOTModule*>(wasmModule);
@@ -723,8 +841,8 @@ uint8_t* WAMRWasmModule::wasmPointerToNative(uint32_t wasmPtr)
 
 bool WAMRWasmModule::doGrowMemory(uint32_t pageChange)
 {
-    auto* aotModule = reinterpret_cast<AOTModuleInstance*>(moduleInstance);
-    return aot_enlarge_memory(aotModule, pageChange);
+    // Note that this works for both AOT and interpreted modules
+    return wasm_runtime_enlarge_memory(moduleInstance, pageChange);
 }
 
 size_t WAMRWasmModule::getMemorySizeBytes()
@@ -763,19 +881,107 @@ std::vector<std::string> WAMRWasmModule::getArgv()
 }
 
 uint32_t WAMRWasmModule::mmapFile(uint32_t hostFd, size_t length)
+{
+    return mmapFile(hostFd, length, false);
+}
+
+uint32_t WAMRWasmModule::mmapFile(uint32_t hostFd, size_t length, bool shared)
 {
     // Create a new memory region in WASM
-    int32_t wasmOffset = mmapMemory(length);
+    uint32_t wasmOffset = mmapMemory(length);
     uint8_t* nativePtr = wasmPointerToNative(wasmOffset);
 
-    // Instead of ::munmap + ::map with a fd (which is not too robust), just
-    // read the file contents into our newly mmap-ed memory
-    auto bytesRead = read(hostFd, nativePtr, length);
-    if (bytesRead == -1) {
-        SPDLOG_ERROR("Error reading from fd {}", hostFd);
-        throw std::runtime_error("Error reading from file descriptor");
+    // Pages past the end of the file can't be touched once mapped, so we
+    // leave them as zeroed memory
+    struct stat fileStat;
+    if (::fstat(hostFd, &fileStat) != 0) {
+        SPDLOG_ERROR("Error stat-ing fd {}: {}", hostFd, strerror(errno));
+        throw std::runtime_error("Error stat-ing file descriptor");
+    }
+
+    size_t mapLength = std::min<size_t>(length, fileStat.st_size);
+    if (mapLength == 0) {
+        return wasmOffset;
+    }
+
+    // Linear memory is reserved up front with mmap (as we enable WAMR's
+    // hardware bound checks), so we can map the file over part of it. Shared
+    // mappings of read-only files can only be read
+    int prot = PROT_READ | PROT_WRITE;
+    if (shared && (::fcntl(hostFd, F_GETFL) & O_ACCMODE) == O_RDONLY) {
+        prot = PROT_READ;
     }
+    int flags = (shared ? MAP_SHARED : MAP_PRIVATE) | MAP_FIXED;
+
+    void* mappedPtr = ::mmap(nativePtr, mapLength, prot, flags, hostFd, 0);
+    if (mappedPtr == MAP_FAILED) {
+        SPDLOG_ERROR("Failed mmapping file descriptor {} ({} - {})",
+                     hostFd,
+                     errno,
+                     strerror(errno));
+        throw std::runtime_error("Unable to map file");
+    }
+
+    // File-backed pages look unmodified when diffing against the snapshot
+    // memory is mapped from, so we must diff every page from now on
+    mappedSnapshotKey.clear();
+
+    auto fileMapping =
+      std::make_shared<storage::FileMapping>(hostFd, mapLength);
+
+    faabric::util::UniqueLock lock(mappedFilesMx);
+    mappedFiles[wasmOffset] = { mapLength, fileMapping };
 
     return wasmOffset;
 }
+
+void WAMRWasmModule::unmapFile(uint32_t wasmOffset, size_t length)
+{
+    // Like munmap, we unmap whole pages
+    size_t start = wasmOffset;
+    size_t end = start + faabric::util::getRequiredHostPages(length) *
+                           faabric::util::HOST_PAGE_SIZE;
+
+    faabric::util::UniqueLock lock(mappedFilesMx);
+
+    // The first mapping that may overlap is the last one starting at or
+    // before the start of the range
+    auto it = mappedFiles.upper_bound(wasmOffset);
+    if (it != mappedFiles.begin()) {
+        it--;
+    }
+
+    while (it != mappedFiles.end() && it->first < end) {
+        size_t mapStart = it->first;
+        size_t mapEnd = mapStart + it->second.length;
+        if (mapEnd <= start) {
+            it++;
+            continue;
+        }
+
+        size_t overlapStart = std::max(mapStart, start);
+        size_t overlapEnd = std::min(mapEnd, end);
+        remapAsZeroed(overlapStart, overlapEnd - overlapStart);
+
+        // Whatever is left either side of the range is still mapped
+        auto fileMapping = it->second.fileMapping;
+        it = mappedFiles.erase(it);
+        if (mapStart < overlapStart) {
+            mappedFiles[mapStart] = { overlapStart - mapStart, fileMapping };
+        }
+        if (overlapEnd < mapEnd) {
+            MappedRange rest = { mapEnd - overlapEnd, fileMapping };
+            it = mappedFiles.emplace(overlapEnd, rest).first;
+        }
+    }
+}
+
+void WAMRWasmModule::unmapAllFiles()
+{
+    faabric::util::UniqueLock lock(mappedFilesMx);
+    for (const auto& [wasmOffset, range] : mappedFiles) {
+        remapAsZeroed(wasmOffset, range.length);
+    }
+    mappedFiles.clear();
+}
 }
@@ -10,7 +10,9 @@
 #include <wasm_export.h>
 
 namespace wasm {
-std::vector<uint8_t> wamrCodegen(std::vector<uint8_t>& wasmBytesIn, bool isSgx)
+std::vector<uint8_t> wamrCodegen(std::vector<uint8_t>& wasmBytesIn,
+                                 bool isSgx,
+                                 const std::string& targetCpu)
 {
     // WAMR may make modifications to the byte buffer when instantiating a
     // module and generating bytecode. Thus, we take a copy here
@@ -34,10 +36,11 @@ std::vector<uint8_t> wamrCodegen(std::vector<uint8_t>& wasmBytesIn, bool isSgx)
     memset(errorBuffer, '\0', errorBufferSize);
     // Sadly, non-pointer types are not portably provided by the WASM headers
     using wasm_module = std::pointer_traits<wasm_module_t>::element_type;
-    std::unique_ptr<wasm_module, decltype(&wasm_runtime_unload)> wasmModule(
-      wasm_runtime_load(
+    using unload_func = decltype(&WAMRWasmModule::unloadModuleGlobally);
+    std::unique_ptr<wasm_module, unload_func> wasmModule(
+      WAMRWasmModule::loadModuleGlobally(
         wasmBytes.data(), wasmBytes.size(), errorBuffer, errorBufferSize),
-      &wasm_runtime_unload);
+      &WAMRWasmModule::unloadModuleGlobally);
 
     if (wasmModule == nullptr) {
         std::string tmpStr(errorBuffer, errorBufferSize);
@@ -75,6 +78,15 @@ std::vector<uint8_t> wamrCodegen(std::vector<uint8_t>& wasmBytesIn, bool isSgx)
     option.is_jit_mode = false;
     option.enable_simd = true;
 
+    // Specialise the generated code for the given CPU if set
+    std::string targetArch = "x86_64";
+    std::string targetCpuCopy = targetCpu;
+    if (!targetCpu.empty()) {
+        SPDLOG_DEBUG("WAMR codegen targeting CPU {}", targetCpu);
+        option.target_arch = targetArch.data();
+        option.target_cpu = targetCpuCopy.data();
+    }
+
     if (isSgx) {
         // Setting size_level = 1 sometimes gives errors during re-location
         // due to the size of the .rodata. This temporarily fixes it, but i
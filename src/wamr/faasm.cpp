@@ -11,6 +11,7 @@
 #include <wasm/faasm.h>
 #include <wasm/host_interface_test.h>
 #include <wasm/migration.h>
+#include <wasm/state.h>
 
 #include <wasm_export.h>
 
@@ -18,38 +19,17 @@ using namespace faabric::executor;
 
 namespace wasm {
 
-static std::shared_ptr<faabric::state::StateKeyValue> getStateKV(
-  int32_t* keyPtr,
-  size_t size = 0)
-{
-    WAMRWasmModule* module = getExecutingWAMRModule();
-    module->validateNativePointer(keyPtr, sizeof(int32_t));
-
-    const faabric::Message* call = &ExecutorContext::get()->getMsg();
-    char* key = reinterpret_cast<char*>(keyPtr); // second
-
-    faabric::state::State& s = faabric::state::getGlobalState();
-    std::shared_ptr<faabric::state::StateKeyValue> kv;
-    if (size > 0) {
-        kv = s.getKV(call->user(), key, size);
-    } else {
-        kv = s.getKV(call->user(), key);
-    }
-
-    return kv;
-}
-
 static void __faasm_append_state_wrapper(wasm_exec_env_t execEnv,
-                                         int32_t* keyPtr,
+                                         char* key,
                                          uint8_t* dataPtr,
                                          int32_t dataLen)
 {
     auto* module = getExecutingWAMRModule();
     module->validateNativePointer(dataPtr, dataLen);
 
-    SPDLOG_DEBUG("S - faasm_append_state {}", (char*)keyPtr);
+    SPDLOG_DEBUG("S - faasm_append_state {}", key);
 
-    auto kv = getStateKV(keyPtr);
+    auto kv = getStateKV(key);
     kv->append(dataPtr, dataLen);
 }
 
@@ -152,24 +132,24 @@ static void __faasm_migrate_point_wrapper(wasm_exec_env_t execEnv,
 }
 
 static void __faasm_pull_state_wrapper(wasm_exec_env_t execEnv,
-                                       int32_t* keyPtr,
+                                       char* key,
                                        int32_t stateLen)
 {
-    auto kv = getStateKV(keyPtr, stateLen);
+    auto kv = getStateKV(key, stateLen);
     SPDLOG_DEBUG("S - pull_state - {} {}", kv->key, stateLen);
 
     kv->pull();
 }
 
-static void __faasm_push_state_wrapper(wasm_exec_env_t execEnv, int32_t* keyPtr)
+static void __faasm_push_state_wrapper(wasm_exec_env_t execEnv, char* key)
 {
-    auto kv = getStateKV(keyPtr, 0);
+    auto kv = getStateKV(key, 0);
     SPDLOG_DEBUG("S - push_state - {}", kv->key);
     kv->pushFull();
 }
 
 static void __faasm_read_appended_state_wrapper(wasm_exec_env_t execEnv,
-                                                int32_t* keyPtr,
+                                                char* key,
                                                 uint8_t* bufferPtr,
                                                 int32_t bufferLen,
                                                 int32_t numElems)
@@ -177,9 +157,9 @@ static void __faasm_read_appended_state_wrapper(wasm_exec_env_t execEnv,
     auto* module = getExecutingWAMRModule();
     module->validateNativePointer(bufferPtr, bufferLen);
 
-    SPDLOG_DEBUG("S - faasm_read_appended_state {}", (char*)keyPtr);
+    SPDLOG_DEBUG("S - faasm_read_appended_state {}", key);
 
-    auto kv = getStateKV(keyPtr, bufferLen);
+    auto kv = getStateKV(key, bufferLen);
     kv->getAppended(bufferPtr, bufferLen, numElems);
 }
 
@@ -226,16 +206,16 @@ static void __faasm_write_output_wrapper(wasm_exec_env_t exec_env,
 }
 
 static NativeSymbol faasmNs[] = {
-    REG_NATIVE_FUNC(__faasm_append_state, "(**i)"),
+    REG_NATIVE_FUNC(__faasm_append_state, "($*i)"),
     REG_NATIVE_FUNC(__faasm_await_call, "(i)i"),
     REG_NATIVE_FUNC(__faasm_await_call_output, "(i**)i"),
     REG_NATIVE_FUNC(__faasm_chain_name, "($$i)i"),
     REG_NATIVE_FUNC(__faasm_chain_ptr, "(i$i)i"),
     REG_NATIVE_FUNC(__faasm_host_interface_test, "(i)"),
     REG_NATIVE_FUNC(__faasm_migrate_point, "(ii)"),
-    REG_NATIVE_FUNC(__faasm_pull_state, "(*i)"),
-    REG_NATIVE_FUNC(__faasm_push_state, "(*)"),
-    REG_NATIVE_FUNC(__faasm_read_appended_state, "(**ii)"),
+    REG_NATIVE_FUNC(__faasm_pull_state, "($i)"),
+    REG_NATIVE_FUNC(__faasm_push_state, "($)"),
+    REG_NATIVE_FUNC(__faasm_read_appended_state, "($*ii)"),
     REG_NATIVE_FUNC(__faasm_read_input, "($i)i"),
     REG_NATIVE_FUNC(__faasm_sm_critical_local, "()"),
     REG_NATIVE_FUNC(__faasm_sm_critical_local_end, "()"),
@@ -78,14 +78,47 @@ uint32_t getFaasmFilesystemApi(NativeSymbol** nativeSymbols)
 
 // ---------- WASI symbols ----------
 
+// Translates the guest's iovecs into native ones pointing straight into linear
+// memory, so that reads and writes need no intermediate buffers
+static std::vector<::iovec> wasmIovecsToNative(WAMRWasmModule* module,
+                                               const iovec_app_t* iovecWasm,
+                                               int32_t iovecCount)
+{
+    if (iovecCount < 0) {
+        SPDLOG_ERROR("Invalid iovec count: {}", iovecCount);
+        throw std::runtime_error("Invalid iovec count");
+    }
+
+    module->validateNativePointer((void*)iovecWasm,
+                                  sizeof(iovec_app_t) * iovecCount);
+
+    std::vector<::iovec> iovecNative(iovecCount, (::iovec){});
+    for (int i = 0; i < iovecCount; i++) {
+        module->validateWasmOffset(iovecWasm[i].buffOffset,
+                                   sizeof(char) * iovecWasm[i].buffLen);
+
+        iovecNative[i] = {
+            .iov_base = module->wasmPointerToNative(iovecWasm[i].buffOffset),
+            .iov_len = iovecWasm[i].buffLen,
+        };
+    }
+
+    return iovecNative;
+}
+
 static uint32_t wasi_fd_allocate(wasm_exec_env_t exec_env,
                                  __wasi_fd_t fd,
                                  __wasi_filesize_t offset,
                                  __wasi_filesize_t len)
 {
-    WAMR_NATIVE_SYMBOL_NOT_IMPLEMENTED("wasi_fd_allocate");
+    SPDLOG_DEBUG("S - fd_allocate {} {} {}", fd, offset, len);
 
-    return 0;
+    storage::FileSystem& fs = getExecutingWAMRModule()->getFileSystem();
+    if (!fs.fileDescriptorExists(fd)) {
+        return __WASI_EBADF;
+    }
+
+    return fs.getFileDescriptor(fd).allocate(offset, len);
 }
 
 static int32_t wasi_fd_close(wasm_exec_env_t exec_env, int32_t fd)
@@ -103,16 +136,15 @@ static int32_t wasi_fd_fdstat_get(wasm_exec_env_t exec_env,
 {
     WAMRWasmModule* module = getExecutingWAMRModule();
     storage::FileSystem& fs = module->getFileSystem();
-    std::string path = fs.getPathForFd(fd);
-    SPDLOG_DEBUG("S - fd_fdstat_get {} ({})", fd, path);
-
     if (!fs.fileDescriptorExists(fd)) {
+        SPDLOG_DEBUG("S - fd_fdstat_get {} (bad fd)", fd);
         return __WASI_EBADF;
     }
 
-    module->validateNativePointer(statWasm, sizeof(__wasi_fdstat_t));
-
     storage::FileDescriptor& fileDesc = fs.getFileDescriptor(fd);
+    SPDLOG_DEBUG("S - fd_fdstat_get {} ({})", fd, fileDesc.getPath());
+
+    module->validateNativePointer(statWasm, sizeof(__wasi_fdstat_t));
     storage::Stat statNative = fileDesc.stat();
 
     if (statNative.failed) {
@@ -186,12 +218,17 @@ static int32_t wasi_fd_filestat_get(wasm_exec_env_t exec_env,
 }
 
 static int32_t wasi_fd_filestat_set_size(wasm_exec_env_t execEnv,
-                                         int32_t a,
-                                         int64_t b)
+                                         int32_t fd,
+                                         int64_t size)
 {
-    WAMR_NATIVE_SYMBOL_NOT_IMPLEMENTED("wasi_fd_filestat_set_size");
+    SPDLOG_DEBUG("S - fd_filestat_set_size {} {}", fd, size);
 
-    return 0;
+    storage::FileSystem& fs = getExecutingWAMRModule()->getFileSystem();
+    if (!fs.fileDescriptorExists(fd)) {
+        return __WASI_EBADF;
+    }
+
+    return fs.getFileDescriptor(fd).setSize(size);
 }
 
 static uint32_t wasi_fd_pread(wasm_exec_env_t exec_env,
@@ -201,9 +238,27 @@ static uint32_t wasi_fd_pread(wasm_exec_env_t exec_env,
                               __wasi_filesize_t offset,
                               uint32_t* nReadWasm)
 {
-    WAMR_NATIVE_SYMBOL_NOT_IMPLEMENTED("wasi_fd_pread");
+    WAMRWasmModule* module = getExecutingWAMRModule();
+    storage::FileSystem& fs = module->getFileSystem();
+    if (!fs.fileDescriptorExists(fd)) {
+        return __WASI_EBADF;
+    }
 
-    return 0;
+    storage::FileDescriptor& fileDesc = fs.getFileDescriptor(fd);
+    SPDLOG_TRACE("S - fd_pread {} {} ({})", fd, offset, fileDesc.getPath());
+
+    module->validateNativePointer(nReadWasm, sizeof(uint32_t));
+    std::vector<::iovec> iovecNative =
+      wasmIovecsToNative(module, iovecWasm, iovecLen);
+
+    ssize_t n = fileDesc.pread(iovecNative, iovecLen, offset);
+    if (n < 0) {
+        return fileDesc.getWasiErrno();
+    }
+
+    *nReadWasm = n;
+
+    return __WASI_ESUCCESS;
 }
 
 static int32_t wasi_fd_prestat_dir_name(wasm_exec_env_t exec_env,
@@ -254,9 +309,27 @@ static uint32_t wasi_fd_pwrite(wasm_exec_env_t exec_env,
                                __wasi_filesize_t offset,
                                uint32_t* nWrittenWasm)
 {
-    WAMR_NATIVE_SYMBOL_NOT_IMPLEMENTED("wasi_fd_pwrite");
+    WAMRWasmModule* module = getExecutingWAMRModule();
+    storage::FileSystem& fs = module->getFileSystem();
+    if (!fs.fileDescriptorExists(fd)) {
+        return __WASI_EBADF;
+    }
 
-    return 0;
+    storage::FileDescriptor& fileDesc = fs.getFileDescriptor(fd);
+    SPDLOG_TRACE("S - fd_pwrite {} {} ({})", fd, offset, fileDesc.getPath());
+
+    module->validateNativePointer(nWrittenWasm, sizeof(uint32_t));
+    std::vector<::iovec> iovecNative =
+      wasmIovecsToNative(module, iovecWasm, iovecLen);
+
+    ssize_t n = fileDesc.pwrite(iovecNative, iovecLen, offset);
+    if (n < 0) {
+        return fileDesc.getWasiErrno();
+    }
+
+    *nWrittenWasm = n;
+
+    return __WASI_ESUCCESS;
 }
 
 static int32_t wasi_fd_read(wasm_exec_env_t exec_env,
@@ -267,24 +340,13 @@ static int32_t wasi_fd_read(wasm_exec_env_t exec_env,
 {
     WAMRWasmModule* module = getExecutingWAMRModule();
     storage::FileSystem& fileSystem = module->getFileSystem();
-    std::string path = fileSystem.getPathForFd(fd);
-
-    SPDLOG_TRACE("S - fd_read {} ({})", fd, path);
+    storage::FileDescriptor& fileDesc = fileSystem.getFileDescriptor(fd);
 
-    storage::FileDescriptor fileDesc = fileSystem.getFileDescriptor(fd);
+    SPDLOG_TRACE("S - fd_read {} ({})", fd, fileDesc.getPath());
 
     // Translate app iovecs to native ones
-    std::vector<::iovec> ioVecBuffNative(ioVecCountWasm, (::iovec){});
-    for (int i = 0; i < ioVecCountWasm; i++) {
-        module->validateWasmOffset(ioVecBuffWasm[i].buffOffset,
-                                   sizeof(char) * ioVecBuffWasm[i].buffLen);
-
-        ioVecBuffNative[i] = {
-            .iov_base =
-              module->wasmPointerToNative(ioVecBuffWasm[i].buffOffset),
-            .iov_len = ioVecBuffWasm[i].buffLen,
-        };
-    }
+    std::vector<::iovec> ioVecBuffNative =
+      wasmIovecsToNative(module, ioVecBuffWasm, ioVecCountWasm);
 
     // Read from fd
     module->validateNativePointer(bytesRead, sizeof(int32_t));
@@ -341,9 +403,14 @@ static int32_t wasi_fd_seek(wasm_exec_env_t exec_env,
 
 static uint32_t wasi_fd_sync(wasm_exec_env_t exec_env, __wasi_fd_t fd)
 {
-    WAMR_NATIVE_SYMBOL_NOT_IMPLEMENTED("wasi_fd_sync");
+    SPDLOG_DEBUG("S - fd_sync {}", fd);
 
-    return 0;
+    storage::FileSystem& fs = getExecutingWAMRModule()->getFileSystem();
+    if (!fs.fileDescriptorExists(fd)) {
+        return __WASI_EBADF;
+    }
+
+    return fs.getFileDescriptor(fd).sync();
 }
 
 static uint32_t wasi_fd_tell(wasm_exec_env_t exec_env,
@@ -367,30 +434,18 @@ static int32_t wasi_fd_write(wasm_exec_env_t exec_env,
 {
     WAMRWasmModule* module = getExecutingWAMRModule();
     storage::FileSystem& fileSystem = module->getFileSystem();
-    std::string path = fileSystem.getPathForFd(fd);
+    storage::FileDescriptor& fileDesc = fileSystem.getFileDescriptor(fd);
 
-    SPDLOG_TRACE("S - fd_write {} ({})", fd, path);
+    SPDLOG_TRACE("S - fd_write {} ({})", fd, fileDesc.getPath());
 
     // Check pointers
-    module->validateNativePointer(reinterpret_cast<void*>(ioVecBuffWasm),
-                                  sizeof(iovec_app_t) * ioVecCountWasm);
     module->validateNativePointer(bytesWritten, sizeof(int32_t));
 
     // Translate the app iovecs into native iovecs
-    std::vector<::iovec> ioVecBuffNative(ioVecCountWasm, (::iovec){});
-    for (int i = 0; i < ioVecCountWasm; i++) {
-        module->validateWasmOffset(ioVecBuffWasm[i].buffOffset,
-                                   sizeof(char) * ioVecBuffWasm[i].buffLen);
-
-        ioVecBuffNative[i] = {
-            .iov_base =
-              module->wasmPointerToNative(ioVecBuffWasm[i].buffOffset),
-            .iov_len = ioVecBuffWasm[i].buffLen,
-        };
-    }
+    std::vector<::iovec> ioVecBuffNative =
+      wasmIovecsToNative(module, ioVecBuffWasm, ioVecCountWasm);
 
     // Do the write
-    storage::FileDescriptor& fileDesc = fileSystem.getFileDescriptor(fd);
     ssize_t n = fileDesc.write(ioVecBuffNative, ioVecCountWasm);
     if (n < 0) {
         SPDLOG_ERROR(
@@ -7,6 +7,8 @@
 #include <wasm/WasmModule.h>
 #include <wasm_export.h>
 
+#include <sys/mman.h>
+
 namespace wasm {
 static int32_t __sbrk_wrapper(wasm_exec_env_t exec_env, int32_t increment)
 {
@@ -58,7 +60,8 @@ static int32_t mmap_wrapper(wasm_exec_env_t exec_env,
         // If fd is provided, we're mapping a file into memory
         storage::FileDescriptor& fileDesc =
           module->getFileSystem().getFileDescriptor(wasmFd);
-        return module->mmapFile(fileDesc.getLinuxFd(), length);
+        bool shared = (flags & MAP_SHARED) != 0;
+        return module->mmapFile(fileDesc.getLinuxFd(), length, shared);
     }
 
     // If fd not provided, map memory directly
@@ -72,6 +75,7 @@ static int32_t munmap_wrapper(wasm_exec_env_t exec_env,
     SPDLOG_TRACE("S - munmap - {} {}", addr, length);
 
     WAMRWasmModule* executingModule = getExecutingWAMRModule();
+    executingModule->unmapFile(addr, length);
     executingModule->unmapMemory(addr, length);
 
     return 0;
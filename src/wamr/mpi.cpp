@@ -5,9 +5,14 @@
 #include <wamr/WAMRModuleMixin.h>
 #include <wamr/WAMRWasmModule.h>
 #include <wamr/native.h>
+#include <wasm/mpi.h>
 
 #include <wasm_export.h>
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 using namespace faabric::mpi;
 
 #define MPI_FUNC(str)                                                          \
@@ -16,6 +21,11 @@ using namespace faabric::mpi;
 #define MPI_FUNC_ARGS(formatStr, ...)                                          \
     SPDLOG_TRACE("MPI-{} " formatStr, executingContext.getRank(), __VA_ARGS__);
 
+// Not all versions of the MPI header define this
+#ifndef MPI_UNDEFINED
+#define MPI_UNDEFINED (-32766)
+#endif
+
 #define CALL_MPI_WORLD_CATCH_EXCEPTION(retval, call)                           \
     try {                                                                      \
         retval = call;                                                         \
@@ -121,6 +131,48 @@ class WamrMpiContextWrapper
         return hostOpType;
     }
 
+    // Validates an array with one entry per rank, like the counts and
+    // displacements of the vector collectives
+    void validateRankArray(int32_t* wasmPtr) const
+    {
+        module->validateNativePointer(wasmPtr,
+                                      world.getSize() * sizeof(int32_t));
+    }
+
+    // Copies out an (already validated) array with one entry per rank
+    std::vector<int32_t> getRankArray(const int32_t* wasmPtr) const
+    {
+        return std::vector<int32_t>(wasmPtr, wasmPtr + world.getSize());
+    }
+
+    // Validates a buffer holding one block per rank, as described by the
+    // (already validated) counts and displacements of a vector collective
+    void validateBlockBuffer(int32_t* buf,
+                             const int32_t* counts,
+                             const int32_t* displs,
+                             faabric_datatype_t* dtype) const
+    {
+        size_t extent = 0;
+        for (int r = 0; r < world.getSize(); r++) {
+            int32_t displ = displs[r];
+            if (counts[r] < 0 || displ < 0) {
+                SPDLOG_ERROR("Bad block for rank {} ({} at {})",
+                             r,
+                             counts[r],
+                             displ);
+                auto ex = std::runtime_error("Bad block in vector collective");
+                module->doThrowException(ex);
+            }
+
+            if (counts[r] > 0) {
+                extent =
+                  std::max<size_t>(extent, (size_t)displ + (size_t)counts[r]);
+            }
+        }
+
+        module->validateNativePointer(buf, extent * dtype->size);
+    }
+
     template<typename T>
     void writeMpiResult(int32_t* resPtr, T result)
     {
@@ -138,6 +190,7 @@ static thread_local std::unique_ptr<WamrMpiContextWrapper> ctx = nullptr;
 static int terminateMpi()
 {
     // Destroy the MPI world
+    doMpiFinalize(ctx->world, ctx->rank);
     CALL_MPI_WORLD_CATCH_EXCEPTION_NO_RETURN(ctx->world.destroy())
 
     // Null-out the context
@@ -202,14 +255,57 @@ static int32_t MPI_Allgatherv_wrapper(wasm_exec_env_t execEnv,
                                       int32_t sendCount,
                                       int32_t* sendType,
                                       int32_t* recvBuf,
-                                      int32_t recvCount,
-                                      int32_t dspls,
+                                      int32_t* recvCounts,
+                                      int32_t* displs,
                                       int32_t* recvType,
                                       int32_t* comm)
 {
-    WAMR_NATIVE_SYMBOL_NOT_IMPLEMENTED("MPI_Allgatherv");
+    MPI_FUNC_ARGS("S - MPI_Allgatherv {} {} {} {} {} {} {} {}",
+                  (uintptr_t)sendBuf,
+                  sendCount,
+                  (uintptr_t)sendType,
+                  (uintptr_t)recvBuf,
+                  (uintptr_t)recvCounts,
+                  (uintptr_t)displs,
+                  (uintptr_t)recvType,
+                  (uintptr_t)comm);
 
-    return 0;
+    ctx->checkMpiComm(comm);
+    faabric_datatype_t* hostSendDtype = ctx->getFaasmDataType(sendType);
+    faabric_datatype_t* hostRecvDtype = ctx->getFaasmDataType(recvType);
+
+    ctx->validateRankArray(recvCounts);
+    ctx->validateRankArray(displs);
+    ctx->validateBlockBuffer(recvBuf, recvCounts, displs, hostRecvDtype);
+
+    // In place, our block is already where it should be in the receive buffer
+    int worldSize = ctx->world.getSize();
+    std::vector<int32_t> sendCounts(worldSize, sendCount);
+    std::vector<int32_t> sendDispls(worldSize, 0);
+    if (ctx->isInPlace(sendBuf)) {
+        sendBuf = recvBuf;
+        sendCounts.assign(worldSize, recvCounts[ctx->rank]);
+        sendDispls.assign(worldSize, displs[ctx->rank]);
+        hostSendDtype = hostRecvDtype;
+    } else {
+        ctx->module->validateNativePointer(sendBuf,
+                                           sendCount * hostSendDtype->size);
+    }
+
+    CALL_MPI_WORLD_CATCH_EXCEPTION_NO_RETURN(
+      doMpiAllToAllV(ctx->world,
+                     ctx->rank,
+                     (uint8_t*)sendBuf,
+                     sendCounts,
+                     sendDispls,
+                     hostSendDtype,
+                     (uint8_t*)recvBuf,
+                     ctx->getRankArray(recvCounts),
+                     ctx->getRankArray(displs),
+                     hostRecvDtype,
+                     MpiMessageType::ALLGATHER))
+
+    return MPI_SUCCESS;
 }
 
 static int32_t MPI_Allreduce_wrapper(wasm_exec_env_t execEnv,
@@ -241,12 +337,13 @@ static int32_t MPI_Allreduce_wrapper(wasm_exec_env_t execEnv,
     }
 
     CALL_MPI_WORLD_CATCH_EXCEPTION_NO_RETURN(
-      ctx->world.allReduce(ctx->rank,
-                           (uint8_t*)sendBuf,
-                           (uint8_t*)recvBuf,
-                           hostDtype,
-                           count,
-                           hostOp))
+      doMpiAllReduce(ctx->world,
+                     ctx->rank,
+                     (uint8_t*)sendBuf,
+                     (uint8_t*)recvBuf,
+                     hostDtype,
+                     count,
+                     hostOp))
 
     return MPI_SUCCESS;
 }
@@ -292,18 +389,51 @@ static int32_t MPI_Alltoall_wrapper(wasm_exec_env_t execEnv,
 
 static int32_t MPI_Alltoallv_wrapper(wasm_exec_env_t execEnv,
                                      int32_t* sendBuf,
-                                     int32_t sendCount,
-                                     int32_t sdispls,
+                                     int32_t* sendCounts,
+                                     int32_t* sendDispls,
                                      int32_t* sendType,
                                      int32_t* recvBuf,
-                                     int32_t recvCount,
-                                     int32_t rdispls,
+                                     int32_t* recvCounts,
+                                     int32_t* recvDispls,
                                      int32_t* recvType,
                                      int32_t* comm)
 {
-    WAMR_NATIVE_SYMBOL_NOT_IMPLEMENTED("MPI_Alltoallv");
+    MPI_FUNC_ARGS("S - MPI_Alltoallv {} {} {} {} {} {} {} {} {}",
+                  (uintptr_t)sendBuf,
+                  (uintptr_t)sendCounts,
+                  (uintptr_t)sendDispls,
+                  (uintptr_t)sendType,
+                  (uintptr_t)recvBuf,
+                  (uintptr_t)recvCounts,
+                  (uintptr_t)recvDispls,
+                  (uintptr_t)recvType,
+                  (uintptr_t)comm);
 
-    return 0;
+    ctx->checkMpiComm(comm);
+    faabric_datatype_t* hostSendDtype = ctx->getFaasmDataType(sendType);
+    faabric_datatype_t* hostRecvDtype = ctx->getFaasmDataType(recvType);
+
+    ctx->validateRankArray(sendCounts);
+    ctx->validateRankArray(sendDispls);
+    ctx->validateRankArray(recvCounts);
+    ctx->validateRankArray(recvDispls);
+    ctx->validateBlockBuffer(sendBuf, sendCounts, sendDispls, hostSendDtype);
+    ctx->validateBlockBuffer(recvBuf, recvCounts, recvDispls, hostRecvDtype);
+
+    CALL_MPI_WORLD_CATCH_EXCEPTION_NO_RETURN(
+      doMpiAllToAllV(ctx->world,
+                     ctx->rank,
+                     (uint8_t*)sendBuf,
+                     ctx->getRankArray(sendCounts),
+                     ctx->getRankArray(sendDispls),
+                     hostSendDtype,
+                     (uint8_t*)recvBuf,
+                     ctx->getRankArray(recvCounts),
+                     ctx->getRankArray(recvDispls),
+                     hostRecvDtype,
+                     MpiMessageType::ALLTOALL))
+
+    return MPI_SUCCESS;
 }
 
 static int32_t MPI_Barrier_wrapper(wasm_exec_env_t execEnv, int32_t* comm)
@@ -336,12 +466,12 @@ static int32_t MPI_Bcast_wrapper(wasm_exec_env_t execEnv,
     ctx->module->validateNativePointer(buffer, count * hostDtype->size);
 
     CALL_MPI_WORLD_CATCH_EXCEPTION_NO_RETURN(
-      ctx->world.broadcast(root,
-                           ctx->rank,
-                           reinterpret_cast<uint8_t*>(buffer),
-                           hostDtype,
-                           count,
-                           MpiMessageType::BROADCAST))
+      doMpiBroadcast(ctx->world,
+                     ctx->rank,
+                     root,
+                     reinterpret_cast<uint8_t*>(buffer),
+                     hostDtype,
+                     count))
 
     return MPI_SUCCESS;
 }
@@ -522,9 +652,33 @@ static int32_t MPI_Comm_split_wrapper(wasm_exec_env_t execEnv,
                                       int32_t key,
                                       int32_t* newComm)
 {
-    WAMR_NATIVE_SYMBOL_NOT_IMPLEMENTED("MPI_Comm_split");
+    MPI_FUNC_ARGS("S - MPI_Comm_split {} {} {} {}",
+                  (uintptr_t)comm,
+                  color,
+                  key,
+                  (uintptr_t)newComm);
 
-    return 0;
+    ctx->checkMpiComm(comm);
+    ctx->module->validateNativePointer(newComm, sizeof(int32_t));
+
+    int worldSize = ctx->world.getSize();
+    int32_t colorKey[2] = { color, key };
+    std::vector<int32_t> colorKeys(2 * worldSize);
+    CALL_MPI_WORLD_CATCH_EXCEPTION_NO_RETURN(
+      ctx->world.allGather(ctx->rank,
+                           (uint8_t*)colorKey,
+                           MPI_INT,
+                           2,
+                           (uint8_t*)colorKeys.data(),
+                           MPI_INT,
+                           2))
+
+    CALL_MPI_WORLD_CATCH_EXCEPTION_NO_RETURN(checkMpiCommSplit(colorKeys))
+
+    // The new communicator is the world, so we point it at the same struct
+    *newComm = ctx->module->nativePointerToWasmOffset(comm);
+
+    return MPI_SUCCESS;
 }
 
 static int32_t MPI_Finalize_wrapper(wasm_exec_env_t execEnv)
@@ -702,8 +856,8 @@ static int32_t MPI_Irecv_wrapper(wasm_exec_env_t execEnv,
     int requestId;
     CALL_MPI_WORLD_CATCH_EXCEPTION(
       requestId,
-      ctx->world.irecv(
-        sourceRank, ctx->rank, (uint8_t*)buffer, hostDtype, count))
+      doMpiIrecv(
+        ctx->world, ctx->rank, sourceRank, (uint8_t*)buffer, hostDtype, count))
 
     ctx->writeFaasmRequestId(requestPtrPtr, requestId);
 
@@ -735,7 +889,8 @@ static int32_t MPI_Isend_wrapper(wasm_exec_env_t execEnv,
     int requestId;
     CALL_MPI_WORLD_CATCH_EXCEPTION(
       requestId,
-      ctx->world.isend(ctx->rank, destRank, (uint8_t*)buffer, hostDtype, count))
+      doMpiIsend(
+        ctx->world, ctx->rank, destRank, (uint8_t*)buffer, hostDtype, count))
 
     ctx->writeFaasmRequestId(requestPtrPtr, requestId);
 
@@ -771,9 +926,14 @@ static int32_t MPI_Probe_wrapper(wasm_exec_env_t execEnv,
                   (uintptr_t)comm,
                   (uintptr_t)statusPtr);
 
-    WAMR_NATIVE_SYMBOL_NOT_IMPLEMENTED("MPI_Probe");
+    ctx->checkMpiComm(comm);
+    ctx->module->validateNativePointer(statusPtr, sizeof(MPI_Status));
+    MPI_Status* status = reinterpret_cast<MPI_Status*>(statusPtr);
 
-    return 0;
+    CALL_MPI_WORLD_CATCH_EXCEPTION_NO_RETURN(
+      doMpiProbe(ctx->world, ctx->rank, source, status))
+
+    return MPI_SUCCESS;
 }
 
 static int32_t MPI_Recv_wrapper(wasm_exec_env_t execEnv,
@@ -801,8 +961,13 @@ static int32_t MPI_Recv_wrapper(wasm_exec_env_t execEnv,
 
     ctx->module->validateNativePointer(buffer, count * hostDtype->size);
 
-    CALL_MPI_WORLD_CATCH_EXCEPTION_NO_RETURN(ctx->world.recv(
-      sourceRank, ctx->rank, (uint8_t*)buffer, hostDtype, count, status))
+    CALL_MPI_WORLD_CATCH_EXCEPTION_NO_RETURN(doMpiRecv(ctx->world,
+                                                       ctx->rank,
+                                                       sourceRank,
+                                                       (uint8_t*)buffer,
+                                                       hostDtype,
+                                                       count,
+                                                       status))
 
     return MPI_SUCCESS;
 }
@@ -852,14 +1017,50 @@ static int32_t MPI_Reduce_wrapper(wasm_exec_env_t execEnv,
 static int32_t MPI_Reduce_scatter_wrapper(wasm_exec_env_t execEnv,
                                           int32_t* sendBuf,
                                           int32_t* recvBuf,
-                                          int32_t recvCount,
+                                          int32_t* recvCounts,
                                           int32_t* datatype,
                                           int32_t* op,
                                           int32_t* comm)
 {
-    WAMR_NATIVE_SYMBOL_NOT_IMPLEMENTED("MPI_Reduce_scatter");
+    MPI_FUNC_ARGS("S - MPI_Reduce_scatter {} {} {} {} {} {}",
+                  (uintptr_t)sendBuf,
+                  (uintptr_t)recvBuf,
+                  (uintptr_t)recvCounts,
+                  (uintptr_t)datatype,
+                  (uintptr_t)op,
+                  (uintptr_t)comm);
 
-    return 0;
+    ctx->checkMpiComm(comm);
+    faabric_datatype_t* hostDtype = ctx->getFaasmDataType(datatype);
+    faabric_op_t* hostOp = ctx->getFaasmOp(op);
+
+    int worldSize = ctx->world.getSize();
+    ctx->validateRankArray(recvCounts);
+
+    // Blocks are laid out back to back in the send buffer
+    std::vector<int32_t> displs(worldSize, 0);
+    for (int r = 1; r < worldSize; r++) {
+        displs.at(r) = displs.at(r - 1) + recvCounts[r - 1];
+    }
+
+    int32_t myCount = recvCounts[ctx->rank];
+    ctx->module->validateNativePointer(recvBuf, myCount * hostDtype->size);
+
+    if (ctx->isInPlace(sendBuf)) {
+        sendBuf = recvBuf;
+    }
+    ctx->validateBlockBuffer(sendBuf, recvCounts, displs.data(), hostDtype);
+
+    CALL_MPI_WORLD_CATCH_EXCEPTION_NO_RETURN(
+      doMpiReduceScatter(ctx->world,
+                         ctx->rank,
+                         (uint8_t*)sendBuf,
+                         (uint8_t*)recvBuf,
+                         ctx->getRankArray(recvCounts),
+                         hostDtype,
+                         hostOp))
+
+    return MPI_SUCCESS;
 }
 
 static int32_t MPI_Request_free_wrapper(wasm_exec_env_t execEnv,
@@ -979,7 +1180,8 @@ static int32_t MPI_Send_wrapper(wasm_exec_env_t execEnv,
     ctx->module->validateNativePointer(buffer, count * hostDtype->size);
 
     CALL_MPI_WORLD_CATCH_EXCEPTION_NO_RETURN(
-      ctx->world.send(ctx->rank, destRank, (uint8_t*)buffer, hostDtype, count))
+      doMpiSend(
+        ctx->world, ctx->rank, destRank, (uint8_t*)buffer, hostDtype, count))
 
     return MPI_SUCCESS;
 }
@@ -1025,16 +1227,17 @@ static int32_t MPI_Sendrecv_wrapper(wasm_exec_env_t execEnv,
                                        recvCount * hostRecvDtype->size);
 
     CALL_MPI_WORLD_CATCH_EXCEPTION_NO_RETURN(
-      ctx->world.sendRecv((uint8_t*)sendBuf,
-                          sendCount,
-                          hostSendDtype,
-                          destination,
-                          (uint8_t*)recvBuf,
-                          recvCount,
-                          hostRecvDtype,
-                          source,
-                          ctx->rank,
-                          status))
+      doMpiSendRecv(ctx->world,
+                    ctx->rank,
+                    (uint8_t*)sendBuf,
+                    sendCount,
+                    hostSendDtype,
+                    destination,
+                    (uint8_t*)recvBuf,
+                    recvCount,
+                    hostRecvDtype,
+                    source,
+                    status))
 
     return MPI_SUCCESS;
 }
@@ -1095,7 +1298,7 @@ static int32_t MPI_Wait_wrapper(wasm_exec_env_t execEnv,
     MPI_FUNC_ARGS("S - MPI_Wait {} {}", (uintptr_t)requestPtrPtr, requestId);
 
     CALL_MPI_WORLD_CATCH_EXCEPTION_NO_RETURN(
-      ctx->world.awaitAsyncRequest(requestId))
+      doMpiAwait(ctx->world, requestId))
 
     return MPI_SUCCESS;
 }
@@ -1117,12 +1320,34 @@ static int32_t MPI_Waitall_wrapper(wasm_exec_env_t execEnv,
 static int32_t MPI_Waitany_wrapper(wasm_exec_env_t execEnv,
                                    int32_t count,
                                    int32_t* requestArray,
-                                   int32_t idx,
+                                   int32_t* idxPtr,
                                    int32_t* status)
 {
-    WAMR_NATIVE_SYMBOL_NOT_IMPLEMENTED("MPI_Waitany");
+    MPI_FUNC_ARGS("S - MPI_Waitany {} {} {}",
+                  count,
+                  (uintptr_t)requestArray,
+                  (uintptr_t)idxPtr);
+
+    // Each request holds its id in place of a wasm pointer (see
+    // writeFaasmRequestId)
+    ctx->module->validateNativePointer(requestArray, count * sizeof(int32_t));
+    ctx->module->validateNativePointer(idxPtr, sizeof(int32_t));
+
+    // MPI_STATUS_IGNORE is a null pointer, which WAMR converts to the start of
+    // the module's memory
+    MPI_Status* statusOut = nullptr;
+    if (ctx->module->nativePointerToWasmOffset(status) != 0) {
+        ctx->module->validateNativePointer(status, sizeof(MPI_Status));
+        statusOut = reinterpret_cast<MPI_Status*>(status);
+    }
 
-    return 0;
+    int32_t idx = -1;
+    CALL_MPI_WORLD_CATCH_EXCEPTION_NO_RETURN(
+      idx = doMpiWaitAny(ctx->world, requestArray, count, statusOut))
+
+    *idxPtr = idx < 0 ? MPI_UNDEFINED : idx;
+
+    return MPI_SUCCESS;
 }
 
 static double MPI_Wtime_wrapper()
@@ -1135,10 +1360,10 @@ static double MPI_Wtime_wrapper()
 static NativeSymbol ns[] = {
     REG_NATIVE_FUNC(MPI_Abort, "(ii)i"),
     REG_NATIVE_FUNC(MPI_Allgather, "(*i**i**)i"),
-    REG_NATIVE_FUNC(MPI_Allgatherv, "(*i**ii**)i"),
+    REG_NATIVE_FUNC(MPI_Allgatherv, "(*i******)i"),
     REG_NATIVE_FUNC(MPI_Allreduce, "(**i***)i"),
     REG_NATIVE_FUNC(MPI_Alltoall, "(*i**i**)i"),
-    REG_NATIVE_FUNC(MPI_Alltoallv, "(*ii**ii**)i"),
+    REG_NATIVE_FUNC(MPI_Alltoallv, "(*********)i"),
     REG_NATIVE_FUNC(MPI_Barrier, "(*)i"),
     REG_NATIVE_FUNC(MPI_Bcast, "(*i*i*)i"),
     REG_NATIVE_FUNC(MPI_Cart_create, "(*iiii*)i"),
@@ -1163,7 +1388,7 @@ static NativeSymbol ns[] = {
     REG_NATIVE_FUNC(MPI_Probe, "(ii**)i"),
     REG_NATIVE_FUNC(MPI_Recv, "(*i*ii**)i"),
     REG_NATIVE_FUNC(MPI_Reduce, "(**i**i*)i"),
-    REG_NATIVE_FUNC(MPI_Reduce_scatter, "(**i***)i"),
+    REG_NATIVE_FUNC(MPI_Reduce_scatter, "(******)i"),
     REG_NATIVE_FUNC(MPI_Request_free, "(*)i"),
     REG_NATIVE_FUNC(MPI_Rsend, "(*i*ii*)i"),
     REG_NATIVE_FUNC(MPI_Scan, "(**i***)i"),
@@ -1176,7 +1401,7 @@ static NativeSymbol ns[] = {
     REG_NATIVE_FUNC(MPI_Type_size, "(**)i"),
     REG_NATIVE_FUNC(MPI_Wait, "(*i)i"),
     REG_NATIVE_FUNC(MPI_Waitall, "(i**)i"),
-    REG_NATIVE_FUNC(MPI_Waitany, "(i*i*)i"),
+    REG_NATIVE_FUNC(MPI_Waitany, "(i***)i"),
     REG_NATIVE_FUNC(MPI_Wtime, "()F"),
 };
 
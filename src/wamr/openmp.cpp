@@ -38,6 +38,158 @@ static void __kmpc_end_critical_wrapper(wasm_exec_env_t execEnv,
       wasm::doOpenMPEndCritical(loc, globalTid, crit));
 }
 
+static void __kmpc_dispatch_fini_4_wrapper(wasm_exec_env_t execEnv,
+                                           int32_t loc,
+                                           int32_t gtid)
+{
+    CALL_OPENMP_CATCH_EXCETION_NO_RETURN(wasm::doOpenMPDispatchFini(loc, gtid));
+}
+
+static void __kmpc_dispatch_fini_4u_wrapper(wasm_exec_env_t execEnv,
+                                            int32_t loc,
+                                            int32_t gtid)
+{
+    CALL_OPENMP_CATCH_EXCETION_NO_RETURN(wasm::doOpenMPDispatchFini(loc, gtid));
+}
+
+static void __kmpc_dispatch_fini_8_wrapper(wasm_exec_env_t execEnv,
+                                           int32_t loc,
+                                           int32_t gtid)
+{
+    CALL_OPENMP_CATCH_EXCETION_NO_RETURN(wasm::doOpenMPDispatchFini(loc, gtid));
+}
+
+static void __kmpc_dispatch_fini_8u_wrapper(wasm_exec_env_t execEnv,
+                                            int32_t loc,
+                                            int32_t gtid)
+{
+    CALL_OPENMP_CATCH_EXCETION_NO_RETURN(wasm::doOpenMPDispatchFini(loc, gtid));
+}
+
+static void __kmpc_dispatch_init_4_wrapper(wasm_exec_env_t execEnv,
+                                           int32_t loc,
+                                           int32_t gtid,
+                                           int32_t schedule,
+                                           int32_t lower,
+                                           int32_t upper,
+                                           int32_t stride,
+                                           int32_t chunk)
+{
+    CALL_OPENMP_CATCH_EXCETION_NO_RETURN(wasm::doOpenMPDispatchInit4(
+      loc, gtid, schedule, lower, upper, stride, chunk));
+}
+
+static void __kmpc_dispatch_init_4u_wrapper(wasm_exec_env_t execEnv,
+                                            int32_t loc,
+                                            int32_t gtid,
+                                            int32_t schedule,
+                                            uint32_t lower,
+                                            uint32_t upper,
+                                            int32_t stride,
+                                            int32_t chunk)
+{
+    CALL_OPENMP_CATCH_EXCETION_NO_RETURN(wasm::doOpenMPDispatchInit4u(
+      loc, gtid, schedule, lower, upper, stride, chunk));
+}
+
+static void __kmpc_dispatch_init_8_wrapper(wasm_exec_env_t execEnv,
+                                           int32_t loc,
+                                           int32_t gtid,
+                                           int32_t schedule,
+                                           int64_t lower,
+                                           int64_t upper,
+                                           int64_t stride,
+                                           int64_t chunk)
+{
+    CALL_OPENMP_CATCH_EXCETION_NO_RETURN(wasm::doOpenMPDispatchInit8(
+      loc, gtid, schedule, lower, upper, stride, chunk));
+}
+
+static void __kmpc_dispatch_init_8u_wrapper(wasm_exec_env_t execEnv,
+                                            int32_t loc,
+                                            int32_t gtid,
+                                            int32_t schedule,
+                                            uint64_t lower,
+                                            uint64_t upper,
+                                            int64_t stride,
+                                            int64_t chunk)
+{
+    CALL_OPENMP_CATCH_EXCETION_NO_RETURN(wasm::doOpenMPDispatchInit8u(
+      loc, gtid, schedule, lower, upper, stride, chunk));
+}
+
+static int32_t __kmpc_dispatch_next_4_wrapper(wasm_exec_env_t execEnv,
+                                              int32_t loc,
+                                              int32_t gtid,
+                                              int32_t* lastIter,
+                                              int32_t* lower,
+                                              int32_t* upper,
+                                              int32_t* stride)
+{
+    try {
+        return wasm::doOpenMPDispatchNext4(
+          loc, gtid, lastIter, lower, upper, stride);
+    } catch (std::exception& e) {
+        wasm::getExecutingWAMRModule()->doThrowException(e);
+    }
+
+    return 0;
+}
+
+static int32_t __kmpc_dispatch_next_4u_wrapper(wasm_exec_env_t execEnv,
+                                               int32_t loc,
+                                               int32_t gtid,
+                                               int32_t* lastIter,
+                                               uint32_t* lower,
+                                               uint32_t* upper,
+                                               int32_t* stride)
+{
+    try {
+        return wasm::doOpenMPDispatchNext4u(
+          loc, gtid, lastIter, lower, upper, stride);
+    } catch (std::exception& e) {
+        wasm::getExecutingWAMRModule()->doThrowException(e);
+    }
+
+    return 0;
+}
+
+static int32_t __kmpc_dispatch_next_8_wrapper(wasm_exec_env_t execEnv,
+                                              int32_t loc,
+                                              int32_t gtid,
+                                              int32_t* lastIter,
+                                              int64_t* lower,
+                                              int64_t* upper,
+                                              int64_t* stride)
+{
+    try {
+        return wasm::doOpenMPDispatchNext8(
+          loc, gtid, lastIter, lower, upper, stride);
+    } catch (std::exception& e) {
+        wasm::getExecutingWAMRModule()->doThrowException(e);
+    }
+
+    return 0;
+}
+
+static int32_t __kmpc_dispatch_next_8u_wrapper(wasm_exec_env_t execEnv,
+                                               int32_t loc,
+                                               int32_t gtid,
+                                               int32_t* lastIter,
+                                               uint64_t* lower,
+                                               uint64_t* upper,
+                                               int64_t* stride)
+{
+    try {
+        return wasm::doOpenMPDispatchNext8u(
+          loc, gtid, lastIter, lower, upper, stride);
+    } catch (std::exception& e) {
+        wasm::getExecutingWAMRModule()->doThrowException(e);
+    }
+
+    return 0;
+}
+
 static void __kmpc_end_master_wrapper(wasm_exec_env_t execEnv,
                                       int32_t loc,
                                       int32_t globalTid)
@@ -53,7 +205,7 @@ static void __kmpc_end_reduce_wrapper(wasm_exec_env_t execEnv,
 {
     OMP_FUNC_ARGS("__kmpc_end_reduce {} {} {}", loc, gtid, lck);
     CALL_OPENMP_CATCH_EXCETION_NO_RETURN(
-      wasm::doOpenMPEndReduceCritical(msg, true));
+      wasm::doOpenMPEndReduce(msg, true));
 }
 
 static void __kmpc_end_reduce_nowait_wrapper(wasm_exec_env_t execEnv,
@@ -63,7 +215,7 @@ static void __kmpc_end_reduce_nowait_wrapper(wasm_exec_env_t execEnv,
 {
     OMP_FUNC_ARGS("__kmpc_end_reduce_nowait {} {} {}", loc, gtid, lck);
     CALL_OPENMP_CATCH_EXCETION_NO_RETURN(
-      wasm::doOpenMPEndReduceCritical(msg, false));
+      wasm::doOpenMPEndReduce(msg, false));
 }
 
 static void __kmpc_end_single_wrapper(wasm_exec_env_t execEnv,
@@ -169,6 +321,36 @@ static void __kmpc_push_num_threads_wrapper(wasm_exec_env_t execEnv,
     wasm::doOpenMPPushNumThreads(loc, globalTid, numThreads);
 }
 
+// Runs the reduction, calling the compiler-generated reduction function
+// through the function table
+static int32_t startReduce(wasm_exec_env_t execEnv,
+                           faabric::Message* msg,
+                           std::shared_ptr<threads::Level> level,
+                           int32_t reduceData,
+                           int32_t reduceFunc,
+                           bool barrier)
+{
+    auto combine = [execEnv, reduceFunc](int32_t lhs, int32_t rhs) {
+        std::vector<uint32_t> argv = { (uint32_t)lhs, (uint32_t)rhs };
+        if (!wasm_runtime_call_indirect(execEnv, reduceFunc, 2, argv.data())) {
+            wasm_module_inst_t moduleInstance =
+              wasm_runtime_get_module_inst(execEnv);
+            SPDLOG_ERROR("Failed calling OpenMP reduction function: {}",
+                         wasm_runtime_get_exception(moduleInstance));
+            throw std::runtime_error("Failed calling reduction function");
+        }
+    };
+
+    try {
+        return wasm::doOpenMPStartReduce(
+          msg, level, reduceData, combine, barrier);
+    } catch (std::exception& e) {
+        wasm::getExecutingWAMRModule()->doThrowException(e);
+    }
+
+    return 0;
+}
+
 static int32_t __kmpc_reduce_wrapper(wasm_exec_env_t execEnv,
                                      int32_t loc,
                                      int32_t gtid,
@@ -187,10 +369,7 @@ static int32_t __kmpc_reduce_wrapper(wasm_exec_env_t execEnv,
                   reduceFunc,
                   lockPtr);
 
-    CALL_OPENMP_CATCH_EXCETION_NO_RETURN(wasm::doOpenMPStartReduceCritical(
-      msg, level, numReduceVars, reduceVarPtrs, reduceVarsSize));
-
-    return 1;
+    return startReduce(execEnv, msg, level, reduceVarPtrs, reduceFunc, true);
 }
 
 static int32_t __kmpc_reduce_nowait_wrapper(wasm_exec_env_t execEnv,
@@ -211,10 +390,7 @@ static int32_t __kmpc_reduce_nowait_wrapper(wasm_exec_env_t execEnv,
                   reduceFunc,
                   lockPtr);
 
-    CALL_OPENMP_CATCH_EXCETION_NO_RETURN(wasm::doOpenMPStartReduceCritical(
-      msg, level, numReduceVars, reduceVarPtrs, reduceVarsSize));
-
-    return 1;
+    return startReduce(execEnv, msg, level, reduceVarPtrs, reduceFunc, false);
 }
 
 static int32_t omp_get_max_threads_wrapper(wasm_exec_env_t execEnv)
@@ -237,15 +413,41 @@ static double omp_get_wtime_wrapper(wasm_exec_env_t execEnv)
     return wasm::doOpenMPGetWTime();
 }
 
+static void omp_get_schedule_wrapper(wasm_exec_env_t execEnv,
+                                     int32_t* kind,
+                                     int32_t* chunk)
+{
+    wasm::doOpenMPGetSchedule(kind, chunk);
+}
+
 static void omp_set_num_threads_wrapper(wasm_exec_env_t execEnv,
                                         int32_t numThreads)
 {
     wasm::doOpenMPSetNumThreads(numThreads);
 }
 
+static void omp_set_schedule_wrapper(wasm_exec_env_t execEnv,
+                                     int32_t kind,
+                                     int32_t chunk)
+{
+    wasm::doOpenMPSetSchedule(kind, chunk);
+}
+
 static NativeSymbol ns[] = {
     REG_NATIVE_FUNC(__kmpc_barrier, "(ii)"),
     REG_NATIVE_FUNC(__kmpc_critical, "(iii)"),
+    REG_NATIVE_FUNC(__kmpc_dispatch_fini_4, "(ii)"),
+    REG_NATIVE_FUNC(__kmpc_dispatch_fini_4u, "(ii)"),
+    REG_NATIVE_FUNC(__kmpc_dispatch_fini_8, "(ii)"),
+    REG_NATIVE_FUNC(__kmpc_dispatch_fini_8u, "(ii)"),
+    REG_NATIVE_FUNC(__kmpc_dispatch_init_4, "(iiiiiii)"),
+    REG_NATIVE_FUNC(__kmpc_dispatch_init_4u, "(iiiiiii)"),
+    REG_NATIVE_FUNC(__kmpc_dispatch_init_8, "(iiiIIII)"),
+    REG_NATIVE_FUNC(__kmpc_dispatch_init_8u, "(iiiIIII)"),
+    REG_NATIVE_FUNC(__kmpc_dispatch_next_4, "(ii****)i"),
+    REG_NATIVE_FUNC(__kmpc_dispatch_next_4u, "(ii****)i"),
+    REG_NATIVE_FUNC(__kmpc_dispatch_next_8, "(ii****)i"),
+    REG_NATIVE_FUNC(__kmpc_dispatch_next_8u, "(ii****)i"),
     REG_NATIVE_FUNC(__kmpc_end_critical, "(iii)"),
     REG_NATIVE_FUNC(__kmpc_end_master, "(ii)"),
     REG_NATIVE_FUNC(__kmpc_end_reduce, "(iii)"),
@@ -264,9 +466,11 @@ static NativeSymbol ns[] = {
     REG_NATIVE_FUNC(__kmpc_single, "(ii)i"),
     REG_NATIVE_FUNC(omp_get_max_threads, "()i"),
     REG_NATIVE_FUNC(omp_get_num_threads, "()i"),
+    REG_NATIVE_FUNC(omp_get_schedule, "(**)"),
     REG_NATIVE_FUNC(omp_get_thread_num, "()i"),
     REG_NATIVE_FUNC(omp_get_wtime, "()F"),
     REG_NATIVE_FUNC(omp_set_num_threads, "(i)"),
+    REG_NATIVE_FUNC(omp_set_schedule, "(ii)"),
 };
 
 uint32_t getFaasmOpenMPApi(NativeSymbol** nativeSymbols)
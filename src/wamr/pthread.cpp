@@ -41,17 +41,23 @@ static int32_t pthread_join_wrapper(wasm_exec_env_t execEnv,
         *resPtr = returnValue;
     }
 
-    // Our pthread_join implementation assumes that the first pthread_join
-    // is called after _all_ pthread_create calls have been made, and waits
-    // for _all_ pthread threads to finish. As a consequence, it is safe to
-    // kill all thread execution environments from _any_ call to pthread_join
-    // (the method is idempotent, so we can call many times)
+    // Threads run as soon as they are created, so we can only kill the
+    // threads' execution environments once none are left running (the method
+    // is idempotent, so we can call it many times)
     auto* wamrModule = getExecutingWAMRModule();
-    wamrModule->destroyThreadsExecEnv();
+    if (wamrModule->getPendingPthreadCount() == 0) {
+        wamrModule->destroyThreadsExecEnv();
+    }
 
     return 0;
 }
 
+static int32_t pthread_detach_wrapper(wasm_exec_env_t execEnv,
+                                      int32_t pthreadPtr)
+{
+    return wasm::doPthreadDetach(pthreadPtr);
+}
+
 static int32_t pthread_once_wrapper(wasm_exec_env_t exec_env,
                                     int32_t a,
                                     int32_t b)
@@ -93,29 +99,26 @@ static int32_t pthread_cond_init_wrapper(wasm_exec_env_t exec_env,
                                          int32_t a,
                                          int32_t b)
 {
-    SPDLOG_DEBUG("S - pthread_cond_init {}", a, b);
+    SPDLOG_DEBUG("S - pthread_cond_init {} {}", a, b);
     return 0;
 }
 
 static int32_t pthread_cond_signal_wrapper(wasm_exec_env_t exec_env, int32_t a)
 {
-    SPDLOG_DEBUG("S - pthread_cond_signal {}", a);
-    return 0;
+    return doPthreadCondSignal(a);
 }
 
 static int32_t pthread_cond_wait_wrapper(wasm_exec_env_t exec_env,
                                          int32_t a,
                                          int32_t b)
 {
-    SPDLOG_DEBUG("S - pthread_cond_wait {}", a, b);
-    return 0;
+    return doPthreadCondWait(a, b);
 }
 
 static int32_t pthread_cond_broadcast_wrapper(wasm_exec_env_t exec_env,
                                               int32_t a)
 {
-    SPDLOG_DEBUG("S - pthread_cond_broadcast {}", a);
-    return 0;
+    return doPthreadCondBroadcast(a);
 }
 
 static int32_t pthread_cond_destroy_wrapper(wasm_exec_env_t exec_env, int32_t a)
@@ -150,6 +153,7 @@ static NativeSymbol ns[] = {
     REG_NATIVE_FUNC(pthread_create, "(iiii)i"),
     REG_NATIVE_FUNC(pthread_exit, "(i)"),
     REG_NATIVE_FUNC(pthread_join, "(i*)i"),
+    REG_NATIVE_FUNC(pthread_detach, "(i)i"),
     REG_NATIVE_FUNC(pthread_once, "(ii)i"),
     REG_NATIVE_FUNC(pthread_mutex_init, "(ii)i"),
     REG_NATIVE_FUNC(pthread_mutex_lock, "(i)i"),
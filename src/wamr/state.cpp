@@ -5,6 +5,7 @@
 #include <wamr/native.h>
 #include <wasm/WasmExecutionContext.h>
 #include <wasm/WasmModule.h>
+#include <wasm/state.h>
 
 #include <wasm_export.h>
 
@@ -91,11 +92,335 @@ static void __faasm_push_state_wrapper(wasm_exec_env_t exec_env, char* key)
     kv->pushFull();
 }
 
+/**
+ * Pushes only the chunks of the given key that have been flagged as dirty
+ */
+static void __faasm_push_state_partial_wrapper(wasm_exec_env_t exec_env,
+                                               char* key)
+{
+    SPDLOG_DEBUG("S - faasm_push_state_partial - {}", key);
+
+    auto kv = getStateKV(key, 0);
+    kv->pushPartial();
+}
+
+/**
+ * Pushes the dirty chunks of the given key, restricted to the bytes set in
+ * the value of the mask key
+ */
+static void __faasm_push_state_partial_mask_wrapper(wasm_exec_env_t exec_env,
+                                                    char* key,
+                                                    char* maskKey)
+{
+    SPDLOG_DEBUG("S - faasm_push_state_partial_mask - {} {}", key, maskKey);
+
+    auto kv = getStateKV(key, 0);
+    auto maskKv = getStateKV(maskKey, 0);
+    kv->pushPartialMask(maskKv);
+}
+
+/**
+ * Writes the given buffer to the state at the given offset, only marking the
+ * chunk it covers as dirty
+ */
+static void __faasm_write_state_offset_wrapper(wasm_exec_env_t exec_env,
+                                               char* key,
+                                               int32_t totalLen,
+                                               int32_t offset,
+                                               uint8_t* buffer,
+                                               int32_t bufferLen)
+{
+    SPDLOG_DEBUG("S - faasm_write_state_offset - {} {} {} <data> {}",
+                 key,
+                 totalLen,
+                 offset,
+                 bufferLen);
+
+    auto kv = getStateKV(key, totalLen);
+    kv->setChunk(offset, buffer, bufferLen);
+}
+
+/**
+ * Reads the chunk of state at the given offset into the buffer provided,
+ * pulling only that chunk if it is not already present
+ */
+static void __faasm_read_state_offset_wrapper(wasm_exec_env_t exec_env,
+                                              char* key,
+                                              int32_t totalLen,
+                                              int32_t offset,
+                                              uint8_t* buffer,
+                                              int32_t bufferLen)
+{
+    SPDLOG_DEBUG("S - faasm_read_state_offset - {} {} {} <buffer> {}",
+                 key,
+                 totalLen,
+                 offset,
+                 bufferLen);
+
+    auto kv = getStateKV(key, totalLen);
+    kv->getChunk(offset, buffer, bufferLen);
+}
+
+/**
+ * Maps the chunk of state at the given offset into linear memory and returns
+ * a pointer to it. Writes through the pointer go straight to the shared
+ * state, and must be flagged as dirty to be pushed.
+ */
+static int32_t __faasm_read_state_offset_ptr_wrapper(wasm_exec_env_t exec_env,
+                                                     char* key,
+                                                     int32_t totalLen,
+                                                     int32_t offset,
+                                                     int32_t len)
+{
+    SPDLOG_DEBUG("S - faasm_read_state_offset_ptr - {} {} {} {}",
+                 key,
+                 totalLen,
+                 offset,
+                 len);
+
+    auto kv = getStateKV(key, totalLen);
+
+    WasmModule* module = getExecutingModule();
+    uint32_t wasmPtr = module->mapSharedStateMemory(kv, offset, len);
+
+    // Make sure the chunk is pulled
+    kv->getChunk(offset, len);
+
+    return wasmPtr;
+}
+
+static void __faasm_flag_state_dirty_wrapper(wasm_exec_env_t exec_env,
+                                             char* key,
+                                             int32_t totalLen)
+{
+    SPDLOG_DEBUG("S - faasm_flag_state_dirty - {} {}", key, totalLen);
+
+    auto kv = getStateKV(key, totalLen);
+    kv->flagDirty();
+}
+
+static void __faasm_flag_state_offset_dirty_wrapper(wasm_exec_env_t exec_env,
+                                                    char* key,
+                                                    int32_t totalLen,
+                                                    int32_t offset,
+                                                    int32_t len)
+{
+    // Called for every write through a mapped chunk, so no logging here
+    auto kv = getStateKV(key, totalLen);
+    kv->flagChunkDirty(offset, len);
+}
+
+static void __faasm_clear_appended_state_wrapper(wasm_exec_env_t exec_env,
+                                                 char* key)
+{
+    SPDLOG_DEBUG("S - faasm_clear_appended_state - {}", key);
+
+    auto kv = getStateKV(key, 0);
+    kv->clearAppended();
+}
+
+static void __faasm_lock_state_read_wrapper(wasm_exec_env_t exec_env,
+                                            char* key)
+{
+    SPDLOG_DEBUG("S - faasm_lock_state_read - {}", key);
+    getStateKV(key, 0)->lockRead();
+}
+
+static void __faasm_unlock_state_read_wrapper(wasm_exec_env_t exec_env,
+                                              char* key)
+{
+    SPDLOG_DEBUG("S - faasm_unlock_state_read - {}", key);
+    getStateKV(key, 0)->unlockRead();
+}
+
+static void __faasm_lock_state_write_wrapper(wasm_exec_env_t exec_env,
+                                             char* key)
+{
+    SPDLOG_DEBUG("S - faasm_lock_state_write - {}", key);
+    getStateKV(key, 0)->lockWrite();
+}
+
+static void __faasm_unlock_state_write_wrapper(wasm_exec_env_t exec_env,
+                                               char* key)
+{
+    SPDLOG_DEBUG("S - faasm_unlock_state_write - {}", key);
+    getStateKV(key, 0)->unlockWrite();
+}
+
+static std::string getBatchKey(WAMRWasmModule* module, uint32_t keyPtr)
+{
+    if (!wasm_runtime_validate_app_str_addr(module->getModuleInstance(),
+                                            keyPtr)) {
+        SPDLOG_ERROR("Invalid key pointer in state batch: {}", keyPtr);
+        throw std::runtime_error("Invalid key pointer in state batch");
+    }
+
+    return std::string((char*)module->wasmPointerToNative(keyPtr));
+}
+
+static void validateBatchArray(WAMRWasmModule* module,
+                               void* array,
+                               int32_t nKeys)
+{
+    if (nKeys < 0) {
+        SPDLOG_ERROR("Invalid number of keys for state batch: {}", nKeys);
+        throw std::runtime_error("Invalid number of keys for state batch");
+    }
+
+    if (nKeys > 0) {
+        module->validateNativePointer(array, nKeys * sizeof(int32_t));
+    }
+}
+
+// Reads the keys and buffers of a batched state call out of the arrays of
+// wasm offsets and lengths passed in. Without offsets, each entry covers the
+// whole value
+static std::vector<StateBatchEntry> getStateBatch(int32_t nKeys,
+                                                  uint32_t* keyPtrs,
+                                                  uint32_t* bufferPtrs,
+                                                  int32_t* lens,
+                                                  int32_t* totalLens = nullptr,
+                                                  int32_t* offsets = nullptr)
+{
+    WAMRWasmModule* module = getExecutingWAMRModule();
+    validateBatchArray(module, keyPtrs, nKeys);
+    validateBatchArray(module, bufferPtrs, nKeys);
+    validateBatchArray(module, lens, nKeys);
+    if (offsets != nullptr) {
+        validateBatchArray(module, totalLens, nKeys);
+        validateBatchArray(module, offsets, nKeys);
+    }
+
+    std::vector<StateBatchEntry> entries(nKeys);
+    for (int32_t i = 0; i < nKeys; i++) {
+        module->validateWasmOffset(bufferPtrs[i], lens[i]);
+
+        StateBatchEntry& entry = entries.at(i);
+        entry.key = getBatchKey(module, keyPtrs[i]);
+        entry.buffer = module->wasmPointerToNative(bufferPtrs[i]);
+        entry.len = lens[i];
+        entry.totalLen = offsets == nullptr ? lens[i] : totalLens[i];
+        entry.offset = offsets == nullptr ? 0 : offsets[i];
+    }
+
+    return entries;
+}
+
+static std::vector<std::string> getStateBatchKeys(int32_t nKeys,
+                                                  uint32_t* keyPtrs)
+{
+    WAMRWasmModule* module = getExecutingWAMRModule();
+    validateBatchArray(module, keyPtrs, nKeys);
+
+    std::vector<std::string> keys;
+    for (int32_t i = 0; i < nKeys; i++) {
+        keys.push_back(getBatchKey(module, keyPtrs[i]));
+    }
+
+    return keys;
+}
+
+/**
+ * Reads the state for many keys at once, each into its own buffer. Takes
+ * arrays of pointers to the keys and buffers, and of the buffers' lengths
+ */
+static void __faasm_read_state_batch_wrapper(wasm_exec_env_t exec_env,
+                                             uint32_t* keyPtrs,
+                                             uint32_t* bufferPtrs,
+                                             int32_t* bufferLens,
+                                             int32_t nKeys)
+{
+    std::string user = ExecutorContext::get()->getMsg().user();
+    doFaasmReadStateBatch(
+      user, getStateBatch(nKeys, keyPtrs, bufferPtrs, bufferLens));
+}
+
+/**
+ * Reads a chunk of state for many keys at once, as with
+ * __faasm_read_state_offset
+ */
+static void __faasm_read_state_offset_batch_wrapper(wasm_exec_env_t exec_env,
+                                                    uint32_t* keyPtrs,
+                                                    int32_t* totalLens,
+                                                    int32_t* offsets,
+                                                    uint32_t* bufferPtrs,
+                                                    int32_t* bufferLens,
+                                                    int32_t nKeys)
+{
+    std::string user = ExecutorContext::get()->getMsg().user();
+    doFaasmReadStateBatch(
+      user,
+      getStateBatch(
+        nKeys, keyPtrs, bufferPtrs, bufferLens, totalLens, offsets));
+}
+
+static void __faasm_write_state_batch_wrapper(wasm_exec_env_t exec_env,
+                                              uint32_t* keyPtrs,
+                                              uint32_t* bufferPtrs,
+                                              int32_t* bufferLens,
+                                              int32_t nKeys)
+{
+    std::string user = ExecutorContext::get()->getMsg().user();
+    doFaasmWriteStateBatch(
+      user, getStateBatch(nKeys, keyPtrs, bufferPtrs, bufferLens));
+}
+
+static void __faasm_write_state_offset_batch_wrapper(wasm_exec_env_t exec_env,
+                                                     uint32_t* keyPtrs,
+                                                     int32_t* totalLens,
+                                                     int32_t* offsets,
+                                                     uint32_t* bufferPtrs,
+                                                     int32_t* bufferLens,
+                                                     int32_t nKeys)
+{
+    std::string user = ExecutorContext::get()->getMsg().user();
+    doFaasmWriteStateBatch(
+      user,
+      getStateBatch(
+        nKeys, keyPtrs, bufferPtrs, bufferLens, totalLens, offsets));
+}
+
+static void __faasm_push_state_batch_wrapper(wasm_exec_env_t exec_env,
+                                             uint32_t* keyPtrs,
+                                             int32_t nKeys)
+{
+    std::string user = ExecutorContext::get()->getMsg().user();
+    doFaasmPushStateBatch(user, getStateBatchKeys(nKeys, keyPtrs), false);
+}
+
+static void __faasm_push_state_partial_batch_wrapper(wasm_exec_env_t exec_env,
+                                                     uint32_t* keyPtrs,
+                                                     int32_t nKeys)
+{
+    std::string user = ExecutorContext::get()->getMsg().user();
+    doFaasmPushStateBatch(user, getStateBatchKeys(nKeys, keyPtrs), true);
+}
+
+// Pulling, pushing in full, and appending state are registered with the rest
+// of the Faasm API
 static NativeSymbol ns[] = {
     REG_NATIVE_FUNC(__faasm_read_state, "($$i)i"),
     REG_NATIVE_FUNC(__faasm_read_state_ptr, "($i)i"),
     REG_NATIVE_FUNC(__faasm_write_state, "($$i)"),
     REG_NATIVE_FUNC(__faasm_push_state, "($)"),
+    REG_NATIVE_FUNC(__faasm_push_state_partial, "($)"),
+    REG_NATIVE_FUNC(__faasm_push_state_partial_mask, "($$)"),
+    REG_NATIVE_FUNC(__faasm_write_state_offset, "($ii*~)"),
+    REG_NATIVE_FUNC(__faasm_read_state_offset, "($ii*~)"),
+    REG_NATIVE_FUNC(__faasm_read_state_offset_ptr, "($iii)i"),
+    REG_NATIVE_FUNC(__faasm_flag_state_dirty, "($i)"),
+    REG_NATIVE_FUNC(__faasm_flag_state_offset_dirty, "($iii)"),
+    REG_NATIVE_FUNC(__faasm_clear_appended_state, "($)"),
+    REG_NATIVE_FUNC(__faasm_lock_state_read, "($)"),
+    REG_NATIVE_FUNC(__faasm_unlock_state_read, "($)"),
+    REG_NATIVE_FUNC(__faasm_lock_state_write, "($)"),
+    REG_NATIVE_FUNC(__faasm_unlock_state_write, "($)"),
+    REG_NATIVE_FUNC(__faasm_read_state_batch, "(***i)"),
+    REG_NATIVE_FUNC(__faasm_read_state_offset_batch, "(*****i)"),
+    REG_NATIVE_FUNC(__faasm_write_state_batch, "(***i)"),
+    REG_NATIVE_FUNC(__faasm_write_state_offset_batch, "(*****i)"),
+    REG_NATIVE_FUNC(__faasm_push_state_batch, "(*i)"),
+    REG_NATIVE_FUNC(__faasm_push_state_partial_batch, "(*i)"),
 };
 
 uint32_t getFaasmStateApi(NativeSymbol** nativeSymbols)
@@ -0,0 +1,356 @@
+#include <wasm/LocalMpiTransport.h>
+
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace wasm {
+
+// Mixes the halves of the key, as std::hash is the identity for integers
+size_t LocalMpiTransport::ChannelKeyHash::operator()(
+  const ChannelKey& key) const
+{
+    uint64_t ranks = (((uint64_t)(uint32_t)key.sendRank) << 32) |
+                     ((uint64_t)(uint32_t)key.recvRank);
+    uint64_t rest = (((uint64_t)(uint32_t)key.worldId) << 32) |
+                    ((uint64_t)(uint32_t)key.tag);
+
+    return std::hash<uint64_t>()(ranks) ^
+           (std::hash<uint64_t>()(rest) * 0x9E3779B97F4A7C15ULL);
+}
+
+LocalMpiGroup::LocalMpiGroup(const std::vector<int>& ranksIn)
+  : ranks([&ranksIn] {
+      std::vector<int> sorted = ranksIn;
+      std::sort(sorted.begin(), sorted.end());
+      return sorted;
+  }())
+  , sendBuffers(ranks.size(), nullptr)
+  , recvBuffers(ranks.size(), nullptr)
+{}
+
+int LocalMpiGroup::getLocalIdx(int rank) const
+{
+    auto it = std::lower_bound(ranks.begin(), ranks.end(), rank);
+    if (it == ranks.end() || *it != rank) {
+        SPDLOG_ERROR("Rank {} not in local MPI group", rank);
+        throw std::runtime_error("Rank not in local MPI group");
+    }
+
+    return it - ranks.begin();
+}
+
+void LocalMpiGroup::shareBuffers(int rank,
+                                 const uint8_t* sendBuffer,
+                                 uint8_t* recvBuffer)
+{
+    int localIdx = getLocalIdx(rank);
+    sendBuffers.at(localIdx) = sendBuffer;
+    recvBuffers.at(localIdx) = recvBuffer;
+
+    // The barrier's lock makes the buffers visible to the others
+    barrier();
+}
+
+const uint8_t* LocalMpiGroup::getSendBuffer(int localIdx) const
+{
+    return sendBuffers.at(localIdx);
+}
+
+uint8_t* LocalMpiGroup::getRecvBuffer(int localIdx) const
+{
+    return recvBuffers.at(localIdx);
+}
+
+void LocalMpiGroup::barrier()
+{
+    faabric::util::UniqueLock lock(mx);
+    int thisGeneration = generation;
+    if (++nWaiting == (int)ranks.size()) {
+        nWaiting = 0;
+        generation++;
+        cv.notify_all();
+        return;
+    }
+
+    cv.wait(lock, [this, thisGeneration] {
+        return generation != thisGeneration;
+    });
+}
+
+LocalMpiTransport& getLocalMpiTransport()
+{
+    static LocalMpiTransport transport;
+    return transport;
+}
+
+std::shared_ptr<LocalMpiTransport::Channel> LocalMpiTransport::getChannel(
+  const ChannelKey& key)
+{
+    {
+        faabric::util::SharedLock lock(channelsMx);
+        auto it = channels.find(key);
+        if (it != channels.end()) {
+            return it->second;
+        }
+    }
+
+    faabric::util::FullLock lock(channelsMx);
+    auto [it, _] = channels.try_emplace(key, std::make_shared<Channel>());
+    return it->second;
+}
+
+// Copies a send into a posted receive, which have both been taken off their
+// channel, so nobody else can touch them
+void LocalMpiTransport::transfer(Message& send, Message& recv)
+{
+    if (send.nBytes > recv.nBytes) {
+        SPDLOG_ERROR("Local MPI message truncated ({} > {})",
+                     send.nBytes,
+                     recv.nBytes);
+        send.truncated = true;
+        recv.truncated = true;
+    } else if (send.nBytes > 0) {
+        const uint8_t* src =
+          send.eagerData.empty() ? send.buffer : send.eagerData.data();
+        std::memcpy(recv.buffer, src, send.nBytes);
+        recv.nBytes = send.nBytes;
+    } else {
+        recv.nBytes = 0;
+    }
+
+    for (auto* msg : { &send, &recv }) {
+        msg->done.store(true, std::memory_order_release);
+        msg->done.notify_all();
+    }
+}
+
+std::shared_ptr<LocalMpiTransport::Message> LocalMpiTransport::doSend(
+  const ChannelKey& key,
+  const uint8_t* buffer,
+  size_t nBytes)
+{
+    auto msg = std::make_shared<Message>();
+    msg->buffer = const_cast<uint8_t*>(buffer);
+    msg->nBytes = nBytes;
+
+    std::shared_ptr<Channel> channel = getChannel(key);
+    std::shared_ptr<Message> recv = nullptr;
+    {
+        faabric::util::UniqueLock lock(channel->mx);
+        if (!channel->recvs.empty()) {
+            recv = channel->recvs.front();
+            channel->recvs.pop_front();
+            recv->matched = true;
+            msg->matched = true;
+        } else {
+            // Small messages are buffered so that the sender doesn't wait
+            if (nBytes <= LOCAL_MPI_EAGER_LIMIT) {
+                msg->eagerData.assign(buffer, buffer + nBytes);
+                msg->done.store(true, std::memory_order_release);
+            } else {
+                msg->channel = channel;
+            }
+
+            channel->sends.push_back(msg);
+            channel->cv.notify_all();
+        }
+    }
+
+    // Copy straight into the receiver's buffer outside the lock
+    if (recv != nullptr) {
+        transfer(*msg, *recv);
+    }
+
+    return msg;
+}
+
+std::shared_ptr<LocalMpiTransport::Message> LocalMpiTransport::doRecv(
+  const ChannelKey& key,
+  uint8_t* buffer,
+  size_t maxBytes)
+{
+    auto msg = std::make_shared<Message>();
+    msg->buffer = buffer;
+    msg->nBytes = maxBytes;
+
+    std::shared_ptr<Channel> channel = getChannel(key);
+    std::shared_ptr<Message> send = nullptr;
+    {
+        faabric::util::UniqueLock lock(channel->mx);
+        if (!channel->sends.empty()) {
+            send = channel->sends.front();
+            channel->sends.pop_front();
+            send->matched = true;
+            msg->matched = true;
+        } else {
+            channel->recvs.push_back(msg);
+        }
+    }
+
+    // Copy straight out of the sender's memory (or its eager copy) outside
+    // the lock. Senders waiting for us are woken once it's done
+    if (send != nullptr) {
+        transfer(*send, *msg);
+    }
+
+    return msg;
+}
+
+size_t LocalMpiTransport::awaitMessage(const std::shared_ptr<Message>& msg)
+{
+    // Large sends give the receiver a chance to copy the message straight out
+    // of our memory, then copy it out themselves if it hasn't turned up
+    if (msg->channel != nullptr) {
+        auto deadline =
+          std::chrono::steady_clock::now() +
+          std::chrono::microseconds(LOCAL_MPI_RENDEZVOUS_TIMEOUT_US);
+        while (!msg->done.load(std::memory_order_acquire) &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+
+        faabric::util::UniqueLock lock(msg->channel->mx);
+        if (!msg->matched) {
+            msg->eagerData.assign(msg->buffer, msg->buffer + msg->nBytes);
+            msg->done.store(true, std::memory_order_release);
+        }
+        msg->channel = nullptr;
+    }
+
+    while (!msg->done.load(std::memory_order_acquire)) {
+        msg->done.wait(false, std::memory_order_acquire);
+    }
+
+    if (msg->truncated) {
+        throw std::runtime_error("Local MPI message truncated");
+    }
+
+    return msg->nBytes;
+}
+
+int LocalMpiTransport::addRequest(std::shared_ptr<Message> msg)
+{
+    // Stay negative if the counter wraps around
+    int requestId = nextRequestId.fetch_sub(1);
+    if (requestId >= 0) {
+        nextRequestId.store(-1);
+        requestId = nextRequestId.fetch_sub(1);
+    }
+
+    faabric::util::UniqueLock lock(requestsMx);
+    requests[requestId] = std::move(msg);
+
+    return requestId;
+}
+
+void LocalMpiTransport::send(int worldId,
+                             int sendRank,
+                             int recvRank,
+                             const uint8_t* buffer,
+                             size_t nBytes,
+                             int tag)
+{
+    awaitMessage(doSend({ worldId, sendRank, recvRank, tag }, buffer, nBytes));
+}
+
+size_t LocalMpiTransport::recv(int worldId,
+                               int sendRank,
+                               int recvRank,
+                               uint8_t* buffer,
+                               size_t maxBytes,
+                               int tag)
+{
+    return awaitMessage(
+      doRecv({ worldId, sendRank, recvRank, tag }, buffer, maxBytes));
+}
+
+int LocalMpiTransport::isend(int worldId,
+                             int sendRank,
+                             int recvRank,
+                             const uint8_t* buffer,
+                             size_t nBytes,
+                             int tag)
+{
+    return addRequest(
+      doSend({ worldId, sendRank, recvRank, tag }, buffer, nBytes));
+}
+
+int LocalMpiTransport::irecv(int worldId,
+                             int sendRank,
+                             int recvRank,
+                             uint8_t* buffer,
+                             size_t maxBytes,
+                             int tag)
+{
+    return addRequest(
+      doRecv({ worldId, sendRank, recvRank, tag }, buffer, maxBytes));
+}
+
+size_t LocalMpiTransport::await(int requestId)
+{
+    std::shared_ptr<Message> msg = nullptr;
+    {
+        faabric::util::UniqueLock lock(requestsMx);
+        auto it = requests.find(requestId);
+        if (it == requests.end()) {
+            SPDLOG_ERROR("Local MPI request {} not found", requestId);
+            throw std::runtime_error("Local MPI request not found");
+        }
+
+        msg = it->second;
+        requests.erase(it);
+    }
+
+    return awaitMessage(msg);
+}
+
+size_t LocalMpiTransport::probe(int worldId,
+                                int sendRank,
+                                int recvRank,
+                                int tag)
+{
+    std::shared_ptr<Channel> channel =
+      getChannel({ worldId, sendRank, recvRank, tag });
+
+    faabric::util::UniqueLock lock(channel->mx);
+    channel->cv.wait(lock, [&channel] { return !channel->sends.empty(); });
+
+    return channel->sends.front()->nBytes;
+}
+
+std::shared_ptr<LocalMpiGroup> LocalMpiTransport::getGroup(
+  int worldId,
+  int groupId,
+  const std::vector<int>& ranks)
+{
+    faabric::util::UniqueLock lock(groupsMx);
+    auto& group = groups[{ worldId, groupId }];
+    if (group == nullptr) {
+        group = std::make_shared<LocalMpiGroup>(ranks);
+    }
+
+    return group;
+}
+
+void LocalMpiTransport::removeGroups(int worldId)
+{
+    faabric::util::UniqueLock lock(groupsMx);
+    groups.erase(groups.lower_bound({ worldId, INT32_MIN }),
+                 groups.upper_bound({ worldId, INT32_MAX }));
+}
+
+void LocalMpiTransport::removeReceiver(int worldId, int recvRank)
+{
+    faabric::util::FullLock lock(channelsMx);
+    std::erase_if(channels, [worldId, recvRank](const auto& entry) {
+        return entry.first.worldId == worldId &&
+               entry.first.recvRank == recvRank;
+    });
+}
+}
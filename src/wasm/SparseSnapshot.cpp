@@ -0,0 +1,375 @@
+#include <storage/ArtifactCache.h>
+#include <wasm/SparseSnapshot.h>
+
+#include <faabric/snapshot/SnapshotRegistry.h>
+#include <faabric/util/environment.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/memory.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <zlib.h>
+
+// See https://www.kernel.org/doc/Documentation/vm/pagemap.txt
+#define PAGEMAP_ENTRY_PRESENT (1ULL << 63)
+#define PAGEMAP_ENTRY_SWAPPED (1ULL << 62)
+#define PAGEMAP_ENTRY_FILE (1ULL << 61)
+
+#define SPARSE_SNAPSHOT_MAGIC 0x53505253
+
+namespace wasm {
+
+static void checkInRange(std::span<const uint8_t> bytes,
+                         size_t offset,
+                         size_t nBytes)
+{
+    if (offset + nBytes > bytes.size()) {
+        SPDLOG_ERROR("Sparse snapshot truncated ({} + {} > {})",
+                     offset,
+                     nBytes,
+                     bytes.size());
+        throw std::runtime_error("Sparse snapshot truncated");
+    }
+}
+
+template<typename T>
+static void appendValue(std::vector<uint8_t>& bytes, T value)
+{
+    const auto* valuePtr = reinterpret_cast<const uint8_t*>(&value);
+    bytes.insert(bytes.end(), valuePtr, valuePtr + sizeof(T));
+}
+
+template<typename T>
+static T readValue(std::span<const uint8_t> bytes, size_t& offset)
+{
+    checkInRange(bytes, offset, sizeof(T));
+
+    T value;
+    std::memcpy(&value, bytes.data() + offset, sizeof(T));
+    offset += sizeof(T);
+
+    return value;
+}
+
+// Extra threads are shared by all the (de)compressions on this host, so that
+// concurrent migrations don't start more threads than there are cores. The
+// calling thread always does its share, so work goes on with none spare
+static std::mutex spareThreadsMx;
+static int nSpareThreads = -1;
+
+static int takeSpareThreads(int nWanted)
+{
+    faabric::util::UniqueLock lock(spareThreadsMx);
+    if (nSpareThreads < 0) {
+        nSpareThreads = std::max(faabric::util::getUsableCores() - 1, 0);
+    }
+
+    int nTaken = std::min(nWanted, nSpareThreads);
+    nSpareThreads -= nTaken;
+    return nTaken;
+}
+
+static void returnSpareThreads(int nReturned)
+{
+    faabric::util::UniqueLock lock(spareThreadsMx);
+    nSpareThreads += nReturned;
+}
+
+// Calls the given function for each index across up to the given number of
+// threads, and rethrows the first error once they have all finished
+static void parallelFor(size_t n,
+                        int nThreads,
+                        const std::function<void(size_t)>& f)
+{
+    std::atomic<size_t> nextIdx = 0;
+    std::mutex errorMx;
+    std::exception_ptr error = nullptr;
+
+    auto worker = [&] {
+        for (size_t idx = nextIdx.fetch_add(1); idx < n;
+             idx = nextIdx.fetch_add(1)) {
+            try {
+                f(idx);
+            } catch (...) {
+                faabric::util::UniqueLock lock(errorMx);
+                if (error == nullptr) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    int nExtra = 0;
+    if (n > 1 && nThreads > 1) {
+        nExtra = takeSpareThreads(std::min<int>(nThreads, n) - 1);
+    }
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nExtra; i++) {
+        threads.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto& t : threads) {
+        t.join();
+    }
+    returnSpareThreads(nExtra);
+
+    if (error != nullptr) {
+        std::rethrow_exception(error);
+    }
+}
+
+SparseSnapshot::SparseSnapshot(const std::string& baseKeyIn, size_t sizeIn)
+  : baseKey(baseKeyIn)
+  , size(sizeIn)
+{}
+
+void SparseSnapshot::addPages(uint32_t offset, std::span<const uint8_t> data)
+{
+    if (offset + data.size() > size) {
+        SPDLOG_ERROR("Sparse snapshot pages out of range ({} + {} > {})",
+                     offset,
+                     data.size(),
+                     size);
+        throw std::runtime_error("Sparse snapshot pages out of range");
+    }
+
+    if (!runs.empty() &&
+        runs.back().offset + runs.back().data.size() == offset) {
+        std::vector<uint8_t>& runData = runs.back().data;
+        runData.insert(runData.end(), data.begin(), data.end());
+    } else {
+        runs.push_back({ offset, { data.begin(), data.end() } });
+    }
+
+    overlaySize += data.size();
+}
+
+const std::vector<SparseSnapshotRun>& SparseSnapshot::getRuns() const
+{
+    return runs;
+}
+
+size_t SparseSnapshot::getOverlaySize() const
+{
+    return overlaySize;
+}
+
+void SparseSnapshot::writeRuns(std::span<uint8_t> memory) const
+{
+    for (const auto& run : runs) {
+        if (run.offset + run.data.size() > memory.size()) {
+            SPDLOG_ERROR("Sparse snapshot run out of memory range ({} > {})",
+                         run.offset + run.data.size(),
+                         memory.size());
+            throw std::runtime_error("Sparse snapshot run out of range");
+        }
+
+        std::memcpy(
+          memory.data() + run.offset, run.data.data(), run.data.size());
+    }
+}
+
+std::vector<uint8_t> SparseSnapshot::toBytes(int nThreads) const
+{
+    struct Chunk
+    {
+        uint32_t offset;
+        std::span<const uint8_t> data;
+        std::vector<uint8_t> compressed;
+    };
+
+    std::vector<Chunk> chunks;
+    for (const auto& run : runs) {
+        size_t runSize = run.data.size();
+        for (size_t i = 0; i < runSize; i += SPARSE_SNAPSHOT_CHUNK_SIZE) {
+            size_t chunkSize =
+              std::min<size_t>(SPARSE_SNAPSHOT_CHUNK_SIZE, runSize - i);
+            chunks.push_back({ (uint32_t)(run.offset + i),
+                               { run.data.data() + i, chunkSize },
+                               {} });
+        }
+    }
+
+    // Favour speed over ratio, as this is on the critical path of migrations
+    parallelFor(chunks.size(), nThreads, [&chunks](size_t idx) {
+        Chunk& chunk = chunks.at(idx);
+        uLongf compressedSize = ::compressBound(chunk.data.size());
+        chunk.compressed.resize(compressedSize);
+
+        int res = ::compress2(chunk.compressed.data(),
+                              &compressedSize,
+                              chunk.data.data(),
+                              chunk.data.size(),
+                              Z_BEST_SPEED);
+        if (res != Z_OK) {
+            SPDLOG_ERROR("Failed to compress sparse snapshot chunk at {}: {}",
+                         chunk.offset,
+                         res);
+            throw std::runtime_error("Failed to compress sparse snapshot");
+        }
+
+        chunk.compressed.resize(compressedSize);
+    });
+
+    std::vector<uint8_t> bytes;
+    appendValue<uint32_t>(bytes, SPARSE_SNAPSHOT_MAGIC);
+    appendValue<uint32_t>(bytes, baseKey.size());
+    bytes.insert(bytes.end(), baseKey.begin(), baseKey.end());
+    appendValue<uint64_t>(bytes, size);
+    appendValue<uint32_t>(bytes, baseHash.size());
+    bytes.insert(bytes.end(), baseHash.begin(), baseHash.end());
+
+    appendValue<uint32_t>(bytes, chunks.size());
+    for (const auto& chunk : chunks) {
+        appendValue<uint32_t>(bytes, chunk.offset);
+        appendValue<uint32_t>(bytes, chunk.data.size());
+        appendValue<uint32_t>(bytes, chunk.compressed.size());
+        bytes.insert(
+          bytes.end(), chunk.compressed.begin(), chunk.compressed.end());
+    }
+
+    return bytes;
+}
+
+std::shared_ptr<SparseSnapshot> SparseSnapshot::fromBytes(
+  std::span<const uint8_t> bytes,
+  int nThreads)
+{
+    size_t offset = 0;
+    uint32_t magic = readValue<uint32_t>(bytes, offset);
+    if (magic != SPARSE_SNAPSHOT_MAGIC) {
+        SPDLOG_ERROR("Not a sparse snapshot (magic {:#x})", magic);
+        throw std::runtime_error("Not a sparse snapshot");
+    }
+
+    uint32_t keySize = readValue<uint32_t>(bytes, offset);
+    checkInRange(bytes, offset, keySize);
+    std::string key((const char*)bytes.data() + offset, keySize);
+    offset += keySize;
+
+    uint64_t memSize = readValue<uint64_t>(bytes, offset);
+
+    uint32_t hashSize = readValue<uint32_t>(bytes, offset);
+    checkInRange(bytes, offset, hashSize);
+    std::vector<uint8_t> hash(bytes.begin() + offset,
+                              bytes.begin() + offset + hashSize);
+    offset += hashSize;
+
+    uint32_t nChunks = readValue<uint32_t>(bytes, offset);
+    std::vector<uint32_t> chunkOffsets(nChunks);
+    std::vector<std::span<const uint8_t>> compressed(nChunks);
+    std::vector<std::vector<uint8_t>> chunks(nChunks);
+    for (uint32_t i = 0; i < nChunks; i++) {
+        chunkOffsets.at(i) = readValue<uint32_t>(bytes, offset);
+        chunks.at(i).resize(readValue<uint32_t>(bytes, offset));
+        uint32_t compressedSize = readValue<uint32_t>(bytes, offset);
+        checkInRange(bytes, offset, compressedSize);
+        compressed.at(i) = bytes.subspan(offset, compressedSize);
+        offset += compressedSize;
+    }
+
+    parallelFor(nChunks, nThreads, [&compressed, &chunks](size_t idx) {
+        std::vector<uint8_t>& chunk = chunks.at(idx);
+        uLongf chunkSize = chunk.size();
+        int res = ::uncompress(chunk.data(),
+                               &chunkSize,
+                               compressed.at(idx).data(),
+                               compressed.at(idx).size());
+        if (res != Z_OK || chunkSize != chunk.size()) {
+            SPDLOG_ERROR("Failed to decompress sparse snapshot chunk {}: {}",
+                         idx,
+                         res);
+            throw std::runtime_error("Failed to decompress sparse snapshot");
+        }
+    });
+
+    auto snap = std::make_shared<SparseSnapshot>(key, memSize);
+    snap->baseHash = hash;
+    for (uint32_t i = 0; i < nChunks; i++) {
+        snap->addPages(chunkOffsets.at(i), chunks.at(i));
+    }
+
+    return snap;
+}
+
+std::vector<bool> getPrivatelyModifiedPages(std::span<uint8_t> region)
+{
+    size_t nPages = faabric::util::getRequiredHostPages(region.size());
+    std::vector<uint64_t> entries(nPages, 0);
+
+    int fd = ::open("/proc/self/pagemap", O_RDONLY);
+    if (fd < 0) {
+        SPDLOG_ERROR("Failed to open pagemap: {}", std::strerror(errno));
+        throw std::runtime_error("Failed to open pagemap");
+    }
+
+    // There is one 64-bit entry per virtual page
+    size_t startPage =
+      ((uintptr_t)region.data()) / faabric::util::HOST_PAGE_SIZE;
+    size_t nBytes = nPages * sizeof(uint64_t);
+    ssize_t nRead =
+      ::pread(fd, entries.data(), nBytes, startPage * sizeof(uint64_t));
+    ::close(fd);
+
+    if (nRead != (ssize_t)nBytes) {
+        SPDLOG_ERROR("Failed to read pagemap ({} != {}): {}",
+                     nRead,
+                     nBytes,
+                     std::strerror(errno));
+        throw std::runtime_error("Failed to read pagemap");
+    }
+
+    // Pages that are present and not file-backed have been copied on write.
+    // Pages that are not present have not been touched, so read through to
+    // the file (or are zero if anonymous)
+    std::vector<bool> modified(nPages, false);
+    for (size_t i = 0; i < nPages; i++) {
+        uint64_t e = entries.at(i);
+        bool present = (e & PAGEMAP_ENTRY_PRESENT) != 0;
+        bool swapped = (e & PAGEMAP_ENTRY_SWAPPED) != 0;
+        bool file = (e & PAGEMAP_ENTRY_FILE) != 0;
+        modified.at(i) = swapped || (present && !file);
+    }
+
+    return modified;
+}
+
+std::vector<uint8_t> getSnapshotHash(const std::string& snapshotKey)
+{
+    static std::mutex hashMx;
+    static std::unordered_map<
+      std::string,
+      std::pair<std::weak_ptr<faabric::util::SnapshotData>,
+                std::vector<uint8_t>>>
+      hashes;
+
+    auto snap =
+      faabric::snapshot::getSnapshotRegistry().getSnapshot(snapshotKey);
+
+    faabric::util::UniqueLock lock(hashMx);
+
+    // Snapshots registered again under the same key must be hashed again
+    auto it = hashes.find(snapshotKey);
+    if (it != hashes.end() && it->second.first.lock() == snap) {
+        return it->second.second;
+    }
+
+    std::vector<uint8_t> hash = storage::ArtifactCache::hashBytes(
+      { snap->getDataPtr(), snap->getSize() });
+    hashes[snapshotKey] = { snap, hash };
+
+    return hash;
+}
+}
@@ -7,6 +7,7 @@
 #include <faabric/util/batch.h>
 #include <faabric/util/bytes.h>
 #include <faabric/util/config.h>
+#include <faabric/util/dirty.h>
 #include <faabric/util/environment.h>
 #include <faabric/util/func.h>
 #include <faabric/util/gids.h>
@@ -19,6 +20,8 @@
 #include <threads/ThreadState.h>
 #include <wasm/WasmExecutionContext.h>
 #include <wasm/WasmModule.h>
+#include <wasm/migration.h>
+#include <wasm/openmp.h>
 
 #include <boost/filesystem.hpp>
 #include <sys/mman.h>
@@ -98,6 +101,10 @@ std::string WasmModule::snapshot(bool locallyRestorable)
 
 void WasmModule::setMemorySize(size_t nBytes)
 {
+    // Callers set the size before mapping a snapshot over memory, so we no
+    // longer know which snapshot memory is mapped from
+    mappedSnapshotKey.clear();
+
     uint32_t memSize = getCurrentBrk();
 
     if (nBytes > memSize) {
@@ -133,6 +140,117 @@ void WasmModule::restore(const std::string& snapshotKey)
     // Map the snapshot into memory
     uint8_t* memoryBase = getMemoryBase();
     data->mapToMemory({ memoryBase, data->getSize() });
+    mappedSnapshotKey = snapshotKey;
+}
+
+std::shared_ptr<SparseSnapshot> WasmModule::getSparseSnapshotData(
+  const std::string& baseSnapshotKey)
+{
+    PROF_START(wasmSparseSnapshot)
+
+    auto base = reg.getSnapshot(baseSnapshotKey);
+    size_t baseSize = base->getSize();
+    const uint8_t* baseData = base->getDataPtr();
+
+    std::span<uint8_t> memView = getMemoryView();
+    auto snap =
+      std::make_shared<SparseSnapshot>(baseSnapshotKey, memView.size());
+
+    // If memory is mapped from the base snapshot, only pages that have been
+    // copied on write can differ from it. Otherwise we must check every page
+    bool isMappedFromBase = mappedSnapshotKey == baseSnapshotKey;
+    std::vector<bool> candidates;
+    if (isMappedFromBase) {
+        candidates = getPrivatelyModifiedPages(memView);
+    }
+
+    const size_t pageSize = faabric::util::HOST_PAGE_SIZE;
+    const std::vector<uint8_t> zeroPage(pageSize, 0);
+    size_t nPages = memView.size() / pageSize;
+    for (size_t i = 0; i < nPages; i++) {
+        if (isMappedFromBase && !candidates.at(i)) {
+            continue;
+        }
+
+        size_t offset = i * pageSize;
+        const uint8_t* page = memView.data() + offset;
+        const uint8_t* basePage =
+          offset + pageSize <= baseSize ? baseData + offset : zeroPage.data();
+
+        if (std::memcmp(page, basePage, pageSize) != 0) {
+            snap->addPages(offset, { page, pageSize });
+        }
+    }
+
+    SPDLOG_DEBUG("Sparse snapshot of {}/{} has {}/{} bytes over {}",
+                 boundUser,
+                 boundFunction,
+                 snap->getOverlaySize(),
+                 memView.size(),
+                 baseSnapshotKey);
+
+    PROF_END(wasmSparseSnapshot)
+
+    return snap;
+}
+
+void WasmModule::restoreSparse(const SparseSnapshot& snap)
+{
+    // The base may differ if the snapshot was taken on another host
+    if (!snap.baseHash.empty() &&
+        snap.baseHash != getSnapshotHash(snap.baseKey)) {
+        SPDLOG_ERROR("Base snapshot {} differs from that of sparse snapshot",
+                     snap.baseKey);
+        throw std::runtime_error("Sparse snapshot base mismatch");
+    }
+
+    restore(snap.baseKey);
+
+    // Anything above the base snapshot may hold data from before the
+    // restore, or still be mapped from another snapshot, so we replace it
+    // with fresh zeroed memory
+    size_t baseSize = getMemorySizeBytes();
+    setMemorySize(snap.size);
+    mappedSnapshotKey = snap.baseKey;
+
+    size_t newSize = getMemorySizeBytes();
+    if (newSize > baseSize) {
+        remapAsZeroed(baseSize, newSize - baseSize);
+    }
+
+    snap.writeRuns(getMemoryView());
+}
+
+void WasmModule::remapAsZeroed(uint32_t wasmOffset, size_t length)
+{
+    void* res = ::mmap(getMemoryBase() + wasmOffset,
+                       length,
+                       PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,
+                       -1,
+                       0);
+    if (res == MAP_FAILED) {
+        SPDLOG_ERROR("Failed to remap {} bytes at {} as zeroed memory: {}",
+                     length,
+                     wasmOffset,
+                     std::strerror(errno));
+        throw std::runtime_error("Failed to remap memory as zeroed");
+    }
+}
+
+void WasmModule::setMappedSnapshotKey(const std::string& snapshotKey)
+{
+    mappedSnapshotKey = snapshotKey;
+}
+
+std::string WasmModule::getResetSnapshotKey()
+{
+    return resetSnapshotKey;
+}
+
+void WasmModule::setResetSnapshotKey(const std::string& snapshotKey)
+{
+    resetSnapshotKey = snapshotKey;
 }
 
 void WasmModule::ignoreThreadStacksInSnapshot(const std::string& snapKey)
@@ -325,6 +443,10 @@ uint32_t WasmModule::mapSharedStateMemory(
                                 chunk.nPagesOffset,
                                 chunk.nPagesLength);
 
+            // Like mapped files, shared pages look unmodified when diffing
+            // against the snapshot memory was mapped from
+            mappedSnapshotKey.clear();
+
             // Cache the wasm pointer
             sharedMemWasmPtrs[segmentKey] = wasmOffsetPtr;
         }
@@ -365,8 +487,12 @@ int32_t WasmModule::executeTask(
     assert(!threadStacks.empty());
     uint32_t stackTop = threadStacks.at(threadPoolIdx);
 
-    // Ignore stacks and guard pages in snapshot if present
-    if (!msg.snapshotkey().empty()) {
+    // Migration deltas only hold the pages that differ from a snapshot we
+    // already have, so memory must be rebuilt from both. Otherwise, ignore
+    // stacks and guard pages in the snapshot if present
+    if (isMigrationDelta(msg.snapshotkey())) {
+        restoreMigrationDelta(*this, msg.snapshotkey());
+    } else if (!msg.snapshotkey().empty()) {
         ignoreThreadStacksInSnapshot(msg.snapshotkey());
     }
 
@@ -388,6 +514,7 @@ int32_t WasmModule::executeTask(
 
                 // Set up the level
                 threads::setCurrentOpenMPLevel(req);
+                OpenMPThreadScope ompThreadScope(&msg);
                 returnValue = executeOMPThread(threadPoolIdx, stackTop, msg);
                 break;
             }
@@ -401,7 +528,17 @@ int32_t WasmModule::executeTask(
     } else {
         // Vanilla function
         SPDLOG_TRACE("Executing {} as standard function", funcStr);
-        returnValue = executeFunction(msg);
+        try {
+            returnValue = executeFunction(msg);
+        } catch (...) {
+            // Threads still running must finish before we rethrow, as the
+            // module may then be reset under them
+            clearPthreadCalls();
+            throw;
+        }
+
+        // Threads that were never joined must finish before the function
+        awaitAllPthreadCalls();
     }
 
     // Set result and timestamp
@@ -467,109 +604,225 @@ void WasmModule::clearMergeRegions()
     mergeRegions.clear();
 }
 
-void WasmModule::queuePthreadCall(threads::PthreadCall call)
+std::shared_ptr<faabric::util::SnapshotData>
+WasmModule::updateMainThreadSnapshot(faabric::Message& msg)
 {
-    // We assume that all pthread calls are queued from the main thread before
-    // await is called from the same thread, so this doesn't need to be
-    // thread-safe.
-    queuedPthreadCalls.emplace_back(call);
+    const auto funcStr = faabric::util::funcToString(msg, false);
+    faabric::executor::Executor* executor =
+      faabric::executor::ExecutorContext::get()->getExecutor();
+    auto snap = executor->getMainThreadSnapshot(msg, true);
+
+    // Get dirty regions since last batch of threads
+    std::span<uint8_t> memView = executor->getMemoryView();
+    faabric::util::getDirtyTracker()->stopTracking(memView);
+    faabric::util::getDirtyTracker()->stopThreadLocalTracking(memView);
+
+    // If this is the first batch, these dirty regions will be empty
+    std::vector<char> dirtyRegions =
+      faabric::util::getDirtyTracker()->getBothDirtyPages(memView);
+
+    // Apply changes to snapshot
+    snap->fillGapsWithBytewiseRegions();
+    std::vector<faabric::util::SnapshotDiff> updates =
+      snap->diffWithDirtyRegions(memView, dirtyRegions);
+
+    if (updates.empty()) {
+        SPDLOG_DEBUG("No updates to main thread snapshot for {} over {} pages",
+                     funcStr,
+                     dirtyRegions.size());
+    } else {
+        SPDLOG_DEBUG("Updating main thread snapshot for {} with {} diffs",
+                     funcStr,
+                     updates.size());
+        snap->applyDiffs(updates);
+    }
+
+    // Clear merge regions, not persisted between batches of threads
+    snap->clearMergeRegions();
+
+    // Now we have to add any merge regions we've been saving up for this
+    // next batch of threads
+    for (const auto& mr : getMergeRegions()) {
+        snap->addMergeRegion(mr.offset, mr.length, mr.dataType, mr.operation);
+    }
+
+    return snap;
 }
 
-int WasmModule::awaitPthreadCall(faabric::Message* msg, int pthreadPtr)
+int WasmModule::dispatchPthreadCall(faabric::Message* msg,
+                                    threads::PthreadCall call)
 {
-    // We assume that await is called in a loop from the main thread, after
-    // all pthread calls have been queued, so this function doesn't need to be
-    // thread safe.
     assert(msg != nullptr);
 
-    // Execute the queued pthread calls
-    faabric::executor::Executor* executor =
-      faabric::executor::ExecutorContext::get()->getExecutor();
-    if (!queuedPthreadCalls.empty()) {
-        int nPthreadCalls = queuedPthreadCalls.size();
+    std::shared_ptr<faabric::BatchExecuteRequest> req =
+      faabric::util::batchExecFactory(msg->user(), msg->function(), 1);
+    faabric::util::updateBatchExecAppId(req, msg->appid());
 
-        std::string funcStr = faabric::util::funcToString(*msg, true);
-        SPDLOG_DEBUG(
-          "Executing {} pthread calls for {}", nPthreadCalls, funcStr);
+    req->set_type(faabric::BatchExecuteRequest::THREADS);
+    req->set_subtype(wasm::ThreadRequestType::PTHREAD);
 
-        std::shared_ptr<faabric::BatchExecuteRequest> req =
-          faabric::util::batchExecFactory(
-            msg->user(), msg->function(), nPthreadCalls);
-        faabric::util::updateBatchExecAppId(req, msg->appid());
+    // In the local tests, we always set the single-host hint to avoid
+    // having to synchronise snapshots
+    if (faabric::util::isTestMode()) {
+        req->set_singlehosthint(true);
+    }
 
-        req->set_type(faabric::BatchExecuteRequest::THREADS);
-        req->set_subtype(wasm::ThreadRequestType::PTHREAD);
+    // Function pointer and args
+    // NOTE - with a pthread interface we only ever pass the function a single
+    // pointer argument, hence we use the input data here to hold this argument
+    // as a string
+    faabric::Message& m = req->mutable_messages()->at(0);
+    m.set_funcptr(call.entryFunc);
+    m.set_inputdata(std::to_string(call.argsPtr));
 
-        // In the local tests, we always set the single-host hint to avoid
-        // having to synchronise snapshots
-        if (faabric::util::isTestMode()) {
-            req->set_singlehosthint(true);
+    bool isFirstInBatch = false;
+    {
+        faabric::util::UniqueLock lock(pthreadCallsMx);
+
+        // Our pthread IDs start at 1, and start again once all threads have
+        // been awaited
+        isFirstInBatch =
+          pthreadPtrsToRequests.empty() && detachedPthreadRequests.empty();
+        if (isFirstInBatch) {
+            nextPthreadIdx = 1;
         }
-
-        for (int i = 0; i < nPthreadCalls; i++) {
-            threads::PthreadCall p = queuedPthreadCalls.at(i);
-            faabric::Message& m = req->mutable_messages()->at(i);
-
-            // Function pointer and args
-            // NOTE - with a pthread interface we only ever pass the
-            // function a single pointer argument, hence we use the
-            // input data here to hold this argument as a string
-            m.set_funcptr(p.entryFunc);
-            m.set_inputdata(std::to_string(p.argsPtr));
-
-            // Assign a thread ID and increment. Our pthread IDs start
-            // at 1. Set this as part of the group with the other threads.
-            m.set_appidx(i + 1);
-            m.set_groupidx(i + 1);
-
-            // Record this thread -> call ID
-            SPDLOG_TRACE("pthread {} mapped to call {}", p.pthreadPtr, m.id());
-            pthreadPtrsToChainedCalls.insert({ p.pthreadPtr, m.id() });
+        int pthreadIdx = nextPthreadIdx++;
+        m.set_appidx(pthreadIdx);
+        m.set_groupidx(pthreadIdx);
+
+        // A pthread struct reused before its thread was joined leaks the
+        // thread, but we still need to await it before finishing
+        auto it = pthreadPtrsToRequests.find(call.pthreadPtr);
+        if (it != pthreadPtrsToRequests.end()) {
+            SPDLOG_WARN("pthread {} reused before being joined",
+                        call.pthreadPtr);
+            detachedPthreadRequests.emplace_back(it->second);
         }
 
-        std::shared_ptr<faabric::util::SnapshotData> snap = nullptr;
-        if (!req->singlehosthint()) {
-            snap = executor->getMainThreadSnapshot(*msg, true);
+        SPDLOG_TRACE("pthread {} mapped to call {}", call.pthreadPtr, m.id());
+        pthreadPtrsToRequests[call.pthreadPtr] = req;
+    }
+
+    // Unlike OpenMP, the main thread carries on while the pthread runs, so
+    // we start tracking its writes again straight away. Threads created while
+    // others are still running belong to the same batch, so they share its
+    // snapshot and merge regions, which must be left alone until all the
+    // batch's threads have been awaited
+    if (!req->singlehosthint() && isFirstInBatch) {
+        updateMainThreadSnapshot(*msg);
+
+        std::span<uint8_t> memView = getMemoryView();
+        faabric::util::getDirtyTracker()->startTracking(memView);
+        faabric::util::getDirtyTracker()->startThreadLocalTracking(memView);
+    }
+
+    SPDLOG_DEBUG("Dispatching pthread call {} for {}",
+                 m.id(),
+                 faabric::util::funcToString(*msg, true));
+    faabric::planner::getPlannerClient().callFunctions(req);
+
+    return m.id();
+}
+
+static int32_t awaitPthreadRequest(
+  std::shared_ptr<faabric::BatchExecuteRequest> req)
+{
+    auto results = faabric::scheduler::getScheduler().awaitThreadResults(
+      req, 10 * faabric::util::getSystemConfig().boundTimeout);
+
+    if (results.size() != 1) {
+        SPDLOG_ERROR("Did not find a result for pthread call {}",
+                     req->messages(0).id());
+        throw std::runtime_error("Result not found for pthread");
+    }
+
+    return results.at(0).second;
+}
+
+int WasmModule::awaitPthreadCall(faabric::Message* msg, int pthreadPtr)
+{
+    assert(msg != nullptr);
+
+    std::shared_ptr<faabric::BatchExecuteRequest> req = nullptr;
+    {
+        faabric::util::UniqueLock lock(pthreadCallsMx);
+        auto it = pthreadPtrsToRequests.find(pthreadPtr);
+        if (it == pthreadPtrsToRequests.end()) {
+            SPDLOG_ERROR("No joinable pthread for ptr {}", pthreadPtr);
+            throw std::runtime_error("No joinable pthread");
         }
 
-        // Execute the threads and await results
-        faabric::planner::getPlannerClient().callFunctions(req);
-        lastPthreadResults =
-          faabric::scheduler::getScheduler().awaitThreadResults(
-            req, 10 * faabric::util::getSystemConfig().boundTimeout);
-
-        // Empty the queue
-        queuedPthreadCalls.clear();
-    }
-
-    // Get the result of this call
-    unsigned int pthreadMsgId = pthreadPtrsToChainedCalls[pthreadPtr];
-    bool found = false;
-    int thisResult = 0;
-    for (auto [mid, res] : lastPthreadResults) {
-        if (pthreadMsgId == mid) {
-            thisResult = res;
-            found = true;
-            break;
+        req = it->second;
+        pthreadPtrsToRequests.erase(it);
+    }
+
+    return awaitPthreadRequest(req);
+}
+
+void WasmModule::detachPthreadCall(int pthreadPtr)
+{
+    faabric::util::UniqueLock lock(pthreadCallsMx);
+    auto it = pthreadPtrsToRequests.find(pthreadPtr);
+    if (it == pthreadPtrsToRequests.end()) {
+        SPDLOG_ERROR("No joinable pthread to detach for ptr {}", pthreadPtr);
+        throw std::runtime_error("No joinable pthread");
+    }
+
+    detachedPthreadRequests.emplace_back(it->second);
+    pthreadPtrsToRequests.erase(it);
+}
+
+void WasmModule::awaitAllPthreadCalls()
+{
+    std::vector<std::shared_ptr<faabric::BatchExecuteRequest>> reqs;
+    {
+        faabric::util::UniqueLock lock(pthreadCallsMx);
+        reqs.swap(detachedPthreadRequests);
+        for (auto& [ptr, req] : pthreadPtrsToRequests) {
+            reqs.emplace_back(req);
         }
+        pthreadPtrsToRequests.clear();
     }
 
-    if (!found) {
-        SPDLOG_ERROR("Did not find a result for pthread: ptr {}, mid {}",
-                     pthreadPtr,
-                     pthreadMsgId);
-        throw std::runtime_error("Result not found for pthread");
+    if (!reqs.empty()) {
+        SPDLOG_DEBUG("Awaiting {} unjoined pthread calls", reqs.size());
+    }
+
+    for (auto& req : reqs) {
+        awaitPthreadRequest(req);
     }
+}
 
-    // Remove the mapping for this pointer
-    pthreadPtrsToChainedCalls.erase(pthreadPtr);
+int WasmModule::getPendingPthreadCount()
+{
+    faabric::util::UniqueLock lock(pthreadCallsMx);
+    return pthreadPtrsToRequests.size() + detachedPthreadRequests.size();
+}
 
-    // If we're done, clear the results
-    if (pthreadPtrsToChainedCalls.empty()) {
-        lastPthreadResults.clear();
+void WasmModule::clearPthreadCalls()
+{
+    std::vector<std::shared_ptr<faabric::BatchExecuteRequest>> reqs;
+    {
+        faabric::util::UniqueLock lock(pthreadCallsMx);
+        reqs.swap(detachedPthreadRequests);
+        for (auto& [ptr, req] : pthreadPtrsToRequests) {
+            reqs.emplace_back(req);
+        }
+        pthreadPtrsToRequests.clear();
+        nextPthreadIdx = 1;
     }
 
-    return thisResult;
+    // The calls have already been dispatched, and run in this module's
+    // memory, so we must wait for them before it is reset
+    for (auto& req : reqs) {
+        try {
+            awaitPthreadRequest(req);
+        } catch (std::exception& e) {
+            SPDLOG_ERROR("Failed to await pthread call {}: {}",
+                         req->messages(0).id(),
+                         e.what());
+        }
+    }
 }
 
 void WasmModule::createThreadStacks()
@@ -600,39 +853,21 @@ std::vector<uint32_t> WasmModule::getThreadStacks()
     return threadStacks;
 }
 
-std::shared_ptr<std::mutex> WasmModule::getPthreadMutex(uint32_t id)
+threads::GuestSyncObject* WasmModule::getPthreadSyncObject(uint32_t id)
 {
-    faabric::util::SharedLock lock(pthreadLocksMx);
-    auto it = pthreadLocks.find(id);
-    if (it != pthreadLocks.end()) {
-        return it->second;
+    threads::GuestSyncObject* obj = pthreadSyncObjects.get(id);
+    if (obj == nullptr) {
+        SPDLOG_ERROR("Trying to get non-existent pthread object {}", id);
+        throw std::runtime_error("Non-existent pthread object");
     }
 
-    SPDLOG_ERROR("Trying to get non-existent pthread lock {}", id);
-    throw std::runtime_error("Non-existent pthread lock");
+    return obj;
 }
 
-std::shared_ptr<std::mutex> WasmModule::getOrCreatePthreadMutex(uint32_t id)
+threads::GuestSyncObject* WasmModule::getOrCreatePthreadSyncObject(
+  uint32_t id)
 {
-    std::shared_ptr<std::mutex> mx = nullptr;
-    {
-        faabric::util::SharedLock lock(pthreadLocksMx);
-        auto it = pthreadLocks.find(id);
-        if (it != pthreadLocks.end()) {
-            return it->second;
-        }
-    }
-
-    faabric::util::FullLock lock(pthreadLocksMx);
-    auto it = pthreadLocks.find(id);
-    if (it != pthreadLocks.end()) {
-        return it->second;
-    }
-
-    mx = std::make_shared<std::mutex>();
-    pthreadLocks[id] = mx;
-
-    return mx;
+    return pthreadSyncObjects.getOrCreate(id);
 }
 
 bool WasmModule::isBound()
@@ -1,3 +1,4 @@
+#include <conf/FaasmConfig.h>
 #include <faabric/batch-scheduler/BatchScheduler.h>
 #include <faabric/batch-scheduler/SchedulingDecision.h>
 #include <faabric/executor/ExecutorContext.h>
@@ -8,10 +9,16 @@
 #include <faabric/snapshot/SnapshotRegistry.h>
 #include <faabric/util/ExecGraph.h>
 #include <faabric/util/batch.h>
+#include <faabric/util/environment.h>
 #include <faabric/util/network.h>
+#include <faabric/util/string_tools.h>
+#include <faabric/util/timing.h>
 #include <wasm/WasmExecutionContext.h>
+#include <wasm/WasmModule.h>
 #include <wasm/migration.h>
 
+#include <future>
+
 namespace wasm {
 void doMigrationPoint(int32_t entrypointFuncWasmOffset,
                       const std::string& entrypointFuncArg)
@@ -41,15 +48,13 @@ void doMigrationPoint(int32_t entrypointFuncWasmOffset,
     if (appMustFreeze) {
         std::vector<uint8_t> inputData(entrypointFuncArg.begin(),
                                        entrypointFuncArg.end());
-        std::string snapKey = "migration_" + std::to_string(call->id());
+        auto [snapKey, snap] =
+          takeMigrationSnapshot(*getExecutingModule(), call->id());
 
         call->set_funcptr(entrypointFuncWasmOffset);
         call->set_inputdata(inputData.data(), inputData.size());
         call->set_snapshotkey(snapKey);
 
-        auto* exec = faabric::executor::ExecutorContext::get()->getExecutor();
-        auto snap =
-          std::make_shared<faabric::util::SnapshotData>(exec->getMemoryView());
         auto& reg = faabric::snapshot::getSnapshotRegistry();
         reg.registerSnapshot(snapKey, snap);
 
@@ -78,6 +83,19 @@ void doMigrationPoint(int32_t entrypointFuncWasmOffset,
         hostToMigrateTo = migration->dsthost();
     }
 
+    // Start taking the snapshot to migrate with, as it only depends on this
+    // module's memory, which won't change while we prepare for the migration
+    std::future<std::pair<std::string,
+                          std::shared_ptr<faabric::util::SnapshotData>>>
+      migrationSnapshot;
+    if (funcMustMigrate) {
+        WasmModule* module = getExecutingModule();
+        int msgId = call->id();
+        migrationSnapshot = std::async(std::launch::async, [module, msgId] {
+            return takeMigrationSnapshot(*module, msgId);
+        });
+    }
+
     // Regardless if we have to individually migrate or not, we need to prepare
     // for the app migration
     if (appMustMigrate && call->ismpi()) {
@@ -107,15 +125,12 @@ void doMigrationPoint(int32_t entrypointFuncWasmOffset,
         msg.set_inputdata(inputData.data(), inputData.size());
         msg.set_funcptr(entrypointFuncWasmOffset);
 
-        // Take snapshot of function and send it to the host we are migrating
-        // to. Note that the scheduler only pushes snapshots as part of function
+        // Send the snapshot of the function to the host we are migrating to.
+        // Note that the scheduler only pushes snapshots as part of function
         // chaining from the master host of the app, and
         // we are most likely migrating from a non-master host. Thus, we must
         // take and push the snapshot manually.
-        auto* exec = faabric::executor::ExecutorContext::get()->getExecutor();
-        auto snap =
-          std::make_shared<faabric::util::SnapshotData>(exec->getMemoryView());
-        std::string snapKey = "migration_" + std::to_string(msg.id());
+        auto [snapKey, snap] = migrationSnapshot.get();
         auto& reg = faabric::snapshot::getSnapshotRegistry();
         reg.registerSnapshot(snapKey, snap);
         faabric::snapshot::getSnapshotClient(hostToMigrateTo)
@@ -176,4 +191,59 @@ void doMigrationPoint(int32_t entrypointFuncWasmOffset,
         }
     }
 }
+
+std::pair<std::string, std::shared_ptr<faabric::util::SnapshotData>>
+takeMigrationSnapshot(WasmModule& module, int msgId)
+{
+    conf::FaasmConfig& conf = conf::getFaasmConfig();
+    std::string baseKey = module.getResetSnapshotKey();
+
+    if (conf.deltaMigration != "on" || baseKey.empty()) {
+        std::string snapKey = "migration_" + std::to_string(msgId);
+        auto snap =
+          std::make_shared<faabric::util::SnapshotData>(module.getMemoryView());
+        return { snapKey, snap };
+    }
+
+    PROF_START(migrationDelta)
+
+    std::shared_ptr<SparseSnapshot> delta =
+      module.getSparseSnapshotData(baseKey);
+    delta->baseHash = getSnapshotHash(baseKey);
+    std::vector<uint8_t> bytes =
+      delta->toBytes(faabric::util::getUsableCores());
+
+    // The snapshot is mapped over memory before we restore the delta, so it
+    // must be a whole number of wasm pages
+    bytes.resize(roundUpToWasmPageAligned(bytes.size()));
+
+    std::string snapKey = MIGRATION_DELTA_PREFIX + std::to_string(msgId);
+    SPDLOG_DEBUG("Migration delta {} has {} bytes ({} changed of {})",
+                 snapKey,
+                 bytes.size(),
+                 delta->getOverlaySize(),
+                 delta->size);
+
+    PROF_END(migrationDelta)
+
+    return { snapKey, std::make_shared<faabric::util::SnapshotData>(bytes) };
+}
+
+bool isMigrationDelta(const std::string& snapshotKey)
+{
+    return faabric::util::startsWith(snapshotKey, MIGRATION_DELTA_PREFIX);
+}
+
+void restoreMigrationDelta(WasmModule& module, const std::string& snapshotKey)
+{
+    auto data =
+      faabric::snapshot::getSnapshotRegistry().getSnapshot(snapshotKey);
+    std::shared_ptr<SparseSnapshot> delta = SparseSnapshot::fromBytes(
+      { data->getDataPtr(), data->getSize() }, faabric::util::getUsableCores());
+
+    SPDLOG_DEBUG("Restoring migration delta {} over {}",
+                 snapshotKey,
+                 delta->baseKey);
+    module.restoreSparse(*delta);
+}
 }
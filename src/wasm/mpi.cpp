@@ -0,0 +1,814 @@
+#include <wasm/LocalMpiTransport.h>
+#include <wasm/mpi.h>
+
+#include <faabric/executor/ExecutorContext.h>
+#include <faabric/transport/PointToPointBroker.h>
+#include <faabric/util/config.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace wasm {
+
+// How the ranks of a world are spread over hosts
+struct MpiTopology
+{
+    int groupId = 0;
+
+    std::vector<bool> isLocal;
+
+    // The lowest rank on each rank's host
+    std::vector<int> leaderOf;
+
+    // Sorted, so the first is this host's leader
+    std::vector<int> localRanks;
+
+    // The leader of each host, sorted
+    std::vector<int> leaders;
+};
+
+// Ranks are the indexes of the world's point-to-point group, so we can look
+// them up in the broker. Lookups take a lock, so we cache them for each
+// group, as the group changes when ranks are migrated. Worlds without a
+// point-to-point group (e.g. in tests) have an empty topology, and only use
+// the world
+static const MpiTopology& getTopology()
+{
+    static thread_local MpiTopology topology;
+
+    int groupId =
+      faabric::executor::ExecutorContext::get()->getMsg().groupid();
+    if (groupId == topology.groupId) {
+        return topology;
+    }
+
+    topology = MpiTopology();
+    topology.groupId = groupId;
+    if (groupId == 0) {
+        return topology;
+    }
+
+    auto& broker = faabric::transport::getPointToPointBroker();
+    std::string thisHost = faabric::util::getSystemConfig().endpointHost;
+    std::set<int> ranks = broker.getIdxsRegisteredForGroup(groupId);
+    int worldSize = ranks.empty() ? 0 : *ranks.rbegin() + 1;
+    topology.isLocal.resize(worldSize, false);
+    topology.leaderOf.resize(worldSize, -1);
+
+    std::map<std::string, int> hostLeaders;
+    for (int rank : ranks) {
+        std::string host = broker.getHostForReceiver(groupId, rank);
+        topology.isLocal.at(rank) = host == thisHost;
+        if (topology.isLocal.at(rank)) {
+            topology.localRanks.push_back(rank);
+        }
+
+        // Ranks are in order, so the first we see on each host is its leader
+        auto [it, isNew] = hostLeaders.try_emplace(host, rank);
+        if (isNew) {
+            topology.leaders.push_back(rank);
+        }
+        topology.leaderOf.at(rank) = it->second;
+    }
+
+    return topology;
+}
+
+// Negative ranks, e.g. MPI_ANY_SOURCE, are left to the world
+static bool isLocalRank(int rank)
+{
+    const MpiTopology& topology = getTopology();
+    return rank >= 0 && rank < (int)topology.isLocal.size() &&
+           topology.isLocal.at(rank);
+}
+
+static void writeLocalStatus(MPI_Status* status, int sourceRank, size_t nBytes)
+{
+    if (status == nullptr) {
+        return;
+    }
+
+    status->MPI_SOURCE = sourceRank;
+    status->MPI_ERROR = MPI_SUCCESS;
+    status->bytesSize = nBytes;
+}
+
+void doMpiSend(faabric::mpi::MpiWorld& world,
+               int rank,
+               int destRank,
+               const uint8_t* buffer,
+               faabric_datatype_t* dtype,
+               int count,
+               faabric::mpi::MpiMessageType messageType)
+{
+    if (isLocalRank(destRank)) {
+        getLocalMpiTransport().send(world.getId(),
+                                    rank,
+                                    destRank,
+                                    buffer,
+                                    count * dtype->size,
+                                    static_cast<int>(messageType));
+        return;
+    }
+
+    world.send(rank, destRank, buffer, dtype, count, messageType);
+}
+
+void doMpiRecv(faabric::mpi::MpiWorld& world,
+               int rank,
+               int sourceRank,
+               uint8_t* buffer,
+               faabric_datatype_t* dtype,
+               int count,
+               MPI_Status* status,
+               faabric::mpi::MpiMessageType messageType)
+{
+    if (isLocalRank(sourceRank)) {
+        size_t nBytes =
+          getLocalMpiTransport().recv(world.getId(),
+                                      sourceRank,
+                                      rank,
+                                      buffer,
+                                      count * dtype->size,
+                                      static_cast<int>(messageType));
+        writeLocalStatus(status, sourceRank, nBytes);
+        return;
+    }
+
+    world.recv(sourceRank, rank, buffer, dtype, count, status, messageType);
+}
+
+int doMpiIsend(faabric::mpi::MpiWorld& world,
+               int rank,
+               int destRank,
+               const uint8_t* buffer,
+               faabric_datatype_t* dtype,
+               int count,
+               faabric::mpi::MpiMessageType messageType)
+{
+    if (isLocalRank(destRank)) {
+        return getLocalMpiTransport().isend(world.getId(),
+                                            rank,
+                                            destRank,
+                                            buffer,
+                                            count * dtype->size,
+                                            static_cast<int>(messageType));
+    }
+
+    return world.isend(rank, destRank, buffer, dtype, count, messageType);
+}
+
+int doMpiIrecv(faabric::mpi::MpiWorld& world,
+               int rank,
+               int sourceRank,
+               uint8_t* buffer,
+               faabric_datatype_t* dtype,
+               int count,
+               faabric::mpi::MpiMessageType messageType)
+{
+    if (isLocalRank(sourceRank)) {
+        return getLocalMpiTransport().irecv(world.getId(),
+                                            sourceRank,
+                                            rank,
+                                            buffer,
+                                            count * dtype->size,
+                                            static_cast<int>(messageType));
+    }
+
+    return world.irecv(sourceRank, rank, buffer, dtype, count, messageType);
+}
+
+void doMpiAwait(faabric::mpi::MpiWorld& world, int requestId)
+{
+    if (LocalMpiTransport::isLocalRequest(requestId)) {
+        getLocalMpiTransport().await(requestId);
+        return;
+    }
+
+    world.awaitAsyncRequest(requestId);
+}
+
+void doMpiSendRecv(faabric::mpi::MpiWorld& world,
+                   int rank,
+                   const uint8_t* sendBuffer,
+                   int sendCount,
+                   faabric_datatype_t* sendType,
+                   int destRank,
+                   uint8_t* recvBuffer,
+                   int recvCount,
+                   faabric_datatype_t* recvType,
+                   int sourceRank,
+                   MPI_Status* status)
+{
+    if (!isLocalRank(destRank) && !isLocalRank(sourceRank)) {
+        world.sendRecv((uint8_t*)sendBuffer,
+                       sendCount,
+                       sendType,
+                       destRank,
+                       recvBuffer,
+                       recvCount,
+                       recvType,
+                       sourceRank,
+                       rank,
+                       status);
+        return;
+    }
+
+    // The send can't wait for the receive to complete, as our peer may be
+    // doing the same
+    int sendId =
+      doMpiIsend(world, rank, destRank, sendBuffer, sendType, sendCount);
+    doMpiRecv(
+      world, rank, sourceRank, recvBuffer, recvType, recvCount, status);
+    doMpiAwait(world, sendId);
+}
+
+void doMpiProbe(faabric::mpi::MpiWorld& world,
+                int rank,
+                int sourceRank,
+                MPI_Status* status)
+{
+    if (isLocalRank(sourceRank)) {
+        size_t nBytes =
+          getLocalMpiTransport().probe(world.getId(), sourceRank, rank);
+        writeLocalStatus(status, sourceRank, nBytes);
+        return;
+    }
+
+    world.probe(sourceRank, rank, status);
+}
+
+int doMpiWaitAny(faabric::mpi::MpiWorld& world,
+                 int32_t* requestIds,
+                 int count,
+                 MPI_Status* status)
+{
+    // We can't poll requests for completion, so we wait on the first active
+    // one. Request ids are never zero, so it marks inactive requests
+    for (int i = 0; i < count; i++) {
+        if (requestIds[i] == 0) {
+            continue;
+        }
+
+        size_t nBytes = 0;
+        if (LocalMpiTransport::isLocalRequest(requestIds[i])) {
+            nBytes = getLocalMpiTransport().await(requestIds[i]);
+        } else {
+            world.awaitAsyncRequest(requestIds[i]);
+        }
+        requestIds[i] = 0;
+
+        if (status != nullptr) {
+            status->MPI_ERROR = MPI_SUCCESS;
+            status->bytesSize = nBytes;
+        }
+
+        return i;
+    }
+
+    return -1;
+}
+
+// ------------------------------------------------
+// HIERARCHICAL COLLECTIVES
+// ------------------------------------------------
+
+// Whether collectives can go through one leader per host, which only pays off
+// if some host has more than one rank
+static bool useHierarchy(faabric::mpi::MpiWorld& world)
+{
+    const MpiTopology& topology = getTopology();
+    return !topology.localRanks.empty() &&
+           (int)topology.isLocal.size() == world.getSize() &&
+           topology.leaders.size() < topology.isLocal.size();
+}
+
+template<typename T>
+static void reduceArrays(faabric_op_t* op,
+                         T* __restrict dst,
+                         const T* __restrict src,
+                         size_t n)
+{
+    // Simple loops over restricted pointers, so that the compiler vectorises
+    // them
+    if (op->id == MPI_SUM->id) {
+        for (size_t i = 0; i < n; i++) {
+            dst[i] += src[i];
+        }
+    } else if (op->id == MPI_PROD->id) {
+        for (size_t i = 0; i < n; i++) {
+            dst[i] *= src[i];
+        }
+    } else if (op->id == MPI_MAX->id) {
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = src[i] > dst[i] ? src[i] : dst[i];
+        }
+    } else if (op->id == MPI_MIN->id) {
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = src[i] < dst[i] ? src[i] : dst[i];
+        }
+    } else {
+        SPDLOG_ERROR("Unsupported op for local reduce: {}", op->id);
+        throw std::runtime_error("Unsupported op for local reduce");
+    }
+}
+
+static bool canReduceLocally(faabric_datatype_t* dtype, faabric_op_t* op)
+{
+    bool supportedOp = op->id == MPI_SUM->id || op->id == MPI_PROD->id ||
+                       op->id == MPI_MAX->id || op->id == MPI_MIN->id;
+    bool supportedType =
+      dtype->id == MPI_FLOAT->id || dtype->id == MPI_DOUBLE->id ||
+      ((dtype->id == MPI_INT->id || dtype->id == MPI_LONG->id ||
+        dtype->id == MPI_LONG_LONG->id) &&
+       (dtype->size == sizeof(int32_t) || dtype->size == sizeof(int64_t)));
+
+    return supportedOp && supportedType;
+}
+
+// Combines n elements of src into dst
+static void reduceInto(faabric_datatype_t* dtype,
+                       faabric_op_t* op,
+                       uint8_t* dst,
+                       const uint8_t* src,
+                       size_t n)
+{
+    if (dtype->id == MPI_FLOAT->id) {
+        reduceArrays<float>(op, (float*)dst, (const float*)src, n);
+    } else if (dtype->id == MPI_DOUBLE->id) {
+        reduceArrays<double>(op, (double*)dst, (const double*)src, n);
+    } else if (dtype->size == sizeof(int32_t)) {
+        reduceArrays<int32_t>(op, (int32_t*)dst, (const int32_t*)src, n);
+    } else {
+        reduceArrays<int64_t>(op, (int64_t*)dst, (const int64_t*)src, n);
+    }
+}
+
+static size_t getChunkCount(faabric_datatype_t* dtype)
+{
+    return std::max<size_t>(1, MPI_COLLECTIVE_CHUNK_SIZE / dtype->size);
+}
+
+// Calls the given function for each chunk of a buffer of count elements
+template<typename F>
+static void forEachChunk(faabric_datatype_t* dtype, size_t count, F f)
+{
+    size_t chunkCount = getChunkCount(dtype);
+    for (size_t offset = 0; offset < count; offset += chunkCount) {
+        f(offset, std::min(chunkCount, count - offset));
+    }
+}
+
+// A reduce-scatter followed by an allgather, so each rank sends and receives
+// about twice the buffer whatever the number of ranks. Segments are sent in
+// chunks, so that we reduce one chunk while the next is in flight
+void doMpiRingAllReduce(faabric::mpi::MpiWorld& world,
+                        int rank,
+                        const std::vector<int>& ring,
+                        uint8_t* buffer,
+                        faabric_datatype_t* dtype,
+                        int count,
+                        faabric_op_t* op)
+{
+    auto msgType = faabric::mpi::MpiMessageType::ALLREDUCE;
+    int nRanks = ring.size();
+    int me = std::find(ring.begin(), ring.end(), rank) - ring.begin();
+    int next = ring.at((me + 1) % nRanks);
+    int prev = ring.at((me + nRanks - 1) % nRanks);
+    size_t elemSize = dtype->size;
+
+    auto segStart = [count, nRanks](int seg) {
+        return ((size_t)count * seg) / nRanks;
+    };
+
+    std::vector<uint8_t> chunkBuffer(
+      std::min<size_t>(count, getChunkCount(dtype)) * elemSize);
+    MPI_Status status;
+
+    // After the reduce-scatter, each rank has the result for the segment after
+    // its own, which the allgather passes around the ring
+    for (int phase = 0; phase < 2; phase++) {
+        bool reducing = phase == 0;
+        int shift = reducing ? 0 : 1;
+        for (int step = 0; step < nRanks - 1; step++) {
+            int sendSeg = (me - step + shift + nRanks) % nRanks;
+            int recvSeg = (me - step - 1 + shift + nRanks) % nRanks;
+
+            uint8_t* sendPtr = buffer + segStart(sendSeg) * elemSize;
+            size_t sendCount = segStart(sendSeg + 1) - segStart(sendSeg);
+            std::vector<int> sendIds;
+            forEachChunk(dtype, sendCount, [&](size_t offset, size_t n) {
+                sendIds.push_back(doMpiIsend(world,
+                                             rank,
+                                             next,
+                                             sendPtr + offset * elemSize,
+                                             dtype,
+                                             n,
+                                             msgType));
+            });
+
+            uint8_t* recvPtr = buffer + segStart(recvSeg) * elemSize;
+            size_t recvCount = segStart(recvSeg + 1) - segStart(recvSeg);
+            forEachChunk(dtype, recvCount, [&](size_t offset, size_t n) {
+                uint8_t* chunkPtr = recvPtr + offset * elemSize;
+                if (reducing) {
+                    doMpiRecv(world,
+                              rank,
+                              prev,
+                              chunkBuffer.data(),
+                              dtype,
+                              n,
+                              &status,
+                              msgType);
+                    reduceInto(dtype, op, chunkPtr, chunkBuffer.data(), n);
+                } else {
+                    doMpiRecv(
+                      world, rank, prev, chunkPtr, dtype, n, &status, msgType);
+                }
+            });
+
+            for (int sendId : sendIds) {
+                doMpiAwait(world, sendId);
+            }
+        }
+    }
+}
+
+void doMpiAllReduce(faabric::mpi::MpiWorld& world,
+                    int rank,
+                    const uint8_t* sendBuffer,
+                    uint8_t* recvBuffer,
+                    faabric_datatype_t* dtype,
+                    int count,
+                    faabric_op_t* op)
+{
+    if (!useHierarchy(world) || !canReduceLocally(dtype, op)) {
+        world.allReduce(
+          rank, (uint8_t*)sendBuffer, recvBuffer, dtype, count, op);
+        return;
+    }
+
+    const MpiTopology& topology = getTopology();
+    std::shared_ptr<LocalMpiGroup> group = getLocalMpiTransport().getGroup(
+      world.getId(), topology.groupId, topology.localRanks);
+    int localIdx = group->getLocalIdx(rank);
+    int nLocal = group->ranks.size();
+    size_t elemSize = dtype->size;
+
+    // Each local rank reduces its own slice of everyone's buffers into the
+    // leader's receive buffer, reading them straight from each module's memory
+    group->shareBuffers(rank, sendBuffer, recvBuffer);
+    uint8_t* leaderBuffer = group->getRecvBuffer(0);
+    size_t sliceStart = ((size_t)count * localIdx) / nLocal;
+    size_t sliceEnd = ((size_t)count * (localIdx + 1)) / nLocal;
+    if (sliceEnd > sliceStart) {
+        uint8_t* dst = leaderBuffer + sliceStart * elemSize;
+        size_t n = sliceEnd - sliceStart;
+
+        // The leader's own input is already in place if it's reducing in place
+        const uint8_t* leaderInput = group->getSendBuffer(0);
+        if (leaderInput != leaderBuffer) {
+            std::memcpy(dst, leaderInput + sliceStart * elemSize, n * elemSize);
+        }
+
+        for (int i = 1; i < nLocal; i++) {
+            reduceInto(dtype,
+                       op,
+                       dst,
+                       group->getSendBuffer(i) + sliceStart * elemSize,
+                       n);
+        }
+    }
+    group->barrier();
+
+    if (localIdx == 0 && topology.leaders.size() > 1) {
+        doMpiRingAllReduce(
+          world, rank, topology.leaders, leaderBuffer, dtype, count, op);
+    }
+    group->barrier();
+
+    if (localIdx != 0) {
+        std::memcpy(recvBuffer, leaderBuffer, count * elemSize);
+    }
+
+    // The leader's buffer must stay put until everyone has copied it
+    group->barrier();
+}
+
+// Each rank in the chain forwards a chunk to the next as soon as it has it,
+// so that they all receive in a pipeline
+void doMpiChainBroadcast(faabric::mpi::MpiWorld& world,
+                         int rank,
+                         const std::vector<int>& chain,
+                         uint8_t* buffer,
+                         faabric_datatype_t* dtype,
+                         int count)
+{
+    auto msgType = faabric::mpi::MpiMessageType::BROADCAST;
+    int me = std::find(chain.begin(), chain.end(), rank) - chain.begin();
+    int prev = me > 0 ? chain.at(me - 1) : -1;
+    int next = me + 1 < (int)chain.size() ? chain.at(me + 1) : -1;
+
+    MPI_Status status;
+    std::vector<int> sendIds;
+    forEachChunk(dtype, count, [&](size_t offset, size_t n) {
+        uint8_t* chunkPtr = buffer + offset * dtype->size;
+        if (prev >= 0) {
+            doMpiRecv(world, rank, prev, chunkPtr, dtype, n, &status, msgType);
+        }
+
+        if (next >= 0) {
+            sendIds.push_back(
+              doMpiIsend(world, rank, next, chunkPtr, dtype, n, msgType));
+        }
+    });
+
+    for (int sendId : sendIds) {
+        doMpiAwait(world, sendId);
+    }
+}
+
+void doMpiBroadcast(faabric::mpi::MpiWorld& world,
+                    int rank,
+                    int root,
+                    uint8_t* buffer,
+                    faabric_datatype_t* dtype,
+                    int count)
+{
+    if (!useHierarchy(world)) {
+        world.broadcast(root,
+                        rank,
+                        buffer,
+                        dtype,
+                        count,
+                        faabric::mpi::MpiMessageType::BROADCAST);
+        return;
+    }
+
+    const MpiTopology& topology = getTopology();
+    std::shared_ptr<LocalMpiGroup> group = getLocalMpiTransport().getGroup(
+      world.getId(), topology.groupId, topology.localRanks);
+
+    // The root passes the message along a chain of one rank per host, the root
+    // itself on its own host and the leader on the others
+    int rootLeader = topology.leaderOf.at(root);
+    std::vector<int> chain = { root };
+    for (int leader : topology.leaders) {
+        if (leader != rootLeader) {
+            chain.push_back(leader);
+        }
+    }
+
+    bool onRootHost = topology.leaderOf.at(rank) == rootLeader;
+    int localSource = onRootHost ? root : group->ranks.front();
+    if (rank == localSource) {
+        doMpiChainBroadcast(world, rank, chain, buffer, dtype, count);
+    }
+
+    // The other ranks on the host copy straight from the source's memory
+    group->shareBuffers(rank, buffer, buffer);
+    if (rank != localSource) {
+        std::memcpy(buffer,
+                    group->getRecvBuffer(group->getLocalIdx(localSource)),
+                    count * dtype->size);
+    }
+
+    group->barrier();
+}
+
+// ------------------------------------------------
+// VECTOR COLLECTIVES
+// ------------------------------------------------
+
+// Blocks are sent from and received into the callers' buffers directly, and
+// all transfers are posted before waiting on any of them, so that ranks don't
+// wait on each other in turn
+void doMpiAllToAllV(faabric::mpi::MpiWorld& world,
+                    int rank,
+                    const uint8_t* sendBuffer,
+                    const std::vector<int32_t>& sendCounts,
+                    const std::vector<int32_t>& sendDispls,
+                    faabric_datatype_t* sendType,
+                    uint8_t* recvBuffer,
+                    const std::vector<int32_t>& recvCounts,
+                    const std::vector<int32_t>& recvDispls,
+                    faabric_datatype_t* recvType,
+                    faabric::mpi::MpiMessageType messageType)
+{
+    int worldSize = recvCounts.size();
+
+    std::vector<int> requestIds;
+    requestIds.reserve(2 * worldSize);
+    for (int r = 0; r < worldSize; r++) {
+        if (r == rank || recvCounts.at(r) == 0) {
+            continue;
+        }
+
+        requestIds.push_back(
+          doMpiIrecv(world,
+                     rank,
+                     r,
+                     recvBuffer + recvDispls.at(r) * recvType->size,
+                     recvType,
+                     recvCounts.at(r),
+                     messageType));
+    }
+
+    for (int r = 0; r < worldSize; r++) {
+        if (r == rank || sendCounts.at(r) == 0) {
+            continue;
+        }
+
+        requestIds.push_back(
+          doMpiIsend(world,
+                     rank,
+                     r,
+                     sendBuffer + sendDispls.at(r) * sendType->size,
+                     sendType,
+                     sendCounts.at(r),
+                     messageType));
+    }
+
+    // Our own block doesn't leave our buffers
+    if (sendCounts.at(rank) > 0) {
+        std::memmove(recvBuffer + recvDispls.at(rank) * recvType->size,
+                     sendBuffer + sendDispls.at(rank) * sendType->size,
+                     sendCounts.at(rank) * sendType->size);
+    }
+
+    for (int requestId : requestIds) {
+        doMpiAwait(world, requestId);
+    }
+}
+
+// Reduces everyone's buffer into the root's, one chunk at a time, so that the
+// root reduces one chunk while the next is in flight
+static void doMpiChunkedReduce(faabric::mpi::MpiWorld& world,
+                               int rank,
+                               int root,
+                               int worldSize,
+                               const uint8_t* sendBuffer,
+                               uint8_t* recvBuffer,
+                               faabric_datatype_t* dtype,
+                               int count,
+                               faabric_op_t* op)
+{
+    auto msgType = faabric::mpi::MpiMessageType::REDUCE;
+    size_t elemSize = dtype->size;
+
+    if (rank != root) {
+        std::vector<int> sendIds;
+        forEachChunk(dtype, count, [&](size_t offset, size_t n) {
+            sendIds.push_back(doMpiIsend(world,
+                                         rank,
+                                         root,
+                                         sendBuffer + offset * elemSize,
+                                         dtype,
+                                         n,
+                                         msgType));
+        });
+
+        for (int sendId : sendIds) {
+            doMpiAwait(world, sendId);
+        }
+
+        return;
+    }
+
+    if (sendBuffer != recvBuffer) {
+        std::memcpy(recvBuffer, sendBuffer, count * elemSize);
+    }
+
+    std::vector<uint8_t> chunkBuffer(
+      std::min<size_t>(count, getChunkCount(dtype)) * elemSize);
+    MPI_Status status;
+    forEachChunk(dtype, count, [&](size_t offset, size_t n) {
+        for (int r = 0; r < worldSize; r++) {
+            if (r == root) {
+                continue;
+            }
+
+            doMpiRecv(
+              world, rank, r, chunkBuffer.data(), dtype, n, &status, msgType);
+            reduceInto(
+              dtype, op, recvBuffer + offset * elemSize, chunkBuffer.data(), n);
+        }
+    });
+}
+
+// A single reduce to the first rank, which then scatters the blocks. Each
+// rank has finished sending its input once the reduce is done, so the result
+// can overwrite it
+void doMpiReduceScatter(faabric::mpi::MpiWorld& world,
+                        int rank,
+                        const uint8_t* sendBuffer,
+                        uint8_t* recvBuffer,
+                        const std::vector<int32_t>& recvCounts,
+                        faabric_datatype_t* dtype,
+                        faabric_op_t* op)
+{
+    int root = 0;
+    int worldSize = recvCounts.size();
+    size_t elemSize = dtype->size;
+
+    std::vector<int32_t> displs(worldSize, 0);
+    for (int r = 1; r < worldSize; r++) {
+        displs.at(r) = displs.at(r - 1) + recvCounts.at(r - 1);
+    }
+    int totalCount = displs.back() + recvCounts.back();
+
+    // The world's reduce may use any rank's receive buffer for partial results
+    bool reduceHere = canReduceLocally(dtype, op);
+    std::vector<uint8_t> reduced;
+    if (rank == root || !reduceHere) {
+        reduced.resize(totalCount * elemSize);
+    }
+
+    if (reduceHere) {
+        doMpiChunkedReduce(world,
+                           rank,
+                           root,
+                           worldSize,
+                           sendBuffer,
+                           reduced.data(),
+                           dtype,
+                           totalCount,
+                           op);
+    } else {
+        world.reduce(rank,
+                     root,
+                     (uint8_t*)sendBuffer,
+                     reduced.data(),
+                     dtype,
+                     totalCount,
+                     op);
+    }
+
+    auto msgType = faabric::mpi::MpiMessageType::SCATTER;
+    if (rank != root) {
+        if (recvCounts.at(rank) > 0) {
+            MPI_Status status;
+            doMpiRecv(world,
+                      rank,
+                      root,
+                      recvBuffer,
+                      dtype,
+                      recvCounts.at(rank),
+                      &status,
+                      msgType);
+        }
+
+        return;
+    }
+
+    std::vector<int> sendIds;
+    for (int r = 0; r < worldSize; r++) {
+        if (r == root || recvCounts.at(r) == 0) {
+            continue;
+        }
+
+        sendIds.push_back(doMpiIsend(world,
+                                     rank,
+                                     r,
+                                     reduced.data() + displs.at(r) * elemSize,
+                                     dtype,
+                                     recvCounts.at(r),
+                                     msgType));
+    }
+
+    std::memcpy(recvBuffer,
+                reduced.data() + displs.at(root) * elemSize,
+                recvCounts.at(root) * elemSize);
+
+    for (int sendId : sendIds) {
+        doMpiAwait(world, sendId);
+    }
+}
+
+void checkMpiCommSplit(const std::vector<int32_t>& colorKeys)
+{
+    int worldSize = colorKeys.size() / 2;
+    for (int r = 1; r < worldSize; r++) {
+        bool sameColor = colorKeys.at(2 * r) == colorKeys.at(0);
+        bool inOrder = colorKeys.at(2 * r + 1) >= colorKeys.at(2 * r - 1);
+        if (!sameColor || !inOrder) {
+            SPDLOG_ERROR("Unsupported MPI_Comm_split (rank {} color {} key {})",
+                         r,
+                         colorKeys.at(2 * r),
+                         colorKeys.at(2 * r + 1));
+            throw std::runtime_error("Unsupported MPI_Comm_split");
+        }
+    }
+}
+
+void doMpiFinalize(faabric::mpi::MpiWorld& world, int rank)
+{
+    getLocalMpiTransport().removeReceiver(world.getId(), rank);
+    getLocalMpiTransport().removeGroups(world.getId());
+}
+}
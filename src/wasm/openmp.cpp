@@ -1,15 +1,25 @@
 #include <faabric/batch-scheduler/BatchScheduler.h>
 #include <faabric/executor/ExecutorContext.h>
 #include <faabric/planner/PlannerClient.h>
+#include <faabric/redis/Redis.h>
 #include <faabric/transport/PointToPointBroker.h>
 #include <faabric/util/batch.h>
+#include <faabric/util/config.h>
 #include <faabric/util/func.h>
+#include <faabric/util/locks.h>
 #include <faabric/util/testing.h>
 #include <faabric/util/timing.h>
 #include <wasm/WasmExecutionContext.h>
 #include <wasm/WasmModule.h>
 #include <wasm/openmp.h>
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
 namespace wasm {
 static std::shared_ptr<faabric::transport::PointToPointGroup>
 getExecutingPointToPointGroup()
@@ -19,6 +29,179 @@ getExecutingPointToPointGroup()
       msg.groupid());
 }
 
+// ----------------------------------------------------
+// LOCAL TEAMS
+// ----------------------------------------------------
+
+// Reductions hand each thread's private variables to its parent through a
+// slot, recording which reduction the data belongs to
+struct ReduceSlot
+{
+    // Wasm pointer to the thread's private reduction variables
+    std::atomic<int32_t> data = 0;
+
+    // Number of the last reduction whose data is ready in this slot, and of the
+    // last one whose data has been combined by the thread's parent
+    std::atomic<int> ready = -1;
+    std::atomic<int> consumed = -1;
+};
+
+// Dynamic and guided loops hand out chunks of iterations from a counter shared
+// by the team. If the whole team is on this host, the counter lives in its
+// local team. Otherwise it lives in Redis, keyed on the team's point-to-point
+// group
+struct LoopCounter
+{
+    std::atomic<uint64_t> next = 0;
+    std::atomic<int> nFinished = 0;
+};
+
+// The members of a team executing on this host, and the state they use to
+// synchronise without going through the point-to-point group
+struct LocalTeam
+{
+    LocalTeam(std::vector<int> membersIn, bool distributedIn)
+      : members(std::move(membersIn))
+      , distributed(distributedIn)
+      , reduceSlots(members.size())
+    {}
+
+    // Thread numbers of the members of the team on this host, in order
+    const std::vector<int> members;
+
+    // Whether any members of the team are executing on other hosts
+    const bool distributed;
+
+    std::vector<ReduceSlot> reduceSlots;
+
+    // Number of the last blocking reduction finished by the root
+    std::atomic<int> reduceReleased = -1;
+
+    // Held by the thread in a critical section on this host. For distributed
+    // teams, the first thread to enter also takes the group's lock, which is
+    // then passed between threads on this host while they are waiting for it
+    std::recursive_mutex criticalMx;
+    std::atomic<int> nCriticalWaiting = 0;
+    int criticalDepth = 0;
+    int criticalLeaseIdx = -1;
+    int nCriticalHandoffs = 0;
+
+    // Counters of the team's dynamic and guided loops, by loop number, if
+    // the team is not distributed
+    std::mutex loopCountersMx;
+    std::unordered_map<int, std::shared_ptr<LoopCounter>> loopCounters;
+
+    std::atomic<int> nFinished = 0;
+};
+
+static std::mutex localTeamsMx;
+static std::unordered_map<int, std::shared_ptr<LocalTeam>> localTeams;
+
+// This thread's view of each team it is a member of. Reductions are numbered
+// in the order each thread reaches them, which is the same across the team
+struct TeamThreadState
+{
+    int rank = 0;
+    int nReductions = 0;
+    std::shared_ptr<LocalTeam> team = nullptr;
+};
+
+static thread_local std::unordered_map<int, TeamThreadState> teamThreadStates;
+
+static std::shared_ptr<LocalTeam> getLocalTeam(int groupId, int nThreads)
+{
+    faabric::util::UniqueLock lock(localTeamsMx);
+    auto& team = localTeams[groupId];
+    if (team != nullptr) {
+        return team;
+    }
+
+    auto& broker = faabric::transport::getPointToPointBroker();
+    std::string thisHost = faabric::util::getSystemConfig().endpointHost;
+    std::set<int> groupIdxs = broker.getIdxsRegisteredForGroup(groupId);
+    std::vector<int> members;
+    for (int idx : groupIdxs) {
+        if (broker.getHostForReceiver(groupId, idx) == thisHost) {
+            members.push_back(idx);
+        }
+    }
+
+    // Teams without a point-to-point group (e.g. in tests) are all local
+    if (members.empty()) {
+        for (int i = 0; i < nThreads; i++) {
+            members.push_back(i);
+        }
+    }
+    std::sort(members.begin(), members.end());
+
+    bool distributed = !groupIdxs.empty() && members.size() < groupIdxs.size();
+    team = std::make_shared<LocalTeam>(members, distributed);
+    return team;
+}
+
+static TeamThreadState& getTeamThreadState(
+  faabric::Message* msg,
+  const std::shared_ptr<threads::Level>& level)
+{
+    TeamThreadState& s = teamThreadStates[msg->groupid()];
+    if (s.team != nullptr) {
+        return s;
+    }
+
+    s.team = getLocalTeam(msg->groupid(), level->numThreads);
+
+    int threadNum = level->getLocalThreadNum(msg);
+    const std::vector<int>& members = s.team->members;
+    auto it = std::find(members.begin(), members.end(), threadNum);
+    if (it == members.end()) {
+        SPDLOG_ERROR("Thread {} not in local team for group {}",
+                     threadNum,
+                     msg->groupid());
+        throw std::runtime_error("Thread not in local team");
+    }
+    s.rank = it - members.begin();
+
+    return s;
+}
+
+void doOpenMPFinishThread(faabric::Message* msg)
+{
+    std::shared_ptr<threads::Level> level = threads::getCurrentOpenMPLevel();
+    if (level->numThreads == 1) {
+        return;
+    }
+
+    // The last thread on this host to finish removes the team. Every thread
+    // must be counted, even those that never used the team
+    TeamThreadState& s = getTeamThreadState(msg, level);
+    if (s.team->nFinished.fetch_add(1) + 1 == (int)s.team->members.size()) {
+        faabric::util::UniqueLock lock(localTeamsMx);
+        auto it = localTeams.find(msg->groupid());
+        if (it != localTeams.end() && it->second == s.team) {
+            localTeams.erase(it);
+        }
+    }
+
+    teamThreadStates.erase(msg->groupid());
+}
+
+OpenMPThreadScope::OpenMPThreadScope(faabric::Message* msgIn)
+  : msg(msgIn)
+{}
+
+OpenMPThreadScope::~OpenMPThreadScope()
+{
+    // Must not throw, as we may already be unwinding
+    try {
+        doOpenMPFinishThread(msg);
+    } catch (std::exception& e) {
+        SPDLOG_ERROR("Failed to finish OpenMP thread (group {}, idx {}): {}",
+                     msg->groupid(),
+                     msg->groupidx(),
+                     e.what());
+    }
+}
+
 // ----------------------------------------------------
 // BARRIER
 // ----------------------------------------------------
@@ -41,6 +224,10 @@ void doOpenMPBarrier(int32_t loc, int32_t globalTid)
 // CRITICAL
 // ----------------------------------------------------
 
+// Number of times the group's lock is passed between threads on this host
+// before it is released, so that other hosts get a turn
+#define MAX_CRITICAL_HANDOFFS 64
+
 /**
  * Enter code protected by a `critical` construct. This function blocks until
  the thread can enter the critical section.
@@ -55,23 +242,55 @@ void doOpenMPCritical(int32_t loc, int32_t globalTid, int32_t crit)
 {
     OMP_FUNC_ARGS("__kmpc_critical {} {} {}", loc, globalTid, crit);
 
-    if (level->numThreads > 1) {
-        getExecutingPointToPointGroup()->lock(msg->groupidx(), true);
+    if (level->numThreads == 1) {
+        return;
+    }
+
+    // Threads on this host queue on a local lock, so teams on a single host
+    // don't send any messages
+    LocalTeam& team = *getTeamThreadState(msg, level).team;
+    team.nCriticalWaiting++;
+    team.criticalMx.lock();
+    team.nCriticalWaiting--;
+
+    if (team.criticalDepth++ > 0 || !team.distributed) {
+        return;
+    }
 
-        // NOTE: here we need to pull the latest snapshot diffs from master.
-        // This is a really inefficient way to implement a critical, and needs
-        // more thought as to whether we can avoid doing a request/ response
-        // every time.
+    // The first thread on this host to get in takes the group's lock on
+    // behalf of the host, unless it's already been passed on to us
+    if (team.criticalLeaseIdx < 0) {
+        getExecutingPointToPointGroup()->lock(msg->groupidx(), true);
+        team.criticalLeaseIdx = msg->groupidx();
+        team.nCriticalHandoffs = 0;
     }
+
+    // NOTE: as with reductions, other hosts' updates to shared variables are
+    // only visible at the end of the parallel section
 }
 
 void doOpenMPEndCritical(int32_t loc, int32_t globalTid, int32_t crit)
 {
     OMP_FUNC_ARGS("__kmpc_end_critical {} {} {}", loc, globalTid, crit);
 
-    if (level->numThreads > 1) {
-        getExecutingPointToPointGroup()->unlock(msg->groupidx(), true);
+    if (level->numThreads == 1) {
+        return;
     }
+
+    LocalTeam& team = *getTeamThreadState(msg, level).team;
+    if (--team.criticalDepth == 0 && team.criticalLeaseIdx >= 0) {
+        // Keep hold of the group's lock if another thread on this host is
+        // waiting for it, up to a limit
+        bool handOff = team.nCriticalWaiting > 0 &&
+                       ++team.nCriticalHandoffs < MAX_CRITICAL_HANDOFFS;
+        if (!handOff) {
+            getExecutingPointToPointGroup()->unlock(team.criticalLeaseIdx,
+                                                    true);
+            team.criticalLeaseIdx = -1;
+        }
+    }
+
+    team.criticalMx.unlock();
 }
 
 void doOpenMPFlush(int32_t loc)
@@ -121,7 +340,6 @@ void doOpenMPFork(int32_t loc,
     auto* parentModule = getExecutingModule();
     auto parentReq =
       faabric::executor::ExecutorContext::get()->getBatchRequest();
-    const auto parentStr = faabric::util::funcToString(*parentCall, false);
     auto* parentExecutor =
       faabric::executor::ExecutorContext::get()->getExecutor();
 
@@ -202,44 +420,7 @@ void doOpenMPFork(int32_t loc,
     // the snapshot if necessary (i.e. getOrAwaitSnapshot())
     std::shared_ptr<faabric::util::SnapshotData> snap = nullptr;
     if (!req->singlehosthint()) {
-        snap = parentExecutor->getMainThreadSnapshot(*parentCall, true);
-
-        // Get dirty regions since last batch of threads
-        std::span<uint8_t> memView = parentExecutor->getMemoryView();
-        faabric::util::getDirtyTracker()->stopTracking(memView);
-        faabric::util::getDirtyTracker()->stopThreadLocalTracking(memView);
-
-        // If this is the first batch, these dirty regions will be empty
-        std::vector<char> dirtyRegions =
-          faabric::util::getDirtyTracker()->getBothDirtyPages(memView);
-
-        // Apply changes to snapshot
-        snap->fillGapsWithBytewiseRegions();
-        std::vector<faabric::util::SnapshotDiff> updates =
-          snap->diffWithDirtyRegions(memView, dirtyRegions);
-
-        if (updates.empty()) {
-            SPDLOG_DEBUG(
-              "No updates to main thread snapshot for {} over {} pages",
-              parentStr,
-              dirtyRegions.size());
-        } else {
-            SPDLOG_DEBUG("Updating main thread snapshot for {} with {} diffs",
-                         parentStr,
-                         updates.size());
-            snap->applyDiffs(updates);
-        }
-
-        // Clear merge regions, not persisted between batches of threads
-        snap->clearMergeRegions();
-
-        // Now we have to add any merge regions we've been saving up for this
-        // next batch of threads
-        auto mergeRegions = parentModule->getMergeRegions();
-        for (const auto& mr : mergeRegions) {
-            snap->addMergeRegion(
-              mr.offset, mr.length, mr.dataType, mr.operation);
-        }
+        snap = parentModule->updateMainThreadSnapshot(*parentCall);
     }
 
     // Invoke all non-main threads
@@ -383,8 +564,21 @@ enum sched_type : int32_t
     sch_lower = 32, /**< lower bound for unordered values */
     sch_static_chunked = 33,
     sch_static = 34, /**< static unspecialized */
+    sch_dynamic_chunked = 35,
+    sch_guided_chunked = 36,
+    sch_runtime = 37,
+    sch_auto = 38,
+    sch_static_greedy = 40,
+    sch_static_balanced = 41,
+    sch_guided_iterative_chunked = 42,
+    sch_guided_analytical_chunked = 43,
+    sch_static_steal = 44,
 };
 
+// Clang sets these bits on the schedule to ask for monotonic or non-monotonic
+// iteration order, which makes no difference to us
+#define SCH_MODIFIER_MASK ((1 << 29) | (1 << 30))
+
 template<typename T>
 void for_static_init(int32_t schedule,
                      int32_t* lastIter,
@@ -578,6 +772,444 @@ void doOpenMPForStaticFini(int32_t loc, int32_t globalTid)
     OMP_FUNC_ARGS("__kmpc_for_static_fini {} {}", loc, globalTid);
 }
 
+// -------------------------------------------------------
+// FOR LOOP DISPATCH
+// -------------------------------------------------------
+
+// Values of omp_sched_t, as passed to omp_set_schedule
+enum omp_sched_kind : int32_t
+{
+    omp_sched_static = 1,
+    omp_sched_dynamic = 2,
+    omp_sched_guided = 3,
+    omp_sched_auto = 4,
+};
+
+#define OMP_SCHED_MONOTONIC_MASK 0x80000000
+
+// The loop currently being dispatched to this thread. Iterations are counted
+// from zero, and mapped back onto the loop bounds when handed out
+struct DispatchState
+{
+    // Loops are numbered in the order each thread reaches them, which is the
+    // same across the team
+    int groupId = -1;
+    int nLoops = 0;
+
+    int32_t schedule = sch_static;
+    uint64_t lower = 0;
+    int64_t stride = 1;
+    uint64_t tripCount = 0;
+    uint64_t chunk = 1;
+    int nThreads = 1;
+    int threadNum = 0;
+    bool finished = true;
+
+    // Number of chunks taken by this thread for static schedules
+    uint64_t nStaticChunks = 0;
+
+    // Shared counter for dynamic and guided schedules
+    int loopIdx = 0;
+    std::string counterKey;
+    std::shared_ptr<LocalTeam> team = nullptr;
+    std::shared_ptr<LoopCounter> localCounter = nullptr;
+};
+
+static thread_local DispatchState dispatchState;
+
+static int32_t resolveSchedule(int32_t schedule,
+                               int64_t& chunk,
+                               const std::shared_ptr<threads::Level>& level)
+{
+    schedule &= ~SCH_MODIFIER_MASK;
+
+    if (schedule == sch_runtime) {
+        chunk = level->runtimeScheduleChunk;
+        switch (level->runtimeScheduleKind & ~OMP_SCHED_MONOTONIC_MASK) {
+            case omp_sched_static:
+                return chunk > 0 ? sch_static_chunked : sch_static;
+            case omp_sched_dynamic:
+                return sch_dynamic_chunked;
+            case omp_sched_guided:
+            case omp_sched_auto:
+                return sch_guided_chunked;
+            default: {
+                SPDLOG_ERROR("Unrecognised OpenMP runtime schedule {}",
+                             level->runtimeScheduleKind);
+                throw std::runtime_error("Unrecognised runtime schedule");
+            }
+        }
+    }
+
+    switch (schedule) {
+        case sch_static_chunked:
+        case sch_static:
+        case sch_dynamic_chunked:
+        case sch_guided_chunked:
+            return schedule;
+        case sch_static_greedy:
+        case sch_static_balanced:
+            return sch_static;
+        case sch_static_steal:
+            return sch_dynamic_chunked;
+        case sch_auto:
+        case sch_guided_iterative_chunked:
+        case sch_guided_analytical_chunked:
+            return sch_guided_chunked;
+        default: {
+            SPDLOG_ERROR("Unimplemented OpenMP dispatch scheduler {}",
+                         schedule);
+            throw std::runtime_error("Unimplemented OpenMP scheduler");
+        }
+    }
+}
+
+static uint64_t readLoopCounter(const DispatchState& s)
+{
+    if (s.localCounter != nullptr) {
+        return s.localCounter->next.load(std::memory_order_relaxed);
+    }
+
+    return faabric::redis::Redis::getState().getCounter(s.counterKey);
+}
+
+// Returns the value of the counter before adding
+static uint64_t addToLoopCounter(const DispatchState& s, uint64_t n)
+{
+    if (s.localCounter != nullptr) {
+        return s.localCounter->next.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    return faabric::redis::Redis::getState().incrByLong(s.counterKey, n) - n;
+}
+
+static void finishLoop(DispatchState& s)
+{
+    s.finished = true;
+    if (s.counterKey.empty()) {
+        return;
+    }
+
+    // The last thread to finish removes the counter
+    if (s.localCounter != nullptr) {
+        if (s.localCounter->nFinished.fetch_add(1) + 1 == s.nThreads) {
+            faabric::util::UniqueLock lock(s.team->loopCountersMx);
+            s.team->loopCounters.erase(s.loopIdx);
+        }
+        s.localCounter = nullptr;
+        s.team = nullptr;
+    } else {
+        faabric::redis::Redis& redis = faabric::redis::Redis::getState();
+        std::string finishedKey = s.counterKey + "_finished";
+        if (redis.incr(finishedKey) == s.nThreads) {
+            redis.del(s.counterKey);
+            redis.del(finishedKey);
+        }
+    }
+
+    s.counterKey.clear();
+}
+
+// Claims the next chunk of iterations, [start, end), for this thread
+static bool claimChunk(DispatchState& s, uint64_t& start, uint64_t& end)
+{
+    if (s.schedule == sch_static || s.schedule == sch_static_chunked) {
+        // Static chunks are dealt round-robin
+        uint64_t chunkIdx = s.threadNum + s.nStaticChunks * s.nThreads;
+        s.nStaticChunks++;
+        start = chunkIdx * s.chunk;
+        end = start + s.chunk;
+    } else {
+        uint64_t size = s.chunk;
+
+        // Guided chunks shrink in proportion to the iterations left. If
+        // another thread claims a chunk in the meantime we just take a
+        // slightly bigger chunk than we should
+        if (s.schedule == sch_guided_chunked) {
+            uint64_t claimed = readLoopCounter(s);
+            if (claimed < s.tripCount) {
+                uint64_t remaining = s.tripCount - claimed;
+                size = std::max<uint64_t>(size, remaining / (2 * s.nThreads));
+            }
+        }
+
+        start = addToLoopCounter(s, size);
+        end = start + size;
+    }
+
+    if (start >= s.tripCount) {
+        return false;
+    }
+
+    end = std::min(end, s.tripCount);
+
+    return true;
+}
+
+template<typename T>
+void dispatch_init(int32_t schedule,
+                   T lower,
+                   T upper,
+                   typename std::make_signed<T>::type stride,
+                   typename std::make_signed<T>::type chunk)
+{
+    typedef typename std::make_unsigned<T>::type UT;
+
+    faabric::Message* msg =
+      &faabric::executor::ExecutorContext::get()->getMsg();
+    std::shared_ptr<threads::Level> level = threads::getCurrentOpenMPLevel();
+    DispatchState& s = dispatchState;
+
+    // Make sure we don't leave a counter behind if the last loop wasn't
+    // drained
+    if (!s.finished) {
+        finishLoop(s);
+    }
+
+    if (s.groupId != msg->groupid()) {
+        s.groupId = msg->groupid();
+        s.nLoops = 0;
+    }
+    s.loopIdx = s.nLoops++;
+
+    if (stride > 0) {
+        s.tripCount =
+          upper < lower ? 0 : (UT)((UT)upper - (UT)lower) / (UT)stride + 1;
+    } else if (stride < 0) {
+        s.tripCount =
+          lower < upper ? 0 : (UT)((UT)lower - (UT)upper) / (UT)-stride + 1;
+    } else {
+        SPDLOG_ERROR("OpenMP loop with zero stride");
+        throw std::runtime_error("OpenMP loop with zero stride");
+    }
+
+    int64_t chunk64 = chunk;
+    s.schedule = resolveSchedule(schedule, chunk64, level);
+    s.lower = (uint64_t)lower;
+    s.stride = stride;
+    s.nThreads = level->numThreads;
+    s.threadNum = level->getLocalThreadNum(msg);
+    s.nStaticChunks = 0;
+    s.finished = false;
+
+    // A single thread just runs the whole loop
+    if (s.nThreads == 1) {
+        s.schedule = sch_static;
+    }
+
+    if (s.schedule == sch_static) {
+        s.chunk = std::max<uint64_t>(
+          1, (s.tripCount + s.nThreads - 1) / (uint64_t)s.nThreads);
+    } else {
+        s.chunk = std::max<int64_t>(1, chunk64);
+    }
+
+    if (s.schedule == sch_dynamic_chunked || s.schedule == sch_guided_chunked) {
+        s.counterKey = fmt::format("omp_loop_{}_{}", s.groupId, s.loopIdx);
+
+        std::shared_ptr<LocalTeam> team = getTeamThreadState(msg, level).team;
+        if (!team->distributed) {
+            faabric::util::UniqueLock lock(team->loopCountersMx);
+            auto& counter = team->loopCounters[s.loopIdx];
+            if (counter == nullptr) {
+                counter = std::make_shared<LoopCounter>();
+            }
+            s.team = team;
+            s.localCounter = counter;
+        }
+    }
+}
+
+template<typename T>
+int32_t dispatch_next(int32_t* lastIter,
+                      T* lower,
+                      T* upper,
+                      typename std::make_signed<T>::type* stride)
+{
+    DispatchState& s = dispatchState;
+    if (s.finished) {
+        return 0;
+    }
+
+    uint64_t start = 0;
+    uint64_t end = 0;
+    if (!claimChunk(s, start, end)) {
+        finishLoop(s);
+        return 0;
+    }
+
+    // Unsigned arithmetic wraps the same way for negative bounds and strides
+    *lower = (T)(s.lower + start * (uint64_t)s.stride);
+    *upper = (T)(s.lower + (end - 1) * (uint64_t)s.stride);
+    *stride = s.stride;
+    *lastIter = end == s.tripCount;
+
+    SPDLOG_TRACE("OMP {}: dispatching iterations {}-{} of {}",
+                 s.threadNum,
+                 start,
+                 end,
+                 s.tripCount);
+
+    return 1;
+}
+
+/**
+ * Called at the start of loops that are not statically scheduled, i.e. those
+ * with a dynamic, guided, runtime or auto schedule. Each thread then calls
+ * __kmpc_dispatch_next until it returns zero to get its chunks of iterations.
+ *
+ * The guts of the implementation in openmp can be found in
+ * __kmp_dispatch_init in runtime/src/kmp_dispatch.cpp
+ */
+void doOpenMPDispatchInit4(int32_t loc,
+                           int32_t gtid,
+                           int32_t schedule,
+                           int32_t lower,
+                           int32_t upper,
+                           int32_t stride,
+                           int32_t chunk)
+{
+    OMP_FUNC_ARGS("__kmpc_dispatch_init_4 {} {} {} {} {} {} {}",
+                  loc,
+                  gtid,
+                  schedule,
+                  lower,
+                  upper,
+                  stride,
+                  chunk);
+
+    dispatch_init<int32_t>(schedule, lower, upper, stride, chunk);
+}
+
+void doOpenMPDispatchInit4u(int32_t loc,
+                            int32_t gtid,
+                            int32_t schedule,
+                            uint32_t lower,
+                            uint32_t upper,
+                            int32_t stride,
+                            int32_t chunk)
+{
+    OMP_FUNC_ARGS("__kmpc_dispatch_init_4u {} {} {} {} {} {} {}",
+                  loc,
+                  gtid,
+                  schedule,
+                  lower,
+                  upper,
+                  stride,
+                  chunk);
+
+    dispatch_init<uint32_t>(schedule, lower, upper, stride, chunk);
+}
+
+void doOpenMPDispatchInit8(int32_t loc,
+                           int32_t gtid,
+                           int32_t schedule,
+                           int64_t lower,
+                           int64_t upper,
+                           int64_t stride,
+                           int64_t chunk)
+{
+    OMP_FUNC_ARGS("__kmpc_dispatch_init_8 {} {} {} {} {} {} {}",
+                  loc,
+                  gtid,
+                  schedule,
+                  lower,
+                  upper,
+                  stride,
+                  chunk);
+
+    dispatch_init<int64_t>(schedule, lower, upper, stride, chunk);
+}
+
+void doOpenMPDispatchInit8u(int32_t loc,
+                            int32_t gtid,
+                            int32_t schedule,
+                            uint64_t lower,
+                            uint64_t upper,
+                            int64_t stride,
+                            int64_t chunk)
+{
+    OMP_FUNC_ARGS("__kmpc_dispatch_init_8u {} {} {} {} {} {} {}",
+                  loc,
+                  gtid,
+                  schedule,
+                  lower,
+                  upper,
+                  stride,
+                  chunk);
+
+    dispatch_init<uint64_t>(schedule, lower, upper, stride, chunk);
+}
+
+/**
+ * Returns one if there is a chunk of iterations for this thread, writing its
+ * bounds, or zero once the loop is finished. Note that we don't use the
+ * logging macros here, as this is called for every chunk.
+ */
+int32_t doOpenMPDispatchNext4(int32_t loc,
+                              int32_t gtid,
+                              int32_t* lastIter,
+                              int32_t* lower,
+                              int32_t* upper,
+                              int32_t* stride)
+{
+    return dispatch_next<int32_t>(lastIter, lower, upper, stride);
+}
+
+int32_t doOpenMPDispatchNext4u(int32_t loc,
+                               int32_t gtid,
+                               int32_t* lastIter,
+                               uint32_t* lower,
+                               uint32_t* upper,
+                               int32_t* stride)
+{
+    return dispatch_next<uint32_t>(lastIter, lower, upper, stride);
+}
+
+int32_t doOpenMPDispatchNext8(int32_t loc,
+                              int32_t gtid,
+                              int32_t* lastIter,
+                              int64_t* lower,
+                              int64_t* upper,
+                              int64_t* stride)
+{
+    return dispatch_next<int64_t>(lastIter, lower, upper, stride);
+}
+
+int32_t doOpenMPDispatchNext8u(int32_t loc,
+                               int32_t gtid,
+                               int32_t* lastIter,
+                               uint64_t* lower,
+                               uint64_t* upper,
+                               int64_t* stride)
+{
+    return dispatch_next<uint64_t>(lastIter, lower, upper, stride);
+}
+
+/**
+ * Only needed for ordered loops, which we don't support
+ */
+void doOpenMPDispatchFini(int32_t loc, int32_t gtid)
+{
+    OMP_FUNC_ARGS("__kmpc_dispatch_fini {} {}", loc, gtid);
+}
+
+void doOpenMPSetSchedule(int32_t kind, int32_t chunk)
+{
+    OMP_FUNC_ARGS("omp_set_schedule {} {}", kind, chunk);
+
+    level->runtimeScheduleKind = kind;
+    level->runtimeScheduleChunk = chunk;
+}
+
+void doOpenMPGetSchedule(int32_t* kind, int32_t* chunk)
+{
+    OMP_FUNC("omp_get_schedule");
+
+    *kind = level->runtimeScheduleKind;
+    *chunk = level->runtimeScheduleChunk;
+}
+
 int32_t doOpenMPGetMaxThreads()
 {
     OMP_FUNC("omp_get_max_threads");
@@ -675,49 +1307,99 @@ void doOpenMPEndSingle(int32_t loc, int32_t globalTid)
 // REDUCTION
 // ---------------------------------------------------
 
-/**
- * Called to start a reduction.
- */
-void doOpenMPStartReduceCritical(faabric::Message* msg,
-                                 std::shared_ptr<threads::Level> level,
-                                 int32_t numReduceVars,
-                                 int32_t reduceVarPtrs,
-                                 int32_t reduceVarsSize)
+static void waitForReduction(std::atomic<int>& counter, int reduction)
 {
-    // This function synchronises updates to shared reduce variables.
-    // Each host will have its own copy of these variables, which will be merged
-    // at the end of the parallel section via Faasm shared memory.
-    // This means we only need to synchronise local accesses here, so we only
-    // need a local lock.
-    SPDLOG_TRACE("Entering reduce critical section for group {}",
-                 msg->groupid());
-
-    std::shared_ptr<faabric::transport::PointToPointGroup> group =
-      faabric::transport::PointToPointGroup::getOrAwaitGroup(msg->groupid());
-    group->localLock();
+    int value = counter.load(std::memory_order_acquire);
+    while (value < reduction) {
+        counter.wait(value, std::memory_order_acquire);
+        value = counter.load(std::memory_order_acquire);
+    }
 }
 
 /**
- * Called to finish off a reduction.
+ * Called by each thread to start a reduction. Returns 1 on the thread that
+ * must combine the result into the shared variables and then call
+ * doOpenMPEndReduce, and 0 on all others, whose data has already been combined.
+ *
+ * Each thread accumulates into private copies of the reduction variables, and
+ * the compiler gives us a function to combine two sets of them. Rather than
+ * having every thread combine into the shared variables in a critical section,
+ * the threads on each host combine their private copies pairwise in a tree,
+ * which takes log(n) rounds and no lock. Only the root of the tree then updates
+ * the shared variables, so each host contributes a single set of changes to be
+ * merged with the rest of the memory at the end of the parallel section.
  */
-void doOpenMPEndReduceCritical(faabric::Message* msg, bool barrier)
+int32_t doOpenMPStartReduce(faabric::Message* msg,
+                            std::shared_ptr<threads::Level> level,
+                            int32_t reduceData,
+                            const OpenMPReduceFunc& reduceFunc,
+                            bool barrier)
 {
-    std::shared_ptr<threads::Level> level = threads::getCurrentOpenMPLevel();
-    int localThreadNum = level->getLocalThreadNum(msg);
+    // A single thread just updates the shared variables itself
+    if (level->numThreads == 1) {
+        return 1;
+    }
+
+    TeamThreadState& s = getTeamThreadState(msg, level);
+    LocalTeam& team = *s.team;
+    int nMembers = team.members.size();
+    int reduction = s.nReductions++;
+
+    // In round k we combine the data of the thread 2^k ranks above us, until
+    // we become the child of the thread 2^k ranks below
+    for (int step = 1; step < nMembers && s.rank % (2 * step) == 0;
+         step *= 2) {
+        int child = s.rank + step;
+        if (child >= nMembers) {
+            continue;
+        }
+
+        ReduceSlot& childSlot = team.reduceSlots.at(child);
+        waitForReduction(childSlot.ready, reduction);
+        reduceFunc(reduceData, childSlot.data.load(std::memory_order_relaxed));
 
-    // Unlock the critical section
-    std::shared_ptr<faabric::transport::PointToPointGroup> group =
-      faabric::transport::PointToPointGroup::getGroup(msg->groupid());
-    group->localUnlock();
+        childSlot.consumed.store(reduction, std::memory_order_release);
+        childSlot.consumed.notify_one();
+    }
 
-    // Master must make sure all other threads are done
-    group->notify(localThreadNum);
+    if (s.rank == 0) {
+        SPDLOG_TRACE("Thread {} finishing reduction {} for group {}",
+                     team.members.at(0),
+                     reduction,
+                     msg->groupid());
+        return 1;
+    }
 
-    // Everyone waits if there's a barrier
+    // The private variables live on this thread's stack, so we must not return
+    // until our parent has read them
+    ReduceSlot& slot = team.reduceSlots.at(s.rank);
+    slot.data.store(reduceData, std::memory_order_relaxed);
+    slot.ready.store(reduction, std::memory_order_release);
+    slot.ready.notify_one();
+    waitForReduction(slot.consumed, reduction);
+
+    // Blocking reductions imply a barrier, so wait for the root to finish too.
+    // Other hosts can't see our shared variables until the end of the parallel
+    // section anyway, so this only needs to include the threads on this host
     if (barrier) {
-        PROF_START(FinaliseReduceBarrier)
-        group->barrier(localThreadNum);
-        PROF_END(FinaliseReduceBarrier)
+        waitForReduction(team.reduceReleased, reduction);
+    }
+
+    return 0;
+}
+
+/**
+ * Called by the thread that updated the shared variables to finish a reduction.
+ */
+void doOpenMPEndReduce(faabric::Message* msg, bool barrier)
+{
+    std::shared_ptr<threads::Level> level = threads::getCurrentOpenMPLevel();
+    if (!barrier || level->numThreads == 1) {
+        return;
     }
+
+    TeamThreadState& s = getTeamThreadState(msg, level);
+    s.team->reduceReleased.store(s.nReductions - 1, std::memory_order_release);
+    s.team->reduceReleased.notify_all();
 }
 }
@@ -0,0 +1,286 @@
+#include <faabric/executor/ExecutorContext.h>
+#include <faabric/state/State.h>
+#include <faabric/util/logging.h>
+#include <wasm/state.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace wasm {
+
+std::shared_ptr<faabric::state::StateKeyValue> getStateKV(
+  const std::string& key,
+  size_t size)
+{
+    std::string user =
+      faabric::executor::ExecutorContext::get()->getMsg().user();
+    faabric::state::State& state = faabric::state::getGlobalState();
+    if (size > 0) {
+        return state.getKV(user, key, size);
+    }
+
+    return state.getKV(user, key);
+}
+
+// Groups the entries of a batch by key, keeping the order of the entries for
+// each key, and of the keys' first appearance
+static std::vector<std::vector<size_t>> groupByKey(
+  const std::vector<StateBatchEntry>& entries)
+{
+    std::vector<std::vector<size_t>> groups;
+    std::unordered_map<std::string, size_t> groupIdxs;
+    for (size_t i = 0; i < entries.size(); i++) {
+        auto [it, isNew] = groupIdxs.try_emplace(entries.at(i).key, 0);
+        if (isNew) {
+            it->second = groups.size();
+            groups.emplace_back();
+        }
+
+        groups.at(it->second).push_back(i);
+    }
+
+    return groups;
+}
+
+// The tasks of one batch, which the calling thread and any pool threads that
+// join in take in turn. Pool threads may only pick the batch up once the
+// caller has finished it, in which case they leave it alone
+struct StateBatchJob
+{
+    const std::function<void(size_t)>* task = nullptr;
+    size_t nTasks = 0;
+    std::atomic<size_t> nextTask = 0;
+
+    std::mutex mx;
+    std::condition_variable cv;
+    size_t nActive = 0;
+    bool closed = false;
+    std::exception_ptr error = nullptr;
+
+    void runTasks()
+    {
+        size_t i;
+        while ((i = nextTask.fetch_add(1)) < nTasks) {
+            try {
+                (*task)(i);
+            } catch (...) {
+                std::unique_lock<std::mutex> lock(mx);
+                if (error == nullptr) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    }
+
+    void join()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mx);
+            if (closed) {
+                return;
+            }
+            nActive++;
+        }
+
+        runTasks();
+
+        {
+            std::unique_lock<std::mutex> lock(mx);
+            nActive--;
+        }
+        cv.notify_all();
+    }
+
+    // Stops any more threads joining, and waits for those that have
+    void close()
+    {
+        std::unique_lock<std::mutex> lock(mx);
+        closed = true;
+        cv.wait(lock, [this] { return nActive == 0; });
+    }
+};
+
+// Threads shared by all batches, started on first use, so that batches don't
+// pay for starting threads of their own
+class StateBatchPool
+{
+  public:
+    StateBatchPool()
+    {
+        for (int t = 1; t < STATE_BATCH_MAX_THREADS; t++) {
+            threads.emplace_back([this] { work(); });
+        }
+    }
+
+    ~StateBatchPool()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mx);
+            shutdown = true;
+        }
+        cv.notify_all();
+
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    void post(std::shared_ptr<StateBatchJob> job, size_t nThreads)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mx);
+            for (size_t t = 0; t < nThreads; t++) {
+                jobs.push_back(job);
+            }
+        }
+        cv.notify_all();
+    }
+
+  private:
+    std::mutex mx;
+    std::condition_variable cv;
+    std::deque<std::shared_ptr<StateBatchJob>> jobs;
+    bool shutdown = false;
+
+    std::vector<std::thread> threads;
+
+    void work()
+    {
+        while (true) {
+            std::shared_ptr<StateBatchJob> job;
+            {
+                std::unique_lock<std::mutex> lock(mx);
+                cv.wait(lock, [this] { return shutdown || !jobs.empty(); });
+                if (shutdown) {
+                    return;
+                }
+
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            job->join();
+        }
+    }
+};
+
+static StateBatchPool& getStateBatchPool()
+{
+    static StateBatchPool pool;
+    return pool;
+}
+
+// Runs the task for each index, on this thread and up to a handful from the
+// pool, rethrowing the first error once they have all finished
+static void runConcurrently(size_t nTasks,
+                            const std::function<void(size_t)>& task)
+{
+    if (nTasks == 0) {
+        return;
+    }
+
+    size_t nThreads = std::min<size_t>(nTasks, STATE_BATCH_MAX_THREADS);
+    if (nThreads == 1) {
+        for (size_t i = 0; i < nTasks; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    auto job = std::make_shared<StateBatchJob>();
+    job->task = &task;
+    job->nTasks = nTasks;
+    getStateBatchPool().post(job, nThreads - 1);
+
+    // This thread does its share too, and is the only one guaranteed to
+    // take part if the pool is busy with other batches
+    job->join();
+    job->close();
+
+    if (job->error != nullptr) {
+        std::rethrow_exception(job->error);
+    }
+}
+
+static bool isWholeValue(const StateBatchEntry& entry)
+{
+    return entry.offset == 0 && entry.len == entry.totalLen;
+}
+
+void doFaasmReadStateBatch(const std::string& user,
+                           const std::vector<StateBatchEntry>& entries)
+{
+    SPDLOG_DEBUG("S - read_state_batch - {} entries", entries.size());
+
+    faabric::state::State& state = faabric::state::getGlobalState();
+    std::vector<std::vector<size_t>> groups = groupByKey(entries);
+    runConcurrently(groups.size(), [&](size_t g) {
+        for (size_t i : groups.at(g)) {
+            const StateBatchEntry& entry = entries.at(i);
+            auto kv = state.getKV(user, entry.key, entry.totalLen);
+            if (isWholeValue(entry)) {
+                kv->get(entry.buffer);
+            } else {
+                kv->getChunk(entry.offset, entry.buffer, entry.len);
+            }
+        }
+    });
+}
+
+void doFaasmWriteStateBatch(const std::string& user,
+                            const std::vector<StateBatchEntry>& entries)
+{
+    SPDLOG_DEBUG("S - write_state_batch - {} entries", entries.size());
+
+    faabric::state::State& state = faabric::state::getGlobalState();
+    std::vector<std::vector<size_t>> groups = groupByKey(entries);
+    runConcurrently(groups.size(), [&](size_t g) {
+        for (size_t i : groups.at(g)) {
+            const StateBatchEntry& entry = entries.at(i);
+            auto kv = state.getKV(user, entry.key, entry.totalLen);
+            if (isWholeValue(entry)) {
+                kv->set(entry.buffer);
+            } else {
+                kv->setChunk(entry.offset, entry.buffer, entry.len);
+            }
+        }
+    });
+}
+
+void doFaasmPushStateBatch(const std::string& user,
+                           const std::vector<std::string>& keys,
+                           bool partial)
+{
+    SPDLOG_DEBUG("S - push_state_batch - {} keys (partial {})",
+                 keys.size(),
+                 partial);
+
+    // Each key only needs pushing once
+    std::vector<std::string> uniqueKeys;
+    std::unordered_set<std::string> seen;
+    for (const auto& key : keys) {
+        if (seen.insert(key).second) {
+            uniqueKeys.push_back(key);
+        }
+    }
+
+    faabric::state::State& state = faabric::state::getGlobalState();
+    runConcurrently(uniqueKeys.size(), [&](size_t i) {
+        auto kv = state.getKV(user, uniqueKeys.at(i));
+        if (partial) {
+            kv->pushPartial();
+        } else {
+            kv->pushFull();
+        }
+    });
+}
+}
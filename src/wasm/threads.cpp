@@ -24,7 +24,10 @@ int32_t doPthreadCreate(int32_t pthreadPtr,
     pthreadCall.entryFunc = entryFunc;
     pthreadCall.argsPtr = argsPtr;
 
-    getExecutingModule()->queuePthreadCall(pthreadCall);
+    // Threads start running straight away, rather than waiting to be joined
+    faabric::Message* call =
+      &faabric::executor::ExecutorContext::get()->getMsg();
+    getExecutingModule()->dispatchPthreadCall(call, pthreadCall);
 
     return 0;
 }
@@ -48,10 +51,19 @@ int32_t doPthreadJoin(int32_t pthreadPtr)
     return returnValue;
 }
 
+int32_t doPthreadDetach(int32_t pthreadPtr)
+{
+    SPDLOG_DEBUG("S - pthread_detach - {}", pthreadPtr);
+
+    getExecutingModule()->detachPthreadCall(pthreadPtr);
+
+    return 0;
+}
+
 int32_t doPthreadMutexLock(int32_t mutex)
 {
     SPDLOG_TRACE("S - pthread_mutex_lock {}", mutex);
-    getExecutingModule()->getOrCreatePthreadMutex(mutex)->lock();
+    getExecutingModule()->getOrCreatePthreadSyncObject(mutex)->mx.lock();
 
     return 0;
 }
@@ -60,8 +72,9 @@ int32_t doPthreadMutexTryLock(int32_t mutex)
 {
     SPDLOG_TRACE("S - pthread_mutex_trylock {}", mutex);
 
-    bool success =
-      getExecutingModule()->getOrCreatePthreadMutex(mutex)->try_lock();
+    threads::GuestSyncObject* mutexObj =
+      getExecutingModule()->getOrCreatePthreadSyncObject(mutex);
+    bool success = mutexObj->mx.try_lock();
 
     if (!success) {
         return EBUSY;
@@ -73,7 +86,52 @@ int32_t doPthreadMutexTryLock(int32_t mutex)
 int32_t doPthreadMutexUnlock(int32_t mutex)
 {
     SPDLOG_TRACE("S - pthread_mutex_unlock {}", mutex);
-    getExecutingModule()->getPthreadMutex(mutex)->unlock();
+    getExecutingModule()->getPthreadSyncObject(mutex)->mx.unlock();
+
+    return 0;
+}
+
+// Condition variables are futex-style: waiters block on a sequence number that
+// is bumped by each signal, so a signal sent between a waiter unlocking the
+// mutex and blocking is not lost. As with pthreads, waiters may wake
+// spuriously, so guest code must check its condition in a loop
+int32_t doPthreadCondWait(int32_t cond, int32_t mutex)
+{
+    SPDLOG_TRACE("S - pthread_cond_wait {} {}", cond, mutex);
+
+    WasmModule* module = getExecutingModule();
+    threads::GuestSyncObject* condObj =
+      module->getOrCreatePthreadSyncObject(cond);
+    threads::GuestSyncObject* mutexObj = module->getPthreadSyncObject(mutex);
+
+    uint32_t seq = condObj->condSeq.load(std::memory_order_acquire);
+    mutexObj->mx.unlock();
+    condObj->condSeq.wait(seq, std::memory_order_acquire);
+    mutexObj->mx.lock();
+
+    return 0;
+}
+
+int32_t doPthreadCondSignal(int32_t cond)
+{
+    SPDLOG_TRACE("S - pthread_cond_signal {}", cond);
+
+    threads::GuestSyncObject* condObj =
+      getExecutingModule()->getOrCreatePthreadSyncObject(cond);
+    condObj->condSeq.fetch_add(1, std::memory_order_release);
+    condObj->condSeq.notify_one();
+
+    return 0;
+}
+
+int32_t doPthreadCondBroadcast(int32_t cond)
+{
+    SPDLOG_TRACE("S - pthread_cond_broadcast {}", cond);
+
+    threads::GuestSyncObject* condObj =
+      getExecutingModule()->getOrCreatePthreadSyncObject(cond);
+    condObj->condSeq.fetch_add(1, std::memory_order_release);
+    condObj->condSeq.notify_all();
 
     return 0;
 }
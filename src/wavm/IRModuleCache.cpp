@@ -115,12 +115,16 @@ Runtime::ModuleRef IRModuleCache::getCompiledMainModule(const std::string& user,
 
             storage::FileLoader& functionLoader = storage::getFileLoader();
             faabric::Message msg = faabric::util::messageFactory(user, func);
-            std::vector<uint8_t> objectFileBytes =
-              functionLoader.loadFunctionObjectFile(msg);
-
-            if (!objectFileBytes.empty()) {
-                compiledModuleMap[key] =
-                  Runtime::loadPrecompiledModule(module, objectFileBytes);
+            std::shared_ptr<storage::MappedFile> objectFile =
+              functionLoader.mapFunctionObjectFile(msg);
+
+            if (objectFile->size() > 0) {
+                // WAVM keeps its own copy of the object code, so we read it
+                // straight from the mapped file
+                std::span<const uint8_t> objectBytes = objectFile->getSpan();
+                compiledModuleMap[key] = Runtime::loadPrecompiledModule(
+                  module,
+                  std::vector<uint8_t>(objectBytes.begin(), objectBytes.end()));
             } else {
                 compiledModuleMap[key] = Runtime::compileModule(module);
             }
@@ -148,10 +152,12 @@ Runtime::ModuleRef IRModuleCache::getCompiledSharedModule(
             IR::Module& module = getModuleFromMap(key);
 
             storage::FileLoader& functionLoader = storage::getFileLoader();
-            std::vector<uint8_t> objectBytes =
-              functionLoader.loadSharedObjectObjectFile(path);
-            compiledModuleMap[key] =
-              Runtime::loadPrecompiledModule(module, objectBytes);
+            std::shared_ptr<storage::MappedFile> objectFile =
+              functionLoader.mapSharedObjectObjectFile(path);
+            std::span<const uint8_t> objectBytes = objectFile->getSpan();
+            compiledModuleMap[key] = Runtime::loadPrecompiledModule(
+              module,
+              std::vector<uint8_t>(objectBytes.begin(), objectBytes.end()));
         }
     } else {
         SPDLOG_DEBUG(
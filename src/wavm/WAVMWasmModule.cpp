@@ -83,6 +83,11 @@ void WAVMWasmModule::reset(faabric::Message& msg,
     if (!_isBound) {
         return;
     }
+
+    // Pthreads take the reset lock to execute, so they must be awaited first
+    clearPthreadCalls();
+    pthreadSyncObjects.clear();
+
     faabric::util::FullLock moduleLock(resetMx);
 
     assert(msg.user() == boundUser);
@@ -90,6 +95,7 @@ void WAVMWasmModule::reset(faabric::Message& msg,
 
     std::string funcStr = faabric::util::funcToString(msg, true);
     SPDLOG_DEBUG("Resetting after {} (snap key {})", funcStr, snapshotKey);
+
     auto [cachedModule, cacheLock] =
       wasm::getWAVMModuleCache().getCachedModule(msg);
 
@@ -240,6 +246,7 @@ void WAVMWasmModule::clone(const WAVMWasmModule& other,
             uint8_t* memoryBase = getMemoryBase();
             data->mapToMemory({ memoryBase, data->getSize() });
         }
+        mappedSnapshotKey = snapshotKey;
 
         // Reset shared memory variables
         sharedMemWasmPtrs = other.sharedMemWasmPtrs;
@@ -1051,6 +1058,10 @@ U32 WAVMWasmModule::mmapFile(U32 fd, size_t length)
         throw std::runtime_error("Unable to map file into required location");
     }
 
+    // File-backed pages look unmodified when diffing against the snapshot
+    // memory is mapped from, so we must diff every page from now on
+    mappedSnapshotKey.clear();
+
     return wasmPtr;
 }
 
@@ -2,6 +2,7 @@
 
 #include <WAVM/IR/Module.h>
 #include <WAVM/IR/Types.h>
+#include <WAVM/LLVMJIT/LLVMJIT.h>
 #include <WAVM/Runtime/Runtime.h>
 #include <WAVM/WASM/WASM.h>
 #include <WAVM/WASTParse/WASTParse.h>
@@ -12,7 +13,8 @@
 using namespace WAVM;
 
 namespace wasm {
-std::vector<uint8_t> wavmCodegen(std::vector<uint8_t>& bytes)
+std::vector<uint8_t> wavmCodegen(std::vector<uint8_t>& bytes,
+                                 const std::string& targetCpu)
 {
 
     IR::Module moduleIR;
@@ -43,7 +45,21 @@ std::vector<uint8_t> wavmCodegen(std::vector<uint8_t>& bytes)
         }
     }
 
-    // Compile the module to object code
+    // Compile the module to object code for the given CPU if set
+    if (!targetCpu.empty()) {
+        LLVMJIT::TargetSpec targetSpec = LLVMJIT::getHostTargetSpec();
+        targetSpec.cpu = targetCpu;
+
+        if (LLVMJIT::validateTarget(targetSpec, moduleIR.featureSpec) !=
+            LLVMJIT::TargetValidationResult::valid) {
+            SPDLOG_ERROR("Invalid WAVM codegen target CPU: {}", targetCpu);
+            throw std::runtime_error("Invalid codegen target CPU");
+        }
+
+        SPDLOG_DEBUG("WAVM codegen targeting CPU {}", targetCpu);
+        return LLVMJIT::compileModule(moduleIR, targetSpec);
+    }
+
     Runtime::ModuleRef module = Runtime::compileModule(moduleIR);
     std::vector<uint8_t> objBytes = Runtime::getObjectCode(module);
     return objBytes;
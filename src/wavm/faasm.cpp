@@ -13,6 +13,7 @@
 #include <wasm/faasm.h>
 #include <wasm/host_interface_test.h>
 #include <wasm/migration.h>
+#include <wasm/state.h>
 #include <wavm/WAVMWasmModule.h>
 
 #include <WAVM/Platform/Diagnostics.h>
@@ -395,6 +396,163 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
     kv->flagChunkDirty(offset, len);
 }
 
+// Reads the keys and buffers of a batched state call out of the arrays of
+// pointers and lengths passed in. Without offsets, each entry covers the
+// whole value
+static std::vector<StateBatchEntry> getStateBatch(I32 nKeys,
+                                                  I32 keyPtrsPtr,
+                                                  I32 bufferPtrsPtr,
+                                                  I32 lensPtr,
+                                                  I32 totalLensPtr = 0,
+                                                  I32 offsetsPtr = 0)
+{
+    if (nKeys < 0) {
+        SPDLOG_ERROR("Invalid number of keys for state batch: {}", nKeys);
+        throw std::runtime_error("Invalid number of keys for state batch");
+    }
+
+    Runtime::Memory* memoryPtr = getExecutingWAVMModule()->defaultMemory;
+    I32* keyPtrs =
+      Runtime::memoryArrayPtr<I32>(memoryPtr, (Uptr)keyPtrsPtr, (Uptr)nKeys);
+    I32* bufferPtrs =
+      Runtime::memoryArrayPtr<I32>(memoryPtr, (Uptr)bufferPtrsPtr, (Uptr)nKeys);
+    I32* lens =
+      Runtime::memoryArrayPtr<I32>(memoryPtr, (Uptr)lensPtr, (Uptr)nKeys);
+
+    I32* totalLens = nullptr;
+    I32* offsets = nullptr;
+    if (offsetsPtr != 0) {
+        totalLens = Runtime::memoryArrayPtr<I32>(
+          memoryPtr, (Uptr)totalLensPtr, (Uptr)nKeys);
+        offsets = Runtime::memoryArrayPtr<I32>(
+          memoryPtr, (Uptr)offsetsPtr, (Uptr)nKeys);
+    }
+
+    std::vector<StateBatchEntry> entries(nKeys);
+    for (I32 i = 0; i < nKeys; i++) {
+        StateBatchEntry& entry = entries.at(i);
+        entry.key = getStringFromWasm(keyPtrs[i]);
+        entry.buffer = Runtime::memoryArrayPtr<U8>(
+          memoryPtr, (Uptr)bufferPtrs[i], (Uptr)lens[i]);
+        entry.len = lens[i];
+        entry.totalLen = offsets == nullptr ? lens[i] : totalLens[i];
+        entry.offset = offsets == nullptr ? 0 : offsets[i];
+    }
+
+    return entries;
+}
+
+static std::vector<std::string> getStateBatchKeys(I32 nKeys, I32 keyPtrsPtr)
+{
+    if (nKeys < 0) {
+        SPDLOG_ERROR("Invalid number of keys for state batch: {}", nKeys);
+        throw std::runtime_error("Invalid number of keys for state batch");
+    }
+
+    Runtime::Memory* memoryPtr = getExecutingWAVMModule()->defaultMemory;
+    I32* keyPtrs =
+      Runtime::memoryArrayPtr<I32>(memoryPtr, (Uptr)keyPtrsPtr, (Uptr)nKeys);
+
+    std::vector<std::string> keys;
+    for (I32 i = 0; i < nKeys; i++) {
+        keys.push_back(getStringFromWasm(keyPtrs[i]));
+    }
+
+    return keys;
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__faasm_read_state_batch",
+                               void,
+                               __faasm_read_state_batch,
+                               I32 keyPtrsPtr,
+                               I32 bufferPtrsPtr,
+                               I32 bufferLensPtr,
+                               I32 nKeys)
+{
+    std::string user = ExecutorContext::get()->getMsg().user();
+    doFaasmReadStateBatch(
+      user, getStateBatch(nKeys, keyPtrsPtr, bufferPtrsPtr, bufferLensPtr));
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__faasm_read_state_offset_batch",
+                               void,
+                               __faasm_read_state_offset_batch,
+                               I32 keyPtrsPtr,
+                               I32 totalLensPtr,
+                               I32 offsetsPtr,
+                               I32 bufferPtrsPtr,
+                               I32 bufferLensPtr,
+                               I32 nKeys)
+{
+    std::string user = ExecutorContext::get()->getMsg().user();
+    doFaasmReadStateBatch(user,
+                          getStateBatch(nKeys,
+                                        keyPtrsPtr,
+                                        bufferPtrsPtr,
+                                        bufferLensPtr,
+                                        totalLensPtr,
+                                        offsetsPtr));
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__faasm_write_state_batch",
+                               void,
+                               __faasm_write_state_batch,
+                               I32 keyPtrsPtr,
+                               I32 bufferPtrsPtr,
+                               I32 bufferLensPtr,
+                               I32 nKeys)
+{
+    std::string user = ExecutorContext::get()->getMsg().user();
+    doFaasmWriteStateBatch(
+      user, getStateBatch(nKeys, keyPtrsPtr, bufferPtrsPtr, bufferLensPtr));
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__faasm_write_state_offset_batch",
+                               void,
+                               __faasm_write_state_offset_batch,
+                               I32 keyPtrsPtr,
+                               I32 totalLensPtr,
+                               I32 offsetsPtr,
+                               I32 bufferPtrsPtr,
+                               I32 bufferLensPtr,
+                               I32 nKeys)
+{
+    std::string user = ExecutorContext::get()->getMsg().user();
+    doFaasmWriteStateBatch(user,
+                           getStateBatch(nKeys,
+                                         keyPtrsPtr,
+                                         bufferPtrsPtr,
+                                         bufferLensPtr,
+                                         totalLensPtr,
+                                         offsetsPtr));
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__faasm_push_state_batch",
+                               void,
+                               __faasm_push_state_batch,
+                               I32 keyPtrsPtr,
+                               I32 nKeys)
+{
+    std::string user = ExecutorContext::get()->getMsg().user();
+    doFaasmPushStateBatch(user, getStateBatchKeys(nKeys, keyPtrsPtr), false);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__faasm_push_state_partial_batch",
+                               void,
+                               __faasm_push_state_partial_batch,
+                               I32 keyPtrsPtr,
+                               I32 nKeys)
+{
+    std::string user = ExecutorContext::get()->getMsg().user();
+    doFaasmPushStateBatch(user, getStateBatchKeys(nKeys, keyPtrsPtr), true);
+}
+
 I32 _readInputImpl(I32 bufferPtr, I32 bufferLen)
 {
     // Write to the wasm buffer
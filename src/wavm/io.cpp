@@ -331,16 +331,14 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
                                I32 resBytesWrittenPtr)
 {
     storage::FileSystem& fileSystem = getExecutingWAVMModule()->getFileSystem();
-    std::string path = fileSystem.getPathForFd(fd);
+    storage::FileDescriptor& fileDesc = fileSystem.getFileDescriptor(fd);
 
     SPDLOG_TRACE("S - fd_write - {} {} {} {} ({})",
                  fd,
                  iovecsPtr,
                  iovecCount,
                  resBytesWrittenPtr,
-                 path);
-
-    storage::FileDescriptor& fileDesc = fileSystem.getFileDescriptor(fd);
+                 fileDesc.getPath());
 
     auto nativeIovecs = wasiIovecsToNativeIovecs(iovecsPtr, iovecCount);
     ssize_t bytesWritten = fileDesc.write(nativeIovecs, iovecCount);
@@ -373,12 +371,14 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
 {
     PROF_START(FdRead)
     storage::FileSystem& fileSystem = getExecutingWAVMModule()->getFileSystem();
-    std::string path = fileSystem.getPathForFd(fd);
+    storage::FileDescriptor& fileDesc = fileSystem.getFileDescriptor(fd);
 
-    SPDLOG_TRACE(
-      "S - fd_read - {} {} {} ({})", fd, iovecsPtr, iovecCount, path);
+    SPDLOG_TRACE("S - fd_read - {} {} {} ({})",
+                 fd,
+                 iovecsPtr,
+                 iovecCount,
+                 fileDesc.getPath());
 
-    storage::FileDescriptor& fileDesc = fileSystem.getFileDescriptor(fd);
     auto nativeIovecs = wasiIovecsToNativeIovecs(iovecsPtr, iovecCount);
 
     int bytesRead =
@@ -567,10 +567,10 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
 {
 
     storage::FileSystem& fileSystem = getExecutingWAVMModule()->getFileSystem();
-    std::string path = fileSystem.getPathForFd(fd);
-    SPDLOG_DEBUG("S - fd_fdstat_get - {} {} ({})", fd, statPtr, path);
-
     storage::FileDescriptor& fileDesc = fileSystem.getFileDescriptor(fd);
+    SPDLOG_DEBUG(
+      "S - fd_fdstat_get - {} {} ({})", fd, statPtr, fileDesc.getPath());
+
     storage::Stat statResult = fileDesc.stat();
 
     if (statResult.failed) {
@@ -970,52 +970,117 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
                                "fd_pwrite",
                                I32,
                                wasi_fd_pwrite,
-                               I32 a,
-                               I32 b,
-                               I32 c,
-                               I64 d,
-                               I32 e)
+                               I32 fd,
+                               I32 iovecsPtr,
+                               I32 iovecCount,
+                               I64 offset,
+                               I32 resBytesWrittenPtr)
 {
-    throwException(Runtime::ExceptionTypes::calledUnimplementedIntrinsic);
+    storage::FileSystem& fileSystem = getExecutingWAVMModule()->getFileSystem();
+    if (!fileSystem.fileDescriptorExists(fd)) {
+        return __WASI_EBADF;
+    }
+
+    storage::FileDescriptor& fileDesc = fileSystem.getFileDescriptor(fd);
+    SPDLOG_TRACE("S - fd_pwrite - {} {} {} {} ({})",
+                 fd,
+                 iovecsPtr,
+                 iovecCount,
+                 offset,
+                 fileDesc.getPath());
+
+    auto nativeIovecs = wasiIovecsToNativeIovecs(iovecsPtr, iovecCount);
+    ssize_t bytesWritten = fileDesc.pwrite(nativeIovecs, iovecCount, offset);
+    if (bytesWritten < 0) {
+        return fileDesc.getWasiErrno();
+    }
+
+    Runtime::memoryRef<int32_t>(getExecutingWAVMModule()->defaultMemory,
+                                resBytesWrittenPtr) = bytesWritten;
+
+    return __WASI_ESUCCESS;
 }
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
                                "fd_pread",
                                I32,
                                wasi_fd_pread,
-                               I32 a,
-                               I32 b,
-                               I32 c,
-                               I64 d,
-                               I32 e)
+                               I32 fd,
+                               I32 iovecsPtr,
+                               I32 iovecCount,
+                               I64 offset,
+                               I32 resBytesReadPtr)
 {
-    throwException(Runtime::ExceptionTypes::calledUnimplementedIntrinsic);
+    storage::FileSystem& fileSystem = getExecutingWAVMModule()->getFileSystem();
+    if (!fileSystem.fileDescriptorExists(fd)) {
+        return __WASI_EBADF;
+    }
+
+    storage::FileDescriptor& fileDesc = fileSystem.getFileDescriptor(fd);
+    SPDLOG_TRACE("S - fd_pread - {} {} {} {} ({})",
+                 fd,
+                 iovecsPtr,
+                 iovecCount,
+                 offset,
+                 fileDesc.getPath());
+
+    auto nativeIovecs = wasiIovecsToNativeIovecs(iovecsPtr, iovecCount);
+    ssize_t bytesRead = fileDesc.pread(nativeIovecs, iovecCount, offset);
+    if (bytesRead < 0) {
+        return fileDesc.getWasiErrno();
+    }
+
+    Runtime::memoryRef<int32_t>(getExecutingWAVMModule()->defaultMemory,
+                                resBytesReadPtr) = bytesRead;
+
+    return __WASI_ESUCCESS;
 }
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
                                "fd_filestat_set_size",
                                I32,
                                wasi_fd_filestat_set_size,
-                               I32 a,
-                               I64 b)
+                               I32 fd,
+                               I64 size)
 {
-    throwException(Runtime::ExceptionTypes::calledUnimplementedIntrinsic);
+    SPDLOG_DEBUG("S - fd_filestat_set_size - {} {}", fd, size);
+
+    storage::FileSystem& fileSystem = getExecutingWAVMModule()->getFileSystem();
+    if (!fileSystem.fileDescriptorExists(fd)) {
+        return __WASI_EBADF;
+    }
+
+    return fileSystem.getFileDescriptor(fd).setSize(size);
 }
 
-WAVM_DEFINE_INTRINSIC_FUNCTION(wasi, "fd_sync", I32, wasi_fd_sync, I32 a)
+WAVM_DEFINE_INTRINSIC_FUNCTION(wasi, "fd_sync", I32, wasi_fd_sync, I32 fd)
 {
-    throwException(Runtime::ExceptionTypes::calledUnimplementedIntrinsic);
+    SPDLOG_DEBUG("S - fd_sync - {}", fd);
+
+    storage::FileSystem& fileSystem = getExecutingWAVMModule()->getFileSystem();
+    if (!fileSystem.fileDescriptorExists(fd)) {
+        return __WASI_EBADF;
+    }
+
+    return fileSystem.getFileDescriptor(fd).sync();
 }
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
                                "fd_allocate",
                                I32,
                                wasi_fd_allocate,
-                               I32 a,
-                               I64 b,
-                               I64 c)
+                               I32 fd,
+                               I64 offset,
+                               I64 len)
 {
-    throwException(Runtime::ExceptionTypes::calledUnimplementedIntrinsic);
+    SPDLOG_DEBUG("S - fd_allocate - {} {} {}", fd, offset, len);
+
+    storage::FileSystem& fileSystem = getExecutingWAVMModule()->getFileSystem();
+    if (!fileSystem.fileDescriptorExists(fd)) {
+        return __WASI_EBADF;
+    }
+
+    return fileSystem.getFileDescriptor(fd).allocate(offset, len);
 }
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
@@ -8,6 +8,7 @@
 #include <faabric/util/gids.h>
 #include <faabric/util/logging.h>
 #include <wasm/WasmModule.h>
+#include <wasm/mpi.h>
 #include <wavm/WAVMWasmModule.h>
 
 #include <WAVM/Runtime/Intrinsics.h>
@@ -328,8 +329,9 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
 
     ctx->checkMpiComm(comm);
     faabric_datatype_t* hostDtype = ctx->getFaasmDataType(datatype);
-    auto inputs = Runtime::memoryArrayPtr<uint8_t>(ctx->memory, buffer, count);
-    ctx->world.send(ctx->rank, destRank, inputs, hostDtype, count);
+    auto inputs = Runtime::memoryArrayPtr<uint8_t>(
+      ctx->memory, buffer, count * hostDtype->size);
+    doMpiSend(ctx->world, ctx->rank, destRank, inputs, hostDtype, count);
 
     return 0;
 }
@@ -365,6 +367,7 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
 int terminateMpi()
 {
     // Destroy the MPI world
+    doMpiFinalize(ctx->world, ctx->rank);
     ctx->world.destroy();
 
     // Null-out the context
@@ -400,9 +403,10 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
     ctx->checkMpiComm(comm);
     faabric_datatype_t* hostDtype = ctx->getFaasmDataType(datatype);
 
-    auto inputs = Runtime::memoryArrayPtr<uint8_t>(ctx->memory, buffer, count);
+    auto inputs = Runtime::memoryArrayPtr<uint8_t>(
+      ctx->memory, buffer, count * hostDtype->size);
     int requestId =
-      ctx->world.isend(ctx->rank, destRank, inputs, hostDtype, count);
+      doMpiIsend(ctx->world, ctx->rank, destRank, inputs, hostDtype, count);
 
     ctx->writeFaasmRequestId(requestPtrPtr, requestId);
 
@@ -466,8 +470,10 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
     MPI_Status* status =
       &Runtime::memoryRef<MPI_Status>(ctx->memory, statusPtr);
     faabric_datatype_t* hostDtype = ctx->getFaasmDataType(datatype);
-    auto outputs = Runtime::memoryArrayPtr<uint8_t>(ctx->memory, buffer, count);
-    ctx->world.recv(sourceRank, ctx->rank, outputs, hostDtype, count, status);
+    auto outputs = Runtime::memoryArrayPtr<uint8_t>(
+      ctx->memory, buffer, count * hostDtype->size);
+    doMpiRecv(
+      ctx->world, ctx->rank, sourceRank, outputs, hostDtype, count, status);
 
     return 0;
 }
@@ -516,16 +522,17 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
     auto hostRecvBuffer = Runtime::memoryArrayPtr<uint8_t>(
       ctx->memory, recvBuf, recvCount * hostRecvDtype->size);
 
-    ctx->world.sendRecv(hostSendBuffer,
-                        sendCount,
-                        hostSendDtype,
-                        destination,
-                        hostRecvBuffer,
-                        recvCount,
-                        hostRecvDtype,
-                        source,
-                        ctx->rank,
-                        status);
+    doMpiSendRecv(ctx->world,
+                  ctx->rank,
+                  hostSendBuffer,
+                  sendCount,
+                  hostSendDtype,
+                  destination,
+                  hostRecvBuffer,
+                  recvCount,
+                  hostRecvDtype,
+                  source,
+                  status);
 
     return MPI_SUCCESS;
 }
@@ -556,9 +563,10 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
 
     ctx->checkMpiComm(comm);
     faabric_datatype_t* hostDtype = ctx->getFaasmDataType(datatype);
-    auto outputs = Runtime::memoryArrayPtr<uint8_t>(ctx->memory, buffer, count);
+    auto outputs = Runtime::memoryArrayPtr<uint8_t>(
+      ctx->memory, buffer, count * hostDtype->size);
     int requestId =
-      ctx->world.irecv(sourceRank, ctx->rank, outputs, hostDtype, count);
+      doMpiIrecv(ctx->world, ctx->rank, sourceRank, outputs, hostDtype, count);
 
     ctx->writeFaasmRequestId(requestPtrPtr, requestId);
 
@@ -578,7 +586,7 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
     int requestId = ctx->getFaasmRequestId(requestPtrPtr);
 
     MPI_FUNC_ARGS("S - MPI_Wait {} {}", requestPtrPtr, requestId);
-    ctx->world.awaitAsyncRequest(requestId);
+    doMpiAwait(ctx->world, requestId);
 
     return MPI_SUCCESS;
 }
@@ -652,7 +660,7 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
     ctx->checkMpiComm(comm);
     MPI_Status* status =
       &Runtime::memoryRef<MPI_Status>(ctx->memory, statusPtr);
-    ctx->world.probe(source, ctx->rank, status);
+    doMpiProbe(ctx->world, ctx->rank, source, status);
 
     return MPI_SUCCESS;
 }
@@ -679,12 +687,7 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
     auto inputs = Runtime::memoryArrayPtr<uint8_t>(
       ctx->memory, buffer, count * hostDtype->size);
 
-    ctx->world.broadcast(root,
-                         ctx->rank,
-                         inputs,
-                         hostDtype,
-                         count,
-                         faabric::mpi::MpiMessageType::BROADCAST);
+    doMpiBroadcast(ctx->world, ctx->rank, root, inputs, hostDtype, count);
 
     return MPI_SUCCESS;
 }
@@ -994,20 +997,25 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
     faabric_datatype_t* hostDtype = ctx->getFaasmDataType(datatype);
     faabric_op_t* hostOp = ctx->getFaasmOp(op);
 
-    auto* hostRecvBuffer =
-      Runtime::memoryArrayPtr<uint8_t>(ctx->memory, recvBuf, count);
+    auto* hostRecvBuffer = Runtime::memoryArrayPtr<uint8_t>(
+      ctx->memory, recvBuf, count * hostDtype->size);
 
     // Check if we're operating in-place
     uint8_t* hostSendBuffer;
     if (isInPlace(sendBuf)) {
         hostSendBuffer = hostRecvBuffer;
     } else {
-        hostSendBuffer =
-          Runtime::memoryArrayPtr<uint8_t>(ctx->memory, sendBuf, count);
+        hostSendBuffer = Runtime::memoryArrayPtr<uint8_t>(
+          ctx->memory, sendBuf, count * hostDtype->size);
     }
 
-    ctx->world.allReduce(
-      ctx->rank, hostSendBuffer, hostRecvBuffer, hostDtype, count, hostOp);
+    doMpiAllReduce(ctx->world,
+                   ctx->rank,
+                   hostSendBuffer,
+                   hostRecvBuffer,
+                   hostDtype,
+                   count,
+                   hostOp);
 
     return MPI_SUCCESS;
 }
@@ -121,6 +121,30 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
     wasm::doOpenMPSetNumThreads(numThreads);
 }
 
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "omp_set_schedule",
+                               void,
+                               omp_set_schedule,
+                               I32 kind,
+                               I32 chunk)
+{
+    wasm::doOpenMPSetSchedule(kind, chunk);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "omp_get_schedule",
+                               void,
+                               omp_get_schedule,
+                               I32 kindPtr,
+                               I32 chunkPtr)
+{
+    Runtime::Memory* memoryPtr = getExecutingWAVMModule()->defaultMemory;
+    I32* kind = &Runtime::memoryRef<I32>(memoryPtr, kindPtr);
+    I32* chunk = &Runtime::memoryRef<I32>(memoryPtr, chunkPtr);
+
+    wasm::doOpenMPGetSchedule(kind, chunk);
+}
+
 WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                "__kmpc_global_thread_num",
                                I32,
@@ -334,16 +358,225 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
     wasm::doOpenMPForStaticFini(loc, gtid);
 }
 
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__kmpc_dispatch_init_4",
+                               void,
+                               __kmpc_dispatch_init_4,
+                               I32 loc,
+                               I32 gtid,
+                               I32 schedule,
+                               I32 lower,
+                               I32 upper,
+                               I32 stride,
+                               I32 chunk)
+{
+    wasm::doOpenMPDispatchInit4(
+      loc, gtid, schedule, lower, upper, stride, chunk);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__kmpc_dispatch_init_4u",
+                               void,
+                               __kmpc_dispatch_init_4u,
+                               I32 loc,
+                               I32 gtid,
+                               I32 schedule,
+                               I32 lower,
+                               I32 upper,
+                               I32 stride,
+                               I32 chunk)
+{
+    wasm::doOpenMPDispatchInit4u(
+      loc, gtid, schedule, (uint32_t)lower, (uint32_t)upper, stride, chunk);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__kmpc_dispatch_init_8",
+                               void,
+                               __kmpc_dispatch_init_8,
+                               I32 loc,
+                               I32 gtid,
+                               I32 schedule,
+                               I64 lower,
+                               I64 upper,
+                               I64 stride,
+                               I64 chunk)
+{
+    wasm::doOpenMPDispatchInit8(
+      loc, gtid, schedule, lower, upper, stride, chunk);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__kmpc_dispatch_init_8u",
+                               void,
+                               __kmpc_dispatch_init_8u,
+                               I32 loc,
+                               I32 gtid,
+                               I32 schedule,
+                               I64 lower,
+                               I64 upper,
+                               I64 stride,
+                               I64 chunk)
+{
+    wasm::doOpenMPDispatchInit8u(
+      loc, gtid, schedule, (uint64_t)lower, (uint64_t)upper, stride, chunk);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__kmpc_dispatch_next_4",
+                               I32,
+                               __kmpc_dispatch_next_4,
+                               I32 loc,
+                               I32 gtid,
+                               I32 lastIterPtr,
+                               I32 lowerPtr,
+                               I32 upperPtr,
+                               I32 stridePtr)
+{
+    Runtime::Memory* memoryPtr = getExecutingWAVMModule()->defaultMemory;
+    I32* lastIter = &Runtime::memoryRef<I32>(memoryPtr, lastIterPtr);
+    int32_t* lower = &Runtime::memoryRef<int32_t>(memoryPtr, lowerPtr);
+    int32_t* upper = &Runtime::memoryRef<int32_t>(memoryPtr, upperPtr);
+    I32* stride = &Runtime::memoryRef<I32>(memoryPtr, stridePtr);
+
+    return wasm::doOpenMPDispatchNext4(
+      loc, gtid, lastIter, lower, upper, stride);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__kmpc_dispatch_next_4u",
+                               I32,
+                               __kmpc_dispatch_next_4u,
+                               I32 loc,
+                               I32 gtid,
+                               I32 lastIterPtr,
+                               I32 lowerPtr,
+                               I32 upperPtr,
+                               I32 stridePtr)
+{
+    Runtime::Memory* memoryPtr = getExecutingWAVMModule()->defaultMemory;
+    I32* lastIter = &Runtime::memoryRef<I32>(memoryPtr, lastIterPtr);
+    uint32_t* lower = &Runtime::memoryRef<uint32_t>(memoryPtr, lowerPtr);
+    uint32_t* upper = &Runtime::memoryRef<uint32_t>(memoryPtr, upperPtr);
+    I32* stride = &Runtime::memoryRef<I32>(memoryPtr, stridePtr);
+
+    return wasm::doOpenMPDispatchNext4u(
+      loc, gtid, lastIter, lower, upper, stride);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__kmpc_dispatch_next_8",
+                               I32,
+                               __kmpc_dispatch_next_8,
+                               I32 loc,
+                               I32 gtid,
+                               I32 lastIterPtr,
+                               I32 lowerPtr,
+                               I32 upperPtr,
+                               I32 stridePtr)
+{
+    Runtime::Memory* memoryPtr = getExecutingWAVMModule()->defaultMemory;
+    I32* lastIter = &Runtime::memoryRef<I32>(memoryPtr, lastIterPtr);
+    int64_t* lower = &Runtime::memoryRef<int64_t>(memoryPtr, lowerPtr);
+    int64_t* upper = &Runtime::memoryRef<int64_t>(memoryPtr, upperPtr);
+    I64* stride = &Runtime::memoryRef<I64>(memoryPtr, stridePtr);
+
+    return wasm::doOpenMPDispatchNext8(
+      loc, gtid, lastIter, lower, upper, stride);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__kmpc_dispatch_next_8u",
+                               I32,
+                               __kmpc_dispatch_next_8u,
+                               I32 loc,
+                               I32 gtid,
+                               I32 lastIterPtr,
+                               I32 lowerPtr,
+                               I32 upperPtr,
+                               I32 stridePtr)
+{
+    Runtime::Memory* memoryPtr = getExecutingWAVMModule()->defaultMemory;
+    I32* lastIter = &Runtime::memoryRef<I32>(memoryPtr, lastIterPtr);
+    uint64_t* lower = &Runtime::memoryRef<uint64_t>(memoryPtr, lowerPtr);
+    uint64_t* upper = &Runtime::memoryRef<uint64_t>(memoryPtr, upperPtr);
+    I64* stride = &Runtime::memoryRef<I64>(memoryPtr, stridePtr);
+
+    return wasm::doOpenMPDispatchNext8u(
+      loc, gtid, lastIter, lower, upper, stride);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__kmpc_dispatch_fini_4",
+                               void,
+                               __kmpc_dispatch_fini_4,
+                               I32 loc,
+                               I32 gtid)
+{
+    wasm::doOpenMPDispatchFini(loc, gtid);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__kmpc_dispatch_fini_4u",
+                               void,
+                               __kmpc_dispatch_fini_4u,
+                               I32 loc,
+                               I32 gtid)
+{
+    wasm::doOpenMPDispatchFini(loc, gtid);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__kmpc_dispatch_fini_8",
+                               void,
+                               __kmpc_dispatch_fini_8,
+                               I32 loc,
+                               I32 gtid)
+{
+    wasm::doOpenMPDispatchFini(loc, gtid);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__kmpc_dispatch_fini_8u",
+                               void,
+                               __kmpc_dispatch_fini_8u,
+                               I32 loc,
+                               I32 gtid)
+{
+    wasm::doOpenMPDispatchFini(loc, gtid);
+}
+
+// Runs the reduction, calling the compiler-generated reduction function in the
+// calling thread's context
+static I32 startReduce(Runtime::ContextRuntimeData* contextRuntimeData,
+                       faabric::Message* msg,
+                       std::shared_ptr<threads::Level> level,
+                       I32 reduceData,
+                       I32 reduceFunc,
+                       bool barrier)
+{
+    WAVMWasmModule* module = getExecutingWAVMModule();
+    Runtime::Context* ctx =
+      Runtime::getContextFromRuntimeData(contextRuntimeData);
+    Runtime::Function* func = module->getFunctionFromPtr(reduceFunc);
+
+    auto combine = [module, ctx, func](I32 lhs, I32 rhs) {
+        std::vector<IR::UntaggedValue> args = { lhs, rhs };
+        IR::UntaggedValue result;
+        module->executeWasmFunction(ctx, func, args, result);
+    };
+
+    return wasm::doOpenMPStartReduce(msg, level, reduceData, combine, barrier);
+}
+
 /**
- * This function is called to start the critical section required to perform the
- * reduction operation by each thread. It will then call __kmpc_end_reduce (and
- * its nowait equivalent), when it's finished.
- *
- * It seems that in our case, always returning 1 for both kmpc_reduce and
- * kmpc_reduce_nowait gets the right result.
+ * This function is called by each thread to start a reduction. The threads on
+ * each host combine their private reduction variables in a tree, after which
+ * only the root returns 1, then updates the shared variables and calls
+ * __kmpc_end_reduce (or its nowait equivalent). All other threads return 0.
  *
  * In the OpenMP source we can see a more varied set of return values, but these
- * are for cases we don't yet support (notably teams):
+ * are for cases we don't yet support (notably atomic reductions and teams):
  * https://github.com/llvm/llvm-project/blob/main/openmp/runtime/src/kmp_csupport.cpp
  *
  * Note that the reduce vars passed into this function are the *LOCAL* copies
@@ -372,9 +605,12 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                   reduceFunc,
                   lockPtr);
 
-    wasm::doOpenMPStartReduceCritical(
-      msg, level, numReduceVars, reduceVarPtrs, reduceVarsSize);
-    return 1;
+    return startReduce(contextRuntimeData,
+                       msg,
+                       level,
+                       reduceVarPtrs,
+                       reduceFunc,
+                       true);
 }
 
 /**
@@ -401,13 +637,17 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                   reduceFunc,
                   lockPtr);
 
-    wasm::doOpenMPStartReduceCritical(
-      msg, level, numReduceVars, reduceVarPtrs, reduceVarsSize);
-    return 1;
+    return startReduce(contextRuntimeData,
+                       msg,
+                       level,
+                       reduceVarPtrs,
+                       reduceFunc,
+                       false);
 }
 
 /**
- * Finalises a blocking reduce, called by all threads.
+ * Finalises a blocking reduce, called by the thread that returned 1 from
+ * __kmpc_reduce, and releases the others.
  */
 WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                "__kmpc_end_reduce",
@@ -418,11 +658,12 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                I32 lck)
 {
     OMP_FUNC_ARGS("__kmpc_end_reduce {} {} {}", loc, gtid, lck);
-    wasm::doOpenMPEndReduceCritical(msg, true);
+    wasm::doOpenMPEndReduce(msg, true);
 }
 
 /**
- * Finalises a non-blocking reduce, called by all threads
+ * Finalises a non-blocking reduce, called by the thread that returned 1 from
+ * __kmpc_reduce_nowait
  */
 WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                "__kmpc_end_reduce_nowait",
@@ -433,7 +674,7 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                I32 lck)
 {
     OMP_FUNC_ARGS("__kmpc_end_reduce_nowait {} {} {}", loc, gtid, lck);
-    wasm::doOpenMPEndReduceCritical(msg, false);
+    wasm::doOpenMPEndReduce(msg, false);
 }
 
 // ----------------------------------------------
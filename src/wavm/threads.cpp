@@ -248,9 +248,17 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                pthread_cond_signal,
                                I32 a)
 {
-    SPDLOG_TRACE("S - pthread_cond_signal {}", a);
+    return doPthreadCondSignal(a);
+}
 
-    return 0;
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "pthread_cond_wait",
+                               I32,
+                               pthread_cond_wait,
+                               I32 a,
+                               I32 b)
+{
+    return doPthreadCondWait(a, b);
 }
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(env, "pthread_self", I32, pthread_self)
@@ -323,9 +331,7 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                pthread_cond_broadcast,
                                I32 a)
 {
-    SPDLOG_TRACE("S - pthread_cond_broadcast {}", a);
-
-    return 0;
+    return doPthreadCondBroadcast(a);
 }
 
 // --------------------------
@@ -354,16 +360,6 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
     throwException(Runtime::ExceptionTypes::calledUnimplementedIntrinsic);
 }
 
-WAVM_DEFINE_INTRINSIC_FUNCTION(env,
-                               "pthread_cond_wait",
-                               I32,
-                               pthread_cond_wait,
-                               I32 a,
-                               I32 b)
-{
-    throwException(Runtime::ExceptionTypes::calledUnimplementedIntrinsic);
-}
-
 WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                "pthread_attr_init",
                                I32,
@@ -396,9 +392,9 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                "pthread_detach",
                                I32,
                                s__pthread_detach,
-                               I32 a)
+                               I32 pthreadPtr)
 {
-    throwException(Runtime::ExceptionTypes::calledUnimplementedIntrinsic);
+    return doPthreadDetach(pthreadPtr);
 }
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(env,
@@ -0,0 +1,184 @@
+#include "bench_utils.h"
+
+#include <wasm/mpi.h>
+
+#include <faabric/batch-scheduler/SchedulingDecision.h>
+#include <faabric/executor/ExecutorContext.h>
+#include <faabric/mpi/MpiWorld.h>
+#include <faabric/transport/PointToPointBroker.h>
+#include <faabric/util/batch.h>
+#include <faabric/util/config.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/*
+ * Compares MPI_Alltoallv with the workaround programs used before we had it,
+ * i.e. an MPI_Alltoall with every block padded to the largest, after which
+ * each rank trims the padding out of what it received. Both go through the
+ * same transport, with every rank on this host, so the difference is down to
+ * the padding.
+ */
+static const int appId = 1234;
+static const int groupId = 5678;
+
+// Runs each rank on its own thread, as part of the point-to-point group
+static void runRanks(int worldSize, const std::function<void(int)>& f)
+{
+    std::vector<std::thread> threads;
+    for (int rank = 0; rank < worldSize; rank++) {
+        threads.emplace_back([&f, rank] {
+            auto req = faabric::util::batchExecFactory("mpi", "bench", 1);
+            req->mutable_messages(0)->set_groupid(groupId);
+            req->mutable_messages(0)->set_groupidx(rank);
+            faabric::executor::ExecutorContext::set(nullptr, req, 0);
+
+            f(rank);
+
+            faabric::executor::ExecutorContext::unset();
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+// Skewed block sizes, as in an irregular decomposition: a few large blocks,
+// and many small or empty ones
+static int getCount(int from, int to, int maxCount)
+{
+    int h = (from * 7 + to * 13) % 16;
+    if (h == 0) {
+        return maxCount;
+    }
+
+    return h < 4 ? 0 : maxCount / (8 * h);
+}
+
+static std::vector<int32_t> getDispls(const std::vector<int32_t>& counts)
+{
+    std::vector<int32_t> displs(counts.size(), 0);
+    for (size_t i = 1; i < counts.size(); i++) {
+        displs.at(i) = displs.at(i - 1) + counts.at(i - 1);
+    }
+
+    return displs;
+}
+
+int main()
+{
+    faabric::util::initLogging();
+
+    int worldSize = 8;
+    int nRounds = 20;
+
+    std::string thisHost = faabric::util::getSystemConfig().endpointHost;
+    faabric::batch_scheduler::SchedulingDecision decision(appId, groupId);
+    for (int rank = 0; rank < worldSize; rank++) {
+        decision.addMessage(thisHost, rank + 1, rank, rank);
+    }
+    auto& broker = faabric::transport::getPointToPointBroker();
+    broker.setUpLocalMappingsFromSchedulingDecision(decision);
+
+    faabric::mpi::MpiWorld world;
+    for (int maxCount : { 1024, 64 * 1024, 1024 * 1024 }) {
+        double paddedMs = 0;
+        double vectorMs = 0;
+        runRanks(worldSize, [&](int rank) {
+            std::vector<int32_t> sendCounts(worldSize);
+            std::vector<int32_t> recvCounts(worldSize);
+            for (int r = 0; r < worldSize; r++) {
+                sendCounts.at(r) = getCount(rank, r, maxCount);
+                recvCounts.at(r) = getCount(r, rank, maxCount);
+            }
+            std::vector<int32_t> sendDispls = getDispls(sendCounts);
+            std::vector<int32_t> recvDispls = getDispls(recvCounts);
+
+            std::vector<double> sendBuffer(sendDispls.back() +
+                                           sendCounts.back());
+            std::vector<double> recvBuffer(recvDispls.back() +
+                                           recvCounts.back());
+
+            std::vector<int32_t> paddedCounts(worldSize, maxCount);
+            std::vector<int32_t> paddedDispls = getDispls(paddedCounts);
+            std::vector<double> paddedSend(worldSize * maxCount);
+            std::vector<double> paddedRecv(worldSize * maxCount);
+
+            auto padded = [&] {
+                for (int r = 0; r < worldSize; r++) {
+                    std::memcpy(paddedSend.data() + r * maxCount,
+                                sendBuffer.data() + sendDispls.at(r),
+                                sendCounts.at(r) * sizeof(double));
+                }
+
+                wasm::doMpiAllToAllV(world,
+                                     rank,
+                                     (uint8_t*)paddedSend.data(),
+                                     paddedCounts,
+                                     paddedDispls,
+                                     MPI_DOUBLE,
+                                     (uint8_t*)paddedRecv.data(),
+                                     paddedCounts,
+                                     paddedDispls,
+                                     MPI_DOUBLE,
+                                     faabric::mpi::MpiMessageType::ALLTOALL);
+
+                for (int r = 0; r < worldSize; r++) {
+                    std::memcpy(recvBuffer.data() + recvDispls.at(r),
+                                paddedRecv.data() + r * maxCount,
+                                recvCounts.at(r) * sizeof(double));
+                }
+            };
+
+            auto unpadded = [&] {
+                wasm::doMpiAllToAllV(world,
+                                     rank,
+                                     (uint8_t*)sendBuffer.data(),
+                                     sendCounts,
+                                     sendDispls,
+                                     MPI_DOUBLE,
+                                     (uint8_t*)recvBuffer.data(),
+                                     recvCounts,
+                                     recvDispls,
+                                     MPI_DOUBLE,
+                                     faabric::mpi::MpiMessageType::ALLTOALL);
+            };
+
+            double rankPaddedMs = bench::timeMs([&] {
+                for (int i = 0; i < nRounds; i++) {
+                    padded();
+                }
+            });
+            double rankVectorMs = bench::timeMs([&] {
+                for (int i = 0; i < nRounds; i++) {
+                    unpadded();
+                }
+            });
+
+            // Every rank waits on every other in each round, so any of them
+            // will do
+            if (rank == 0) {
+                paddedMs = rankPaddedMs;
+                vectorMs = rankVectorMs;
+            }
+        });
+
+        printf("ranks=%i maxCount=%i padded=%.2fms alltoallv=%.2fms\n",
+               worldSize,
+               maxCount,
+               paddedMs / nRounds,
+               vectorMs / nRounds);
+    }
+
+    for (int rank = 0; rank < worldSize; rank++) {
+        wasm::doMpiFinalize(world, rank);
+    }
+    broker.clear();
+
+    return 0;
+}
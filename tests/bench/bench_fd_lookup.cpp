@@ -0,0 +1,99 @@
+#include "bench_utils.h"
+
+#include <storage/FileDescriptor.h>
+#include <storage/FileSystem.h>
+
+#include <faabric/util/logging.h>
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <unordered_map>
+
+/*
+ * Compares looking up file descriptors the way the fd_* host calls used to,
+ * i.e. a map lookup for the path, copied for logging, then another for the
+ * descriptor, with the single index into the dense table they do now.
+ */
+class OldFileDescriptors
+{
+  public:
+    std::unordered_map<int, storage::FileDescriptor> fileDescriptors;
+
+    std::string getPathForFd(int fd)
+    {
+        if (fileDescriptors.count(fd) == 0) {
+            return "";
+        }
+
+        return fileDescriptors[fd].getPath();
+    }
+
+    storage::FileDescriptor& getFileDescriptor(int fd)
+    {
+        if (fileDescriptors.count(fd) == 0) {
+            throw std::runtime_error("File descriptor does not exist");
+        }
+
+        return fileDescriptors.at(fd);
+    }
+};
+
+int main()
+{
+    faabric::util::initLogging();
+
+    int nRuns = 5000000;
+
+    storage::FileSystem fs;
+    fs.prepareFilesystem();
+
+    // Both tables hold the same descriptors
+    OldFileDescriptors oldFds;
+    for (int fd = 0; fd < 5; fd++) {
+        oldFds.fileDescriptors[fd] = fs.getFileDescriptor(fd);
+    }
+
+    // Alternate between the two preopened directories
+    volatile size_t sink = 0;
+    auto oldLookup = [&](int i) {
+        int fd = 3 + (i & 1);
+        std::string path = oldFds.getPathForFd(fd);
+        storage::FileDescriptor& fileDesc = oldFds.getFileDescriptor(fd);
+        sink = sink + path.size() + fileDesc.getLinuxFd();
+    };
+
+    auto newLookup = [&](int i) {
+        int fd = 3 + (i & 1);
+        storage::FileDescriptor& fileDesc = fs.getFileDescriptor(fd);
+        sink = sink + fileDesc.getPath().size() + fileDesc.getLinuxFd();
+    };
+
+    printf("lookup old=%.1fns new=%.1fns\n",
+           bench::timeNsPerRun(nRuns, oldLookup),
+           bench::timeNsPerRun(nRuns, newLookup));
+
+    // The same with the smallest write a guest would make
+    int devNull = open("/dev/null", O_WRONLY);
+    char buf[16] = { 0 };
+    iovec iov = { buf, sizeof(buf) };
+    auto oldWrite = [&](int i) {
+        oldLookup(i);
+        sink = sink + ::writev(devNull, &iov, 1);
+    };
+    auto newWrite = [&](int i) {
+        newLookup(i);
+        sink = sink + ::writev(devNull, &iov, 1);
+    };
+
+    printf("lookup + 16B writev old=%.1fns new=%.1fns\n",
+           bench::timeNsPerRun(nRuns, oldWrite),
+           bench::timeNsPerRun(nRuns, newWrite));
+
+    close(devNull);
+    fs.tearDown();
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "bench_utils.h"
+
+#include <threads/GuestSyncTable.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Compares guest pthread mutexes the way they used to be kept, i.e. a map of
+ * std::mutex behind a shared lock, looked up on both lock and unlock, with the
+ * lock-free table of inline GuestMutexes.
+ */
+class OldGuestMutexes
+{
+  public:
+    std::shared_ptr<std::mutex> getOrCreate(uint32_t id)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(mx);
+            auto it = mutexes.find(id);
+            if (it != mutexes.end()) {
+                return it->second;
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mx);
+        auto& mutex = mutexes[id];
+        if (mutex == nullptr) {
+            mutex = std::make_shared<std::mutex>();
+        }
+
+        return mutex;
+    }
+
+    std::shared_ptr<std::mutex> get(uint32_t id)
+    {
+        std::shared_lock<std::shared_mutex> lock(mx);
+        return mutexes.at(id);
+    }
+
+  private:
+    std::shared_mutex mx;
+    std::unordered_map<uint32_t, std::shared_ptr<std::mutex>> mutexes;
+};
+
+// Each thread takes and releases the locks in turn, bumping a counter for
+// each one while it holds it
+static double run(int nThreads,
+                  int nLocks,
+                  int nIters,
+                  const std::function<void(uint32_t, long&)>& lockedIncrement)
+{
+    std::vector<long> counters(nLocks, 0);
+    return bench::timeMs([&] {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nThreads; t++) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < nIters; i++) {
+                    int lockIdx = (i + t) % nLocks;
+                    lockedIncrement(8 * lockIdx + 8, counters.at(lockIdx));
+                }
+            });
+        }
+
+        for (auto& t : threads) {
+            t.join();
+        }
+    });
+}
+
+int main()
+{
+    int nIters = 500000;
+
+    for (int nThreads : { 1, 4, 8 }) {
+        for (int nLocks : { 1, 64 }) {
+            OldGuestMutexes oldMutexes;
+            double oldMs =
+              run(nThreads, nLocks, nIters, [&](uint32_t id, long& c) {
+                  oldMutexes.getOrCreate(id)->lock();
+                  c++;
+                  oldMutexes.get(id)->unlock();
+              });
+
+            threads::GuestSyncTable table;
+            double newMs =
+              run(nThreads, nLocks, nIters, [&](uint32_t id, long& c) {
+                  table.getOrCreate(id)->mx.lock();
+                  c++;
+                  table.get(id)->mx.unlock();
+              });
+
+            printf("threads=%i locks=%i old=%.1fms new=%.1fms\n",
+                   nThreads,
+                   nLocks,
+                   oldMs,
+                   newMs);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+
+namespace bench {
+
+// Runs the function the given number of times, returning the mean time per run
+// in nanoseconds
+inline double timeNsPerRun(int nRuns, const std::function<void(int)>& f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nRuns; i++) {
+        f(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+           nRuns;
+}
+
+inline double timeMs(const std::function<void()>& f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+}
@@ -10,8 +10,10 @@
 #include <faabric/util/func.h>
 #include <faabric/util/testing.h>
 
+#include <codegen/BatchCodegen.h>
 #include <codegen/MachineCodeGenerator.h>
 #include <conf/FaasmConfig.h>
+#include <conf/isa.h>
 #include <storage/FileLoader.h>
 
 #include <filesystem>
@@ -182,8 +184,15 @@ TEST_CASE_METHOD(CodegenTestFixture,
       faabric::util::readFileToBytes(objectFileA);
     REQUIRE(dummyBytesAfter == dummyBytes);
 
-    // Now change the hash file and check the object file *is* overwritten
-    faabric::util::writeBytesToFile(hashFileA, dummyBytes);
+    // Now change the recorded hash and check the object file *is*
+    // overwritten. Cached files are checked against the cache's index, so we
+    // must change it through the loader rather than write it directly
+    if (faasmConf.wasmVm == "wavm") {
+        loader.uploadFunctionObjectHash(msgA, dummyBytes);
+    } else {
+        loader.uploadFunctionWamrAotHash(msgA, dummyBytes);
+    }
+    REQUIRE(faabric::util::readFileToBytes(hashFileA) == dummyBytes);
     gen.codegenForFunction(msgA);
 
     std::vector<uint8_t> objAAfter =
@@ -336,4 +345,203 @@ TEST_CASE_METHOD(CodegenTestFixture,
                       hashFileSgx.substr(preffix.length())) !=
             bucketKeys.end());
 }
+
+TEST_CASE_METHOD(CodegenTestFixture,
+                 "Test ISA-specialised codegen",
+                 "[codegen]")
+{
+    std::string objectFile;
+
+    SECTION("WAVM codegen")
+    {
+        faasmConf.wasmVm = "wavm";
+        objectFile = "/tmp/obj/demo/hello/function.wasm.o";
+    }
+
+    SECTION("WAMR codegen")
+    {
+        faasmConf.wasmVm = "wamr";
+        objectFile = "/tmp/obj/demo/hello/function.aot";
+    }
+
+    // Only generate code this host can run
+    if (!conf::hostSupportsIsa(ISA_AVX2)) {
+        return;
+    }
+
+    faasmConf.codegenIsas = ISA_AVX2;
+    std::string isaObjectFile = objectFile + "." + ISA_AVX2;
+
+    loader.uploadFunction(msgA);
+    loader.clearLocalCache();
+
+    gen.codegenForFunction(msgA);
+
+    // Check both the generic and specialised machine code exist
+    REQUIRE(std::filesystem::exists(objectFile));
+    REQUIRE(std::filesystem::exists(isaObjectFile));
+    REQUIRE(std::filesystem::exists(isaObjectFile + HASH_EXT));
+    REQUIRE(s3.listKeys(faasmConf.s3Bucket).size() == 5);
+
+    std::vector<uint8_t> isaBytes =
+      faabric::util::readFileToBytes(isaObjectFile);
+
+    // Check the loader picks the specialised machine code
+    loader.clearLocalCache();
+    if (faasmConf.wasmVm == "wavm") {
+        REQUIRE(loader.loadFunctionObjectFile(msgA) == isaBytes);
+    } else {
+        REQUIRE(loader.loadFunctionWamrAotFile(msgA) == isaBytes);
+    }
+
+    // Check the loader falls back to the generic machine code when the ISA
+    // is not configured
+    faasmConf.codegenIsas = "";
+    loader.clearLocalCache();
+    std::vector<uint8_t> genericBytes;
+    if (faasmConf.wasmVm == "wavm") {
+        genericBytes = loader.loadFunctionObjectFile(msgA);
+    } else {
+        genericBytes = loader.loadFunctionWamrAotFile(msgA);
+    }
+    REQUIRE(!genericBytes.empty());
+    REQUIRE(std::filesystem::exists(objectFile));
+    REQUIRE(!std::filesystem::exists(isaObjectFile));
+}
+
+TEST_CASE_METHOD(CodegenTestFixture,
+                 "Test the best ISA is cached until invalidated",
+                 "[codegen]")
+{
+    if (!conf::hostSupportsIsa(ISA_AVX2)) {
+        return;
+    }
+
+    faasmConf.wasmVm = "wamr";
+
+    // Generate generic machine code only
+    faasmConf.codegenIsas = "";
+    loader.uploadFunction(msgA);
+    gen.codegenForFunction(msgA);
+    std::vector<uint8_t> genericBytes = loader.loadFunctionWamrAotFile(msgA);
+    faasmConf.codegenIsas = ISA_AVX2;
+
+    // Check the loader records that there is no specialised machine code
+    loader.clearLocalCache();
+    REQUIRE(loader.loadFunctionWamrAotFile(msgA) == genericBytes);
+
+    // Add specialised machine code behind the loader's back, and check it's
+    // not picked up until the cache is invalidated
+    std::vector<uint8_t> isaBytes = { 0, 1, 2, 3 };
+    std::string isaKey =
+      std::string("demo/hello/function.aot.") + std::string(ISA_AVX2);
+    s3.addKeyBytes(faasmConf.s3Bucket, isaKey, isaBytes);
+    s3.addKeyBytes(faasmConf.s3Bucket,
+                   isaKey + HASH_EXT,
+                   loader.loadFunctionWamrAotHash(msgA));
+
+    REQUIRE(loader.loadFunctionWamrAotFile(msgA) == genericBytes);
+
+    loader.invalidateLocalCache();
+    REQUIRE(loader.loadFunctionWamrAotFile(msgA) == isaBytes);
+}
+
+TEST_CASE_METHOD(CodegenTestFixture,
+                 "Test stale ISA-specialised machine code is not loaded",
+                 "[codegen]")
+{
+    if (!conf::hostSupportsIsa(ISA_AVX2)) {
+        return;
+    }
+
+    faasmConf.wasmVm = "wamr";
+    faasmConf.codegenIsas = ISA_AVX2;
+    std::string objectFile = "/tmp/obj/demo/hello/function.aot";
+    std::string isaObjectFile = objectFile + "." + ISA_AVX2;
+
+    loader.uploadFunction(msgA);
+    gen.codegenForFunction(msgA);
+    REQUIRE(std::filesystem::exists(isaObjectFile));
+
+    SECTION("Generic machine code invalidated")
+    {
+        // As done when the function is uploaded again
+        loader.deleteFunctionWamrAotHashes(msgA);
+
+        REQUIRE(!std::filesystem::exists(isaObjectFile));
+        REQUIRE(!std::filesystem::exists(isaObjectFile + HASH_EXT));
+    }
+
+    SECTION("Generic machine code regenerated from different wasm")
+    {
+        // As seen by another host that still has the old machine code cached
+        // locally, after the function is changed
+        loader.uploadFunctionWamrAotHash(msgA, std::vector<uint8_t>(16, 1));
+        loader.invalidateLocalCache();
+
+        REQUIRE(std::filesystem::exists(isaObjectFile));
+    }
+
+    // Check the generic machine code is picked over the stale specialised one
+    std::vector<uint8_t> genericBytes =
+      s3.getKeyBytes(faasmConf.s3Bucket, "demo/hello/function.aot");
+    REQUIRE(loader.loadFunctionWamrAotFile(msgA) == genericBytes);
+}
+
+TEST_CASE_METHOD(CodegenTestFixture, "Test batch codegen", "[codegen]")
+{
+    SECTION("WAVM codegen")
+    {
+        faasmConf.wasmVm = "wavm";
+    }
+
+    SECTION("WAMR codegen")
+    {
+        faasmConf.wasmVm = "wamr";
+    }
+
+    loader.uploadFunction(msgA);
+    loader.uploadFunction(msgB);
+    loader.clearLocalCache();
+
+    // Include a function that doesn't exist, to check it doesn't stop the rest
+    faabric::Message msgMissing = faabric::util::messageFactory("demo", "foo");
+    std::vector<faabric::Message> msgs = { msgA, msgMissing, msgB };
+
+    codegen::BatchCodegen batch(2);
+    REQUIRE(batch.getThreadCount() == 2);
+
+    std::vector<codegen::CodegenResult> results =
+      batch.codegenForFunctions(msgs);
+    REQUIRE(results.size() == 3);
+    REQUIRE(results.at(0).name == "demo/hello");
+    REQUIRE(results.at(0).status == codegen::CodegenStatus::Generated);
+    REQUIRE(results.at(1).name == "demo/foo");
+    REQUIRE(results.at(1).status == codegen::CodegenStatus::Failed);
+    REQUIRE(!results.at(1).error.empty());
+    REQUIRE(results.at(2).name == "demo/echo");
+    REQUIRE(results.at(2).status == codegen::CodegenStatus::Generated);
+    REQUIRE(codegen::logCodegenResults(results) == 1);
+
+    // Check the machine code is loadable
+    if (faasmConf.wasmVm == "wavm") {
+        REQUIRE(!loader.loadFunctionObjectFile(msgA).empty());
+        REQUIRE(!loader.loadFunctionObjectFile(msgB).empty());
+    } else {
+        REQUIRE(!loader.loadFunctionWamrAotFile(msgA).empty());
+        REQUIRE(!loader.loadFunctionWamrAotFile(msgB).empty());
+    }
+
+    // Check a second run skips everything
+    std::vector<faabric::Message> validMsgs = { msgA, msgB };
+    results = batch.codegenForFunctions(validMsgs);
+    REQUIRE(results.size() == 2);
+    REQUIRE(results.at(0).status == codegen::CodegenStatus::Skipped);
+    REQUIRE(results.at(1).status == codegen::CodegenStatus::Skipped);
+
+    // Check cleaning forces the codegen
+    results = batch.codegenForFunctions(validMsgs, true);
+    REQUIRE(results.at(0).status == codegen::CodegenStatus::Generated);
+    REQUIRE(results.at(1).status == codegen::CodegenStatus::Generated);
+}
 }
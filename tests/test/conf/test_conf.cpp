@@ -27,7 +27,15 @@ TEST_CASE("Test default faasm config initialisation", "[conf]")
 
     REQUIRE(conf.chainedCallTimeout == 300000);
 
+    REQUIRE(conf.warmPoolSize == 0);
+    REQUIRE(conf.warmPoolMinFreeMb == 1024);
+
     REQUIRE(conf.wasmVm == "wavm");
+    REQUIRE(conf.codegenIsas.empty());
+    REQUIRE(conf.wamrTiered == "off");
+    REQUIRE(conf.deltaMigration == "on");
+
+    REQUIRE(conf.localCacheMaxMb == 4096);
 
     REQUIRE(conf.s3Bucket == "faasm");
     REQUIRE(conf.s3Host == "minio");
@@ -50,10 +58,17 @@ TEST_CASE("Test overriding faasm config initialisation", "[conf]")
     std::string pythonPre = setEnvVar("PYTHON_PRELOAD", "on");
     std::string captureStdout = setEnvVar("CAPTURE_STDOUT", "on");
     std::string wasmVm = setEnvVar("FAASM_WASM_VM", "blah");
+    std::string codegenIsas = setEnvVar("CODEGEN_ISAS", "avx2,avx512");
+    std::string wamrTiered = setEnvVar("WAMR_TIERED", "on");
+    std::string deltaMigration = setEnvVar("DELTA_MIGRATION", "off");
 
     std::string chainedTimeout = setEnvVar("CHAINED_CALL_TIMEOUT", "9999");
 
+    std::string warmPoolSize = setEnvVar("WARM_POOL_SIZE", "4");
+    std::string warmPoolMinFree = setEnvVar("WARM_POOL_MIN_FREE_MB", "512");
+
     std::string faasmLocalDir = setEnvVar("FAASM_LOCAL_DIR", "/tmp/blah");
+    std::string localCacheMax = setEnvVar("LOCAL_CACHE_MAX_MB", "256");
 
     std::string s3Bucket = setEnvVar("S3_BUCKET", "dummy-bucket");
     std::string s3Host = setEnvVar("S3_HOST", "dummy-host");
@@ -75,13 +90,20 @@ TEST_CASE("Test overriding faasm config initialisation", "[conf]")
     REQUIRE(conf.pythonPreload == "on");
     REQUIRE(conf.captureStdout == "on");
     REQUIRE(conf.wasmVm == "blah");
+    REQUIRE(conf.codegenIsas == "avx2,avx512");
+    REQUIRE(conf.wamrTiered == "on");
+    REQUIRE(conf.deltaMigration == "off");
 
     REQUIRE(conf.chainedCallTimeout == 9999);
 
+    REQUIRE(conf.warmPoolSize == 4);
+    REQUIRE(conf.warmPoolMinFreeMb == 512);
+
     REQUIRE(conf.functionDir == "/tmp/blah/wasm");
     REQUIRE(conf.objectFileDir == "/tmp/blah/object");
     REQUIRE(conf.runtimeFilesDir == "/tmp/blah/runtime_root");
     REQUIRE(conf.sharedFilesDir == "/tmp/blah/shared");
+    REQUIRE(conf.localCacheMaxMb == 256);
 
     REQUIRE(conf.s3Bucket == "dummy-bucket");
     REQUIRE(conf.s3Host == "dummy-host");
@@ -101,10 +123,17 @@ TEST_CASE("Test overriding faasm config initialisation", "[conf]")
     setEnvVar("PYTHON_PRELOAD", pythonPre);
     setEnvVar("CAPTURE_STDOUT", captureStdout);
     setEnvVar("FAASM_WASM_VM", wasmVm);
+    setEnvVar("CODEGEN_ISAS", codegenIsas);
+    setEnvVar("WAMR_TIERED", wamrTiered);
+    setEnvVar("DELTA_MIGRATION", deltaMigration);
 
     setEnvVar("CHAINED_CALL_TIMEOUT", chainedTimeout);
 
+    setEnvVar("WARM_POOL_SIZE", warmPoolSize);
+    setEnvVar("WARM_POOL_MIN_FREE_MB", warmPoolMinFree);
+
     setEnvVar("FAASM_LOCAL_DIR", faasmLocalDir);
+    setEnvVar("LOCAL_CACHE_MAX_MB", localCacheMax);
 
     setEnvVar("S3_BUCKET", s3Bucket);
     setEnvVar("S3_HOST", s3Host);
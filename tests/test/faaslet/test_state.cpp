@@ -48,10 +48,25 @@ TEST_CASE_METHOD(StateFuncTestFixture, "Test asynchronous state", "[state]")
 
 TEST_CASE_METHOD(StateFuncTestFixture, "Test offset state", "[state]")
 {
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    std::string oldWasmVm = faasmConf.wasmVm;
+
+    SECTION("WAVM")
+    {
+        faasmConf.wasmVm = "wavm";
+    }
+
+    SECTION("WAMR")
+    {
+        faasmConf.wasmVm = "wamr";
+    }
+
     checkStateExample("state_offset",
                       "state_offset_example",
                       "success",
                       { 5, 5, 6, 6, 4, 5, 6 });
+
+    faasmConf.wasmVm = oldWasmVm;
 }
 
 TEST_CASE_METHOD(StateFuncTestFixture, "Test state size", "[state]")
@@ -77,6 +92,19 @@ TEST_CASE_METHOD(StateFuncTestFixture,
                  "Test shared state offset pointers",
                  "[state]")
 {
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    std::string oldWasmVm = faasmConf.wasmVm;
+
+    SECTION("WAVM")
+    {
+        faasmConf.wasmVm = "wavm";
+    }
+
+    SECTION("WAMR")
+    {
+        faasmConf.wasmVm = "wamr";
+    }
+
     // Run the function to write
     auto reqWrite = setUpContext("demo", "state_shared_write_offset");
     REQUIRE(executeWithPoolGetBooleanResult(reqWrite));
@@ -84,6 +112,8 @@ TEST_CASE_METHOD(StateFuncTestFixture,
     // Run the function to read
     auto reqRead = setUpContext("demo", "state_shared_read_offset");
     REQUIRE(executeWithPoolGetBooleanResult(reqRead));
+
+    faasmConf.wasmVm = oldWasmVm;
 }
 
 TEST_CASE_METHOD(StateFuncTestFixture, "Test writing file to state", "[state]")
@@ -94,8 +124,23 @@ TEST_CASE_METHOD(StateFuncTestFixture, "Test writing file to state", "[state]")
 
 TEST_CASE_METHOD(StateFuncTestFixture, "Test appended state", "[state]")
 {
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    std::string oldWasmVm = faasmConf.wasmVm;
+
+    SECTION("WAVM")
+    {
+        faasmConf.wasmVm = "wavm";
+    }
+
+    SECTION("WAMR")
+    {
+        faasmConf.wasmVm = "wamr";
+    }
+
     auto req = setUpContext("demo", "state_append");
     executeWithPool(req);
+
+    faasmConf.wasmVm = oldWasmVm;
 }
 
 TEST_CASE_METHOD(StateFuncTestFixture, "Test Pi estimate", "[state]")
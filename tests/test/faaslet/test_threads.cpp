@@ -3,12 +3,15 @@
 #include "faasm_fixtures.h"
 #include "utils.h"
 
+#include <faabric/planner/PlannerClient.h>
 #include <faabric/proto/faabric.pb.h>
 #include <faabric/scheduler/FunctionCallClient.h>
 #include <faabric/scheduler/Scheduler.h>
 #include <faabric/util/config.h>
 #include <faabric/util/func.h>
 #include <faabric/util/testing.h>
+#include <faaslet/Faaslet.h>
+#include <threads/ThreadState.h>
 #include <wavm/WAVMWasmModule.h>
 
 namespace tests {
@@ -65,4 +68,105 @@ TEST_CASE_METHOD(PthreadTestFixture, "Run thread checks locally", "[threads]")
 
     runTestLocally("threads_check");
 }
+
+TEST_CASE_METHOD(PthreadTestFixture,
+                 "Test dispatching, joining and detaching pthread calls",
+                 "[threads]")
+{
+    faasmConf.wasmVm = "wavm";
+
+    auto req = faabric::util::batchExecFactory("threads", "threads_local", 1);
+    faabric::Message& msg = req->mutable_messages()->at(0);
+    faabric::executor::ExecutorContext::set(nullptr, req, 0);
+    faaslet::Faaslet f(msg);
+    wasm::WasmModule& module = *f.module;
+
+    // Table index zero is always empty, so every thread fails straight away.
+    // That is enough to follow the calls through the bookkeeping
+    auto makeCall = [](int32_t pthreadPtr) {
+        threads::PthreadCall call;
+        call.pthreadPtr = pthreadPtr;
+        call.entryFunc = 0;
+        call.argsPtr = 0;
+        return call;
+    };
+
+    SECTION("Dispatch and join")
+    {
+        int callId = module.dispatchPthreadCall(&msg, makeCall(10));
+        REQUIRE(module.getPendingPthreadCount() == 1);
+
+        // The call runs without anyone joining it
+        auto results =
+          waitForBatchResults(true, msg.appid(), { callId }, 10000, false);
+        REQUIRE(results.size() == 1);
+
+        REQUIRE(module.awaitPthreadCall(&msg, 10) ==
+                results.at(0).returnvalue());
+        REQUIRE(module.getPendingPthreadCount() == 0);
+
+        // Each call can only be joined once
+        REQUIRE_THROWS_AS(module.awaitPthreadCall(&msg, 10),
+                          std::runtime_error);
+    }
+
+    SECTION("Detach")
+    {
+        module.dispatchPthreadCall(&msg, makeCall(10));
+        module.dispatchPthreadCall(&msg, makeCall(20));
+        REQUIRE(module.getPendingPthreadCount() == 2);
+
+        module.detachPthreadCall(10);
+        REQUIRE(module.getPendingPthreadCount() == 2);
+
+        // Detached calls can be neither joined nor detached again
+        REQUIRE_THROWS_AS(module.awaitPthreadCall(&msg, 10),
+                          std::runtime_error);
+        REQUIRE_THROWS_AS(module.detachPthreadCall(10), std::runtime_error);
+
+        // The others are unaffected
+        module.awaitPthreadCall(&msg, 20);
+        REQUIRE(module.getPendingPthreadCount() == 1);
+
+        // Detached calls are awaited when the function finishes
+        module.awaitAllPthreadCalls();
+        REQUIRE(module.getPendingPthreadCount() == 0);
+    }
+
+    SECTION("Reset")
+    {
+        int joinedId = module.dispatchPthreadCall(&msg, makeCall(10));
+        int detachedId = module.dispatchPthreadCall(&msg, makeCall(20));
+        module.detachPthreadCall(20);
+
+        // Calls left over from a failed execution run in the module's memory,
+        // so check they have all finished once it has been reset
+        f.reset(msg);
+        REQUIRE(module.getPendingPthreadCount() == 0);
+
+        auto& plannerCli = faabric::planner::getPlannerClient();
+        for (int callId : { joinedId, detachedId }) {
+            faabric::Message result =
+              plannerCli.getMessageResult(msg.appid(), callId, 100);
+            REQUIRE(result.type() != faabric::Message_MessageType_EMPTY);
+        }
+
+        // They must not leak into the next execution either
+        REQUIRE_THROWS_AS(module.awaitPthreadCall(&msg, 10),
+                          std::runtime_error);
+    }
+
+    SECTION("Reset sync objects")
+    {
+        module.getOrCreatePthreadSyncObject(1024)->mx.lock();
+
+        // Mutexes and condition variables belong to the memory being reset
+        f.reset(msg);
+        REQUIRE_THROWS_AS(module.getPthreadSyncObject(1024),
+                          std::runtime_error);
+        REQUIRE(module.getOrCreatePthreadSyncObject(1024)->mx.try_lock());
+    }
+
+    f.shutdown();
+}
 }
@@ -0,0 +1,75 @@
+#include <catch2/catch.hpp>
+
+#include "faasm_fixtures.h"
+
+#include <faabric/util/func.h>
+#include <faaslet/Faaslet.h>
+#include <faaslet/FaasletPool.h>
+
+namespace tests {
+
+TEST_CASE_METHOD(MultiRuntimeFunctionExecTestFixture,
+                 "Test warm Faaslet pool",
+                 "[faaslet]")
+{
+    SECTION("WAVM")
+    {
+        faasmConf.wasmVm = "wavm";
+    }
+
+    SECTION("WAMR")
+    {
+        faasmConf.wasmVm = "wamr";
+    }
+
+    faasmConf.warmPoolSize = 2;
+    faasmConf.warmPoolMinFreeMb = 0;
+
+    // Don't start the background thread to check the pool deterministically
+    faaslet::FaasletPool pool;
+
+    auto req = setUpContext("demo", "echo");
+    faabric::Message& msg = req->mutable_messages()->at(0);
+    msg.set_inputdata("hello warm pool");
+
+    // Nothing is warm before the first invocation
+    REQUIRE(pool.take(msg) == nullptr);
+    REQUIRE(pool.getWarmFaasletCount(msg) == 0);
+
+    // One recent invocation means one warm Faaslet
+    pool.fill();
+    REQUIRE(pool.getWarmFaasletCount(msg) == 1);
+
+    // Check the pool never exceeds the configured size
+    pool.take(msg);
+    pool.take(msg);
+    pool.take(msg);
+    pool.fill();
+    REQUIRE(pool.getWarmFaasletCount(msg) == 2);
+
+    // Check a warm Faaslet is bound and can execute
+    std::shared_ptr<faaslet::Faaslet> faaslet = pool.take(msg);
+    REQUIRE(faaslet != nullptr);
+    REQUIRE(faaslet->module->isBound());
+    REQUIRE(pool.getWarmFaasletCount(msg) == 1);
+
+    int returnValue = faaslet->executeTask(0, 0, req);
+    REQUIRE(returnValue == 0);
+    REQUIRE(msg.outputdata() == "hello warm pool");
+    faaslet->shutdown();
+
+    // Check the pool is drained under memory pressure
+    faasmConf.warmPoolMinFreeMb = INT32_MAX;
+    pool.fill();
+    REQUIRE(pool.getWarmFaasletCount(msg) == 1);
+    pool.shrink();
+    REQUIRE(pool.getTotalWarmFaasletCount() == 0);
+
+    // Check clearing drops everything
+    faasmConf.warmPoolMinFreeMb = 0;
+    pool.fill();
+    REQUIRE(pool.getTotalWarmFaasletCount() > 0);
+    pool.clear();
+    REQUIRE(pool.getTotalWarmFaasletCount() == 0);
+}
+}
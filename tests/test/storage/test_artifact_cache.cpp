@@ -0,0 +1,184 @@
+#include <catch2/catch.hpp>
+
+#include "faasm_fixtures.h"
+
+#include <faabric/util/files.h>
+#include <faabric/util/testing.h>
+#include <storage/ArtifactCache.h>
+#include <storage/FileLoader.h>
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+
+using namespace storage;
+
+namespace tests {
+
+class ArtifactCacheTestFixture : public FunctionLoaderTestFixture
+{
+  public:
+    ArtifactCacheTestFixture()
+      : cache(getArtifactCache())
+    {
+        // Switch off test mode so that the cache removes files, and start
+        // from an empty cache
+        faabric::util::setTestMode(false);
+        loader.clearLocalCache();
+
+        std::filesystem::remove_all(testDir);
+        std::filesystem::create_directories(testDir);
+    }
+
+    ~ArtifactCacheTestFixture()
+    {
+        faabric::util::setTestMode(true);
+        cache.clear();
+        std::filesystem::remove_all(testDir);
+    }
+
+  protected:
+    ArtifactCache& cache;
+
+    std::string testDir = "/tmp/artifact_cache_test";
+
+    std::string writeArtifact(const std::string& name,
+                              const std::vector<uint8_t>& bytes,
+                              const std::string& hashKey,
+                              const std::vector<uint8_t>& remoteHash)
+    {
+        std::string path = testDir + "/" + name;
+        faabric::util::writeBytesToFile(path, bytes);
+        cache.put(path, bytes, hashKey, remoteHash);
+        return path;
+    }
+};
+
+TEST_CASE_METHOD(ArtifactCacheTestFixture,
+                 "Test artifact cache LRU eviction",
+                 "[storage]")
+{
+    faasmConf.localCacheMaxMb = 1;
+
+    std::vector<uint8_t> bytes(400 * 1024, 1);
+    std::string pathA = writeArtifact("a", bytes, "", {});
+    std::string pathB = writeArtifact("b", bytes, "", {});
+    REQUIRE(cache.getEntryCount() == 2);
+    REQUIRE(cache.getTotalSize() == 2 * bytes.size());
+
+    // Use A so that B is the least recently used
+    REQUIRE(cache.check(pathA, bytes));
+
+    // Going over budget evicts B
+    std::string pathC = writeArtifact("c", bytes, "", {});
+    REQUIRE(cache.getEntryCount() == 2);
+    REQUIRE(cache.getTotalSize() == 2 * bytes.size());
+    REQUIRE(std::filesystem::exists(pathA));
+    REQUIRE(!std::filesystem::exists(pathB));
+    REQUIRE(std::filesystem::exists(pathC));
+    REQUIRE(!cache.isTracked(pathB));
+}
+
+TEST_CASE_METHOD(ArtifactCacheTestFixture,
+                 "Test artifact cache integrity check",
+                 "[storage]")
+{
+    // Corrupt files must be caught whether or not we're in test mode
+    SECTION("Test mode") { faabric::util::setTestMode(true); }
+
+    SECTION("No test mode") { faabric::util::setTestMode(false); }
+
+    std::vector<uint8_t> bytes = { 0, 1, 2, 3 };
+    std::string path = writeArtifact("a", bytes, "", {});
+    REQUIRE(cache.check(path, bytes));
+
+    // Unchanged files are trusted without hashing what was read from them
+    REQUIRE(cache.check(path, {}));
+
+    // Touch the file without changing it and check it's still valid
+    auto mtime = std::filesystem::last_write_time(path);
+    std::filesystem::last_write_time(path, mtime + std::chrono::seconds(1));
+    REQUIRE(cache.check(path, bytes));
+
+    // Corrupt the file and check it's removed. We move its modification time
+    // on, as it may otherwise be the same as that of the last write
+    std::vector<uint8_t> corrupt = { 0, 1, 2, 4 };
+    faabric::util::writeBytesToFile(path, corrupt);
+    std::filesystem::last_write_time(path, mtime + std::chrono::seconds(2));
+    REQUIRE(!cache.check(path, corrupt));
+    REQUIRE(!std::filesystem::exists(path));
+    REQUIRE(cache.getEntryCount() == 0);
+    REQUIRE(cache.getTotalSize() == 0);
+}
+
+TEST_CASE_METHOD(ArtifactCacheTestFixture,
+                 "Test artifact cache selective invalidation",
+                 "[storage]")
+{
+    std::vector<uint8_t> bytes = { 0, 1, 2, 3 };
+    std::vector<uint8_t> hashA = { 1, 1 };
+    std::vector<uint8_t> hashB = { 2, 2 };
+
+    std::string pathFresh = writeArtifact("fresh", bytes, "keyA", hashA);
+    std::string pathStale = writeArtifact("stale", bytes, "keyB", hashB);
+    std::string pathMissing = writeArtifact("missing", bytes, "keyC", hashA);
+    std::string pathUnchecked = writeArtifact("unchecked", bytes, "", {});
+
+    std::map<std::string, std::vector<uint8_t>> remoteHashes = {
+        { "keyA", hashA },
+        { "keyB", hashA },
+    };
+
+    int nRemoved = cache.invalidate([&remoteHashes](const std::string& key) {
+        return remoteHashes[key];
+    });
+
+    REQUIRE(nRemoved == 3);
+    REQUIRE(cache.getEntryCount() == 1);
+    REQUIRE(std::filesystem::exists(pathFresh));
+    REQUIRE(!std::filesystem::exists(pathStale));
+    REQUIRE(!std::filesystem::exists(pathMissing));
+    REQUIRE(!std::filesystem::exists(pathUnchecked));
+}
+
+TEST_CASE_METHOD(ArtifactCacheTestFixture,
+                 "Test invalidating file loader cache only drops changed files",
+                 "[storage]")
+{
+    faasmConf.wasmVm = "wavm";
+    uploadTestWasm();
+
+    std::string wasmFileA = loader.getFunctionFile(msgA);
+    std::string objFileA = loader.getFunctionObjectFile(msgA);
+    std::string wasmFileB = loader.getFunctionFile(msgB);
+    std::string objFileB = loader.getFunctionObjectFile(msgB);
+
+    // Write a file we don't know about
+    std::string untrackedFile = faasmConf.objectFileDir + "/untracked.o";
+    faabric::util::writeBytesToFile(untrackedFile, { 0, 1, 2 });
+
+    // Change the machine code hash for B remotely, as if another host had
+    // uploaded a new version
+    std::vector<uint8_t> newHash = { 0, 1, 2, 3 };
+    s3.addKeyBytes(faasmConf.s3Bucket,
+                   loader.getHashFilePath("demo/echo/function.wasm.o"),
+                   newHash);
+
+    loader.invalidateLocalCache();
+
+    REQUIRE(std::filesystem::exists(wasmFileA));
+    REQUIRE(std::filesystem::exists(objFileA));
+    REQUIRE(std::filesystem::exists(loader.getHashFilePath(objFileA)));
+
+    REQUIRE(!std::filesystem::exists(wasmFileB));
+    REQUIRE(!std::filesystem::exists(objFileB));
+    REQUIRE(!std::filesystem::exists(loader.getHashFilePath(objFileB)));
+
+    REQUIRE(!std::filesystem::exists(untrackedFile));
+
+    // Check we can still load everything
+    REQUIRE(loader.loadFunctionObjectFile(msgA) == objBytesA);
+    REQUIRE(loader.loadFunctionWasm(msgB) == wasmBytesB);
+    REQUIRE(loader.loadFunctionObjectHash(msgB) == newHash);
+}
+}
@@ -8,6 +8,7 @@
 #include <faabric/util/files.h>
 #include <storage/FileDescriptor.h>
 #include <storage/FileLoader.h>
+#include <storage/FileMapping.h>
 #include <storage/SharedFiles.h>
 
 #include <boost/filesystem.hpp>
@@ -408,4 +409,132 @@ TEST_CASE_METHOD(FileDescriptorTestFixture,
         checkWasiDirentInBuffer(buffer2.data(), entC);
     }
 }
+
+TEST_CASE_METHOD(FileDescriptorTestFixture,
+                 "Test file descriptor table",
+                 "[storage]")
+{
+    REQUIRE(fs.fileDescriptorExists(0));
+    REQUIRE(fs.fileDescriptorExists(DEFAULT_ROOT_FD));
+    REQUIRE(!fs.fileDescriptorExists(-1));
+    REQUIRE(!fs.fileDescriptorExists(100));
+    REQUIRE_THROWS(fs.getFileDescriptor(-1));
+    REQUIRE_THROWS(fs.getFileDescriptor(100));
+    REQUIRE(fs.getPathForFd(100).empty());
+
+    // References must stay valid as more fds are opened
+    FileDescriptor& rootFd = fs.getFileDescriptor(DEFAULT_ROOT_FD);
+    int firstFd = fs.dup(DEFAULT_ROOT_FD);
+    FileDescriptor& firstDesc = fs.getFileDescriptor(firstFd);
+
+    int lastFd = firstFd;
+    for (int i = 0; i < 20; i++) {
+        int newFd = fs.dup(DEFAULT_ROOT_FD);
+        REQUIRE(newFd == lastFd + 1);
+        lastFd = newFd;
+    }
+
+    REQUIRE(&rootFd == &fs.getFileDescriptor(DEFAULT_ROOT_FD));
+    REQUIRE(&firstDesc == &fs.getFileDescriptor(firstFd));
+    REQUIRE(firstDesc.getPath() == rootFd.getPath());
+    REQUIRE(fs.getPathForFd(lastFd) == rootFd.getPath());
+}
+
+TEST_CASE_METHOD(FileDescriptorTestFixture,
+                 "Test positional reads and writes",
+                 "[storage]")
+{
+    std::string dummyPath = "dummy_pread_file.txt";
+    std::string realPath = faasmConf.runtimeFilesDir + "/" + dummyPath;
+    std::vector<uint8_t> contents = { 0, 1, 2, 3, 4, 5, 6 };
+    faabric::util::writeBytesToFile(realPath, contents);
+
+    uint64_t rights = __WASI_RIGHT_FD_READ | __WASI_RIGHT_FD_WRITE;
+    int newFd =
+      fs.openFileDescriptor(DEFAULT_ROOT_FD, dummyPath, rights, 0, 0, 0, 0);
+    REQUIRE(newFd > 0);
+    FileDescriptor& fileDesc = fs.getFileDescriptor(newFd);
+
+    // Read across two buffers from the middle of the file
+    std::vector<uint8_t> bufA(2, 0);
+    std::vector<uint8_t> bufB(3, 0);
+    std::vector<::iovec> iovecs = { { bufA.data(), bufA.size() },
+                                    { bufB.data(), bufB.size() } };
+    REQUIRE(fileDesc.pread(iovecs, 2, 2) == 5);
+    REQUIRE(bufA == std::vector<uint8_t>({ 2, 3 }));
+    REQUIRE(bufB == std::vector<uint8_t>({ 4, 5, 6 }));
+
+    // Reading past the end reads nothing
+    REQUIRE(fileDesc.pread(iovecs, 2, 100) == 0);
+
+    // Write in the middle of the file, then past its end
+    std::vector<uint8_t> data = { 9, 9 };
+    std::vector<::iovec> writeIovecs = { { data.data(), data.size() } };
+    REQUIRE(fileDesc.pwrite(writeIovecs, 1, 1) == 2);
+    REQUIRE(fileDesc.pwrite(writeIovecs, 1, 8) == 2);
+
+    // None of this moves the file offset
+    REQUIRE(fileDesc.tell() == 0);
+    REQUIRE(fileDesc.sync() == __WASI_ESUCCESS);
+
+    std::vector<uint8_t> expected = { 0, 9, 9, 3, 4, 5, 6, 0, 9, 9 };
+    REQUIRE(faabric::util::readFileToBytes(realPath) == expected);
+
+    // Resize the file
+    REQUIRE(fileDesc.setSize(4) == __WASI_ESUCCESS);
+    expected.resize(4);
+    REQUIRE(faabric::util::readFileToBytes(realPath) == expected);
+
+    REQUIRE(fileDesc.allocate(0, 20) == __WASI_ESUCCESS);
+    REQUIRE(fileDesc.stat().st_size == 20);
+
+    REQUIRE(fileDesc.setSize(UINT64_MAX) == __WASI_EINVAL);
+    REQUIRE(fileDesc.pread(iovecs, 2, UINT64_MAX) == -1);
+    REQUIRE(fileDesc.getWasiErrno() == __WASI_EINVAL);
+
+    boost::filesystem::remove(realPath);
+}
+
+TEST_CASE_METHOD(FileDescriptorTestFixture,
+                 "Test files can't be shrunk below their mappings",
+                 "[storage]")
+{
+    std::string dummyPath = "dummy_mapped_file.txt";
+    std::string realPath = faasmConf.runtimeFilesDir + "/" + dummyPath;
+    std::vector<uint8_t> contents(10, 1);
+    faabric::util::writeBytesToFile(realPath, contents);
+
+    uint64_t rights = __WASI_RIGHT_FD_READ | __WASI_RIGHT_FD_WRITE;
+    int newFd =
+      fs.openFileDescriptor(DEFAULT_ROOT_FD, dummyPath, rights, 0, 0, 0, 0);
+    REQUIRE(newFd > 0);
+    FileDescriptor& fileDesc = fs.getFileDescriptor(newFd);
+    int linuxFd = fileDesc.getLinuxFd();
+
+    REQUIRE(FileMapping::getMinFileSize(linuxFd) == 0);
+
+    {
+        FileMapping mappingA(linuxFd, 6);
+        auto mappingB = std::make_unique<FileMapping>(linuxFd, 8);
+        REQUIRE(FileMapping::getMinFileSize(linuxFd) == 8);
+
+        // Growing the file, or shrinking it down to its mappings, is fine
+        REQUIRE(fileDesc.setSize(12) == __WASI_ESUCCESS);
+        REQUIRE(fileDesc.setSize(8) == __WASI_ESUCCESS);
+        REQUIRE(fileDesc.setSize(4) == __WASI_EBUSY);
+        REQUIRE(fileDesc.stat().st_size == 8);
+
+        // Only the mappings that are left count
+        mappingB.reset();
+        REQUIRE(FileMapping::getMinFileSize(linuxFd) == 6);
+        REQUIRE(fileDesc.setSize(4) == __WASI_EBUSY);
+        REQUIRE(fileDesc.setSize(6) == __WASI_ESUCCESS);
+    }
+
+    REQUIRE(FileMapping::getMinFileSize(linuxFd) == 0);
+    REQUIRE(fileDesc.setSize(4) == __WASI_ESUCCESS);
+    REQUIRE(fileDesc.stat().st_size == 4);
+
+    boost::filesystem::remove(realPath);
+}
 }
@@ -92,6 +92,54 @@ TEST_CASE_METHOD(FileLoaderTestFixture,
     REQUIRE(!boost::filesystem::exists(cachedObjectHash));
 }
 
+TEST_CASE_METHOD(FileLoaderTestFixture,
+                 "Test file loader mapping object files",
+                 "[storage]")
+{
+    bool useFsCache;
+    SECTION("With cache")
+    {
+        useFsCache = true;
+    }
+
+    SECTION("Without cache")
+    {
+        useFsCache = false;
+    }
+
+    storage::FileLoader loader(useFsCache);
+    loader.clearLocalCache();
+
+    codegen::MachineCodeGenerator gen(loader);
+    loader.uploadFunction(msgB);
+    gen.codegenForFunction(msgB);
+
+    std::string cachedObjFile = loader.getFunctionObjectFile(msgB);
+
+    // Map once pulling from S3, and once from the local cache
+    loader.clearLocalCache();
+    for (int i = 0; i < 2; i++) {
+        std::shared_ptr<MappedFile> objFile =
+          loader.mapFunctionObjectFile(msgB);
+
+        REQUIRE(objFile->isMapped() == useFsCache);
+        REQUIRE(boost::filesystem::exists(cachedObjFile) == useFsCache);
+
+        std::span<const uint8_t> actual = objFile->getSpan();
+        REQUIRE(std::vector<uint8_t>(actual.begin(), actual.end()) ==
+                objBytesB);
+    }
+
+    // Check the mapping survives the file being replaced
+    std::shared_ptr<MappedFile> objFile = loader.mapFunctionObjectFile(msgB);
+    std::vector<uint8_t> dummyBytes = { 0, 1, 2, 3 };
+    loader.uploadFunctionObjectFile(msgB, dummyBytes);
+
+    std::span<const uint8_t> actual = objFile->getSpan();
+    REQUIRE(std::vector<uint8_t>(actual.begin(), actual.end()) == objBytesB);
+    REQUIRE(loader.loadFunctionObjectFile(msgB) == dummyBytes);
+}
+
 TEST_CASE_METHOD(FileLoaderTestFixture,
                  "Test clearing local file loader cache",
                  "[storage]")
@@ -10,6 +10,8 @@
 #include <conf/FaasmConfig.h>
 #include <storage/S3Wrapper.h>
 
+#include <filesystem>
+
 namespace tests {
 
 TEST_CASE_METHOD(S3TestFixture, "Test read/write keys in bucket", "[s3]")
@@ -87,6 +89,24 @@ TEST_CASE_METHOD(S3TestFixture, "Test read/write keys in bucket", "[s3]")
         REQUIRE_THROWS(s3.getKeyBytes(faasmConf.s3Bucket, "blahblah"));
     }
 
+    SECTION("Test streaming key to file")
+    {
+        std::string filePath = "/tmp/s3_key_to_file.bin";
+        std::filesystem::remove(filePath);
+
+        s3.addKeyBytes(faasmConf.s3Bucket, "alpha", byteDataA);
+        REQUIRE(s3.getKeyToFile(faasmConf.s3Bucket, "alpha", filePath));
+        REQUIRE(faabric::util::readFileToBytes(filePath) == byteDataA);
+
+        std::filesystem::remove(filePath);
+        REQUIRE(
+          !s3.getKeyToFile(faasmConf.s3Bucket, "blahblah", filePath, true));
+        REQUIRE(!std::filesystem::exists(filePath));
+
+        REQUIRE_THROWS(
+          s3.getKeyToFile(faasmConf.s3Bucket, "blahblah", filePath));
+    }
+
     s3.deleteKey(faasmConf.s3Bucket, "alpha");
     s3.deleteKey(faasmConf.s3Bucket, "beta");
     s3.deleteKey(faasmConf.s3Bucket, "simple");
@@ -9,6 +9,9 @@
 #include <faabric/util/files.h>
 #include <faabric/util/func.h>
 #include <storage/FileLoader.h>
+#include <storage/SharedFiles.h>
+
+#include <thread>
 
 using namespace storage;
 
@@ -100,4 +103,88 @@ TEST_CASE_METHOD(SharedFilesTestFixture, "Check sync python file", "[storage]")
     REQUIRE(actualBytes.size() == contents.size());
     REQUIRE(actualBytes == contents);
 }
+
+TEST_CASE_METHOD(SharedFilesTestFixture,
+                 "Check concurrent shared file syncs",
+                 "[storage]")
+{
+    int nFiles = 4;
+    int nThreadsPerFile = 3;
+
+    std::vector<std::string> relPaths;
+    std::vector<std::vector<uint8_t>> contents;
+    for (int i = 0; i < nFiles; i++) {
+        std::string relPath =
+          fmt::format("shared_test_dir/concurrent_{}.txt", i);
+        std::vector<uint8_t> bytes(1024 * (i + 1), (uint8_t)i);
+
+        loader.uploadSharedFile(relPath, bytes);
+        boost::filesystem::remove(loader.getSharedFileFile(relPath));
+
+        relPaths.push_back(relPath);
+        contents.push_back(bytes);
+    }
+
+    std::string missingPath = "faasm://shared_test_dir/concurrent_missing.txt";
+
+    // Sync the same and different files from many threads at once
+    std::vector<std::thread> threads;
+    std::vector<int> results(nFiles * nThreadsPerFile, -1);
+    std::vector<int> missingResults(nThreadsPerFile, -1);
+    for (int i = 0; i < nFiles; i++) {
+        for (int j = 0; j < nThreadsPerFile; j++) {
+            int idx = i * nThreadsPerFile + j;
+            threads.emplace_back([&relPaths, &results, i, idx] {
+                results.at(idx) =
+                  SharedFiles::syncSharedFile("faasm://" + relPaths.at(i));
+            });
+        }
+    }
+
+    for (int j = 0; j < nThreadsPerFile; j++) {
+        threads.emplace_back([&missingPath, &missingResults, j] {
+            missingResults.at(j) = SharedFiles::syncSharedFile(missingPath);
+        });
+    }
+
+    for (auto& t : threads) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+
+    REQUIRE(results == std::vector<int>(nFiles * nThreadsPerFile, 0));
+    REQUIRE(missingResults == std::vector<int>(nThreadsPerFile, ENOENT));
+
+    for (int i = 0; i < nFiles; i++) {
+        std::string syncedPath = loader.getSharedFileFile(relPaths.at(i));
+        REQUIRE(faabric::util::readFileToBytes(syncedPath) == contents.at(i));
+    }
+}
+
+TEST_CASE_METHOD(SharedFilesTestFixture,
+                 "Check failed shared file syncs can be retried",
+                 "[storage]")
+{
+    std::string relPath = "shared_test_dir/failing.txt";
+    std::string sharedPath = "faasm://" + relPath;
+    std::vector<uint8_t> contents = { 0, 1, 2, 3 };
+    loader.uploadSharedFile(relPath, contents);
+
+    // Sync to a path whose parent is a regular file, so the sync fails
+    std::string blockingPath = "/tmp/faasm_shared_file_block";
+    std::string localPath = blockingPath + "/failing.txt";
+    boost::filesystem::remove_all(blockingPath);
+    faabric::util::writeBytesToFile(blockingPath, { 1 });
+
+    // Later syncs must not wait on, or reuse, the failed one
+    REQUIRE_THROWS(SharedFiles::syncSharedFile(sharedPath, localPath));
+    REQUIRE_THROWS(SharedFiles::syncSharedFile(sharedPath, localPath));
+
+    boost::filesystem::remove(blockingPath);
+    REQUIRE(SharedFiles::syncSharedFile(sharedPath, localPath) == 0);
+    REQUIRE(faabric::util::readFileToBytes(localPath) == contents);
+
+    boost::filesystem::remove_all(blockingPath);
+}
 }
@@ -0,0 +1,162 @@
+#include <catch2/catch.hpp>
+
+#include <threads/GuestSyncTable.h>
+
+#include <chrono>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace threads;
+
+namespace tests {
+
+TEST_CASE("Test guest sync table lookups", "[threads]")
+{
+    GuestSyncTable table;
+
+    REQUIRE(table.get(1234) == nullptr);
+    REQUIRE(table.size() == 0);
+
+    GuestSyncObject* objA = table.getOrCreate(1234);
+    GuestSyncObject* objB = table.getOrCreate(5678);
+    REQUIRE(objA != nullptr);
+    REQUIRE(objB != nullptr);
+    REQUIRE(objA != objB);
+    REQUIRE(table.size() == 2);
+
+    REQUIRE(table.get(1234) == objA);
+    REQUIRE(table.getOrCreate(5678) == objB);
+    REQUIRE(table.size() == 2);
+
+    // Objects must work in place
+    objA->mx.lock();
+    REQUIRE(!objA->mx.try_lock());
+    objA->mx.unlock();
+}
+
+TEST_CASE("Test guest sync table growing", "[threads]")
+{
+    GuestSyncTable table;
+
+    // Enough word-aligned addresses to need several segments
+    int nObjs = 4 * GUEST_SYNC_TABLE_INITIAL_SLOTS;
+    std::set<GuestSyncObject*> objs;
+    for (int i = 0; i < nObjs; i++) {
+        objs.insert(table.getOrCreate(1024 + 4 * i));
+    }
+
+    REQUIRE(objs.size() == nObjs);
+    REQUIRE(table.size() == nObjs);
+
+    for (int i = 0; i < nObjs; i++) {
+        REQUIRE(objs.contains(table.get(1024 + 4 * i)));
+    }
+
+    REQUIRE(table.get(1024 + 4 * nObjs) == nullptr);
+}
+
+TEST_CASE("Test clearing the guest sync table", "[threads]")
+{
+    // Two segments, so the table fills up quickly
+    GuestSyncTable table(2);
+    int capacity = 3 * GUEST_SYNC_TABLE_INITIAL_SLOTS;
+
+    GuestSyncObject* obj = table.getOrCreate(1024);
+    obj->mx.lock();
+    table.clear();
+    REQUIRE(table.size() == 0);
+    REQUIRE(table.get(1024) == nullptr);
+
+    // Check objects created again start afresh
+    obj = table.getOrCreate(1024);
+    REQUIRE(obj->mx.try_lock());
+    obj->mx.unlock();
+    table.clear();
+
+    // Check we can cycle through many more addresses than fit in the table,
+    // as long as it's cleared in between
+    int nRounds = 10;
+    int nObjs = capacity / 2;
+    for (int r = 0; r < nRounds; r++) {
+        for (int i = 0; i < nObjs; i++) {
+            REQUIRE(table.getOrCreate(4 * (r * nObjs + i) + 4) != nullptr);
+        }
+        REQUIRE(table.size() == nObjs);
+
+        table.clear();
+    }
+
+    // Without clearing, the table fills up
+    auto fillTable = [&table, capacity] {
+        for (int i = 0; i <= capacity; i++) {
+            table.getOrCreate(4 * i + 4);
+        }
+    };
+    REQUIRE_THROWS_AS(fillTable(), std::runtime_error);
+}
+
+TEST_CASE("Test guest sync table concurrent creation", "[threads]")
+{
+    GuestSyncTable table;
+
+    int nThreads = 8;
+    int nObjs = 2 * GUEST_SYNC_TABLE_INITIAL_SLOTS;
+    std::vector<std::vector<GuestSyncObject*>> results(nThreads);
+
+    // All threads create the same objects at once, and must all get the same
+    // pointers back
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+        threads.emplace_back([&table, &results, nObjs, t] {
+            for (int i = 0; i < nObjs; i++) {
+                results.at(t).push_back(table.getOrCreate(8 * i + 8));
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    REQUIRE(table.size() == nObjs);
+    for (int t = 1; t < nThreads; t++) {
+        REQUIRE(results.at(t) == results.at(0));
+    }
+}
+
+TEST_CASE("Test guest mutex under contention", "[threads]")
+{
+    GuestMutex mx;
+    REQUIRE(mx.try_lock());
+    REQUIRE(!mx.try_lock());
+    mx.unlock();
+
+    // Not atomic, so updates would be lost without mutual exclusion. Holding
+    // the lock for varying times makes some threads spin and others park
+    int nThreads = 8;
+    int nIters = 10000;
+    long counter = 0;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+        threads.emplace_back([&mx, &counter, nIters, t] {
+            for (int i = 0; i < nIters; i++) {
+                mx.lock();
+                counter++;
+                if ((i + t) % 1000 == 0) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+                mx.unlock();
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    REQUIRE(counter == nThreads * nIters);
+}
+}
@@ -23,6 +23,8 @@ TEST_CASE("Check level serialisation and deserialisation", "[threads]")
     lvlA.numThreads = 666;
     lvlA.pushedThreads = 777;
     lvlA.wantedThreads = 888;
+    lvlA.runtimeScheduleKind = 2;
+    lvlA.runtimeScheduleChunk = 999;
 
     std::vector<uint32_t> sharedVarOffsets = { 22, 33, 44, 55, 66 };
     lvlA.setSharedVarOffsets(sharedVarOffsets.data(), sharedVarOffsets.size());
@@ -57,6 +59,8 @@ TEST_CASE("Check level serialisation and deserialisation", "[threads]")
     REQUIRE(lvlB->numThreads == lvlA.numThreads);
     REQUIRE(lvlB->pushedThreads == lvlA.pushedThreads);
     REQUIRE(lvlB->wantedThreads == lvlA.wantedThreads);
+    REQUIRE(lvlB->runtimeScheduleKind == lvlA.runtimeScheduleKind);
+    REQUIRE(lvlB->runtimeScheduleChunk == lvlA.runtimeScheduleChunk);
 
     REQUIRE(lvlB->getSharedVarOffsets() == sharedVarOffsets);
 }
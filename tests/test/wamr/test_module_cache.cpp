@@ -0,0 +1,189 @@
+#include <catch2/catch.hpp>
+
+#include "faasm_fixtures.h"
+
+#include <conf/isa.h>
+#include <faabric/util/func.h>
+#include <faabric/util/testing.h>
+#include <wamr/WAMRModuleCache.h>
+#include <wamr/WAMRWasmModule.h>
+
+#include <filesystem>
+
+namespace tests {
+
+TEST_CASE_METHOD(FunctionExecTestFixture,
+                 "Test sharing cached WAMR modules",
+                 "[wamr]")
+{
+    auto req = setUpContext("demo", "echo", 2);
+    faabric::Message& msgA = req->mutable_messages()->at(0);
+    faabric::Message& msgB = req->mutable_messages()->at(1);
+
+    wasm::WAMRModuleCache& moduleCache = wasm::getWAMRModuleCache();
+    moduleCache.clear();
+
+    // Check the same loaded module is returned for the same function
+    auto cachedA = moduleCache.getModule(msgA);
+    auto cachedB = moduleCache.getModule(msgB);
+    REQUIRE(cachedA == cachedB);
+    REQUIRE(cachedA->getModule() != nullptr);
+    REQUIRE(moduleCache.getTotalCachedModuleCount() == 1);
+
+    // Check a different function gets a different module
+    auto otherReq = setUpContext("demo", "hello");
+    faabric::Message& otherMsg = otherReq->mutable_messages()->at(0);
+    auto cachedOther = moduleCache.getModule(otherMsg);
+    REQUIRE(cachedOther != cachedA);
+    REQUIRE(moduleCache.getTotalCachedModuleCount() == 2);
+
+    // Check instances of the same function share the module, and can both
+    // execute independently
+    wasm::WAMRWasmModule moduleA;
+    moduleA.bindToFunction(msgA);
+    wasm::WAMRWasmModule moduleB;
+    moduleB.bindToFunction(msgB);
+    REQUIRE(cachedA.use_count() == 5);
+
+    REQUIRE(moduleA.executeFunction(msgA) == 0);
+    REQUIRE(moduleB.executeFunction(msgB) == 0);
+
+    // Clearing the cache must not unload modules that are still in use
+    moduleCache.clear();
+    REQUIRE(moduleCache.getTotalCachedModuleCount() == 0);
+    REQUIRE(cachedA.use_count() == 4);
+
+    moduleA.reset(msgA, "");
+    REQUIRE(moduleA.executeFunction(msgA) == 0);
+}
+
+TEST_CASE_METHOD(FunctionExecTestFixture,
+                 "Test tearing down WAMR with cached modules",
+                 "[wamr]")
+{
+    auto req = setUpContext("demo", "echo");
+    faabric::Message& msg = req->mutable_messages()->at(0);
+
+    wasm::WAMRModuleCache& moduleCache = wasm::getWAMRModuleCache();
+    wasm::WAMRWasmModule::initialiseWAMRGlobally();
+    moduleCache.clear();
+
+    auto unusedReq = setUpContext("demo", "hello");
+    moduleCache.getModule(unusedReq->mutable_messages()->at(0));
+    auto cached = moduleCache.getModule(msg);
+    REQUIRE(moduleCache.getTotalCachedModuleCount() == 2);
+
+    // Check the teardown unloads the cached modules first
+    wasm::WAMRWasmModule::destroyWAMRGlobally();
+    REQUIRE(moduleCache.getTotalCachedModuleCount() == 0);
+
+    // Modules still in use when the runtime is gone are left alone
+    cached = nullptr;
+
+    // Check modules can be loaded again once the runtime is back
+    wasm::WAMRWasmModule::initialiseWAMRGlobally();
+    wasm::WAMRWasmModule module;
+    module.bindToFunction(msg);
+    REQUIRE(module.executeFunction(msg) == 0);
+}
+
+class WAMRTieredTestFixture : public FunctionLoaderTestFixture
+{
+  public:
+    WAMRTieredTestFixture()
+      : moduleCache(wasm::getWAMRModuleCache())
+    {
+        // Switch off test mode to start from an empty local cache
+        faabric::util::setTestMode(false);
+        loader.clearLocalCache();
+
+        wasm::WAMRWasmModule::initialiseWAMRGlobally();
+        moduleCache.clear();
+
+        faasmConf.wasmVm = "wamr";
+        faasmConf.wamrTiered = "on";
+    }
+
+    ~WAMRTieredTestFixture()
+    {
+        moduleCache.waitForBackgroundCodegen();
+        moduleCache.clear();
+        loader.clearLocalCache();
+        faabric::util::setTestMode(true);
+    }
+
+  protected:
+    wasm::WAMRModuleCache& moduleCache;
+};
+
+TEST_CASE_METHOD(WAMRTieredTestFixture,
+                 "Test interpreting WAMR modules until AOT file is ready",
+                 "[wamr]")
+{
+    // Upload the function without running codegen
+    loader.uploadFunction(msgB);
+    REQUIRE(loader.loadFunctionWamrAotHash(msgB).empty());
+
+    // Check the first lookup loads an interpreted module we can instantiate
+    auto interpreted = moduleCache.getModule(msgB);
+    REQUIRE(interpreted->isInterpreted());
+    REQUIRE(interpreted->hash.empty());
+
+    wasm::WAMRWasmModule module;
+    module.bindToFunction(msgB);
+    REQUIRE(module.getMemorySizeBytes() > 0);
+
+    // Lookups before the AOT file is ready reuse the interpreted module
+    REQUIRE(moduleCache.getModule(msgB) == interpreted);
+
+    // Check clearing the cache doesn't wait for the codegen
+    REQUIRE(moduleCache.isGeneratingInBackground(msgB));
+    moduleCache.clear();
+    REQUIRE(moduleCache.getTotalCachedModuleCount() == 0);
+
+    // Once the background codegen finishes, check lookups switch to the AOT
+    // file
+    moduleCache.waitForBackgroundCodegen();
+    REQUIRE(!moduleCache.isGeneratingInBackground(msgB));
+    REQUIRE(!loader.loadFunctionWamrAotHash(msgB).empty());
+
+    auto compiled = moduleCache.getModule(msgB);
+    REQUIRE(compiled != interpreted);
+    REQUIRE(!compiled->isInterpreted());
+    REQUIRE(!compiled->hash.empty());
+    REQUIRE(moduleCache.getTotalCachedModuleCount() == 1);
+
+    // Check dropping the AOT hashes (as on upload) goes back to interpreting
+    loader.deleteFunctionWamrAotHashes(msgB);
+    REQUIRE(loader.loadFunctionWamrAotHash(msgB).empty());
+    REQUIRE(moduleCache.getModule(msgB)->isInterpreted());
+
+    // Check the AOT file is generated again
+    REQUIRE(moduleCache.isGeneratingInBackground(msgB));
+    moduleCache.waitForBackgroundCodegen();
+    REQUIRE(!moduleCache.getModule(msgB)->isInterpreted());
+}
+
+TEST_CASE_METHOD(WAMRTieredTestFixture,
+                 "Test background WAMR codegen specialises for ISAs",
+                 "[wamr]")
+{
+    if (!conf::hostSupportsIsa(ISA_AVX2)) {
+        return;
+    }
+
+    faasmConf.codegenIsas = ISA_AVX2;
+
+    loader.uploadFunction(msgB);
+    REQUIRE(moduleCache.getModule(msgB)->isInterpreted());
+    moduleCache.waitForBackgroundCodegen();
+
+    // Check the specialised AOT file is generated from the same wasm
+    std::vector<uint8_t> hash = loader.loadFunctionWamrAotHash(msgB);
+    REQUIRE(!hash.empty());
+    REQUIRE(loader.loadFunctionWamrAotHash(msgB, ISA_AVX2) == hash);
+    REQUIRE(std::filesystem::exists(loader.getFunctionAotFile(msgB, ISA_AVX2)));
+
+    REQUIRE(!moduleCache.getModule(msgB)->isInterpreted());
+}
+}
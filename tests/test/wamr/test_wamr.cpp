@@ -3,11 +3,17 @@
 #include "faasm_fixtures.h"
 
 #include <conf/FaasmConfig.h>
+#include <faabric/snapshot/SnapshotRegistry.h>
 #include <faabric/util/config.h>
+#include <faabric/util/files.h>
 #include <faabric/util/func.h>
+#include <faabric/util/memory.h>
 #include <faaslet/Faaslet.h>
 #include <wamr/WAMRWasmModule.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 using namespace wasm;
 
 namespace tests {
@@ -121,6 +127,99 @@ TEST_CASE_METHOD(FunctionExecTestFixture, "Test WAMR sbrk", "[wamr]")
     wasm_runtime_destroy_thread_env();
 }
 
+TEST_CASE_METHOD(FunctionExecTestFixture,
+                 "Test WAMR reset from snapshot",
+                 "[wamr]")
+{
+    auto req = setUpContext("demo", "echo");
+    faabric::Message& call = req->mutable_messages()->at(0);
+
+    faabric::snapshot::SnapshotRegistry& reg =
+      faabric::snapshot::getSnapshotRegistry();
+
+    wasm_runtime_init_thread_env();
+    wasm::WAMRWasmModule module;
+    module.bindToFunction(call);
+
+    size_t postBindSize = module.getMemorySizeBytes();
+    std::string resetKey = module.registerResetSnapshot(call);
+    REQUIRE(reg.getSnapshot(resetKey)->getSize() == postBindSize);
+
+    // Registering again must not overwrite the existing snapshot
+    REQUIRE(module.registerResetSnapshot(call) == resetKey);
+
+    // Record the default data, then dirty memory and grow it
+    uint8_t* memoryBase = module.getMemoryBase();
+    std::vector<uint8_t> defaultData(memoryBase, memoryBase + 100);
+    std::vector<uint8_t> dummyData(100, 3);
+    REQUIRE(dummyData != defaultData);
+    std::memcpy(memoryBase, dummyData.data(), dummyData.size());
+
+    uint32_t growPtr = module.growMemory(5 * WASM_BYTES_PER_PAGE);
+    module.wasmPointerToNative(growPtr)[0] = 4;
+    REQUIRE(module.getCurrentBrk() == postBindSize + 5 * WASM_BYTES_PER_PAGE);
+
+    module.reset(call, resetKey);
+
+    // Check the memory is restored without re-instantiating the module
+    REQUIRE(module.getMemoryBase() == memoryBase);
+    REQUIRE(module.getCurrentBrk() == postBindSize);
+    std::vector<uint8_t> dataAfter(memoryBase, memoryBase + 100);
+    REQUIRE(dataAfter == defaultData);
+
+    // Check memory above the snapshot is zeroed when claimed again
+    uint32_t regrowPtr = module.growMemory(5 * WASM_BYTES_PER_PAGE);
+    REQUIRE(regrowPtr == growPtr);
+    REQUIRE(module.wasmPointerToNative(regrowPtr)[0] == 0);
+
+    // Check memory above the snapshot is zeroed when it was last mapped from
+    // a larger snapshot
+    module.wasmPointerToNative(regrowPtr)[0] = 5;
+    std::string largerKey = module.snapshot();
+    module.restore(largerKey);
+    REQUIRE(module.wasmPointerToNative(regrowPtr)[0] == 5);
+
+    module.reset(call, resetKey);
+    REQUIRE(module.getCurrentBrk() == postBindSize);
+    REQUIRE(module.growMemory(5 * WASM_BYTES_PER_PAGE) == growPtr);
+    REQUIRE(module.wasmPointerToNative(growPtr)[0] == 0);
+
+    // Check files mapped into memory are unmapped by the reset, so that
+    // reusing the memory doesn't write to them
+    std::string fileName = "/tmp/wamr_reset_mmap_test.bin";
+    std::vector<uint8_t> contents(faabric::util::HOST_PAGE_SIZE, 7);
+    faabric::util::writeBytesToFile(fileName, contents);
+    int hostFd = open(fileName.c_str(), O_RDWR);
+    REQUIRE(hostFd > 0);
+
+    module.reset(call, resetKey);
+    uint32_t filePtr = module.mmapFile(hostFd, contents.size(), true);
+    close(hostFd);
+    REQUIRE(filePtr == postBindSize);
+    REQUIRE(module.wasmPointerToNative(filePtr)[0] == 7);
+
+    module.reset(call, resetKey);
+    REQUIRE(module.growMemory(WASM_BYTES_PER_PAGE) == filePtr);
+    uint8_t* reusedPtr = module.wasmPointerToNative(filePtr);
+    REQUIRE(reusedPtr[0] == 0);
+    reusedPtr[0] = 1;
+    REQUIRE(faabric::util::readFileToBytes(fileName) == contents);
+
+    // Nothing is left mapped for the program to unmap
+    module.unmapFile(filePtr, contents.size());
+    REQUIRE(module.wasmPointerToNative(filePtr)[0] == 1);
+
+    remove(fileName.c_str());
+
+    // Check the module can still execute after the reset
+    module.reset(call, resetKey);
+    REQUIRE(module.executeFunction(call) == 0);
+
+    reg.clear();
+
+    wasm_runtime_destroy_thread_env();
+}
+
 TEST_CASE_METHOD(FunctionExecTestFixture,
                  "Test allocating memory in the WASM module from the runtime",
                  "[wamr]")
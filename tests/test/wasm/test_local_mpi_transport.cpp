@@ -0,0 +1,212 @@
+#include <catch2/catch.hpp>
+
+#include <wasm/LocalMpiTransport.h>
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace wasm;
+
+namespace tests {
+
+static void checkSendAndReceive(size_t nBytes, bool recvFirst)
+{
+    LocalMpiTransport transport;
+    int worldId = 123;
+
+    std::vector<uint8_t> sendData(nBytes, 5);
+    std::vector<uint8_t> recvData(nBytes + 10, 0);
+
+    if (recvFirst) {
+        size_t received = 0;
+        std::thread receiver([&] {
+            received = transport.recv(
+              worldId, 0, 1, recvData.data(), recvData.size());
+        });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        transport.send(worldId, 0, 1, sendData.data(), sendData.size());
+        receiver.join();
+        REQUIRE(received == nBytes);
+    } else {
+        // Large sends must not wait for the receive forever
+        transport.send(worldId, 0, 1, sendData.data(), sendData.size());
+        REQUIRE(transport.probe(worldId, 0, 1) == nBytes);
+
+        // The sender may reuse its buffer once the send returns
+        std::fill(sendData.begin(), sendData.end(), 0);
+
+        size_t received =
+          transport.recv(worldId, 0, 1, recvData.data(), recvData.size());
+        REQUIRE(received == nBytes);
+    }
+
+    std::vector<uint8_t> expected(nBytes, 5);
+    expected.resize(nBytes + 10, 0);
+    REQUIRE(recvData == expected);
+}
+
+TEST_CASE("Test local MPI transport send and receive", "[wasm][mpi]")
+{
+    // Small messages are buffered, large ones copied straight across
+    size_t smallBytes = 100;
+    size_t largeBytes = 4 * LOCAL_MPI_EAGER_LIMIT;
+
+    SECTION("Small, receive posted first")
+    {
+        checkSendAndReceive(smallBytes, true);
+    }
+
+    SECTION("Small, send first")
+    {
+        checkSendAndReceive(smallBytes, false);
+    }
+
+    SECTION("Large, receive posted first")
+    {
+        checkSendAndReceive(largeBytes, true);
+    }
+
+    SECTION("Large, send first")
+    {
+        checkSendAndReceive(largeBytes, false);
+    }
+}
+
+TEST_CASE("Test local MPI transport ordering", "[wasm][mpi]")
+{
+    LocalMpiTransport transport;
+    int worldId = 123;
+    int nMessages = 10;
+
+    std::vector<std::vector<int>> sendData;
+    std::vector<std::vector<int>> recvData(nMessages, std::vector<int>(1, -1));
+    std::vector<int> requestIds;
+    for (int i = 0; i < nMessages; i++) {
+        sendData.push_back({ i });
+        requestIds.push_back(transport.isend(worldId,
+                                             1,
+                                             0,
+                                             (uint8_t*)sendData.at(i).data(),
+                                             sizeof(int)));
+    }
+
+    for (int i = 0; i < nMessages; i++) {
+        requestIds.push_back(transport.irecv(worldId,
+                                             1,
+                                             0,
+                                             (uint8_t*)recvData.at(i).data(),
+                                             sizeof(int)));
+    }
+
+    for (int requestId : requestIds) {
+        REQUIRE(LocalMpiTransport::isLocalRequest(requestId));
+        REQUIRE(transport.await(requestId) == sizeof(int));
+    }
+
+    REQUIRE(recvData == sendData);
+
+    // Other pairs of ranks have their own channel
+    int value = 7;
+    int received = 0;
+    transport.send(worldId, 0, 1, (uint8_t*)&value, sizeof(int));
+    transport.send(worldId + 1, 1, 0, (uint8_t*)&value, sizeof(int));
+    transport.recv(worldId, 0, 1, (uint8_t*)&received, sizeof(int));
+    REQUIRE(received == 7);
+}
+
+TEST_CASE("Test local MPI transport tags", "[wasm][mpi]")
+{
+    LocalMpiTransport transport;
+    int worldId = 123;
+    int tag = 5;
+
+    // A message with another tag sent first must not be matched
+    int untagged = 1;
+    int tagged = 2;
+    transport.send(worldId, 0, 1, (uint8_t*)&untagged, sizeof(int));
+    transport.send(worldId, 0, 1, (uint8_t*)&tagged, sizeof(int), tag);
+    REQUIRE(transport.probe(worldId, 0, 1, tag) == sizeof(int));
+
+    int received = 0;
+    transport.recv(worldId, 0, 1, (uint8_t*)&received, sizeof(int), tag);
+    REQUIRE(received == tagged);
+
+    transport.recv(worldId, 0, 1, (uint8_t*)&received, sizeof(int));
+    REQUIRE(received == untagged);
+
+    // Removing a receiver drops its channels for every tag
+    transport.send(worldId, 0, 1, (uint8_t*)&tagged, sizeof(int), tag);
+    transport.removeReceiver(worldId, 1);
+
+    std::thread sender([&transport, worldId, tag] {
+        int value = 3;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        transport.send(worldId, 0, 1, (uint8_t*)&value, sizeof(int), tag);
+    });
+    transport.recv(worldId, 0, 1, (uint8_t*)&received, sizeof(int), tag);
+    sender.join();
+    REQUIRE(received == 3);
+}
+
+TEST_CASE("Test local MPI transport truncation", "[wasm][mpi]")
+{
+    LocalMpiTransport transport;
+    int worldId = 123;
+
+    std::vector<uint8_t> sendData(100, 1);
+    std::vector<uint8_t> recvData(10, 0);
+    transport.send(worldId, 0, 1, sendData.data(), sendData.size());
+    REQUIRE_THROWS_AS(
+      transport.recv(worldId, 0, 1, recvData.data(), recvData.size()),
+      std::runtime_error);
+
+    REQUIRE_THROWS(transport.await(-12345));
+}
+
+TEST_CASE("Test local MPI group sharing buffers", "[wasm][mpi]")
+{
+    std::vector<int> ranks = { 6, 2, 4 };
+    LocalMpiGroup group(ranks);
+    REQUIRE(group.ranks == std::vector<int>({ 2, 4, 6 }));
+    REQUIRE(group.getLocalIdx(4) == 1);
+    REQUIRE_THROWS(group.getLocalIdx(3));
+
+    // Each rank sums everyone's inputs, read from their buffers directly
+    int nRounds = 20;
+    std::vector<std::vector<int>> results(ranks.size());
+    std::vector<std::thread> threads;
+    for (int rank : ranks) {
+        threads.emplace_back([&group, &results, rank, nRounds] {
+            int localIdx = group.getLocalIdx(rank);
+            for (int round = 0; round < nRounds; round++) {
+                int input = rank * round;
+                int output = 0;
+                group.shareBuffers(rank, (uint8_t*)&input, (uint8_t*)&output);
+
+                for (int i = 0; i < (int)group.ranks.size(); i++) {
+                    output += *(const int*)group.getSendBuffer(i);
+                }
+                results.at(localIdx).push_back(output);
+
+                // Others must not read our input once we've moved on
+                group.barrier();
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (const auto& result : results) {
+        REQUIRE(result.size() == (size_t)nRounds);
+        for (int round = 0; round < nRounds; round++) {
+            REQUIRE(result.at(round) == 12 * round);
+        }
+    }
+}
+}
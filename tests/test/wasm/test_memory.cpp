@@ -10,6 +10,8 @@
 #include <faabric/util/config.h>
 #include <faabric/util/files.h>
 #include <faabric/util/func.h>
+#include <faabric/util/memory.h>
+#include <storage/FileMapping.h>
 
 #include <fcntl.h>
 #include <sys/mman.h>
@@ -73,6 +75,157 @@ TEST_CASE_METHOD(MultiRuntimeFunctionExecTestFixture,
     REQUIRE(equal);
 }
 
+TEST_CASE_METHOD(MultiRuntimeFunctionExecTestFixture,
+                 "Test WAMR private and shared file mappings",
+                 "[wasm]")
+{
+    faabric::Message call = faabric::util::messageFactory("demo", "echo");
+    faasmConf.wasmVm = "wamr";
+    wasm::WAMRWasmModule module;
+    module.bindToFunction(call);
+
+    std::string fileName = "/tmp/wamr_mmap_test.bin";
+    std::vector<uint8_t> contents(5000, 7);
+    faabric::util::writeBytesToFile(fileName, contents);
+    int hostFd = open(fileName.c_str(), O_RDWR);
+    REQUIRE(hostFd > 0);
+
+    bool shared = false;
+    std::vector<uint8_t> expected = contents;
+
+    SECTION("Private")
+    {
+        shared = false;
+    }
+
+    SECTION("Shared")
+    {
+        shared = true;
+        expected.at(0) = 1;
+    }
+
+    // Map more than the file, the rest should be zeroed
+    size_t mapLength = 3 * WASM_BYTES_PER_PAGE;
+    uint32_t wasmPtr = module.mmapFile(hostFd, mapLength, shared);
+    uint8_t* hostPtr = module.wasmPointerToNative(wasmPtr);
+    REQUIRE(std::vector<uint8_t>(hostPtr, hostPtr + contents.size()) ==
+            contents);
+    REQUIRE(hostPtr[contents.size()] == 0);
+    REQUIRE(hostPtr[mapLength - 1] == 0);
+
+    // Only shared mappings write through to the file
+    hostPtr[0] = 1;
+    REQUIRE(msync(hostPtr, contents.size(), MS_SYNC) == 0);
+    close(hostFd);
+    REQUIRE(faabric::util::readFileToBytes(fileName) == expected);
+
+    // Unmapping leaves zeroed memory behind
+    module.unmapFile(wasmPtr, mapLength);
+    hostPtr = module.wasmPointerToNative(wasmPtr);
+    REQUIRE(hostPtr[0] == 0);
+    REQUIRE(faabric::util::readFileToBytes(fileName) == expected);
+
+    remove(fileName.c_str());
+}
+
+TEST_CASE_METHOD(MultiRuntimeFunctionExecTestFixture,
+                 "Test WAMR partial file unmapping",
+                 "[wasm]")
+{
+    faabric::Message call = faabric::util::messageFactory("demo", "echo");
+    faasmConf.wasmVm = "wamr";
+    wasm::WAMRWasmModule module;
+    module.bindToFunction(call);
+
+    size_t pageSize = faabric::util::HOST_PAGE_SIZE;
+    std::string fileName = "/tmp/wamr_munmap_test.bin";
+    std::vector<uint8_t> contents(4 * pageSize, 7);
+    faabric::util::writeBytesToFile(fileName, contents);
+    int hostFd = open(fileName.c_str(), O_RDWR);
+    REQUIRE(hostFd > 0);
+
+    uint32_t wasmPtr = module.mmapFile(hostFd, contents.size(), true);
+    close(hostFd);
+
+    // Unmap the second page, and part of the third, which rounds up
+    module.unmapFile(wasmPtr + pageSize, pageSize + 10);
+
+    uint8_t* hostPtr = module.wasmPointerToNative(wasmPtr);
+    REQUIRE(hostPtr[0] == 7);
+    REQUIRE(hostPtr[pageSize] == 0);
+    REQUIRE(hostPtr[2 * pageSize + 10] == 0);
+    REQUIRE(hostPtr[3 * pageSize] == 7);
+
+    // Only the pages either side are still mapped from the file
+    hostPtr[0] = 1;
+    hostPtr[pageSize] = 1;
+    hostPtr[3 * pageSize] = 1;
+    REQUIRE(msync(hostPtr, pageSize, MS_SYNC) == 0);
+    REQUIRE(msync(hostPtr + 3 * pageSize, pageSize, MS_SYNC) == 0);
+
+    std::vector<uint8_t> expected = contents;
+    expected.at(0) = 1;
+    expected.at(3 * pageSize) = 1;
+    REQUIRE(faabric::util::readFileToBytes(fileName) == expected);
+
+    // Unmapping a range covering both what's left and memory that is no
+    // longer mapped leaves zeroed memory behind
+    module.unmapFile(wasmPtr, contents.size());
+    hostPtr = module.wasmPointerToNative(wasmPtr);
+    REQUIRE(hostPtr[0] == 0);
+    REQUIRE(hostPtr[pageSize] == 0);
+    REQUIRE(hostPtr[3 * pageSize] == 0);
+
+    hostPtr[0] = 2;
+    REQUIRE(faabric::util::readFileToBytes(fileName) == expected);
+
+    remove(fileName.c_str());
+}
+
+TEST_CASE_METHOD(MultiRuntimeFunctionExecTestFixture,
+                 "Test WAMR files can't be shrunk while mapped",
+                 "[wasm]")
+{
+    faabric::Message call = faabric::util::messageFactory("demo", "echo");
+    faasmConf.wasmVm = "wamr";
+    wasm::WAMRWasmModule module;
+    module.bindToFunction(call);
+
+    size_t pageSize = faabric::util::HOST_PAGE_SIZE;
+    std::string fileName = "/tmp/wamr_truncate_test.bin";
+    std::vector<uint8_t> contents(3 * pageSize, 7);
+    faabric::util::writeBytesToFile(fileName, contents);
+    int hostFd = open(fileName.c_str(), O_RDWR);
+    REQUIRE(hostFd > 0);
+
+    // Map more than the file holds, as only the file itself is mapped
+    uint32_t wasmPtr = module.mmapFile(hostFd, 4 * pageSize, true);
+    REQUIRE(storage::FileMapping::getMinFileSize(hostFd) == contents.size());
+
+    // The file stays mapped until every part of it is unmapped
+    SECTION("Partial unmapping")
+    {
+        module.unmapFile(wasmPtr, pageSize);
+        REQUIRE(storage::FileMapping::getMinFileSize(hostFd) ==
+                contents.size());
+
+        module.unmapFile(wasmPtr + pageSize, 2 * pageSize);
+    }
+
+    SECTION("Whole unmapping") { module.unmapFile(wasmPtr, 4 * pageSize); }
+
+    REQUIRE(storage::FileMapping::getMinFileSize(hostFd) == 0);
+
+    // Mappings are dropped along with the module's memory on reset
+    module.mmapFile(hostFd, contents.size(), false);
+    REQUIRE(storage::FileMapping::getMinFileSize(hostFd) == contents.size());
+    module.reset(call, "");
+    REQUIRE(storage::FileMapping::getMinFileSize(hostFd) == 0);
+
+    close(hostFd);
+    remove(fileName.c_str());
+}
+
 TEST_CASE_METHOD(MultiRuntimeFunctionExecTestFixture,
                  "Test memory growth and shrinkage",
                  "[wasm]")
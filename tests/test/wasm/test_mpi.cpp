@@ -0,0 +1,518 @@
+#include <catch2/catch.hpp>
+
+#include <faabric/batch-scheduler/SchedulingDecision.h>
+#include <faabric/executor/ExecutorContext.h>
+#include <faabric/mpi/MpiWorld.h>
+#include <faabric/transport/PointToPointBroker.h>
+#include <faabric/util/batch.h>
+#include <faabric/util/config.h>
+#include <wasm/mpi.h>
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace tests {
+
+/*
+ * Runs each rank of a world on its own thread, in a point-to-point group with
+ * every rank on this host, so their messages go through the local transport.
+ */
+class HostMpiTestFixture
+{
+  public:
+    HostMpiTestFixture()
+    {
+        std::string thisHost = faabric::util::getSystemConfig().endpointHost;
+        faabric::batch_scheduler::SchedulingDecision decision(appId, groupId);
+        for (int rank = 0; rank < worldSize; rank++) {
+            decision.addMessage(thisHost, rank + 1, rank, rank);
+        }
+
+        faabric::transport::getPointToPointBroker()
+          .setUpLocalMappingsFromSchedulingDecision(decision);
+    }
+
+    ~HostMpiTestFixture()
+    {
+        for (int rank = 0; rank < worldSize; rank++) {
+            wasm::doMpiFinalize(world, rank);
+        }
+
+        faabric::transport::getPointToPointBroker().clear();
+    }
+
+    void runRanks(const std::function<void(int)>& f)
+    {
+        std::vector<std::thread> threads;
+        for (int rank = 0; rank < worldSize; rank++) {
+            threads.emplace_back([this, &f, rank] {
+                auto req = faabric::util::batchExecFactory("mpi", "hosts", 1);
+                req->mutable_messages(0)->set_groupid(groupId);
+                req->mutable_messages(0)->set_groupidx(rank);
+                faabric::executor::ExecutorContext::set(nullptr, req, 0);
+
+                f(rank);
+
+                faabric::executor::ExecutorContext::unset();
+            });
+        }
+
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    // Enough elements of the given size to fill the given number of chunks,
+    // plus a few more
+    static int getChunkedCount(size_t elemSize, int nChunks)
+    {
+        return nChunks * (MPI_COLLECTIVE_CHUNK_SIZE / elemSize) + 3;
+    }
+
+  protected:
+    int appId = 1234;
+    int groupId = 5678;
+    int worldSize = 4;
+
+    faabric::mpi::MpiWorld world;
+};
+
+TEST_CASE_METHOD(HostMpiTestFixture, "Test MPI ring allreduce", "[wasm][mpi]")
+{
+    int count = 0;
+
+    SECTION("Fewer elements than ranks")
+    {
+        count = worldSize - 1;
+    }
+
+    SECTION("Single chunk")
+    {
+        count = 1000;
+    }
+
+    // Each rank's segment is a few chunks long
+    SECTION("Many chunks")
+    {
+        count = getChunkedCount(sizeof(int32_t), 3 * worldSize);
+    }
+
+    // The ring doesn't have to be in rank order
+    std::vector<int> ring = { 2, 0, 3, 1 };
+    std::vector<std::vector<int32_t>> results(worldSize);
+    std::vector<int> p2pResults(worldSize, -1);
+
+    runRanks([&](int rank) {
+        std::vector<int32_t> buffer(count);
+        std::iota(buffer.begin(), buffer.end(), rank);
+
+        // The program's own messages between the same ranks are left alone
+        int next = (rank + 1) % worldSize;
+        int prev = (rank + worldSize - 1) % worldSize;
+        int p2pSend = 100 + rank;
+        int sendId =
+          wasm::doMpiIsend(world, rank, next, (uint8_t*)&p2pSend, MPI_INT, 1);
+
+        wasm::doMpiRingAllReduce(
+          world, rank, ring, (uint8_t*)buffer.data(), MPI_INT, count, MPI_SUM);
+
+        MPI_Status status;
+        wasm::doMpiRecv(world,
+                        rank,
+                        prev,
+                        (uint8_t*)&p2pResults.at(rank),
+                        MPI_INT,
+                        1,
+                        &status);
+        wasm::doMpiAwait(world, sendId);
+
+        results.at(rank) = std::move(buffer);
+    });
+
+    // Sum over ranks of (rank + i)
+    int rankSum = worldSize * (worldSize - 1) / 2;
+    std::vector<int32_t> expected(count);
+    for (int i = 0; i < count; i++) {
+        expected.at(i) = rankSum + worldSize * i;
+    }
+
+    for (int rank = 0; rank < worldSize; rank++) {
+        REQUIRE(results.at(rank) == expected);
+        REQUIRE(p2pResults.at(rank) ==
+                100 + (rank + worldSize - 1) % worldSize);
+    }
+}
+
+TEST_CASE_METHOD(HostMpiTestFixture,
+                 "Test MPI chained broadcast",
+                 "[wasm][mpi]")
+{
+    int count = 0;
+
+    SECTION("Single chunk")
+    {
+        count = 1000;
+    }
+
+    SECTION("Many chunks")
+    {
+        count = getChunkedCount(sizeof(double), 5);
+    }
+
+    // The first rank in the chain is the root
+    std::vector<int> chain = { 3, 1, 0, 2 };
+    std::vector<std::vector<double>> results(worldSize);
+
+    runRanks([&](int rank) {
+        std::vector<double> buffer(count, 0);
+        if (rank == chain.front()) {
+            for (int i = 0; i < count; i++) {
+                buffer.at(i) = 0.5 * i;
+            }
+        }
+
+        wasm::doMpiChainBroadcast(
+          world, rank, chain, (uint8_t*)buffer.data(), MPI_DOUBLE, count);
+
+        results.at(rank) = std::move(buffer);
+    });
+
+    std::vector<double> expected(count);
+    for (int i = 0; i < count; i++) {
+        expected.at(i) = 0.5 * i;
+    }
+
+    for (int rank = 0; rank < worldSize; rank++) {
+        REQUIRE(results.at(rank) == expected);
+    }
+}
+
+TEST_CASE_METHOD(HostMpiTestFixture, "Test MPI alltoallv", "[wasm][mpi]")
+{
+    // Each rank sends a different number of elements to each other rank, and
+    // nothing to some of them. Blocks are out of order in the send buffer
+    auto getCount = [](int from, int to) {
+        int count = (3 * from + to) % 4;
+        return count == 3 ? getChunkedCount(sizeof(int32_t), 2) : count;
+    };
+
+    auto getValue = [](int from, int to, int i) {
+        return 1000000 * from + 10000 * to + i;
+    };
+
+    std::vector<std::vector<int32_t>> results(worldSize);
+    std::vector<std::vector<int32_t>> expected(worldSize);
+    for (int rank = 0; rank < worldSize; rank++) {
+        for (int from = 0; from < worldSize; from++) {
+            for (int i = 0; i < getCount(from, rank); i++) {
+                expected.at(rank).push_back(getValue(from, rank, i));
+            }
+        }
+    }
+
+    runRanks([&](int rank) {
+        std::vector<int32_t> sendCounts(worldSize);
+        std::vector<int32_t> sendDispls(worldSize);
+        std::vector<int32_t> sendBuffer;
+        for (int to = worldSize - 1; to >= 0; to--) {
+            sendCounts.at(to) = getCount(rank, to);
+            sendDispls.at(to) = sendBuffer.size();
+            for (int i = 0; i < sendCounts.at(to); i++) {
+                sendBuffer.push_back(getValue(rank, to, i));
+            }
+        }
+
+        std::vector<int32_t> recvCounts(worldSize);
+        std::vector<int32_t> recvDispls(worldSize, 0);
+        for (int from = 0; from < worldSize; from++) {
+            recvCounts.at(from) = getCount(from, rank);
+            if (from > 0) {
+                recvDispls.at(from) =
+                  recvDispls.at(from - 1) + recvCounts.at(from - 1);
+            }
+        }
+
+        std::vector<int32_t> recvBuffer(recvDispls.back() + recvCounts.back());
+        wasm::doMpiAllToAllV(world,
+                             rank,
+                             (uint8_t*)sendBuffer.data(),
+                             sendCounts,
+                             sendDispls,
+                             MPI_INT,
+                             (uint8_t*)recvBuffer.data(),
+                             recvCounts,
+                             recvDispls,
+                             MPI_INT,
+                             faabric::mpi::MpiMessageType::ALLTOALL);
+
+        results.at(rank) = std::move(recvBuffer);
+    });
+
+    for (int rank = 0; rank < worldSize; rank++) {
+        REQUIRE(results.at(rank) == expected.at(rank));
+    }
+}
+
+TEST_CASE_METHOD(HostMpiTestFixture, "Test MPI allgatherv", "[wasm][mpi]")
+{
+    bool inPlace = false;
+
+    SECTION("Separate buffers")
+    {
+        inPlace = false;
+    }
+
+    // The rank's own block is already in the receive buffer
+    SECTION("In place")
+    {
+        inPlace = true;
+    }
+
+    // Blocks have gaps between them in the receive buffer
+    std::vector<int32_t> recvCounts = { 2, 0, 1000, 7 };
+    std::vector<int32_t> displs = { 1, 4, 4, 1010 };
+    int recvSize = 1020;
+
+    std::vector<double> expected(recvSize, -1);
+    for (int rank = 0; rank < worldSize; rank++) {
+        for (int i = 0; i < recvCounts.at(rank); i++) {
+            expected.at(displs.at(rank) + i) = rank + 0.5 * i;
+        }
+    }
+
+    std::vector<std::vector<double>> results(worldSize);
+    runRanks([&](int rank) {
+        std::vector<double> block(recvCounts.at(rank));
+        for (int i = 0; i < recvCounts.at(rank); i++) {
+            block.at(i) = rank + 0.5 * i;
+        }
+
+        std::vector<double> recvBuffer(recvSize, -1);
+        std::vector<int32_t> sendCounts(worldSize, recvCounts.at(rank));
+        std::vector<int32_t> sendDispls(worldSize, 0);
+        uint8_t* sendBuffer = (uint8_t*)block.data();
+        if (inPlace) {
+            std::copy(block.begin(),
+                      block.end(),
+                      recvBuffer.begin() + displs.at(rank));
+            sendBuffer = (uint8_t*)recvBuffer.data();
+            sendDispls.assign(worldSize, displs.at(rank));
+        }
+
+        wasm::doMpiAllToAllV(world,
+                             rank,
+                             sendBuffer,
+                             sendCounts,
+                             sendDispls,
+                             MPI_DOUBLE,
+                             (uint8_t*)recvBuffer.data(),
+                             recvCounts,
+                             displs,
+                             MPI_DOUBLE,
+                             faabric::mpi::MpiMessageType::ALLGATHER);
+
+        results.at(rank) = std::move(recvBuffer);
+    });
+
+    for (int rank = 0; rank < worldSize; rank++) {
+        REQUIRE(results.at(rank) == expected);
+    }
+}
+
+TEST_CASE_METHOD(HostMpiTestFixture,
+                 "Test MPI reduce scatter",
+                 "[wasm][mpi]")
+{
+    bool inPlace = false;
+
+    SECTION("Separate buffers")
+    {
+        inPlace = false;
+    }
+
+    SECTION("In place")
+    {
+        inPlace = true;
+    }
+
+    // The root's block is empty, and one block is a few chunks long
+    std::vector<int32_t> recvCounts = {
+        0, 5, getChunkedCount(sizeof(int32_t), 3), 1
+    };
+    int totalCount =
+      std::accumulate(recvCounts.begin(), recvCounts.end(), 0);
+
+    // Sum over ranks of (rank + i)
+    int rankSum = worldSize * (worldSize - 1) / 2;
+    std::vector<int32_t> reduced(totalCount);
+    for (int i = 0; i < totalCount; i++) {
+        reduced.at(i) = rankSum + worldSize * i;
+    }
+
+    std::vector<std::vector<int32_t>> results(worldSize);
+    runRanks([&](int rank) {
+        std::vector<int32_t> input(totalCount);
+        std::iota(input.begin(), input.end(), rank);
+
+        std::vector<int32_t> recvBuffer(recvCounts.at(rank));
+        uint8_t* sendBuffer = (uint8_t*)input.data();
+        uint8_t* recvPtr = (uint8_t*)recvBuffer.data();
+        if (inPlace) {
+            sendBuffer = recvPtr = (uint8_t*)input.data();
+        }
+
+        wasm::doMpiReduceScatter(
+          world, rank, sendBuffer, recvPtr, recvCounts, MPI_INT, MPI_SUM);
+
+        if (inPlace) {
+            input.resize(recvCounts.at(rank));
+            recvBuffer = std::move(input);
+        }
+        results.at(rank) = std::move(recvBuffer);
+    });
+
+    int offset = 0;
+    for (int rank = 0; rank < worldSize; rank++) {
+        std::vector<int32_t> expected(reduced.begin() + offset,
+                                      reduced.begin() + offset +
+                                        recvCounts.at(rank));
+        REQUIRE(results.at(rank) == expected);
+        offset += recvCounts.at(rank);
+    }
+}
+
+TEST_CASE_METHOD(HostMpiTestFixture, "Test MPI probe", "[wasm][mpi]")
+{
+    std::vector<int32_t> sent = { 1, 2, 3, 4, 5, 6, 7 };
+    MPI_Status status;
+    std::vector<int32_t> received(sent.size());
+
+    runRanks([&](int rank) {
+        if (rank == 2) {
+            wasm::doMpiSend(
+              world, rank, 1, (uint8_t*)sent.data(), MPI_INT, sent.size());
+        } else if (rank == 1) {
+            // Probing leaves the message to be received
+            wasm::doMpiProbe(world, rank, 2, &status);
+
+            MPI_Status recvStatus;
+            wasm::doMpiRecv(world,
+                            rank,
+                            2,
+                            (uint8_t*)received.data(),
+                            MPI_INT,
+                            received.size(),
+                            &recvStatus);
+        }
+    });
+
+    REQUIRE(status.MPI_SOURCE == 2);
+    REQUIRE(status.MPI_ERROR == MPI_SUCCESS);
+    REQUIRE(status.bytesSize == (int)(sent.size() * sizeof(int32_t)));
+    REQUIRE(received == sent);
+}
+
+TEST_CASE_METHOD(HostMpiTestFixture, "Test MPI wait any", "[wasm][mpi]")
+{
+    std::vector<int32_t> received(worldSize, -1);
+    std::vector<int> waitOrder;
+    std::vector<MPI_Status> statuses;
+    int lastIdx = 0;
+
+    runRanks([&](int rank) {
+        if (rank != 0) {
+            int32_t value = 10 * rank;
+            wasm::doMpiSend(world, rank, 0, (uint8_t*)&value, MPI_INT, 1);
+            return;
+        }
+
+        std::vector<int32_t> requestIds;
+        for (int r = 1; r < worldSize; r++) {
+            requestIds.push_back(wasm::doMpiIrecv(
+              world, rank, r, (uint8_t*)&received.at(r), MPI_INT, 1));
+        }
+
+        // Each call moves on to the next active request
+        for (int r = 1; r < worldSize; r++) {
+            MPI_Status status;
+            status.MPI_ERROR = -1;
+            status.bytesSize = -1;
+            waitOrder.push_back(wasm::doMpiWaitAny(
+              world, requestIds.data(), requestIds.size(), &status));
+            statuses.push_back(status);
+        }
+
+        lastIdx =
+          wasm::doMpiWaitAny(world, requestIds.data(), requestIds.size());
+    });
+
+    REQUIRE(waitOrder == std::vector<int>({ 0, 1, 2 }));
+    REQUIRE(lastIdx == -1);
+    for (const auto& status : statuses) {
+        REQUIRE(status.MPI_ERROR == MPI_SUCCESS);
+        REQUIRE(status.bytesSize == (int)sizeof(int32_t));
+    }
+    REQUIRE(received == std::vector<int32_t>({ -1, 10, 20, 30 }));
+}
+
+TEST_CASE_METHOD(HostMpiTestFixture,
+                 "Test MPI comm split checks",
+                 "[wasm][mpi]")
+{
+    std::vector<int32_t> colors(worldSize, 3);
+    std::vector<int32_t> keys = { 0, 1, 1, 5 };
+    bool supported = true;
+
+    SECTION("Same color, keys in order")
+    {
+        supported = true;
+    }
+
+    SECTION("Different colors")
+    {
+        colors.at(2) = 4;
+        supported = false;
+    }
+
+    SECTION("Keys out of order")
+    {
+        keys.at(3) = 0;
+        supported = false;
+    }
+
+    // Every rank gathers all colors and keys, as the host interface does
+    std::vector<int> nThrown(worldSize, 0);
+    runRanks([&](int rank) {
+        int32_t colorKey[2] = { colors.at(rank), keys.at(rank) };
+        std::vector<int32_t> colorKeys(2 * worldSize);
+        std::vector<int32_t> recvDispls(worldSize);
+        for (int r = 0; r < worldSize; r++) {
+            recvDispls.at(r) = 2 * r;
+        }
+
+        wasm::doMpiAllToAllV(world,
+                             rank,
+                             (uint8_t*)colorKey,
+                             std::vector<int32_t>(worldSize, 2),
+                             std::vector<int32_t>(worldSize, 0),
+                             MPI_INT,
+                             (uint8_t*)colorKeys.data(),
+                             std::vector<int32_t>(worldSize, 2),
+                             recvDispls,
+                             MPI_INT,
+                             faabric::mpi::MpiMessageType::ALLGATHER);
+
+        try {
+            wasm::checkMpiCommSplit(colorKeys);
+        } catch (std::runtime_error& e) {
+            nThrown.at(rank) = 1;
+        }
+    });
+
+    std::vector<int> expected(worldSize, supported ? 0 : 1);
+    REQUIRE(nThrown == expected);
+}
+}
@@ -4,6 +4,7 @@
 #include "fixtures.h"
 #include "utils.h"
 
+#include <faabric/executor/ExecutorContext.h>
 #include <faabric/proto/faabric.pb.h>
 #include <faabric/scheduler/Scheduler.h>
 #include <faabric/snapshot/SnapshotRegistry.h>
@@ -11,6 +12,11 @@
 #include <faabric/util/environment.h>
 #include <faabric/util/func.h>
 #include <faabric/util/string_tools.h>
+#include <threads/ThreadState.h>
+#include <wasm/openmp.h>
+
+#include <atomic>
+#include <thread>
 
 // Longer timeout to allow longer-running functions to finish even when doing
 // trace-level logging
@@ -470,4 +476,264 @@ TEST_CASE_METHOD(OpenMPTestFixture,
     REQUIRE(result.returnvalue() > 0);
 #endif
 }
+
+TEST_CASE_METHOD(OpenMPTestFixture,
+                 "Test OpenMP dispatch loop scheduling",
+                 "[wasm][openmp]")
+{
+    int nThreads = 4;
+    int32_t schedule = 0;
+    int32_t lower = 0;
+    int32_t upper = 99;
+    int32_t stride = 1;
+    int32_t chunk = 0;
+
+    SECTION("Dynamic")
+    {
+        schedule = 35;
+        chunk = 3;
+    }
+
+    SECTION("Guided")
+    {
+        schedule = 36;
+        chunk = 2;
+    }
+
+    SECTION("Runtime defaults to static") { schedule = 37; }
+
+    SECTION("Non-monotonic dynamic with negative stride")
+    {
+        schedule = 35 | (1 << 30);
+        lower = 50;
+        upper = -49;
+        stride = -1;
+        chunk = 7;
+    }
+
+    SECTION("Empty loop")
+    {
+        schedule = 35;
+        lower = 1;
+        upper = 0;
+    }
+
+    std::vector<int32_t> expected;
+    for (int32_t i = lower; stride > 0 ? i <= upper : i >= upper; i += stride) {
+        expected.push_back(i);
+    }
+
+    // Run the loop on each thread in the team, recording the iterations
+    auto level = std::make_shared<threads::Level>(nThreads);
+    std::mutex mx;
+    std::vector<int32_t> actual;
+    int nLastIters = 0;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+        threads.emplace_back([&, t] {
+            auto req = faabric::util::batchExecFactory("omp", "dispatch", 1);
+            req->mutable_messages(0)->set_appidx(t);
+            req->mutable_messages(0)->set_groupid(1234);
+            faabric::executor::ExecutorContext::set(nullptr, req, 0);
+            threads::setCurrentOpenMPLevel(level);
+
+            wasm::doOpenMPDispatchInit4(
+              0, t, schedule, lower, upper, stride, chunk);
+
+            int32_t lastIter = 0;
+            int32_t lb = 0;
+            int32_t ub = 0;
+            int32_t st = 0;
+            std::vector<int32_t> iters;
+            int nLast = 0;
+            while (
+              wasm::doOpenMPDispatchNext4(0, t, &lastIter, &lb, &ub, &st)) {
+                for (int32_t i = lb; st > 0 ? i <= ub : i >= ub; i += st) {
+                    iters.push_back(i);
+                }
+                nLast += lastIter;
+            }
+
+            faabric::util::UniqueLock lock(mx);
+            actual.insert(actual.end(), iters.begin(), iters.end());
+            nLastIters += nLast;
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    // Check each iteration ran exactly once
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    REQUIRE(actual == expected);
+    REQUIRE(nLastIters == (expected.empty() ? 0 : 1));
+}
+
+TEST_CASE_METHOD(OpenMPTestFixture,
+                 "Test OpenMP tree reductions",
+                 "[wasm][openmp]")
+{
+    int nThreads = 0;
+    bool barrier = false;
+
+    SECTION("Power of two, blocking")
+    {
+        nThreads = 4;
+        barrier = true;
+    }
+
+    SECTION("Odd number, non-blocking") { nThreads = 5; }
+
+    SECTION("Many threads, blocking")
+    {
+        nThreads = 9;
+        barrier = true;
+    }
+
+    // Each thread's private data is an index into the values, and the
+    // reduction function adds one to the other
+    int nReductions = 3;
+    std::vector<int64_t> values(nThreads, 0);
+    auto reduceFunc = [&values](int32_t lhs, int32_t rhs) {
+        values.at(lhs) += values.at(rhs);
+    };
+
+    auto level = std::make_shared<threads::Level>(nThreads);
+    std::vector<int64_t> results(nReductions, 0);
+    std::atomic<int> nRoots = 0;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+        threads.emplace_back([&, t] {
+            auto req = faabric::util::batchExecFactory("omp", "reduce", 1);
+            req->mutable_messages(0)->set_appidx(t);
+            req->mutable_messages(0)->set_groupid(2345);
+            faabric::executor::ExecutorContext::set(nullptr, req, 0);
+            threads::setCurrentOpenMPLevel(level);
+            faabric::Message* msg = &req->mutable_messages()->at(0);
+
+            for (int r = 0; r < nReductions; r++) {
+                values.at(t) = (r + 1) * (t + 1);
+
+                if (wasm::doOpenMPStartReduce(
+                      msg, level, t, reduceFunc, barrier) == 1) {
+                    results.at(r) = values.at(t);
+                    nRoots++;
+                    wasm::doOpenMPEndReduce(msg, barrier);
+                }
+            }
+
+            wasm::doOpenMPFinishThread(msg);
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    REQUIRE(nRoots == nReductions);
+
+    for (int r = 0; r < nReductions; r++) {
+        REQUIRE(results.at(r) == (r + 1) * nThreads * (nThreads + 1) / 2);
+    }
+}
+
+TEST_CASE_METHOD(OpenMPTestFixture,
+                 "Test OpenMP critical sections on a single host",
+                 "[wasm][openmp]")
+{
+    int nThreads = 4;
+    int nIters = 1000;
+
+    // Not atomic, so updates would be lost without mutual exclusion
+    int counter = 0;
+    int nestedCounter = 0;
+
+    auto level = std::make_shared<threads::Level>(nThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+        threads.emplace_back([&, t] {
+            auto req = faabric::util::batchExecFactory("omp", "critical", 1);
+            req->mutable_messages(0)->set_appidx(t);
+            req->mutable_messages(0)->set_groupid(3456);
+            faabric::executor::ExecutorContext::set(nullptr, req, 0);
+            threads::setCurrentOpenMPLevel(level);
+
+            for (int i = 0; i < nIters; i++) {
+                wasm::doOpenMPCritical(0, t, 0);
+                counter++;
+
+                // Nested critical sections must not deadlock
+                if (i % 10 == 0) {
+                    wasm::doOpenMPCritical(0, t, 1);
+                    nestedCounter++;
+                    wasm::doOpenMPEndCritical(0, t, 1);
+                }
+
+                wasm::doOpenMPEndCritical(0, t, 0);
+            }
+
+            wasm::doOpenMPFinishThread(&req->mutable_messages()->at(0));
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    REQUIRE(counter == nThreads * nIters);
+    REQUIRE(nestedCounter == nThreads * nIters / 10);
+}
+
+TEST_CASE_METHOD(OpenMPTestFixture,
+                 "Test OpenMP teams are removed when threads throw",
+                 "[wasm][openmp]")
+{
+    int groupId = 4567;
+
+    // Runs a team in which the given thread throws, each thread entering a
+    // critical section to make sure it's a member of the team
+    auto runTeam = [groupId](int nThreads, int throwingThread) {
+        auto level = std::make_shared<threads::Level>(nThreads);
+        std::atomic<int> nThrown = 0;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nThreads; t++) {
+            threads.emplace_back([&, t] {
+                auto req = faabric::util::batchExecFactory("omp", "throw", 1);
+                req->mutable_messages(0)->set_appidx(t);
+                req->mutable_messages(0)->set_groupid(groupId);
+                faabric::executor::ExecutorContext::set(nullptr, req, 0);
+                threads::setCurrentOpenMPLevel(level);
+
+                try {
+                    wasm::OpenMPThreadScope scope(
+                      &req->mutable_messages()->at(0));
+                    wasm::doOpenMPCritical(0, t, 0);
+                    wasm::doOpenMPEndCritical(0, t, 0);
+
+                    if (t == throwingThread) {
+                        throw std::runtime_error("Thread failed");
+                    }
+                } catch (std::runtime_error&) {
+                    nThrown++;
+                }
+            });
+        }
+
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        return nThrown.load();
+    };
+
+    REQUIRE(runTeam(2, 1) == 1);
+
+    // Check a bigger team with the same group doesn't pick up the old one,
+    // which would not know about its new members
+    REQUIRE(runTeam(3, -1) == 0);
+}
 }
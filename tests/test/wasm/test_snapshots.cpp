@@ -1,15 +1,20 @@
 #include <catch2/catch.hpp>
 
+#include "faasm_fixtures.h"
 #include "fixtures.h"
 #include "utils.h"
 
 #include <boost/filesystem.hpp>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
 
 #include <faabric/proto/faabric.pb.h>
 #include <faabric/runner/FaabricMain.h>
 #include <faabric/snapshot/SnapshotClient.h>
 #include <faabric/util/config.h>
 #include <faabric/util/environment.h>
+#include <faabric/util/files.h>
 #include <faabric/util/func.h>
 #include <faabric/util/memory.h>
 #include <faabric/util/snapshot.h>
@@ -17,6 +22,8 @@
 
 #include <conf/FaasmConfig.h>
 #include <faaslet/Faaslet.h>
+#include <wasm/SparseSnapshot.h>
+#include <wasm/migration.h>
 #include <wavm/WAVMWasmModule.h>
 
 using namespace wasm;
@@ -28,6 +35,7 @@ class WasmSnapTestFixture
   , public SchedulerFixture
   , public SnapshotRegistryFixture
   , public ConfFixture
+  , public FaasmConfTestFixture
 {
   public:
     WasmSnapTestFixture() { wasm::getWAVMModuleCache().clear(); }
@@ -213,4 +221,232 @@ TEST_CASE_METHOD(WasmSnapTestFixture,
         f.shutdown();
     }
 }
+
+TEST_CASE_METHOD(WasmSnapTestFixture,
+                 "Test sparse snapshot and restore",
+                 "[wasm][snapshot]")
+{
+    faabric::Message m = faabric::util::messageFactory("demo", "echo");
+    size_t pageSize = faabric::util::HOST_PAGE_SIZE;
+
+    wasm::WAVMWasmModule moduleA;
+    moduleA.bindToFunction(m);
+
+    // Register a base snapshot and map it over memory, as on reset
+    std::string baseKey = "sparse-base";
+    reg.registerSnapshot(baseKey, moduleA.getSnapshotData());
+    moduleA.restore(baseKey);
+
+    // Check nothing is captured before memory is modified
+    REQUIRE(moduleA.getSparseSnapshotData(baseKey)->getOverlaySize() == 0);
+
+    // Modify two pages of the base, and rewrite a third with the same data
+    volatile uint8_t* memBase = moduleA.getMemoryBase();
+    memBase[pageSize + 1] = memBase[pageSize + 1] + 1;
+    memBase[3 * pageSize] = memBase[3 * pageSize] + 1;
+    memBase[3 * pageSize + 5] = memBase[3 * pageSize + 5] + 1;
+    memBase[5 * pageSize] = memBase[5 * pageSize];
+
+    // Modify a page above the base
+    uint32_t grownPtr = moduleA.growMemory(WASM_BYTES_PER_PAGE);
+    moduleA.wasmPointerToNative(grownPtr)[10] = 7;
+
+    std::shared_ptr<wasm::SparseSnapshot> snap;
+    SECTION("Memory mapped from base")
+    {
+        snap = moduleA.getSparseSnapshotData(baseKey);
+    }
+
+    SECTION("Memory not mapped from base")
+    {
+        moduleA.setMappedSnapshotKey("");
+        snap = moduleA.getSparseSnapshotData(baseKey);
+    }
+
+    // Check only the modified pages are captured
+    REQUIRE(snap->baseKey == baseKey);
+    REQUIRE(snap->size == moduleA.getMemorySizeBytes());
+    REQUIRE(snap->getOverlaySize() == 3 * pageSize);
+
+    const auto& runs = snap->getRuns();
+    REQUIRE(runs.size() == 3);
+    REQUIRE(runs.at(0).offset == pageSize);
+    REQUIRE(runs.at(1).offset == 3 * pageSize);
+    REQUIRE(runs.at(2).offset == grownPtr);
+
+    // Restore in another module with different memory and check it matches
+    wasm::WAVMWasmModule moduleB;
+    moduleB.bindToFunction(m);
+    moduleB.growMemory(2 * WASM_BYTES_PER_PAGE);
+    std::memset(moduleB.getMemoryBase(), 1, moduleB.getMemorySizeBytes());
+
+    moduleB.restoreSparse(*snap);
+
+    size_t memSize = moduleA.getMemorySizeBytes();
+    REQUIRE(moduleB.getMemorySizeBytes() == memSize);
+    REQUIRE(std::memcmp(moduleA.getMemoryBase(),
+                        moduleB.getMemoryBase(),
+                        memSize) == 0);
+
+    // Check restoring from a sparse snapshot leaves it cheap to take again
+    REQUIRE(moduleB.getSparseSnapshotData(baseKey)->getOverlaySize() ==
+            3 * pageSize);
+}
+
+TEST_CASE_METHOD(WasmSnapTestFixture,
+                 "Test sparse snapshot of mapped files",
+                 "[wasm][snapshot]")
+{
+    faabric::Message m = faabric::util::messageFactory("demo", "echo");
+    size_t pageSize = faabric::util::HOST_PAGE_SIZE;
+
+    wasm::WAVMWasmModule moduleA;
+    moduleA.bindToFunction(m);
+
+    std::string baseKey = "sparse-mapped-base";
+    reg.registerSnapshot(baseKey, moduleA.getSnapshotData());
+    moduleA.restore(baseKey);
+
+    // Mapped file pages are never written to, so they must be captured even
+    // though memory was mapped from the base
+    std::string fileName = "/tmp/sparse_mapped_file.bin";
+    std::vector<uint8_t> contents(2 * pageSize, 7);
+    faabric::util::writeBytesToFile(fileName, contents);
+    int fd = open(fileName.c_str(), O_RDONLY);
+    REQUIRE(fd > 0);
+
+    uint32_t wasmPtr = moduleA.mmapFile(fd, contents.size());
+    close(fd);
+
+    auto snap = moduleA.getSparseSnapshotData(baseKey);
+    REQUIRE(snap->getOverlaySize() == contents.size());
+
+    wasm::WAVMWasmModule moduleB;
+    moduleB.bindToFunction(m);
+    moduleB.restoreSparse(*snap);
+
+    uint8_t* mappedPtr = moduleB.wasmPointerToNative(wasmPtr);
+    std::vector<uint8_t> actual(mappedPtr, mappedPtr + contents.size());
+    REQUIRE(actual == contents);
+
+    remove(fileName.c_str());
+}
+
+TEST_CASE_METHOD(WasmSnapTestFixture,
+                 "Test migration delta snapshots",
+                 "[wasm][snapshot]")
+{
+    faabric::Message m = faabric::util::messageFactory("demo", "echo");
+    size_t pageSize = faabric::util::HOST_PAGE_SIZE;
+    int msgId = 123;
+
+    wasm::WAVMWasmModule moduleA;
+    moduleA.bindToFunction(m);
+
+    // Register a reset snapshot and map it over memory, as on reset
+    std::string baseKey = "delta-base";
+    reg.registerSnapshot(baseKey, moduleA.getSnapshotData());
+    moduleA.restore(baseKey);
+    moduleA.setResetSnapshotKey(baseKey);
+
+    // Modify a page of the base and one above it
+    uint8_t* memBase = moduleA.getMemoryBase();
+    memBase[2 * pageSize + 3] = memBase[2 * pageSize + 3] + 1;
+    uint32_t grownPtr = moduleA.growMemory(WASM_BYTES_PER_PAGE);
+    moduleA.wasmPointerToNative(grownPtr)[10] = 7;
+
+    SECTION("Delta migration off")
+    {
+        faasmConf.deltaMigration = "off";
+
+        auto [snapKey, snap] = takeMigrationSnapshot(moduleA, msgId);
+        REQUIRE(snapKey == "migration_123");
+        REQUIRE(!isMigrationDelta(snapKey));
+        REQUIRE(snap->getSize() == moduleA.getMemorySizeBytes());
+    }
+
+    SECTION("No reset snapshot")
+    {
+        moduleA.setResetSnapshotKey("");
+
+        auto [snapKey, snap] = takeMigrationSnapshot(moduleA, msgId);
+        REQUIRE(snapKey == "migration_123");
+        REQUIRE(snap->getSize() == moduleA.getMemorySizeBytes());
+    }
+
+    SECTION("Delta migration")
+    {
+        auto [snapKey, snap] = takeMigrationSnapshot(moduleA, msgId);
+        REQUIRE(snapKey == "migration_delta_123");
+        REQUIRE(isMigrationDelta(snapKey));
+
+        // Check the delta is small, and can be mapped over memory
+        REQUIRE(snap->getSize() == WASM_BYTES_PER_PAGE);
+        reg.registerSnapshot(snapKey, snap);
+
+        wasm::WAVMWasmModule moduleB;
+        moduleB.bindToFunction(m);
+        moduleB.growMemory(2 * WASM_BYTES_PER_PAGE);
+        std::memset(moduleB.getMemoryBase(), 1, moduleB.getMemorySizeBytes());
+
+        // The executor maps the delta over memory before it is restored
+        moduleB.restore(snapKey);
+
+        SECTION("Same base snapshot")
+        {
+            restoreMigrationDelta(moduleB, snapKey);
+
+            size_t memSize = moduleA.getMemorySizeBytes();
+            REQUIRE(moduleB.getMemorySizeBytes() == memSize);
+            REQUIRE(std::memcmp(moduleA.getMemoryBase(),
+                                moduleB.getMemoryBase(),
+                                memSize) == 0);
+        }
+
+        SECTION("Different base snapshot")
+        {
+            reg.registerSnapshot(baseKey, moduleB.getSnapshotData());
+
+            REQUIRE_THROWS(restoreMigrationDelta(moduleB, snapKey));
+        }
+    }
+}
+
+TEST_CASE("Test concurrent sparse snapshot serialisation", "[wasm][snapshot]")
+{
+    // Several chunks per snapshot, so that each one asks for many threads
+    size_t nChunks = 6;
+    size_t memSize = nChunks * SPARSE_SNAPSHOT_CHUNK_SIZE;
+    std::vector<uint8_t> pages(memSize);
+    for (size_t i = 0; i < pages.size(); i++) {
+        pages.at(i) = (uint8_t)((i / 7) % 251);
+    }
+
+    wasm::SparseSnapshot snap("concurrent-base", memSize);
+    snap.addPages(0, pages);
+
+    // Serialise from more threads than there are cores, each asking for more
+    // threads than there are cores, and check the results are all the same
+    int nCallers = 2 * faabric::util::getUsableCores();
+    int nThreadsEach = 4 * faabric::util::getUsableCores();
+    std::vector<std::vector<uint8_t>> results(nCallers);
+    std::vector<std::thread> callers;
+    for (int i = 0; i < nCallers; i++) {
+        callers.emplace_back([&snap, &results, i, nThreadsEach] {
+            std::vector<uint8_t> bytes = snap.toBytes(nThreadsEach);
+            results.at(i) = wasm::SparseSnapshot::fromBytes(bytes, nThreadsEach)
+                              ->getRuns()
+                              .at(0)
+                              .data;
+        });
+    }
+
+    for (auto& t : callers) {
+        t.join();
+    }
+
+    for (const auto& result : results) {
+        REQUIRE(result == pages);
+    }
+}
 }
@@ -0,0 +1,189 @@
+#include <catch2/catch.hpp>
+
+#include <wasm/WasmExecutionContext.h>
+#include <wasm/threads.h>
+#include <wavm/WAVMWasmModule.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace tests {
+
+class PthreadSyncTestFixture
+{
+  public:
+    // Waits for the condition to hold, giving up after a while so that a lost
+    // wakeup fails the test rather than hanging it
+    bool waitFor(const std::function<bool()>& condition)
+    {
+        auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return true;
+    }
+
+    // Calls the function with the mutex held
+    void withMutex(const std::function<void()>& f)
+    {
+        wasm::doPthreadMutexLock(mutex);
+        f();
+        wasm::doPthreadMutexUnlock(mutex);
+    }
+
+  protected:
+    wasm::WAVMWasmModule module;
+
+    int32_t mutex = 1024;
+    int32_t cond = 2048;
+};
+
+TEST_CASE_METHOD(PthreadSyncTestFixture,
+                 "Test pthread condition variable signal",
+                 "[wasm][threads]")
+{
+    wasm::WasmExecutionContext ctx(&module);
+
+    // Both only touched with the mutex held
+    bool waiting = false;
+    bool ready = false;
+    std::atomic<bool> done = false;
+
+    std::thread waiter([&] {
+        wasm::WasmExecutionContext waiterCtx(&module);
+        wasm::doPthreadMutexLock(mutex);
+        waiting = true;
+        while (!ready) {
+            wasm::doPthreadCondWait(cond, mutex);
+        }
+        wasm::doPthreadMutexUnlock(mutex);
+        done = true;
+    });
+
+    // The waiter only releases the mutex once it is inside the wait
+    REQUIRE(waitFor([&] {
+        bool isWaiting = false;
+        withMutex([&] { isWaiting = waiting; });
+        return isWaiting;
+    }));
+
+    withMutex([&] {
+        ready = true;
+        wasm::doPthreadCondSignal(cond);
+    });
+
+    bool woken = waitFor([&] { return done.load(); });
+    if (!woken) {
+        wasm::doPthreadCondBroadcast(cond);
+    }
+    waiter.join();
+
+    REQUIRE(woken);
+}
+
+TEST_CASE_METHOD(PthreadSyncTestFixture,
+                 "Test pthread condition variable broadcast",
+                 "[wasm][threads]")
+{
+    wasm::WasmExecutionContext ctx(&module);
+
+    int nWaiters = 6;
+
+    // Both only touched with the mutex held
+    int nWaiting = 0;
+    bool ready = false;
+    std::atomic<int> nDone = 0;
+
+    std::vector<std::thread> waiters;
+    for (int i = 0; i < nWaiters; i++) {
+        waiters.emplace_back([&] {
+            wasm::WasmExecutionContext waiterCtx(&module);
+            wasm::doPthreadMutexLock(mutex);
+            nWaiting++;
+            while (!ready) {
+                wasm::doPthreadCondWait(cond, mutex);
+            }
+            wasm::doPthreadMutexUnlock(mutex);
+            nDone++;
+        });
+    }
+
+    REQUIRE(waitFor([&] {
+        int n = 0;
+        withMutex([&] { n = nWaiting; });
+        return n == nWaiters;
+    }));
+
+    // A single broadcast must wake every waiter
+    withMutex([&] {
+        ready = true;
+        wasm::doPthreadCondBroadcast(cond);
+    });
+
+    bool woken = waitFor([&] { return nDone.load() == nWaiters; });
+    while (nDone.load() < nWaiters) {
+        wasm::doPthreadCondBroadcast(cond);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    for (auto& t : waiters) {
+        t.join();
+    }
+
+    REQUIRE(woken);
+}
+
+TEST_CASE_METHOD(PthreadSyncTestFixture,
+                 "Test pthread condition variable wakeups are not lost",
+                 "[wasm][threads]")
+{
+    // Two threads take turns, each signalling the other as soon as it has
+    // released the mutex in its wait. Many of these signals land between the
+    // waiter reading the sequence number and blocking on it, and losing any of
+    // them would leave both threads waiting forever
+    int nRounds = 20000;
+
+    // Only touched with the mutex held
+    int turn = 0;
+    bool stop = false;
+
+    std::atomic<int> nFinished = 0;
+    auto player = [&](int me) {
+        wasm::WasmExecutionContext playerCtx(&module);
+        for (int r = 0; r < nRounds; r++) {
+            wasm::doPthreadMutexLock(mutex);
+            while (turn != me && !stop) {
+                wasm::doPthreadCondWait(cond, mutex);
+            }
+            turn = 1 - me;
+            wasm::doPthreadCondSignal(cond);
+            wasm::doPthreadMutexUnlock(mutex);
+        }
+        nFinished++;
+    };
+
+    std::thread playerA(player, 0);
+    std::thread playerB(player, 1);
+
+    wasm::WasmExecutionContext ctx(&module);
+    bool finished = waitFor([&] { return nFinished.load() == 2; });
+    if (!finished) {
+        withMutex([&] { stop = true; });
+        wasm::doPthreadCondBroadcast(cond);
+    }
+
+    playerA.join();
+    playerB.join();
+
+    REQUIRE(finished);
+}
+}
@@ -6,6 +6,7 @@
 #include <faabric/util/func.h>
 #include <faabric/util/memory.h>
 #include <faabric/util/state.h>
+#include <wasm/state.h>
 #include <wavm/WAVMWasmModule.h>
 
 using namespace WAVM;
@@ -86,4 +87,60 @@ TEST_CASE_METHOD(WasmStateTestFixture,
     std::vector<uint8_t> expectedB2 = { 1, 1, 1, 1, 1, markerB2, 1 };
     checkMapping(moduleB, kv, offsetB2 - 5, 7, expectedB2);
 }
+
+TEST_CASE_METHOD(WasmStateTestFixture, "Test batched state calls", "[wasm]")
+{
+    const std::string user = "demo";
+    int nKeys = 40;
+    int valueLen = 8;
+
+    // Write whole values for each key, then overwrite part of the first one
+    std::vector<std::vector<uint8_t>> values;
+    std::vector<wasm::StateBatchEntry> writes;
+    for (int i = 0; i < nKeys; i++) {
+        values.emplace_back(valueLen, (uint8_t)i);
+    }
+    for (int i = 0; i < nKeys; i++) {
+        writes.push_back({ "batch_" + std::to_string(i),
+                           (uint32_t)valueLen,
+                           0,
+                           values.at(i).data(),
+                           (uint32_t)valueLen });
+    }
+
+    std::vector<uint8_t> chunk = { 7, 7 };
+    writes.push_back({ "batch_0", (uint32_t)valueLen, 2, chunk.data(), 2 });
+    wasm::doFaasmWriteStateBatch(user, writes);
+    wasm::doFaasmPushStateBatch(
+      user, { "batch_0", "batch_0", "batch_1" }, true);
+
+    std::vector<std::vector<uint8_t>> expected = values;
+    expected.at(0).at(2) = 7;
+    expected.at(0).at(3) = 7;
+    for (int i = 0; i < nKeys; i++) {
+        auto kv = state.getKV(user, "batch_" + std::to_string(i), valueLen);
+        std::vector<uint8_t> actual(valueLen, 0);
+        kv->get(actual.data());
+        REQUIRE(actual == expected.at(i));
+    }
+
+    // Read back whole values and chunks
+    std::vector<std::vector<uint8_t>> actual(nKeys,
+                                             std::vector<uint8_t>(valueLen));
+    std::vector<uint8_t> actualChunk(3, 0);
+    std::vector<wasm::StateBatchEntry> reads;
+    for (int i = 0; i < nKeys; i++) {
+        reads.push_back({ "batch_" + std::to_string(i),
+                          (uint32_t)valueLen,
+                          0,
+                          actual.at(i).data(),
+                          (uint32_t)valueLen });
+    }
+    reads.push_back(
+      { "batch_0", (uint32_t)valueLen, 1, actualChunk.data(), 3 });
+    wasm::doFaasmReadStateBatch(user, reads);
+
+    REQUIRE(actual == expected);
+    REQUIRE(actualChunk == std::vector<uint8_t>({ 0, 7, 7 }));
+}
 }
@@ -6,6 +6,7 @@
 #include <conf/FaasmConfig.h>
 #include <faabric/runner/FaabricMain.h>
 #include <faaslet/Faaslet.h>
+#include <storage/ArtifactCache.h>
 #include <storage/FileLoader.h>
 #include <storage/S3Wrapper.h>
 #include <storage/SharedFiles.h>
@@ -34,7 +35,9 @@ class FaasmConfTestFixture
 };
 
 /**
- * Fixture that sets up a dummy S3 bucket and deletes it after each test.
+ * Fixture that sets up a dummy S3 bucket and deletes it after each test. The
+ * index of locally cached artifacts is reset too, as tests change the
+ * artifacts behind it.
  */
 class S3TestFixture : public FaasmConfTestFixture
 {
@@ -43,9 +46,14 @@ class S3TestFixture : public FaasmConfTestFixture
     {
         faasmConf.s3Bucket = "faasm-test";
         s3.createBucket(faasmConf.s3Bucket);
+        storage::getArtifactCache().clear();
     };
 
-    ~S3TestFixture() { s3.deleteBucket(faasmConf.s3Bucket); };
+    ~S3TestFixture()
+    {
+        storage::getArtifactCache().clear();
+        s3.deleteBucket(faasmConf.s3Bucket);
+    };
 
   protected:
     storage::S3Wrapper s3;
@@ -111,12 +119,14 @@ class FunctionExecTestFixture
       , m(fac)
     {
         wasm::WAMRWasmModule::initialiseWAMRGlobally();
+        storage::getArtifactCache().clear();
         m.startRunner();
     }
 
     ~FunctionExecTestFixture()
     {
         m.shutdown();
+        storage::getArtifactCache().clear();
         wasm::WAMRWasmModule::destroyWAMRGlobally();
     }
 